@@ -9,12 +9,14 @@
 
 #define NDTF_SIGNATURE "NDTF"
 #define NDTF_CREATE_VERSION(major, minor) ( ((major & 0xFF) << 8) | (minor & 0xFF) )
-#define NDTF_VERSION_MAJOR 1
-#define NDTF_VERSION_MINOR 0
+#define NDTF_VERSION_MAJOR 2
+#define NDTF_VERSION_MINOR 2
 #define NDTF_VERSION NDTF_CREATE_VERSION(NDTF_VERSION_MAJOR, NDTF_VERSION_MINOR)
 #define NDTF_EXTRACT_VERSION_MAJOR(version) ( (version & 0xFF00) >> 8 )
 #define NDTF_EXTRACT_VERSION_MINOR(version) ( (version & 0x00FF) >> 0 )
 
+#define NDTF_DEFAULT_ALIGNMENT 64
+
 typedef enum NDTF_Dimensions
 {
 	NDTF_DIMENSIONS_TWO = 2,
@@ -40,6 +42,11 @@ typedef enum NDTF_TexelFormat
 	NDTF_TEXELFORMAT_RGBA32323232,		// RGBA UNSIGNED_INTEGER	(0-4294967295)
 	NDTF_TEXELFORMAT_RGB323232,			// RGB UNSIGNED_INTEGER		(0-4294967295)
 	NDTF_TEXELFORMAT_R32,				// R UNSIGNED_INTEGER		(0-4294967295)
+	// (v1.3, v2.2) 4x4 blocks of every slice, x-fastest. stored as one payload, never segmented, lossy or planar
+	NDTF_TEXELFORMAT_BC4,				// R BLOCKS					(8 bytes, decodes to R8)
+	NDTF_TEXELFORMAT_BC5,				// RG BLOCKS				(16 bytes, decodes to RGB888 with B = 0)
+	NDTF_TEXELFORMAT_BC6H,				// RGB BLOCKS				(16 bytes, unsigned half floats, decodes to RGB323232F)
+	NDTF_TEXELFORMAT_BC7,				// RGBA BLOCKS				(16 bytes, decodes to RGBA8888)
 
 	NDTF_TEXELFORMAT_XYZW32323232F = NDTF_TEXELFORMAT_RGBA32323232F,		// (alias) XYZW FLOAT				(-INF - INF)
 	NDTF_TEXELFORMAT_XYZ323232F = NDTF_TEXELFORMAT_RGB323232F,				// (alias) XYZ FLOAT				(-INF - INF)
@@ -49,6 +56,7 @@ typedef enum NDTF_Channels
 {
 	NDTF_CHANNELS_NONE = 0,
 	NDTF_CHANNELS_R = 1,
+	NDTF_CHANNELS_RG = 2,
 	NDTF_CHANNELS_RGB = 3,
 	NDTF_CHANNELS_RGBA = 4,
 	NDTF_CHANNELS_XYZ = NDTF_CHANNELS_RGB,
@@ -57,10 +65,19 @@ typedef enum NDTF_Channels
 
 typedef struct NDTF_Flags
 {
-	uint32_t zlib_compression : 1;
-	uint32_t __unused__ : 31;
+	uint32_t codec : 4;				// enum NDTF_Codec of the payload, 1 (zlib) matches the former zlib_compression bit
+	uint32_t lossy : 1;				// (v1.1) float channels are error bounded lossy encoded, see NDTF_ErrorBound
+	uint32_t deltaAxis : 3;			// (v1.1) bricks hold differences to the previous slice along axis deltaAxis - 1, 0 = off (implies segmented)
+	uint32_t segmented : 1;			// (v1.1) payload is a segment table followed by independently encoded bricks
+	uint32_t checksums : 1;			// (v1.1) header, segment table and segments carry CRC32C checksums (implies segmented)
+	uint32_t zoneMaps : 1;			// (v1.1) the segment table is followed by per brick value ranges, see NDTF_ZoneMapTable (implies segmented)
+	uint32_t deduplicated : 1;		// (v1.1) bricks with identical texels share one stored segment (implies segmented)
+	uint32_t planar : 1;			// (v1.2, v2.1) each channel is stored as a contiguous plane, per brick of segmented files
+	uint32_t __unused__ : 19;
 } NDTF_Flags;
 
+// v2.0 files store the header as laid out here. v1.x files store the extents as uint16 in a 32 byte header,
+// they are written whenever every extent fits
 typedef struct NDTF_Header
 {
 	char signature[4];	// NDTF_SIGNATURE (NDTF)
@@ -70,12 +87,105 @@ typedef struct NDTF_Header
 	NDTF_Flags flags;
 	union
 	{
-		struct { uint16_t size[NDTF_DIMENSIONS_MAX]; };
-		struct { uint16_t width, height, depth, ind, ind2; };
-	}; // size (width, height, depth, ind, ind2)
-	uint8_t __padding__[10];
+		struct { uint32_t size[NDTF_DIMENSIONS_MAX]; };
+		struct { uint32_t width, height, depth, ind, ind2; };
+	}; // size (width, height, depth, ind, ind2), (v2.0) 32 bit
+	uint8_t brickSize[NDTF_DIMENSIONS_MAX];	// (v1.1) brick extent per axis of segmented files, 0 = whole axis, n = 2^(n - 1)
+	uint8_t keyframeInterval;	// (v1.1) flags.deltaAxis: every n-th slice is stored whole, 0 = only the first
+	uint8_t __padding__[2];
+	uint32_t checksum;	// (v1.1) CRC32C of the header with this field set to 0 (flags.checksums)
 } NDTF_Header;
 
+// segment table of segmented files: NDTF_SegmentTable followed by one NDTF_Segment per brick,
+// bricks are ordered x-fastest and each holds its texels x-fastest. bricks of deduplicated files may share a segment
+typedef struct NDTF_SegmentTable
+{
+	uint64_t count;
+	uint32_t checksum;	// CRC32C of the segment entries (flags.checksums)
+	uint32_t __padding__;
+} NDTF_SegmentTable;
+
+// zone maps of files with flags.zoneMaps: NDTF_ZoneMapTable right after the segment entries, followed by one
+// NDTF_ValueRange per brick and channel (brick-major). ranges cover the decoded values, NaN is left out
+typedef struct NDTF_ZoneMapTable
+{
+	uint64_t count;		// bricks * channels
+	uint32_t checksum;	// CRC32C of the ranges (flags.checksums)
+	uint32_t __padding__;
+} NDTF_ZoneMapTable;
+
+typedef struct NDTF_ValueRange
+{
+	double min, max;	// min > max when the brick holds no values of the channel
+} NDTF_ValueRange;
+
+typedef enum NDTF_Codec
+{
+	NDTF_CODEC_NONE = 0,
+	NDTF_CODEC_ZLIB = 1,	// libdeflate zlib stream
+	NDTF_CODEC_DEFLATE = 2,	// (v1.1) libdeflate raw deflate stream
+	NDTF_CODEC_LZ = 3,		// (v1.1) bundled byte oriented LZ (LZ4 block format), fast decoding
+	NDTF_CODEC_USER = 8,	// first id available to ndtf_registerCodec
+	NDTF_CODEC_MAX = 15,
+} NDTF_Codec;
+
+typedef enum NDTF_ErrorBoundMode
+{
+	NDTF_ERRORBOUND_NONE = 0,	// lossless
+	NDTF_ERRORBOUND_ABSOLUTE,	// |decoded - value| <= bound
+	NDTF_ERRORBOUND_RELATIVE,	// |decoded - value| <= bound * (max - min) of the channel over the whole volume
+} NDTF_ErrorBoundMode;
+
+// error bound of the lossy mode per channel, recorded with every encoded stream
+typedef struct NDTF_ErrorBound
+{
+	uint8_t mode;	// enum NDTF_ErrorBoundMode
+	float bound[NDTF_CHANNELS_RGBA];
+} NDTF_ErrorBound;
+
+typedef struct NDTF_Segment
+{
+	uint64_t offset;	// from the start of the file
+	uint64_t size;		// stored size in bytes
+	uint32_t checksum;	// CRC32C of the stored bytes (flags.checksums)
+	uint8_t codec;		// enum NDTF_Codec
+	uint8_t __padding__[3];
+} NDTF_Segment;
+
+typedef enum NDTF_VerifyResult
+{
+	NDTF_VERIFY_OK = 0,
+	NDTF_VERIFY_NO_CHECKSUMS,	// well formed, but the file carries no checksums
+	NDTF_VERIFY_IO_ERROR,
+	NDTF_VERIFY_BAD_HEADER,
+	NDTF_VERIFY_BAD_SEGMENT_TABLE,
+	NDTF_VERIFY_BAD_SEGMENT,
+} NDTF_VerifyResult;
+
+typedef struct NDTF_CodecInfo
+{
+	const char* name;
+	size_t (*compressBound)(size_t size, void* user);
+	// returns the compressed size, 0 on failure. level 0 selects defaultLevel
+	size_t (*compress)(const void* src, size_t srcSize, void* dst, size_t dstCapacity, int level, void* user);
+	// must produce exactly dstSize bytes
+	bool (*decompress)(const void* src, size_t srcSize, void* dst, size_t dstSize, void* user);
+	int defaultLevel;
+	void* user;
+} NDTF_CodecInfo;
+
+typedef void* (*NDTF_AllocFunc)(size_t size, size_t alignment, void* user);
+typedef void* (*NDTF_ReallocFunc)(void* ptr, size_t oldSize, size_t newSize, size_t alignment, void* user);
+typedef void (*NDTF_FreeFunc)(void* ptr, void* user);
+
+typedef struct NDTF_Allocator
+{
+	NDTF_AllocFunc alloc;
+	NDTF_ReallocFunc realloc;	// optional, alloc + copy + free is used when NULL
+	NDTF_FreeFunc free;
+	void* user;
+} NDTF_Allocator;
+
 typedef struct NDTF_File
 {
 	NDTF_Header header;
@@ -87,17 +197,268 @@ typedef struct NDTF_File
 		uint32_t* data32b;
 		float* dataf;
 	}; // data
+	const NDTF_Allocator* allocator; // owner of data (NULL = global allocator)
+	NDTF_ErrorBound errorBound; // applied when saving with flags.lossy, filled on load
 } NDTF_File;
 
 typedef struct NDTF_Coord
 {
 	union
 	{
-		struct { uint16_t coord[NDTF_DIMENSIONS_MAX]; };
-		struct { uint16_t x, y, z, w, v; };
+		struct { uint32_t coord[NDTF_DIMENSIONS_MAX]; };
+		struct { uint32_t x, y, z, w, v; };
 	};
 } NDTF_Coord;
 
+typedef enum NDTF_Phase
+{
+	NDTF_PHASE_IO = 0,		// file reads/writes
+	NDTF_PHASE_HEADER,		// header parsing and validation
+	NDTF_PHASE_DECOMPRESS,
+	NDTF_PHASE_COMPRESS,
+	NDTF_PHASE_CONVERT,		// texel format conversion
+	NDTF_PHASE_ALLOCATE,
+	NDTF_PHASE_COUNT,
+} NDTF_Phase;
+
+typedef struct NDTF_PhaseStats
+{
+	uint64_t count;			// number of times the phase was entered
+	uint64_t bytes;			// bytes processed (read, written, produced or allocated)
+	uint64_t nanoseconds;	// total time spent in the phase
+} NDTF_PhaseStats;
+
+typedef struct NDTF_Stats
+{
+	NDTF_PhaseStats phases[NDTF_PHASE_COUNT];
+	uint64_t allocations;
+	uint64_t frees;
+} NDTF_Stats;
+
+// scope events, called around every instrumented phase (only when built with NDTF_INSTRUMENTATION)
+typedef void (*NDTF_ScopeBeginFunc)(NDTF_Phase phase, const char* name, void* user);
+typedef void (*NDTF_ScopeEndFunc)(NDTF_Phase phase, const char* name, uint64_t bytes, uint64_t nanoseconds, void* user);
+
+typedef struct NDTF_Instrumentation
+{
+	NDTF_ScopeBeginFunc begin;
+	NDTF_ScopeEndFunc end;
+	void* user;
+} NDTF_Instrumentation;
+
+typedef void (*NDTF_TaskFunc)(void* taskData, size_t index);
+
+typedef struct NDTF_Executor
+{
+	// must call task(taskData, i) for every i in [0, count) and only return once all of them have finished
+	void (*run)(NDTF_TaskFunc task, void* taskData, size_t count, void* user);
+	size_t concurrency;		// number of tasks that can run at the same time (0 = hardware concurrency)
+	void* user;
+} NDTF_Executor;
+
+// value statistics of one channel
+typedef struct NDTF_ChannelStats
+{
+	double min, max;		// over finite values, 0 without any
+	double sum, sumSquares;	// over finite values
+	uint64_t count;			// finite values
+	uint64_t nanCount;
+	uint64_t infCount;
+} NDTF_ChannelStats;
+
+// effort of the block encoder, blocks of every preset decode the same way
+typedef enum NDTF_BlockQuality
+{
+	NDTF_BLOCKQUALITY_DEFAULT = 0,	// NORMAL
+	NDTF_BLOCKQUALITY_FAST,			// endpoints from the principal axis, no refinement
+	NDTF_BLOCKQUALITY_NORMAL,		// least squares refinement of the endpoints
+	NDTF_BLOCKQUALITY_HIGH,			// more refinement, BC6H and BC7 also search the two subset partitions
+} NDTF_BlockQuality;
+
+// per channel value statistics, integer channels are reported in their stored range
+typedef struct NDTF_TexelStats
+{
+	NDTF_ChannelStats channels[NDTF_CHANNELS_RGBA];
+	uint32_t channelCount;
+	// optional histogram, set up by the caller: bins per channel over [low, high], values outside land in the
+	// edge bins. low == high selects the value range of integer formats and [0, 1] for float formats
+	uint32_t bins;
+	double low, high;
+	uint64_t* histogram;	// bins * channelCount counts, channel-major, owned by the caller
+} NDTF_TexelStats;
+
+// compiled pointwise transform, see ndtf_transform_create. as NDTF_Context.transform it is applied to the texels
+// of file, stack, staging and plane loads, saves, updates and stream output, which must have its format. saved
+// files are left unchanged. reader regions and channel loads are not transformed
+typedef struct NDTF_Transform NDTF_Transform;
+
+#define NDTF_DEFAULT_COMPRESSION_GAIN 0.05f
+
+// per-call settings for the *_ex functions. a NULL context uses the global defaults
+typedef struct NDTF_Context
+{
+	NDTF_Stats* stats;					// if set, statistics of the call are accumulated into it
+	const NDTF_Allocator* allocator;	// allocator for everything the call allocates (NULL = global allocator)
+	const NDTF_Executor* executor;		// executor for parallel work (NULL = global executor)
+	int compressionLevel;				// passed to the codec when saving (0 = codec default)
+	NDTF_TexelStats* texelStats;		// if set, computed on the fly over the loaded or saved texels
+	NDTF_BlockQuality blockQuality;		// effort of the block encoder when reformatting to a block compressed format
+	const NDTF_Transform* transform;	// applied to loaded and saved texels (NULL = none), see NDTF_Transform
+	float minCompressionGain;			// lossless segments and payloads that shrink by less than this fraction are stored raw (0 = NDTF_DEFAULT_COMPRESSION_GAIN, negative = always compressed). registered codecs always run
+} NDTF_Context;
+
+// zone maps of a file, read without touching the segments
+typedef struct NDTF_ZoneMaps
+{
+	NDTF_Header header;
+	size_t brickCount;
+	size_t channelCount;
+	NDTF_ValueRange* ranges;	// brickCount * channelCount, brick-major
+	const NDTF_Allocator* allocator;
+} NDTF_ZoneMaps;
+
+typedef struct NDTF_CatalogEntry
+{
+	const char* path;	// relative to the scanned directory, '/' separated
+	NDTF_Header header;
+	uint64_t fileSize;
+	int64_t mtime;		// nanoseconds since the epoch
+} NDTF_CatalogEntry;
+
+typedef struct NDTF_Catalog
+{
+	NDTF_CatalogEntry* entries;	// sorted by path
+	size_t count;
+	char* paths;
+	size_t pathsSize;
+	const NDTF_Allocator* allocator;
+} NDTF_Catalog;
+
+#define NDTF_STREAM_DEFAULT_MEMORY ((size_t)512 << 20)
+
+// out-of-core processing, the source is streamed in slabs of planes along its outermost axis.
+// works on uncompressed and segmented sources, a single compressed payload can only be processed in memory
+typedef struct NDTF_StreamOptions
+{
+	size_t memoryLimit;				// working memory ceiling in bytes (0 = NDTF_STREAM_DEFAULT_MEMORY)
+	NDTF_TexelFormat texelFormat;	// output texel format (NONE = keep)
+	NDTF_Codec codec;				// output codec, compressed output is always segmented
+	bool segmented;
+	bool checksums;
+	bool zoneMaps;
+	bool deduplicated;
+	NDTF_ErrorBound errorBound;		// lossy output of float formats (mode NONE = lossless)
+	uint32_t brickSize[NDTF_DIMENSIONS_MAX];	// output bricks, 0 on the outermost axis = largest that fits the memory limit
+	uint8_t downsample[NDTF_DIMENSIONS_MAX];	// box filter reduction factor per axis (0 or 1 = keep)
+	bool planar;					// planar output is always segmented
+} NDTF_StreamOptions;
+
+// upload-ready layout of a file for a buffer to texture copy: the texels of every 3D layer (axes 0-2) are placed
+// with padded row and slice pitches, layers follow each other along axes 3 and 4
+typedef struct NDTF_StagingOptions
+{
+	uint32_t rowAlignment;		// row pitch alignment in bytes (0 = none), e.g. 256 for D3D12
+	uint32_t sliceAlignment;	// slice pitch and layer offset alignment in bytes (0 = none), e.g. 512 for D3D12
+	bool expandRGB;				// stage RGB formats as RGBA
+	double fill;				// alpha of expanded texels, in the stored range of integer formats (e.g. 255 for RGB888)
+} NDTF_StagingOptions;
+
+typedef struct NDTF_StagingLayout
+{
+	NDTF_Header header;				// of the staged file
+	NDTF_TexelFormat texelFormat;	// of the staged texels
+	size_t texelSize;
+	size_t extent[3];				// width, height, depth of a layer
+	size_t layers;					// ind * ind2
+	size_t rowPitch;
+	size_t slicePitch;
+	size_t layerPitch;
+	size_t size;					// staging buffer bytes
+	double fill;
+} NDTF_StagingLayout;
+
+// copy command of one layer
+typedef struct NDTF_StagingRegion
+{
+	uint64_t offset;		// of the first texel in the staging buffer
+	uint64_t rowPitch;		// bytes
+	uint64_t slicePitch;	// bytes
+	uint32_t rowLength;		// row pitch in texels, 0 when it is not a whole number (GL_UNPACK_ROW_LENGTH, bufferRowLength)
+	uint32_t imageHeight;	// slice pitch in rows, 0 when it is not a whole number (GL_UNPACK_IMAGE_HEIGHT, bufferImageHeight)
+	uint32_t extent[3];
+	uint32_t layer;			// ind + ind2 * size of axis 3
+	uint32_t coord[2];		// ind, ind2
+} NDTF_StagingRegion;
+
+// file opened once for reads from any number of threads at the same time, see ndtf_reader_open
+typedef struct NDTF_Reader NDTF_Reader;
+
+// time series played back frame by frame, see ndtf_playback_open
+typedef struct NDTF_Playback NDTF_Playback;
+
+typedef struct NDTF_PlaybackOptions
+{
+	int axis;			// frames are the slices along it, e.g. 3 for ind
+	uint32_t prefetch;	// frames decoded ahead of the current one (0 = 3)
+	uint32_t threads;	// background decode threads (0 = prefetch, at most the hardware concurrency)
+	bool loop;			// the last frame is followed by the first
+} NDTF_PlaybackOptions;
+
+typedef enum NDTF_PlaybackStatus
+{
+	NDTF_PLAYBACK_READY = 0,	// the frame is acquired
+	NDTF_PLAYBACK_PENDING,		// not decoded yet, or every frame buffer is held
+	NDTF_PLAYBACK_END,			// past the last frame without loop
+	NDTF_PLAYBACK_ERROR,		// the frame could not be read, the next acquire moves on to the frame after it
+} NDTF_PlaybackStatus;
+
+typedef struct NDTF_Frame
+{
+	const void* texels;	// the slice packed x-fastest, valid until released
+	uint64_t index;		// along the axis
+} NDTF_Frame;
+
+typedef enum NDTF_Filter
+{
+	NDTF_FILTER_NEAREST = 0,
+	NDTF_FILTER_LINEAR,
+	NDTF_FILTER_CUBIC,		// Catmull-Rom
+	NDTF_FILTER_LANCZOS,	// 3 lobes
+} NDTF_Filter;
+
+typedef struct NDTF_ResizeOptions
+{
+	NDTF_Filter filter;
+	bool alignCorners;		// first and last samples map onto each other and are interpolated without prefiltering (lookup tables, 65 -> 33), otherwise texel areas do
+} NDTF_ResizeOptions;
+
+// pointwise operations on every channel of a texel. integer channels are normalized to [0, 1] and rounded and clamped
+// back, float channels are taken as they are
+typedef enum NDTF_TransformOp
+{
+	NDTF_TRANSFORM_SCALEBIAS = 0,		// v * a + b
+	NDTF_TRANSFORM_CLAMP,				// to [a, b]
+	NDTF_TRANSFORM_SWIZZLE,				// channel c takes channel swizzle[c] or a constant, applies to all channels
+	NDTF_TRANSFORM_POW,					// |v| ^ a, the sign is kept (gamma)
+	NDTF_TRANSFORM_SRGB_TO_LINEAR,		// of |v|, the sign is kept
+	NDTF_TRANSFORM_LINEAR_TO_SRGB,		// of |v|, the sign is kept
+	NDTF_TRANSFORM_LUT,					// lut sampled over [a, b], linearly interpolated and clamped to its ends
+} NDTF_TransformOp;
+
+#define NDTF_SWIZZLE_ZERO 4
+#define NDTF_SWIZZLE_ONE 5
+
+typedef struct NDTF_TransformStep
+{
+	NDTF_TransformOp op;
+	uint32_t channelMask;					// bit c selects channel c (0 = all channels), ignored by SWIZZLE
+	float a[NDTF_CHANNELS_RGBA];			// per channel parameters
+	float b[NDTF_CHANNELS_RGBA];
+	uint8_t swizzle[NDTF_CHANNELS_RGBA];	// source channels, NDTF_SWIZZLE_ZERO or NDTF_SWIZZLE_ONE
+	const float* lut;						// lutSize >= 2 values shared by the selected channels, copied on creation
+	uint32_t lutSize;
+} NDTF_TransformStep;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -105,11 +466,16 @@ extern "C" {
 	size_t ndtf_getChannelSize(NDTF_TexelFormat texelFormat);
 	size_t ndtf_getTexelSize(NDTF_TexelFormat texelFormat);
 	bool ndtf_getChannelIsFloat(NDTF_TexelFormat texelFormat);
+	bool ndtf_getIsBlockCompressed(NDTF_TexelFormat texelFormat);
+	size_t ndtf_getBlockSize(NDTF_TexelFormat texelFormat); // bytes of a 4x4 block, 0 for formats stored per texel
+	NDTF_TexelFormat ndtf_getDecodedTexelFormat(NDTF_TexelFormat texelFormat); // format blocks are encoded from and decoded to, the format itself for the others
 	
 	NDTF_File ndtf_file_loadFromData(uint8_t* data, size_t size, NDTF_TexelFormat* format, NDTF_TexelFormat desiredFormat);
 	NDTF_File ndtf_file_loadFromFile(FILE* file, NDTF_TexelFormat* format, NDTF_TexelFormat desiredFormat);
 	NDTF_File ndtf_file_load(const char* filename, NDTF_TexelFormat* format, NDTF_TexelFormat desiredFormat);
 	
+	// the uint16 extents fail on files larger than 65535 along an axis, use ndtf_file_load for those.
+	// the returned texels come from the global allocator, release them with ndtf_free and not free()
 	void* ndtf_loadFromData(uint8_t* data, size_t size, uint16_t* width, uint16_t* height, uint16_t* depth, uint16_t* ind, uint16_t* ind2, NDTF_TexelFormat* format, NDTF_TexelFormat desiredFormat);
 	void* ndtf_loadFromFile(FILE* file, uint16_t* width, uint16_t* height, uint16_t* depth, uint16_t* ind, uint16_t* ind2, NDTF_TexelFormat* format, NDTF_TexelFormat desiredFormat);
 	void* ndtf_load(const char* filename, uint16_t* width, uint16_t* height, uint16_t* depth, uint16_t* ind, uint16_t* ind2, NDTF_TexelFormat* format, NDTF_TexelFormat desiredFormat);
@@ -132,11 +498,13 @@ extern "C" {
 	
 	bool ndtf_file_isValid(NDTF_File* file);
 	void ndtf_file_reformat(NDTF_File* file, NDTF_TexelFormat desiredFormat);
+	size_t ndtf_file_getReformatMemory(NDTF_File* file, NDTF_TexelFormat desiredFormat); // worst-case peak bytes of ndtf_file_reformat, including the current data
 	NDTF_File ndtf_file_create(NDTF_Dimensions dimensions, NDTF_TexelFormat texelFormat, uint16_t width, uint16_t height, uint16_t depth, uint16_t ind, uint16_t ind2);
 	NDTF_File ndtf_file_create_2D(NDTF_TexelFormat texelFormat, uint16_t width, uint16_t height);
 	NDTF_File ndtf_file_create_3D(NDTF_TexelFormat texelFormat, uint16_t width, uint16_t height, uint16_t depth);
 	NDTF_File ndtf_file_create_4D(NDTF_TexelFormat texelFormat, uint16_t width, uint16_t height, uint16_t depth, uint16_t ind);
 	NDTF_File ndtf_file_create_5D(NDTF_TexelFormat texelFormat, uint16_t width, uint16_t height, uint16_t depth, uint16_t ind, uint16_t ind2);
+	NDTF_File ndtf_file_create_ND(NDTF_Dimensions dimensions, NDTF_TexelFormat texelFormat, const uint32_t size[NDTF_DIMENSIONS_MAX]); // zeroed when the data size overflows
 	size_t ndtf_file_getTexelIndex(NDTF_File* file, NDTF_Coord* coordPtr);
 	bool ndtf_file_setTexel(NDTF_File* file, NDTF_Coord* coordPtr, void* colorPtr);
 	bool ndtf_file_setTexel_2D(NDTF_File* file, uint16_t x, uint16_t y, void* colorPtr);
@@ -148,23 +516,207 @@ extern "C" {
 	void* ndtf_file_getTexel_3D(NDTF_File* file, uint16_t x, uint16_t y, uint16_t z);
 	void* ndtf_file_getTexel_4D(NDTF_File* file, uint16_t x, uint16_t y, uint16_t z, uint16_t w);
 	void* ndtf_file_getTexel_5D(NDTF_File* file, uint16_t x, uint16_t y, uint16_t z, uint16_t w, uint16_t v);
-	void* ndtf_file_saveToData(NDTF_File* file, size_t* size);
+	void* ndtf_file_saveToData(NDTF_File* file, size_t* size); // release with ndtf_free, not free()
 	bool ndtf_file_saveToFile(NDTF_File* file, FILE* handle);
 	bool ndtf_file_save(NDTF_File* file, const char* filename);
 
 	bool ndtf_file_getZLibCompression(NDTF_File* file);
 	void ndtf_file_setZLibCompression(NDTF_File* file, bool zlib_compression);
+	NDTF_Codec ndtf_file_getCodec(NDTF_File* file);
+	void ndtf_file_setCodec(NDTF_File* file, NDTF_Codec codec);
+
+	bool ndtf_file_getSegmented(NDTF_File* file);
+	void ndtf_file_setSegmented(NDTF_File* file, bool segmented);
+	size_t ndtf_file_getBrickExtent(NDTF_File* file, int axis);
+	void ndtf_file_setBrickSize(NDTF_File* file, const uint32_t brickSize[NDTF_DIMENSIONS_MAX]); // 0 = whole axis, rounded up to a power of two, enables segmentation
+	size_t ndtf_file_getSegmentCount(NDTF_File* file);
+	bool ndtf_file_getChecksums(NDTF_File* file);
+	void ndtf_file_setChecksums(NDTF_File* file, bool checksums);
+	bool ndtf_file_getZoneMaps(NDTF_File* file);
+	void ndtf_file_setZoneMaps(NDTF_File* file, bool zoneMaps); // enables segmentation
+	bool ndtf_file_getDeduplicated(NDTF_File* file);
+	void ndtf_file_setDeduplicated(NDTF_File* file, bool deduplicated); // enables segmentation
+	bool ndtf_file_getPlanar(NDTF_File* file);
+	void ndtf_file_setPlanar(NDTF_File* file, bool planar); // ignored for single channel and lossy files
+	int ndtf_file_getDeltaAxis(NDTF_File* file); // -1 = no delta encoding
+	// slices along axis (< 0 = off) are stored as differences to the previous one, XOR for float formats. enables
+	// segmentation with single slice bricks along the axis, ignored for lossy files
+	void ndtf_file_setDelta(NDTF_File* file, int axis, uint8_t keyframeInterval);
+	bool ndtf_file_getErrorBound(NDTF_File* file, NDTF_ErrorBound* bound);
+	// float formats only, NONE = lossless. switches a file without codec to DEFLATE since the quantized values only
+	// shrink once entropy coded, call ndtf_file_setCodec afterwards to pick another codec or none
+	bool ndtf_file_setErrorBound(NDTF_File* file, NDTF_ErrorBoundMode mode, const float bound[NDTF_CHANNELS_RGBA]);
 
+	uint32_t ndtf_crc32c(uint32_t crc, const void* data, size_t size);
+	NDTF_VerifyResult ndtf_verifyData(const uint8_t* data, size_t size, const NDTF_Context* ctx);
+	NDTF_VerifyResult ndtf_verifyFile(FILE* file, const NDTF_Context* ctx);
+	NDTF_VerifyResult ndtf_verify(const char* filename, const NDTF_Context* ctx);
+
+	// the returned buffers of these and the codec functions below come from the global allocator, release them
+	// with ndtf_free and not free()
 	void* ndtf_zLibCompressData(const void* data, size_t size, size_t* newSize);
 	void* ndtf_zLibDecompressData(const void* data, size_t size, size_t* newSize);
 
+	// codecs
+	bool ndtf_registerCodec(NDTF_Codec codec, const NDTF_CodecInfo* info); // ids NDTF_CODEC_USER..NDTF_CODEC_MAX, NULL info unregisters
+	const NDTF_CodecInfo* ndtf_getCodec(NDTF_Codec codec);
+	void* ndtf_compressData(NDTF_Codec codec, const void* data, size_t size, size_t* newSize);
+	void* ndtf_decompressData(NDTF_Codec codec, const void* data, size_t size, size_t* newSize);
+
 	size_t ndtf_file_getDataSize(NDTF_File* file);
 
 	void ndtf_file_free(NDTF_File* file);
 
+	NDTF_File ndtf_file_loadFromData_ex(uint8_t* data, size_t size, NDTF_TexelFormat* format, NDTF_TexelFormat desiredFormat, const NDTF_Context* ctx);
+	NDTF_File ndtf_file_loadFromFile_ex(FILE* file, NDTF_TexelFormat* format, NDTF_TexelFormat desiredFormat, const NDTF_Context* ctx);
+	NDTF_File ndtf_file_load_ex(const char* filename, NDTF_TexelFormat* format, NDTF_TexelFormat desiredFormat, const NDTF_Context* ctx);
+	// one volume of count files stacked along axis, the files are decoded in parallel straight into their place.
+	// axis is the outermost axis of the files (concatenated, their extents along it may differ) or one past it (one
+	// plane per file, axes in between have extent 1). all other extents must match. texelFormat NONE = that of the
+	// first file, files of other formats are converted
+	NDTF_File ndtf_file_loadStack(const char* const* filenames, size_t count, int axis, NDTF_TexelFormat texelFormat, const NDTF_Context* ctx);
+	void ndtf_file_reformat_ex(NDTF_File* file, NDTF_TexelFormat desiredFormat, const NDTF_Context* ctx);
+	NDTF_File ndtf_file_create_ex(NDTF_Dimensions dimensions, NDTF_TexelFormat texelFormat, uint16_t width, uint16_t height, uint16_t depth, uint16_t ind, uint16_t ind2, const NDTF_Context* ctx);
+	NDTF_File ndtf_file_create_ND_ex(NDTF_Dimensions dimensions, NDTF_TexelFormat texelFormat, const uint32_t size[NDTF_DIMENSIONS_MAX], const NDTF_Context* ctx);
+	void* ndtf_file_saveToData_ex(NDTF_File* file, size_t* size, const NDTF_Context* ctx); // release with the allocator of ctx
+	bool ndtf_file_saveToFile_ex(NDTF_File* file, FILE* handle, const NDTF_Context* ctx);
+	bool ndtf_file_save_ex(NDTF_File* file, const char* filename, const NDTF_Context* ctx);
+	void ndtf_file_free_ex(NDTF_File* file, const NDTF_Context* ctx);
+
+	// planar layout, planes[c] holds count values of channel c
+	void ndtf_deinterleave(const void* texels, size_t count, NDTF_TexelFormat texelFormat, void* const planes[NDTF_CHANNELS_RGBA], const NDTF_Context* ctx);
+	void ndtf_interleave(const void* const planes[NDTF_CHANNELS_RGBA], size_t count, NDTF_TexelFormat texelFormat, void* texels, const NDTF_Context* ctx);
+	// one channel as an R8, R16, R32F or R32 file of the same extents. planar files with uncompressed planes
+	// only read the planes of that channel
+	NDTF_File ndtf_file_loadChannelFromData(const uint8_t* data, size_t size, int channel, const NDTF_Context* ctx);
+	NDTF_File ndtf_file_loadChannelFromFile(FILE* file, int channel, const NDTF_Context* ctx);
+	NDTF_File ndtf_file_loadChannel(const char* filename, int channel, const NDTF_Context* ctx);
+
+	// texel statistics
+	bool ndtf_computeTexelStats(const void* data, size_t texels, NDTF_TexelFormat texelFormat, NDTF_TexelStats* stats, const NDTF_Context* ctx);
+	bool ndtf_file_computeTexelStats(NDTF_File* file, NDTF_TexelStats* stats, const NDTF_Context* ctx);
+	double ndtf_texelStats_mean(const NDTF_TexelStats* stats, int channel);
+	double ndtf_texelStats_stddev(const NDTF_TexelStats* stats, int channel);
+
+	// zone maps
+	bool ndtf_zoneMaps_loadFromData(NDTF_ZoneMaps* maps, const uint8_t* data, size_t size, const NDTF_Context* ctx);
+	bool ndtf_zoneMaps_loadFromFile(NDTF_ZoneMaps* maps, FILE* file, const NDTF_Context* ctx);
+	bool ndtf_zoneMaps_load(NDTF_ZoneMaps* maps, const char* filename, const NDTF_Context* ctx);
+	// bricks of which the range of channel (< 0 = any channel) overlaps [low, high], the first capacity ids are
+	// written in ascending order and the total number of matches is returned
+	size_t ndtf_zoneMaps_query(const NDTF_ZoneMaps* maps, int channel, double low, double high, uint64_t* bricks, size_t capacity);
+	bool ndtf_zoneMaps_getBrick(const NDTF_ZoneMaps* maps, uint64_t brick, uint32_t origin[NDTF_DIMENSIONS_MAX], uint32_t extent[NDTF_DIMENSIONS_MAX]);
+	void ndtf_zoneMaps_free(NDTF_ZoneMaps* maps);
+
+	// probing
+	bool ndtf_header_isValid(const NDTF_Header* header);
+	bool ndtf_header_getDataSize(const NDTF_Header* header, size_t* size); // false when the texel bytes overflow size_t
+	bool ndtf_probeData(const uint8_t* data, size_t size, NDTF_Header* header);
+	bool ndtf_probeFile(FILE* file, NDTF_Header* header);
+	bool ndtf_probe(const char* filename, NDTF_Header* header);
+
+	// catalog
+	bool ndtf_catalog_build(NDTF_Catalog* catalog, const char* directory, const NDTF_Catalog* previous, const NDTF_Context* ctx);
+	bool ndtf_catalog_save(const NDTF_Catalog* catalog, const char* filename);
+	bool ndtf_catalog_load(NDTF_Catalog* catalog, const char* filename, const NDTF_Context* ctx);
+	bool ndtf_catalog_refresh(NDTF_Catalog* catalog, const char* directory, const char* indexFilename, const NDTF_Context* ctx);
+	const NDTF_CatalogEntry* ndtf_catalog_find(const NDTF_Catalog* catalog, const char* path);
+	void ndtf_catalog_free(NDTF_Catalog* catalog);
+
+	// out-of-core
+	bool ndtf_stream_process(const char* srcFilename, const char* dstFilename, const NDTF_StreamOptions* options, const NDTF_Context* ctx);
+	bool ndtf_stream_reformat(const char* srcFilename, const char* dstFilename, NDTF_TexelFormat desiredFormat, size_t memoryLimit, const NDTF_Context* ctx);
+	bool ndtf_stream_recompress(const char* srcFilename, const char* dstFilename, NDTF_Codec codec, size_t memoryLimit, const NDTF_Context* ctx);
+	bool ndtf_stream_downsample(const char* srcFilename, const char* dstFilename, const uint8_t factor[NDTF_DIMENSIONS_MAX], size_t memoryLimit, const NDTF_Context* ctx);
+	// planes [first, first + count) along the outermost axis, only the bricks holding them are read and decoded
+	NDTF_File ndtf_stream_loadPlanes(const char* filename, size_t first, size_t count, const NDTF_Context* ctx);
+
+	// staging
+	bool ndtf_staging_getLayout(const NDTF_Header* header, const NDTF_StagingOptions* options, NDTF_StagingLayout* layout);
+	// regions of the first capacity layers, returns the number of layers
+	size_t ndtf_staging_getRegions(const NDTF_StagingLayout* layout, NDTF_StagingRegion* regions, size_t capacity);
+	// decodes a file straight into staging (layout->size bytes, e.g. a mapped upload buffer), padding is left untouched.
+	// the file must match layout->header
+	bool ndtf_staging_loadFromData(const uint8_t* data, size_t size, const NDTF_StagingLayout* layout, void* staging, const NDTF_Context* ctx);
+	bool ndtf_staging_loadFromFile(FILE* file, const NDTF_StagingLayout* layout, void* staging, const NDTF_Context* ctx);
+	bool ndtf_staging_load(const char* filename, const NDTF_StagingLayout* layout, void* staging, const NDTF_Context* ctx);
+
+	// concurrent reads. the header and segment table are read once and reads use positional I/O, so they share no
+	// file position. a single compressed payload is decoded once when opening. ctx is copied, its texelStats are
+	// not collected
+	NDTF_Reader* ndtf_reader_open(const char* filename, const NDTF_Context* ctx);
+	void ndtf_reader_close(NDTF_Reader* reader); // no read may be running
+	const NDTF_Header* ndtf_reader_getHeader(const NDTF_Reader* reader);
+	size_t ndtf_reader_getBrickCount(const NDTF_Reader* reader); // 1 for files that are not segmented
+	// texels of [origin, origin + extent) packed x-fastest, axes past the dimensions are ignored. only the bricks
+	// overlapping the region are read, delta encoded files also read the slices back to the last keyframe.
+	// runs on the calling thread
+	bool ndtf_reader_readRegion(NDTF_Reader* reader, const uint32_t origin[NDTF_DIMENSIONS_MAX], const uint32_t extent[NDTF_DIMENSIONS_MAX], void* texels);
+	// one brick packed x-fastest, origin and extent (both optional) receive its clipped box
+	bool ndtf_reader_readBrick(NDTF_Reader* reader, uint64_t brick, void* texels, uint32_t origin[NDTF_DIMENSIONS_MAX], uint32_t extent[NDTF_DIMENSIONS_MAX]);
+
+	// playback: background threads read the frames after the current one through a reader into a ring of prefetch + 1
+	// frame buffers allocated when opening. frames are acquired in order and released by the caller, a seek cancels
+	// the reads of stale frames between bricks. files delta encoded along the axis read back to the keyframe for every
+	// frame. options NULL = the outermost axis
+	NDTF_Playback* ndtf_playback_open(const char* filename, const NDTF_PlaybackOptions* options, const NDTF_Context* ctx);
+	void ndtf_playback_close(NDTF_Playback* playback); // frames still held become invalid
+	const NDTF_Header* ndtf_playback_getHeader(const NDTF_Playback* playback);
+	uint64_t ndtf_playback_getFrameCount(const NDTF_Playback* playback);
+	size_t ndtf_playback_getFrameSize(const NDTF_Playback* playback); // bytes
+	// the current frame, wait blocks until it is decoded. on success the current frame advances to the next one
+	NDTF_PlaybackStatus ndtf_playback_acquire(NDTF_Playback* playback, NDTF_Frame* frame, bool wait);
+	void ndtf_playback_release(NDTF_Playback* playback, const NDTF_Frame* frame);
+	// makes index the current frame, frames decoded or in flight for the old position are dropped
+	bool ndtf_playback_seek(NDTF_Playback* playback, uint64_t index);
+
+	// incremental saves of segmented files. only the bricks overlapping [origin, origin + extent) are encoded from the
+	// texels of file, which must have the extents and format of the stored file; its codec and other settings are
+	// kept. new segments go into unused space or are appended, the entries are written after them
+	bool ndtf_file_update(NDTF_File* file, const char* filename, const uint32_t origin[NDTF_DIMENSIONS_MAX], const uint32_t extent[NDTF_DIMENSIONS_MAX], const NDTF_Context* ctx);
+	// rewrites a segmented file without the space of replaced segments, reclaimed (optional) receives the bytes saved
+	bool ndtf_compact(const char* filename, uint64_t* reclaimed, const NDTF_Context* ctx);
+
+	// separable resampling to size (0 = keep the axis), one parallel pass per resized axis in float precision.
+	// integer formats are rounded and clamped. options NULL = linear. the result keeps the storage settings of file
+	NDTF_File ndtf_file_resize(NDTF_File* file, const uint32_t size[NDTF_DIMENSIONS_MAX], const NDTF_ResizeOptions* options, const NDTF_Context* ctx);
+
+	// pointwise transforms. the steps are folded into one kernel for texelFormat (not a block format): swizzles become
+	// channel sources, neighbouring steps of one kind merge and 8 and 16 bit formats turn into lookup tables. a
+	// transform is read-only and can be shared between threads. NULL when a step is invalid
+	NDTF_Transform* ndtf_transform_create(const NDTF_TransformStep* steps, size_t count, NDTF_TexelFormat texelFormat, const NDTF_Context* ctx);
+	void ndtf_transform_free(NDTF_Transform* transform);
+	NDTF_TexelFormat ndtf_transform_getTexelFormat(const NDTF_Transform* transform);
+	// count packed texels in place, in parallel
+	bool ndtf_transform_apply(const NDTF_Transform* transform, void* texels, size_t count, const NDTF_Context* ctx);
+	// texels of [origin, origin + extent) in place, origin and extent NULL = the whole file. axes past the dimensions
+	// are ignored. the file must have the format of the transform
+	bool ndtf_file_transform(NDTF_File* file, const NDTF_Transform* transform, const uint32_t origin[NDTF_DIMENSIONS_MAX], const uint32_t extent[NDTF_DIMENSIONS_MAX], const NDTF_Context* ctx);
+
+	// threading
+	void ndtf_setExecutor(const NDTF_Executor* executor);
+	const NDTF_Executor* ndtf_getExecutor(void);
+	size_t ndtf_getHardwareConcurrency(void);
+
+	// memory
+	void ndtf_setAllocator(const NDTF_Allocator* allocator);
+	const NDTF_Allocator* ndtf_getAllocator(void);
+	const NDTF_Allocator* ndtf_getDefaultAllocator(void);
+	void* ndtf_alloc(size_t size);
+	// buffers returned by the library without an NDTF_File, with the global allocator that allocated them.
+	// replaces the free() these took before the allocator interface
+	void ndtf_free(void* ptr);
+
+	// instrumentation
+	bool ndtf_instrumentationEnabled(void);
+	void ndtf_setInstrumentation(const NDTF_Instrumentation* instrumentation);
+	void ndtf_getGlobalStats(NDTF_Stats* stats);
+	void ndtf_resetGlobalStats(void);
+
 	// GL helpers
 #ifdef NDTF_GL_HELPER_FUNCTIONS
 
+	// block formats map to compressed internal formats for glCompressedTexImage*, format and type to their decoded texels
 	GLenum ndtf_glSizedTexelFormat(NDTF_TexelFormat texelFormat);
 	GLenum ndtf_glTexelFormat(NDTF_TexelFormat texelFormat);
 	GLenum ndtf_glTexelType(NDTF_TexelFormat texelFormat);
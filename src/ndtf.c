@@ -1,16 +1,13 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+	#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <ndtf/ndtf.h>
 #include <string.h>
-#include <libdeflate.h>
+#include "ndtf_internal.h"
 
 #define _CRT_SECURE_NO_DEPRECATE
 
-#ifndef max
-	#define max(a,b) (((a) > (b)) ? (a) : (b))
-#endif
-#ifndef min
-	#define min(a,b) (((a) < (b)) ? (a) : (b))
-#endif
-
 NDTF_Channels ndtf_getChannelCount(NDTF_TexelFormat texelFormat)
 {
 	switch (texelFormat)
@@ -19,16 +16,21 @@ NDTF_Channels ndtf_getChannelCount(NDTF_TexelFormat texelFormat)
 	case NDTF_TEXELFORMAT_RGBA16161616:
 	case NDTF_TEXELFORMAT_RGBA32323232F:
 	case NDTF_TEXELFORMAT_RGBA32323232:
+	case NDTF_TEXELFORMAT_BC7:
 		return NDTF_CHANNELS_RGBA;
 	case NDTF_TEXELFORMAT_RGB888:
 	case NDTF_TEXELFORMAT_RGB161616:
 	case NDTF_TEXELFORMAT_RGB323232F:
 	case NDTF_TEXELFORMAT_RGB323232:
+	case NDTF_TEXELFORMAT_BC6H:
 		return NDTF_CHANNELS_RGB;
+	case NDTF_TEXELFORMAT_BC5:
+		return NDTF_CHANNELS_RG;
 	case NDTF_TEXELFORMAT_R8:
 	case NDTF_TEXELFORMAT_R16:
 	case NDTF_TEXELFORMAT_R32F:
 	case NDTF_TEXELFORMAT_R32:
+	case NDTF_TEXELFORMAT_BC4:
 		return NDTF_CHANNELS_R;
 	default:
 		return NDTF_CHANNELS_NONE;
@@ -93,35 +95,76 @@ bool ndtf_getChannelIsFloat(NDTF_TexelFormat texelFormat)
 	case NDTF_TEXELFORMAT_RGBA32323232F:
 	case NDTF_TEXELFORMAT_RGB323232F:
 	case NDTF_TEXELFORMAT_R32F:
+	case NDTF_TEXELFORMAT_BC6H:
 		return true;
 	default:
 		return false;
 	}
 }
+bool ndtf_getIsBlockCompressed(NDTF_TexelFormat texelFormat)
+{
+	return ndtf_getBlockSize(texelFormat) != 0;
+}
+size_t ndtf_getBlockSize(NDTF_TexelFormat texelFormat)
+{
+	switch (texelFormat)
+	{
+	case NDTF_TEXELFORMAT_BC4:
+		return 8;
+	case NDTF_TEXELFORMAT_BC5:
+	case NDTF_TEXELFORMAT_BC6H:
+	case NDTF_TEXELFORMAT_BC7:
+		return 16;
+	default:
+		return 0;
+	}
+}
+NDTF_TexelFormat ndtf_getDecodedTexelFormat(NDTF_TexelFormat texelFormat)
+{
+	switch (texelFormat)
+	{
+	case NDTF_TEXELFORMAT_BC4:
+		return NDTF_TEXELFORMAT_R8;
+	case NDTF_TEXELFORMAT_BC5:
+		return NDTF_TEXELFORMAT_RGB888;
+	case NDTF_TEXELFORMAT_BC6H:
+		return NDTF_TEXELFORMAT_RGB323232F;
+	case NDTF_TEXELFORMAT_BC7:
+		return NDTF_TEXELFORMAT_RGBA8888;
+	default:
+		return texelFormat;
+	}
+}
+
+static void* ndtf_compress(NDTF_Codec codec, const void* data, size_t size, size_t* newSize, const NDTF_Context* ctx);
+static void* ndtf_decompress(NDTF_Codec codec, const void* data, size_t size, size_t* newSize, const NDTF_Context* ctx);
 
 NDTF_File ndtf_file_loadFromData(uint8_t* data, size_t size, NDTF_TexelFormat* format, NDTF_TexelFormat desiredFormat)
+{
+	return ndtf_file_loadFromData_ex(data, size, format, desiredFormat, NULL);
+}
+NDTF_File ndtf_file_loadFromFile(FILE* file, NDTF_TexelFormat* format, NDTF_TexelFormat desiredFormat)
+{
+	return ndtf_file_loadFromFile_ex(file, format, desiredFormat, NULL);
+}
+NDTF_File ndtf_file_load(const char* filename, NDTF_TexelFormat* format, NDTF_TexelFormat desiredFormat)
+{
+	return ndtf_file_load_ex(filename, format, desiredFormat, NULL);
+}
+// the transform of the context, if any, must be made for the texels it is applied to
+NDTF_File ndtf_file_loadFromData_ex(uint8_t* data, size_t size, NDTF_TexelFormat* format, NDTF_TexelFormat desiredFormat, const NDTF_Context* ctx)
 {
 	NDTF_File result;
 	memset(&result, 0, sizeof(NDTF_File));
 
-	if (size < sizeof(NDTF_Header))
-		return result;
+	NDTF_SCOPE_BEGIN(headerScope, ctx, NDTF_PHASE_HEADER, "header");
 
-	memcpy(&result.header, data, sizeof(NDTF_Header));
+	size_t headerSize = ndtf_header_decode(data, size, &result.header);
 
-	if (memcmp(result.header.signature, NDTF_SIGNATURE, 4) != 0)
-	{
-		memset(&result, 0, sizeof(NDTF_File));
-		return result;
-	}
+	NDTF_SCOPE_END(headerScope, ctx, headerSize);
 
-	if (result.header.version > NDTF_VERSION)
-	{
-		memset(&result, 0, sizeof(NDTF_File));
-		return result;
-	}
-
-	if (result.header.dimensions < NDTF_DIMENSIONS_MIN || result.header.dimensions > NDTF_DIMENSIONS_MAX)
+	bool kept = desiredFormat == NDTF_TEXELFORMAT_NONE || desiredFormat == result.header.texelFormat;
+	if (!headerSize || !ndtf_transform_fits(ctx, kept ? (NDTF_TexelFormat)result.header.texelFormat : desiredFormat))
 	{
 		memset(&result, 0, sizeof(NDTF_File));
 		return result;
@@ -129,85 +172,103 @@ NDTF_File ndtf_file_loadFromData(uint8_t* data, size_t size, NDTF_TexelFormat* f
 
 	size_t dataSize = ndtf_file_getDataSize(&result);
 
-	if (ndtf_file_getZLibCompression(&result))
+	result.allocator = ndtf_mem_allocator(ctx);
+	const NDTF_Transform* transform = ctx ? ctx->transform : NULL;
+
+	if (ndtf_file_getSegmented(&result))
 	{
-		size_t actualDataSize = 0;
-		result.data = ndtf_zLibDecompressData(data + sizeof(NDTF_Header), size - sizeof(NDTF_Header), &actualDataSize);
-		if (!result.data)
+		// the returned texels are transformed and their statistics collected while every brick is still in cache
+		ndtf_TexelStatsSink texelStats;
+		bool fused = ctx && ctx->texelStats && kept &&
+			ndtf_texelStats_begin(&texelStats, ctx->texelStats, (NDTF_TexelFormat)result.header.texelFormat);
+
+		bool loaded = ndtf_segments_load(&result, data, size, fused ? &texelStats : NULL, kept ? transform : NULL, ctx);
+		if (fused)
+			ndtf_texelStats_end(&texelStats);
+		if (kept)
+			transform = NULL;
+
+		if (!loaded)
 		{
 			memset(&result, 0, sizeof(NDTF_File));
 			return result;
 		}
-		if (actualDataSize != dataSize)
+
+		if (fused)
 		{
-			free(result.data);
-			memset(&result, 0, sizeof(NDTF_File));
+			if (format) *format = (NDTF_TexelFormat)result.header.texelFormat;
 			return result;
 		}
 	}
 	else
 	{
-		if (size != sizeof(NDTF_Header) + dataSize)
+		result.data = (uint8_t*)ndtf_mem_alloc(ctx, dataSize);
+		if (!result.data || !ndtf_payload_decode(&result.header, data + headerSize, size - headerSize, result.data, &result.errorBound, ctx))
 		{
+			ndtf_mem_free(ctx, result.data);
 			memset(&result, 0, sizeof(NDTF_File));
 			return result;
 		}
+	}
 
-		result.data = (uint8_t*)malloc(dataSize);
-		if (!result.data)
-		{
-			memset(&result, 0, sizeof(NDTF_File));
-			return result;
-		}
+	if (format) *format = (NDTF_TexelFormat)result.header.texelFormat;
+	ndtf_file_reformat_ex(&result, desiredFormat, ctx);
 
-		memcpy(result.data, data + sizeof(NDTF_Header), dataSize);
+	if (transform && !ndtf_file_transform(&result, transform, NULL, NULL, ctx))
+	{
+		ndtf_file_free_ex(&result, ctx);
+		return result;
 	}
 
-	if (format) *format = (NDTF_TexelFormat)result.header.texelFormat;
-	ndtf_file_reformat(&result, desiredFormat);
+	if (ctx && ctx->texelStats)
+		ndtf_file_computeTexelStats(&result, ctx->texelStats, ctx);
 
 	return result;
 }
-NDTF_File ndtf_file_loadFromFile(FILE* file, NDTF_TexelFormat* format, NDTF_TexelFormat desiredFormat)
+NDTF_File ndtf_file_loadFromFile_ex(FILE* file, NDTF_TexelFormat* format, NDTF_TexelFormat desiredFormat, const NDTF_Context* ctx)
 {
 	NDTF_File result;
 	memset(&result, 0, sizeof(NDTF_File));
 
 	if (file != NULL)
 	{
-		if (fseek(file, 0, SEEK_END) != 0)
+		if (ndtf_fseek64(file, 0, SEEK_END) != 0)
 			return result;
 
-		int64_t size = ftell(file);
+		int64_t size = ndtf_ftell64(file);
 		if (size < 0)
 			return result;
 
-		if (fseek(file, 0, SEEK_SET) != 0)
+		if (ndtf_fseek64(file, 0, SEEK_SET) != 0)
 			return result;
 
-		uint8_t* data = (uint8_t*)malloc((size_t)size);
+		uint8_t* data = (uint8_t*)ndtf_mem_alloc(ctx, (size_t)size);
 		if (!data)
 			return result;
 
+		NDTF_SCOPE_BEGIN(ioScope, ctx, NDTF_PHASE_IO, "fread");
+
 		size_t bytesRead = fread(data, 1, size, file);
 
+		NDTF_SCOPE_END(ioScope, ctx, bytesRead);
+
 		if (bytesRead < (size_t)size)
 		{
 			if (ferror(file))
 			{
-				free(data);
+				ndtf_mem_free(ctx, data);
 				return result;
 			}
 		}
 
-		result = ndtf_file_loadFromData(data, (size_t)size, format, desiredFormat);
+		result = ndtf_file_loadFromData_ex(data, (size_t)size, format, desiredFormat, ctx);
 
-		free(data);
+		ndtf_mem_free(ctx, data);
 	}
 
 	return result;
 }
-NDTF_File ndtf_file_load(const char* filename, NDTF_TexelFormat* format, NDTF_TexelFormat desiredFormat)
+NDTF_File ndtf_file_load_ex(const char* filename, NDTF_TexelFormat* format, NDTF_TexelFormat desiredFormat, const NDTF_Context* ctx)
 {
 	NDTF_File result;
 
@@ -215,7 +276,7 @@ NDTF_File ndtf_file_load(const char* filename, NDTF_TexelFormat* format, NDTF_Te
 
 	if (file != NULL)
 	{
-		result = ndtf_file_loadFromFile(file, format, desiredFormat);
+		result = ndtf_file_loadFromFile_ex(file, format, desiredFormat, ctx);
 		fclose(file);
 	}
 	else
@@ -224,59 +285,47 @@ NDTF_File ndtf_file_load(const char* filename, NDTF_TexelFormat* format, NDTF_Te
 	return result;
 }
 
+// data and extents for the uint16 interface, files that do not fit it are released
+static void* ndtf_exportLegacy(NDTF_File* file, uint16_t* width, uint16_t* height, uint16_t* depth, uint16_t* ind, uint16_t* ind2)
+{
+	uint16_t* extents[NDTF_DIMENSIONS_MAX] = { width, height, depth, ind, ind2 };
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+	{
+		if (file->header.size[i] > UINT16_MAX)
+		{
+			ndtf_file_free(file);
+			return NULL;
+		}
+	}
+
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+	{
+		if (extents[i])
+			*extents[i] = (uint16_t)max(file->header.size[i], 1);
+	}
+
+	return file->data8b;
+}
 void* ndtf_loadFromData(uint8_t* data, size_t size, uint16_t* width, uint16_t* height, uint16_t* depth, uint16_t* ind, uint16_t* ind2, NDTF_TexelFormat* format, NDTF_TexelFormat desiredFormat)
 {
 	NDTF_File f = ndtf_file_loadFromData(data, size, format, desiredFormat);
 	if (!ndtf_file_isValid(&f)) return NULL;
 
-	if (width)
-		*width = max(f.header.width, 1);
-	if (height)
-		*height = max(f.header.height, 1);
-	if (depth)
-		*depth = max(f.header.depth, 1);
-	if (ind)
-		*ind = max(f.header.ind, 1);
-	if (ind2)
-		*ind2 = max(f.header.ind2, 1);
-
-	return f.data8b;
+	return ndtf_exportLegacy(&f, width, height, depth, ind, ind2);
 }
 void* ndtf_loadFromFile(FILE* file, uint16_t* width, uint16_t* height, uint16_t* depth, uint16_t* ind, uint16_t* ind2, NDTF_TexelFormat* format, NDTF_TexelFormat desiredFormat)
 {
 	NDTF_File f = ndtf_file_loadFromFile(file, format, desiredFormat);
 	if (!ndtf_file_isValid(&f)) return NULL;
 
-	if (width)
-		*width = max(f.header.width, 1);
-	if (height)
-		*height = max(f.header.height, 1);
-	if (depth)
-		*depth = max(f.header.depth, 1);
-	if (ind)
-		*ind = max(f.header.ind, 1);
-	if (ind2)
-		*ind2 = max(f.header.ind2, 1);
-
-	return f.data8b;
+	return ndtf_exportLegacy(&f, width, height, depth, ind, ind2);
 }
 void* ndtf_load(const char* filename, uint16_t* width, uint16_t* height, uint16_t* depth, uint16_t* ind, uint16_t* ind2, NDTF_TexelFormat* format, NDTF_TexelFormat desiredFormat)
 {
 	NDTF_File f = ndtf_file_load(filename, format, desiredFormat);
 	if (!ndtf_file_isValid(&f)) return NULL;
 
-	if (width)
-		*width = max(f.header.width, 1);
-	if (height)
-		*height = max(f.header.height, 1);
-	if (depth)
-		*depth = max(f.header.depth, 1);
-	if (ind)
-		*ind = max(f.header.ind, 1);
-	if (ind2)
-		*ind2 = max(f.header.ind2, 1);
-
-	return f.data8b;
+	return ndtf_exportLegacy(&f, width, height, depth, ind, ind2);
 }
 uint8_t* ndtf_loadFromData_u8(uint8_t* data, size_t size, uint16_t* width, uint16_t* height, uint16_t* depth, uint16_t* ind, uint16_t* ind2, NDTF_TexelFormat* format, NDTF_TexelFormat desiredFormat)
 {
@@ -287,7 +336,7 @@ uint8_t* ndtf_loadFromData_u8(uint8_t* data, size_t size, uint16_t* width, uint1
 	{
 		if (ndtf_getChannelSize(f) == 1 && !ndtf_getChannelIsFloat(f))
 		{
-			free(result);
+			ndtf_mem_free(NULL, result);
 			return NULL;
 		}
 
@@ -306,7 +355,7 @@ uint8_t* ndtf_loadFromFile_u8(FILE* file, uint16_t* width, uint16_t* height, uin
 	{
 		if (ndtf_getChannelSize(f) == 1 && !ndtf_getChannelIsFloat(f))
 		{
-			free(result);
+			ndtf_mem_free(NULL, result);
 			return NULL;
 		}
 
@@ -325,7 +374,7 @@ uint8_t* ndtf_load_u8(const char* filename, uint16_t* width, uint16_t* height, u
 	{
 		if (ndtf_getChannelSize(f) == 1 && !ndtf_getChannelIsFloat(f))
 		{
-			free(result);
+			ndtf_mem_free(NULL, result);
 			return NULL;
 		}
 
@@ -344,7 +393,7 @@ uint16_t* ndtf_loadFromData_u16(uint8_t* data, size_t size, uint16_t* width, uin
 	{
 		if (ndtf_getChannelSize(f) == 2 && !ndtf_getChannelIsFloat(f))
 		{
-			free(result);
+			ndtf_mem_free(NULL, result);
 			return NULL;
 		}
 
@@ -363,7 +412,7 @@ uint16_t* ndtf_loadFromFile_u16(FILE* file, uint16_t* width, uint16_t* height, u
 	{
 		if (ndtf_getChannelSize(f) == 2 && !ndtf_getChannelIsFloat(f))
 		{
-			free(result);
+			ndtf_mem_free(NULL, result);
 			return NULL;
 		}
 
@@ -382,7 +431,7 @@ uint16_t* ndtf_load_u16(const char* filename, uint16_t* width, uint16_t* height,
 	{
 		if (ndtf_getChannelSize(f) == 2 && !ndtf_getChannelIsFloat(f))
 		{
-			free(result);
+			ndtf_mem_free(NULL, result);
 			return NULL;
 		}
 
@@ -401,7 +450,7 @@ uint32_t* ndtf_loadFromData_u32(uint8_t* data, size_t size, uint16_t* width, uin
 	{
 		if (ndtf_getChannelSize(f) == 4 && !ndtf_getChannelIsFloat(f))
 		{
-			free(result);
+			ndtf_mem_free(NULL, result);
 			return NULL;
 		}
 
@@ -420,7 +469,7 @@ uint32_t* ndtf_loadFromFile_u32(FILE* file, uint16_t* width, uint16_t* height, u
 	{
 		if (ndtf_getChannelSize(f) == 4 && !ndtf_getChannelIsFloat(f))
 		{
-			free(result);
+			ndtf_mem_free(NULL, result);
 			return NULL;
 		}
 
@@ -439,7 +488,7 @@ uint32_t* ndtf_load_u32(const char* filename, uint16_t* width, uint16_t* height,
 	{
 		if (ndtf_getChannelSize(f) == 4 && !ndtf_getChannelIsFloat(f))
 		{
-			free(result);
+			ndtf_mem_free(NULL, result);
 			return NULL;
 		}
 
@@ -458,7 +507,7 @@ float* ndtf_loadFromData_f(uint8_t* data, size_t size, uint16_t* width, uint16_t
 	{
 		if (ndtf_getChannelSize(f) == 4 && ndtf_getChannelIsFloat(f))
 		{
-			free(result);
+			ndtf_mem_free(NULL, result);
 			return NULL;
 		}
 
@@ -477,7 +526,7 @@ float* ndtf_loadFromFile_f(FILE* file, uint16_t* width, uint16_t* height, uint16
 	{
 		if (ndtf_getChannelSize(f) == 4 && ndtf_getChannelIsFloat(f))
 		{
-			free(result);
+			ndtf_mem_free(NULL, result);
 			return NULL;
 		}
 
@@ -496,7 +545,7 @@ float* ndtf_load_f(const char* filename, uint16_t* width, uint16_t* height, uint
 	{
 		if (ndtf_getChannelSize(f) == 4 && ndtf_getChannelIsFloat(f))
 		{
-			free(result);
+			ndtf_mem_free(NULL, result);
 			return NULL;
 		}
 
@@ -507,174 +556,621 @@ float* ndtf_load_f(const char* filename, uint16_t* width, uint16_t* height, uint
 	return (float*)result;
 }
 
-bool ndtf_file_isValid(NDTF_File* file)
+bool ndtf_header_getTexelCount(const NDTF_Header* header, size_t* texels)
 {
-	return file->data && file->header.width && file->header.height;
+	size_t count = 1;
+	for (int i = 0; i < header->dimensions && i < NDTF_DIMENSIONS_MAX; i++)
+	{
+		if (!ndtf_size_mul(count, header->size[i], &count))
+			return false;
+	}
+	*texels = count;
+	return true;
 }
-
-void ndtf_file_reformat(NDTF_File* file, NDTF_TexelFormat desiredFormat)
+bool ndtf_header_getDataSize(const NDTF_Header* header, size_t* size)
 {
-	size_t totalTexels = 1;
-	for (int i = 0; i < file->header.dimensions; i++)
-		totalTexels *= file->header.size[i];
+	// block formats store 4x4 blocks of every slice
+	size_t blockSize = ndtf_getBlockSize((NDTF_TexelFormat)header->texelFormat);
+	if (blockSize)
+	{
+		size_t blocks = 1;
+		for (int i = 0; i < header->dimensions && i < NDTF_DIMENSIONS_MAX; i++)
+		{
+			if (!ndtf_size_mul(blocks, i < 2 ? ((size_t)header->size[i] + 3) / 4 : header->size[i], &blocks))
+				return false;
+		}
+		return ndtf_size_mul(blocks, blockSize, size);
+	}
 
-	size_t bpp = ndtf_getTexelSize((NDTF_TexelFormat)file->header.texelFormat);
-	size_t tDataSize = totalTexels * bpp;
+	size_t texels;
+	return ndtf_header_getTexelCount(header, &texels) &&
+		ndtf_size_mul(texels, ndtf_getTexelSize((NDTF_TexelFormat)header->texelFormat), size);
+}
+bool ndtf_header_isValid(const NDTF_Header* header)
+{
+	size_t dataSize;
+	if (memcmp(header->signature, NDTF_SIGNATURE, 4) != 0 ||
+		header->version > NDTF_VERSION ||
+		header->dimensions < NDTF_DIMENSIONS_MIN || header->dimensions > NDTF_DIMENSIONS_MAX ||
+		!ndtf_header_getDataSize(header, &dataSize))
+		return false;
 
-	if (desiredFormat != NDTF_TEXELFORMAT_NONE && (NDTF_TexelFormat)file->header.texelFormat != desiredFormat)
+	// v1.x headers can only hold 16 bit extents
+	if (NDTF_EXTRACT_VERSION_MAJOR(header->version) < 2)
 	{
-		union
+		for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
 		{
-			uint8_t* data;
-			uint8_t* data8b;
-			uint16_t* data16b;
-			uint32_t* data32b;
-			float* dataf;
-		} oldData;
-		oldData.data = file->data;
-
-		int8_t oldFormat = file->header.texelFormat;
-		file->header.texelFormat = desiredFormat;
+			if (header->size[i] > UINT16_MAX)
+				return false;
+		}
+	}
 
-		size_t nBPP = ndtf_getTexelSize((NDTF_TexelFormat)file->header.texelFormat);
-		size_t nTDataSize = totalTexels * nBPP;
-		file->data = (uint8_t*)malloc(nTDataSize);
+	// blocks are only stored as one payload
+	if (ndtf_getIsBlockCompressed((NDTF_TexelFormat)header->texelFormat) && (header->flags.segmented || header->flags.lossy || header->flags.planar))
+		return false;
 
-		NDTF_Channels oldChannels = ndtf_getChannelCount((NDTF_TexelFormat)oldFormat);
-		NDTF_Channels newChannels = ndtf_getChannelCount((NDTF_TexelFormat)desiredFormat);
-		size_t oldChannelSize = ndtf_getChannelSize((NDTF_TexelFormat)oldFormat);
-		size_t newChannelSize = ndtf_getChannelSize((NDTF_TexelFormat)desiredFormat);
-		bool oldCIsFloat = ndtf_getChannelIsFloat((NDTF_TexelFormat)oldFormat);
-		bool newCIsFloat = ndtf_getChannelIsFloat((NDTF_TexelFormat)desiredFormat);
+	return !header->flags.checksums || (header->flags.segmented && header->checksum == ndtf_header_computeChecksum(header));
+}
+size_t ndtf_header_storedSize(const NDTF_Header* header)
+{
+	return NDTF_EXTRACT_VERSION_MAJOR(header->version) < 2 ? NDTF_HEADER_SIZE_V1 : sizeof(NDTF_Header);
+}
+size_t ndtf_header_encode(const NDTF_Header* header, uint8_t out[sizeof(NDTF_Header)])
+{
+	if (NDTF_EXTRACT_VERSION_MAJOR(header->version) >= 2)
+	{
+		NDTF_Header stored = *header;
+		memset(stored.__padding__, 0, sizeof(stored.__padding__));
+		memcpy(out, &stored, sizeof(NDTF_Header));
+		return sizeof(NDTF_Header);
+	}
 
-		for (size_t i = 0; i < tDataSize; i += bpp)
-		{
-			size_t t = i / bpp;
+	ndtf_HeaderV1 stored;
+	memcpy(stored.signature, header->signature, 4);
+	stored.version = header->version;
+	stored.dimensions = header->dimensions;
+	stored.texelFormat = header->texelFormat;
+	stored.flags = header->flags;
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+		stored.size[i] = (uint16_t)header->size[i];
+	memcpy(stored.brickSize, header->brickSize, NDTF_DIMENSIONS_MAX);
+	stored.keyframeInterval = header->keyframeInterval;
+	stored.checksum = header->checksum;
+
+	memcpy(out, &stored, NDTF_HEADER_SIZE_V1);
+	return NDTF_HEADER_SIZE_V1;
+}
+size_t ndtf_header_decode(const uint8_t* data, size_t size, NDTF_Header* header)
+{
+	if (!data || size < NDTF_HEADER_SIZE_V1)
+		return 0;
+
+	ndtf_HeaderV1 stored;
+	memcpy(&stored, data, NDTF_HEADER_SIZE_V1);
+
+	NDTF_Header result;
+	if (NDTF_EXTRACT_VERSION_MAJOR(stored.version) >= 2)
+	{
+		if (size < sizeof(NDTF_Header))
+			return 0;
+		memcpy(&result, data, sizeof(NDTF_Header));
+	}
+	else
+	{
+		memset(&result, 0, sizeof(NDTF_Header));
+		memcpy(result.signature, stored.signature, 4);
+		result.version = stored.version;
+		result.dimensions = stored.dimensions;
+		result.texelFormat = stored.texelFormat;
+		result.flags = stored.flags;
+		for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+			result.size[i] = stored.size[i];
+		memcpy(result.brickSize, stored.brickSize, NDTF_DIMENSIONS_MAX);
+		result.keyframeInterval = stored.keyframeInterval;
+		result.checksum = stored.checksum;
+	}
+
+	if (!ndtf_header_isValid(&result))
+		return 0;
+
+	*header = result;
+	return ndtf_header_storedSize(&result);
+}
+bool ndtf_header_read(FILE* file, NDTF_Header* header)
+{
+	// the version in front of the extents tells how much follows
+	uint8_t data[sizeof(NDTF_Header)];
+	if (fread(data, 1, NDTF_HEADER_SIZE_V1, file) != NDTF_HEADER_SIZE_V1)
+		return false;
+
+	size_t size = NDTF_HEADER_SIZE_V1;
+	uint16_t version;
+	memcpy(&version, data + offsetof(NDTF_Header, version), sizeof(uint16_t));
+	if (NDTF_EXTRACT_VERSION_MAJOR(version) >= 2)
+	{
+		if (fread(data + size, 1, sizeof(NDTF_Header) - size, file) != sizeof(NDTF_Header) - size)
+			return false;
+		size = sizeof(NDTF_Header);
+	}
 
-			for (int j = 0; j < newChannels; j++)
+	return ndtf_header_decode(data, size, header) != 0;
+}
+bool ndtf_header_write(FILE* file, const NDTF_Header* header)
+{
+	uint8_t data[sizeof(NDTF_Header)];
+	size_t size = ndtf_header_encode(header, data);
+	return fwrite(data, 1, size, file) == size;
+}
+bool ndtf_probeData(const uint8_t* data, size_t size, NDTF_Header* header)
+{
+	NDTF_Header result;
+	if (!ndtf_header_decode(data, size, &result))
+		return false;
+
+	if (header) *header = result;
+	return true;
+}
+bool ndtf_probeFile(FILE* file, NDTF_Header* header)
+{
+	if (!file)
+		return false;
+
+	NDTF_Header result;
+	if (!ndtf_header_read(file, &result))
+		return false;
+
+	if (header) *header = result;
+	return true;
+}
+bool ndtf_probe(const char* filename, NDTF_Header* header)
+{
+	FILE* file = fopen(filename, "rb");
+	if (!file)
+		return false;
+
+	setvbuf(file, NULL, _IONBF, 0); // only the header is read, skip the stdio buffer
+
+	bool result = ndtf_probeFile(file, header);
+	fclose(file);
+
+	return result;
+}
+
+bool ndtf_file_isValid(NDTF_File* file)
+{
+	return file->data && file->header.width && file->header.height;
+}
+
+#define NDTF_REFORMAT_CHUNK_MIN ((size_t)1 << 20) // output bytes below which a chunk is not worth a task
+#define NDTF_REFORMAT_STAGING_MIN ((size_t)8 << 20) // output bytes converted per step of the in-place conversion, at least
+#define NDTF_REFORMAT_FALLBACK_SIZE ((size_t)16 << 10) // staging on the stack when the staging buffer can not be allocated
+
+typedef union ndtf_TexelData
+{
+	uint8_t* data;
+	uint8_t* data8b;
+	uint16_t* data16b;
+	uint32_t* data32b;
+	float* dataf;
+} ndtf_TexelData;
+
+typedef struct ndtf_Reformat
+{
+	ndtf_TexelData oldData;
+	ndtf_TexelData newData;
+	NDTF_TexelFormat oldFormat;
+	NDTF_TexelFormat newFormat;
+	size_t texels;
+	size_t chunkTexels;
+} ndtf_Reformat;
+
+// converts the texels [begin, end), every texel only depends on its own source texel
+static void ndtf_reformatTexels(const ndtf_Reformat* reformat, size_t begin, size_t end)
+{
+	ndtf_TexelData src = reformat->oldData;
+	ndtf_TexelData dst = reformat->newData;
+
+	NDTF_Channels oldChannels = ndtf_getChannelCount(reformat->oldFormat);
+	NDTF_Channels newChannels = ndtf_getChannelCount(reformat->newFormat);
+	size_t oldChannelSize = ndtf_getChannelSize(reformat->oldFormat);
+	size_t newChannelSize = ndtf_getChannelSize(reformat->newFormat);
+	bool oldCIsFloat = ndtf_getChannelIsFloat(reformat->oldFormat);
+	bool newCIsFloat = ndtf_getChannelIsFloat(reformat->newFormat);
+
+	for (size_t t = begin; t < end; t++)
+	{
+		for (int j = 0; j < newChannels; j++)
+		{
+			switch (oldChannelSize)
+			{
+			case 1:
 			{
-				switch (oldChannelSize)
+				switch (newChannelSize)
 				{
 				case 1:
 				{
-					switch (newChannelSize)
-					{
-					case 1:
+					if (j < oldChannels)
+						dst.data8b[t * newChannels + j] = src.data8b[t * oldChannels + j];
+					else
+						dst.data8b[t * newChannels + j] = UINT8_MAX;
+				} break;
+				case 2:
+				{
+					if (j < oldChannels)
+						dst.data16b[t * newChannels + j] = (size_t)src.data8b[t * oldChannels + j] * UINT16_MAX / UINT8_MAX;
+					else
+						dst.data16b[t * newChannels + j] = UINT16_MAX;
+				} break;
+				case 4:
+				{
+					if (newCIsFloat)
 					{
 						if (j < oldChannels)
-							file->data8b[t * newChannels + j] = oldData.data8b[t * oldChannels + j];
+							dst.dataf[t * newChannels + j] = (float)src.data8b[t * oldChannels + j] / UINT8_MAX;
 						else
-							file->data8b[t * newChannels + j] = UINT8_MAX;
-					} break;
-					case 2:
+							dst.dataf[t * newChannels + j] = 1.0f;
+					}
+					else
 					{
 						if (j < oldChannels)
-							file->data16b[t * newChannels + j] = (size_t)oldData.data8b[t * oldChannels + j] * UINT16_MAX / UINT8_MAX;
-						else
-							file->data16b[t * newChannels + j] = UINT16_MAX;
-					} break;
-					case 4:
-					{
-						if (newCIsFloat)
-						{
-							if (j < oldChannels)
-								file->dataf[t * newChannels + j] = (float)oldData.data8b[t * oldChannels + j] / UINT8_MAX;
-							else
-								file->dataf[t * newChannels + j] = 1.0f;
-						}
+							dst.data32b[t * newChannels + j] = (size_t)src.data8b[t * oldChannels + j] * UINT32_MAX / UINT8_MAX;
 						else
-						{
-							if (j < oldChannels)
-								file->data32b[t * newChannels + j] = (size_t)oldData.data8b[t * oldChannels + j] * UINT32_MAX / UINT8_MAX;
-							else
-								file->data32b[t * newChannels + j] = UINT32_MAX;
-						}
-					} break;
+							dst.data32b[t * newChannels + j] = UINT32_MAX;
 					}
 				} break;
+				}
+			} break;
+			case 2:
+			{
+				switch (newChannelSize)
+				{
+				case 1:
+				{
+					if (j < oldChannels)
+						dst.data8b[t * newChannels + j] = src.data16b[t * oldChannels + j] * UINT8_MAX / UINT16_MAX;
+					else
+						dst.data8b[t * newChannels + j] = UINT8_MAX;
+				} break;
 				case 2:
 				{
-					switch (newChannelSize)
-					{
-					case 1:
+					if (j < oldChannels)
+						dst.data16b[t * newChannels + j] = src.data16b[t * oldChannels + j];
+					else
+						dst.data16b[t * newChannels + j] = UINT16_MAX;
+				} break;
+				case 4:
+				{
+					if (newCIsFloat)
 					{
 						if (j < oldChannels)
-							file->data8b[t * newChannels + j] = oldData.data8b[t * oldChannels + j] * UINT8_MAX / UINT16_MAX;
+							dst.dataf[t * newChannels + j] = (float)src.data16b[t * oldChannels + j] / UINT16_MAX;
 						else
-							file->data8b[t * newChannels + j] = UINT8_MAX;
-					} break;
-					case 2:
+							dst.dataf[t * newChannels + j] = 1.0f;
+					}
+					else
 					{
 						if (j < oldChannels)
-							file->data16b[t * newChannels + j] = oldData.data16b[t * oldChannels + j];
+							dst.data32b[t * newChannels + j] = (size_t)src.data16b[t * oldChannels + j] * UINT32_MAX / UINT16_MAX;
 						else
-							file->data16b[t * newChannels + j] = UINT16_MAX;
-					} break;
-					case 4:
-					{
-						if (newCIsFloat)
-						{
-							if (j < oldChannels)
-								file->dataf[t * newChannels + j] = (float)oldData.data16b[t * oldChannels + j] / UINT16_MAX;
-							else
-								file->dataf[t * newChannels + j] = 1.0f;
-						}
-						else
-						{
-							if (j < oldChannels)
-								file->data32b[t * newChannels + j] = (size_t)oldData.data16b[t * oldChannels + j] * UINT32_MAX / UINT16_MAX;
-							else
-								file->data32b[t * newChannels + j] = UINT32_MAX;
-						}
-					} break;
+							dst.data32b[t * newChannels + j] = UINT32_MAX;
 					}
 				} break;
+				}
+			} break;
+			case 4:
+			{
+				switch (newChannelSize)
+				{
+				case 1:
+				{
+					if (j < oldChannels)
+						dst.data8b[t * newChannels + j] = (uint8_t)(oldCIsFloat ? src.dataf[t * oldChannels + j] * UINT8_MAX : src.data32b[t * oldChannels + j] / 0x1000000u);
+					else
+						dst.data8b[t * newChannels + j] = UINT8_MAX;
+				} break;
+				case 2:
+				{
+					if (j < oldChannels)
+						dst.data16b[t * newChannels + j] = (uint16_t)(oldCIsFloat ? src.dataf[t * oldChannels + j] * UINT16_MAX : src.data32b[t * oldChannels + j] / 0x10000u);
+					else
+						dst.data16b[t * newChannels + j] = UINT16_MAX;
+				} break;
 				case 4:
 				{
-					switch (newChannelSize)
-					{
-					case 1:
+					if (newCIsFloat)
 					{
 						if (j < oldChannels)
-							file->data8b[t * newChannels + j] = (uint8_t)(oldCIsFloat ? oldData.dataf[t * oldChannels + j] * UINT8_MAX : oldData.data32b[t * oldChannels + j] / 0x1000000u);
+							dst.dataf[t * newChannels + j] = (oldCIsFloat ? src.dataf[t * oldChannels + j] : (float)src.data32b[t * oldChannels + j] / UINT32_MAX);
 						else
-							file->data8b[t * newChannels + j] = UINT8_MAX;
-					} break;
-					case 2:
+							dst.dataf[t * newChannels + j] = 1.0f;
+					}
+					else
 					{
 						if (j < oldChannels)
-							file->data16b[t * newChannels + j] = (uint16_t)(oldCIsFloat ? oldData.dataf[t * oldChannels + j] * UINT16_MAX : oldData.data32b[t * oldChannels + j] / 0x10000u);
+							dst.data32b[t * newChannels + j] = (uint32_t)(oldCIsFloat ? src.dataf[t * oldChannels + j] * UINT32_MAX : src.data32b[t * oldChannels + j]);
 						else
-							file->data16b[t * newChannels + j] = UINT16_MAX;
-					} break;
-					case 4:
-					{
-						if (newCIsFloat)
-						{
-							if (j < oldChannels)
-								file->dataf[t * newChannels + j] = (oldCIsFloat ? oldData.dataf[t * oldChannels + j] : (float)oldData.data32b[t * oldChannels + j] / UINT32_MAX);
-							else
-								file->dataf[t * newChannels + j] = 1.0f;
-						}
-						else
-						{
-							if (j < oldChannels)
-								file->data32b[t * newChannels + j] = (uint32_t)(oldCIsFloat ? oldData.dataf[t * oldChannels + j] * UINT32_MAX : oldData.data32b[t * oldChannels + j]);
-							else
-								file->data32b[t * newChannels + j] = UINT32_MAX;
-						}
-					} break;
+							dst.data32b[t * newChannels + j] = UINT32_MAX;
 					}
 				} break;
 				}
+			} break;
 			}
 		}
+	}
+}
+
+static void ndtf_reformatTask(void* taskData, size_t index)
+{
+	const ndtf_Reformat* reformat = (const ndtf_Reformat*)taskData;
+	size_t begin = index * reformat->chunkTexels;
+	ndtf_reformatTexels(reformat, begin, min(begin + reformat->chunkTexels, reformat->texels));
+}
+
+void ndtf_reformat_convert(NDTF_TexelFormat oldFormat, const uint8_t* src, NDTF_TexelFormat newFormat, uint8_t* dst, size_t count, const NDTF_Context* ctx)
+{
+	ndtf_Reformat reformat;
+	reformat.oldData.data = (uint8_t*)src;
+	reformat.newData.data = dst;
+	reformat.oldFormat = oldFormat;
+	reformat.newFormat = newFormat;
+	reformat.texels = count;
+
+	size_t chunks = min(ndtf_concurrency(ctx) * 4, max(count * ndtf_getTexelSize(newFormat) / NDTF_REFORMAT_CHUNK_MIN, 1));
+	reformat.chunkTexels = max((count + chunks - 1) / chunks, 1);
+	ndtf_parallelFor(ctx, ndtf_reformatTask, &reformat, (count + reformat.chunkTexels - 1) / reformat.chunkTexels);
+}
+
+// staged output of one step of the in-place conversion, copied back once every texel of the step was read
+typedef struct ndtf_ReformatCopy
+{
+	uint8_t* dst;
+	const uint8_t* src;
+	size_t size;
+	size_t chunkSize;
+} ndtf_ReformatCopy;
+
+static void ndtf_reformatCopyTask(void* taskData, size_t index)
+{
+	const ndtf_ReformatCopy* copy = (const ndtf_ReformatCopy*)taskData;
+	size_t begin = index * copy->chunkSize;
+	memcpy(copy->dst + begin, copy->src + begin, min(copy->chunkSize, copy->size - begin));
+}
+
+// output bytes of a step of the in-place conversion, four chunks per thread of the global executor at most so
+// ndtf_file_getReformatMemory holds for every context
+static size_t ndtf_reformat_stagingSize(const NDTF_Context* ctx)
+{
+	size_t threads = min(ndtf_concurrency(ctx), ndtf_concurrency(NULL));
+	return max(threads * 4 * NDTF_REFORMAT_CHUNK_MIN, NDTF_REFORMAT_STAGING_MIN);
+}
 
-		free(oldData.data); // remove original file data
+void ndtf_file_reformat(NDTF_File* file, NDTF_TexelFormat desiredFormat)
+{
+	ndtf_file_reformat_ex(file, desiredFormat, NULL);
+}
+size_t ndtf_file_getReformatMemory(NDTF_File* file, NDTF_TexelFormat desiredFormat)
+{
+	size_t totalTexels;
+	size_t oTDataSize;
+	if (!ndtf_header_getTexelCount(&file->header, &totalTexels) || !ndtf_header_getDataSize(&file->header, &oTDataSize))
+		return SIZE_MAX;
+
+	NDTF_TexelFormat oldFormat = (NDTF_TexelFormat)file->header.texelFormat;
+	if (desiredFormat == NDTF_TEXELFORMAT_NONE || oldFormat == desiredFormat)
+		return oTDataSize;
+
+	// block formats go through their decoded formats, every step holds both of its buffers
+	if (ndtf_getIsBlockCompressed(oldFormat) || ndtf_getIsBlockCompressed(desiredFormat))
+	{
+		NDTF_Header desired = file->header;
+		desired.texelFormat = desiredFormat;
+		size_t nTDataSize;
+		if (!ndtf_header_getDataSize(&desired, &nTDataSize))
+			return SIZE_MAX;
+
+		NDTF_TexelFormat decodedOld = ndtf_getDecodedTexelFormat(oldFormat);
+		NDTF_TexelFormat decodedNew = ndtf_getDecodedTexelFormat(desiredFormat);
+		size_t decodedOldSize, decodedNewSize;
+		if (!ndtf_size_mul(totalTexels, ndtf_getTexelSize(decodedOld), &decodedOldSize) ||
+			!ndtf_size_mul(totalTexels, ndtf_getTexelSize(decodedNew), &decodedNewSize))
+			return SIZE_MAX;
+
+		size_t peak = 0;
+		size_t held = oTDataSize;
+		size_t step;
+		if (decodedOld != oldFormat)
+		{
+			if (!ndtf_size_add(held, decodedOldSize, &step))
+				return SIZE_MAX;
+			peak = max(peak, step);
+			held = decodedOldSize;
+		}
+		if (decodedNew != decodedOld)
+		{
+			if (!ndtf_size_add(held, decodedNewSize, &step))
+				return SIZE_MAX;
+			peak = max(peak, step);
+			held = decodedNewSize;
+		}
+		if (decodedNew != desiredFormat)
+		{
+			if (!ndtf_size_add(held, nTDataSize, &step))
+				return SIZE_MAX;
+			peak = max(peak, step);
+		}
+		return peak;
+	}
+
+	size_t nTDataSize;
+	if (!ndtf_size_mul(totalTexels, ndtf_getTexelSize(desiredFormat), &nTDataSize) || nTDataSize > SIZE_MAX - oTDataSize)
+		return SIZE_MAX;
+	size_t staging = min(nTDataSize, ndtf_reformat_stagingSize(NULL));
+	if (nTDataSize <= oTDataSize)
+		return oTDataSize + staging;
+
+	// growing the buffer may move it, which briefly holds both
+	return max(oTDataSize + nTDataSize, nTDataSize + staging);
+}
+
+// block formats are decoded and encoded through their decoded formats into new buffers
+static void ndtf_file_reformatBlocks(NDTF_File* file, NDTF_TexelFormat desiredFormat, size_t totalTexels, const NDTF_Context* ctx)
+{
+	const NDTF_Allocator* allocator = ndtf_file_allocator(file);
+	NDTF_TexelFormat format = (NDTF_TexelFormat)file->header.texelFormat;
+	size_t width = file->header.size[0], height = file->header.size[1];
+	size_t slices = width && height ? totalTexels / (width * height) : 0;
+
+	NDTF_Header desired = file->header;
+	desired.texelFormat = desiredFormat;
+	size_t nTDataSize;
+	if (!ndtf_header_getDataSize(&desired, &nTDataSize))
+		return;
+
+	// every step replaces data with a buffer of the next format
+	uint8_t* data = file->data;
+	NDTF_TexelFormat decoded = ndtf_getDecodedTexelFormat(desiredFormat);
+	while (format != desiredFormat)
+	{
+		NDTF_TexelFormat next = ndtf_getIsBlockCompressed(format) ? ndtf_getDecodedTexelFormat(format) : format != decoded ? decoded : desiredFormat;
+		size_t size = nTDataSize;
+		uint8_t* converted = NULL;
+		if (next == desiredFormat || ndtf_size_mul(totalTexels, ndtf_getTexelSize(next), &size))
+			converted = (uint8_t*)ndtf_mem_allocWith(allocator, ctx, max(size, 1));
+		if (!converted)
+		{
+			if (data != file->data)
+				ndtf_mem_freeWith(allocator, ctx, data);
+			return;
+		}
+
+		if (ndtf_getIsBlockCompressed(format))
+			ndtf_bc_decode(format, data, converted, width, height, slices, ctx);
+		else if (ndtf_getIsBlockCompressed(next))
+			ndtf_bc_encode(next, data, converted, width, height, slices, ctx);
+		else
+		{
+			NDTF_SCOPE_BEGIN(convertScope, ctx, NDTF_PHASE_CONVERT, "reformat");
+			ndtf_reformat_convert(format, data, next, converted, totalTexels, ctx);
+			NDTF_SCOPE_END(convertScope, ctx, size);
+		}
+
+		if (data != file->data)
+			ndtf_mem_freeWith(allocator, ctx, data);
+		data = converted;
+		format = next;
+	}
+
+	ndtf_mem_freeWith(allocator, ctx, file->data);
+	file->data = data;
+	file->header.texelFormat = desiredFormat;
+}
+
+void ndtf_file_reformat_ex(NDTF_File* file, NDTF_TexelFormat desiredFormat, const NDTF_Context* ctx)
+{
+	size_t totalTexels;
+	if (!ndtf_header_getTexelCount(&file->header, &totalTexels))
+		return;
+
+	if (desiredFormat != NDTF_TEXELFORMAT_NONE && (NDTF_TexelFormat)file->header.texelFormat != desiredFormat &&
+		(ndtf_getIsBlockCompressed((NDTF_TexelFormat)file->header.texelFormat) || ndtf_getIsBlockCompressed(desiredFormat)))
+	{
+		ndtf_file_reformatBlocks(file, desiredFormat, totalTexels, ctx);
+		return;
+	}
+
+	if (desiredFormat != NDTF_TEXELFORMAT_NONE && (NDTF_TexelFormat)file->header.texelFormat != desiredFormat)
+	{
+		const NDTF_Allocator* allocator = ndtf_file_allocator(file);
+
+		ndtf_Reformat reformat;
+		reformat.oldFormat = (NDTF_TexelFormat)file->header.texelFormat;
+		reformat.newFormat = desiredFormat;
+
+		size_t oBPP = ndtf_getTexelSize(reformat.oldFormat);
+		size_t nBPP = ndtf_getTexelSize(desiredFormat);
+		size_t oTDataSize = totalTexels * oBPP;
+		size_t nTDataSize;
+		if (!ndtf_size_mul(totalTexels, nBPP, &nTDataSize))
+			return;
+
+		// the conversion runs in place: steps of texels are converted chunk by chunk into a staging buffer and
+		// copied back once the whole step was read. shrinking formats step forward, the output never passes the
+		// unread input. widening formats grow the buffer first and step backward from the end for the same reason
+		bool forward = nBPP <= oBPP;
+		if (!forward)
+		{
+			uint8_t* grown = (uint8_t*)ndtf_mem_reallocWith(allocator, ctx, file->data, oTDataSize, nTDataSize);
+			if (!grown)
+				return;
+			file->data = grown;
+		}
+
+		// without memory for the staging buffer a grown file is still converted, one small step at a time
+		uint8_t fallback[NDTF_REFORMAT_FALLBACK_SIZE];
+		size_t stepTexels = max(min(nTDataSize, ndtf_reformat_stagingSize(ctx)) / nBPP, 1);
+		uint8_t* staging = (uint8_t*)ndtf_mem_alloc(ctx, stepTexels * nBPP);
+		if (!staging)
+		{
+			staging = fallback;
+			stepTexels = sizeof(fallback) / nBPP;
+		}
+
+		NDTF_SCOPE_BEGIN(convertScope, ctx, NDTF_PHASE_CONVERT, "reformat");
+
+		size_t chunks = min(ndtf_concurrency(ctx) * 4, max(stepTexels * nBPP / NDTF_REFORMAT_CHUNK_MIN, 1));
+		reformat.chunkTexels = max((stepTexels + chunks - 1) / chunks, 1);
+		reformat.newData.data = staging;
+
+		ndtf_ReformatCopy copy;
+		copy.src = staging;
+		copy.chunkSize = reformat.chunkTexels * nBPP;
+
+		size_t steps = (totalTexels + stepTexels - 1) / stepTexels;
+		for (size_t s = 0; s < steps; s++)
+		{
+			size_t begin = (forward ? s : steps - 1 - s) * stepTexels;
+			reformat.texels = min(stepTexels, totalTexels - begin);
+			reformat.oldData.data = file->data + begin * oBPP;
+			size_t stepChunks = (reformat.texels + reformat.chunkTexels - 1) / reformat.chunkTexels;
+
+			ndtf_parallelFor(ctx, ndtf_reformatTask, &reformat, stepChunks);
+
+			copy.dst = file->data + begin * nBPP;
+			copy.size = reformat.texels * nBPP;
+			ndtf_parallelFor(ctx, ndtf_reformatCopyTask, &copy, stepChunks);
+		}
+
+		NDTF_SCOPE_END(convertScope, ctx, nTDataSize);
+
+		if (staging != fallback)
+			ndtf_mem_free(ctx, staging);
+
+		file->header.texelFormat = desiredFormat;
+
+		// give back the tail where the allocator shrinks in place, a copy would raise the peak again
+		if (nTDataSize < oTDataSize && allocator->realloc)
+		{
+			uint8_t* shrunk = (uint8_t*)ndtf_mem_reallocWith(allocator, ctx, file->data, oTDataSize, nTDataSize);
+			if (shrunk)
+				file->data = shrunk;
+		}
 	}
 }
 
 NDTF_File ndtf_file_create(NDTF_Dimensions dimensions, NDTF_TexelFormat texelFormat, uint16_t width, uint16_t height, uint16_t depth, uint16_t ind, uint16_t ind2)
+{
+	return ndtf_file_create_ex(dimensions, texelFormat, width, height, depth, ind, ind2, NULL);
+}
+NDTF_File ndtf_file_create_ex(NDTF_Dimensions dimensions, NDTF_TexelFormat texelFormat, uint16_t width, uint16_t height, uint16_t depth, uint16_t ind, uint16_t ind2, const NDTF_Context* ctx)
+{
+	uint32_t size[NDTF_DIMENSIONS_MAX] = { width, height, depth, ind, ind2 };
+	return ndtf_file_create_ND_ex(dimensions, texelFormat, size, ctx);
+}
+NDTF_File ndtf_file_create_ND(NDTF_Dimensions dimensions, NDTF_TexelFormat texelFormat, const uint32_t size[NDTF_DIMENSIONS_MAX])
+{
+	return ndtf_file_create_ND_ex(dimensions, texelFormat, size, NULL);
+}
+NDTF_File ndtf_file_create_ND_ex(NDTF_Dimensions dimensions, NDTF_TexelFormat texelFormat, const uint32_t size[NDTF_DIMENSIONS_MAX], const NDTF_Context* ctx)
 {
 	NDTF_File result;
 	memset(&result, 0, sizeof(NDTF_File));
@@ -683,20 +1179,18 @@ NDTF_File ndtf_file_create(NDTF_Dimensions dimensions, NDTF_TexelFormat texelFor
 	result.header.version = NDTF_VERSION;
 	result.header.dimensions = dimensions;
 	result.header.texelFormat = texelFormat;
-	result.header.width = max(width, 1);
-	result.header.height = max(height, 1);
-	result.header.depth = max(depth, 1);
-	result.header.ind = max(ind, 1);
-	result.header.ind2 = max(ind2, 1);
-
-	size_t totalTexels = 1;
-	for (int i = 0; i < dimensions; i++)
-		totalTexels *= result.header.size[i];
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+		result.header.size[i] = max(size[i], 1);
 
-	size_t bpp = ndtf_getTexelSize(texelFormat);
-	size_t tDataSize = totalTexels * bpp;
+	size_t tDataSize;
+	if (!ndtf_header_getDataSize(&result.header, &tDataSize))
+	{
+		memset(&result, 0, sizeof(NDTF_File));
+		return result;
+	}
 
-	result.data = (uint8_t*)malloc(tDataSize);
+	result.allocator = ndtf_mem_allocator(ctx);
+	result.data = (uint8_t*)ndtf_mem_alloc(ctx, tDataSize);
 
 	return result;
 }
@@ -718,7 +1212,9 @@ NDTF_File ndtf_file_create_5D(NDTF_TexelFormat texelFormat, uint16_t width, uint
 }
 size_t ndtf_file_getTexelIndex(NDTF_File* file, NDTF_Coord* coordPtr)
 {
-	NDTF_Channels channels = ndtf_getChannelCount((NDTF_TexelFormat)file->header.texelFormat);
+	// texels of block formats have no address of their own
+	if (ndtf_getIsBlockCompressed((NDTF_TexelFormat)file->header.texelFormat))
+		return SIZE_MAX;
 
 	size_t ind = 0;
 	for (int i = 0; i < file->header.dimensions; i++)
@@ -822,11 +1318,7 @@ void* ndtf_file_getTexel(NDTF_File* file, NDTF_Coord* coordPtr)
 {
 	size_t ind = ndtf_file_getTexelIndex(file, coordPtr);
 
-	size_t totalTexels = 1;
-	for (int i = 0; i < file->header.dimensions; i++)
-		totalTexels *= file->header.size[i];
-	size_t bpp = ndtf_getTexelSize((NDTF_TexelFormat)file->header.texelFormat);
-	size_t tDataSize = totalTexels * bpp;
+	size_t tDataSize = ndtf_file_getDataSize(file);
 
 	if (ind >= tDataSize) return NULL;
 
@@ -874,71 +1366,246 @@ void* ndtf_file_getTexel_5D(NDTF_File* file, uint16_t x, uint16_t y, uint16_t z,
 }
 void* ndtf_file_saveToData(NDTF_File* file, size_t* size)
 {
-	if (!ndtf_file_isValid(file)) return NULL;
+	return ndtf_file_saveToData_ex(file, size, NULL);
+}
+bool ndtf_file_saveToFile(NDTF_File* file, FILE* handle)
+{
+	return ndtf_file_saveToFile_ex(file, handle, NULL);
+}
+bool ndtf_file_save(NDTF_File* file, const char* filename)
+{
+	return ndtf_file_save_ex(file, filename, NULL);
+}
+// bricks of a segmented file, they are transformed and their statistics collected while every brick is in cache for
+// its encode
+static bool ndtf_file_encodeSegments(NDTF_File* file, ndtf_EncodedSegments* encoded, const NDTF_Context* ctx)
+{
+	ndtf_TexelStatsSink texelStats;
+	bool fused = ctx && ctx->texelStats && ndtf_texelStats_begin(&texelStats, ctx->texelStats, (NDTF_TexelFormat)file->header.texelFormat);
+
+	bool result = ndtf_segments_encode(file, encoded, fused ? &texelStats : NULL, ctx ? ctx->transform : NULL, NULL, ctx);
+	if (fused)
+		ndtf_texelStats_end(&texelStats);
 
-	size_t fileSize = sizeof(NDTF_Header);
+	return result;
+}
+
+// texels of a non segmented file as they are stored, a transformed copy when the context has a transform
+static bool ndtf_file_storedTexels(NDTF_File* file, NDTF_File* stored, const NDTF_Context* ctx)
+{
+	*stored = *file;
+	if (!ctx || !ctx->transform)
+		return true;
 
 	size_t dataSize = ndtf_file_getDataSize(file);
+	stored->data = (uint8_t*)ndtf_mem_alloc(ctx, max(dataSize, 1));
+	if (!stored->data)
+		return false;
+	ndtf_transform_runParallel(ctx->transform, file->data, stored->data, dataSize / ndtf_getTexelSize((NDTF_TexelFormat)file->header.texelFormat), ctx);
+	return true;
+}
 
-	fileSize += dataSize;
+// compressed payload, or data itself with the codec of header set to none when it does not shrink by the least gain
+static void* ndtf_compressPayload(void* data, NDTF_Header* header, size_t* dataSize, const NDTF_Context* ctx)
+{
+	NDTF_Codec codec = (NDTF_Codec)header->flags.codec;
+	size_t size = *dataSize;
+	if (ndtf_codec_isPromising(codec, data, size, ctx))
+	{
+		void* compressed = ndtf_compress(codec, data, size, dataSize, ctx);
+		if (!compressed || ndtf_codec_pays(codec, size, *dataSize, ctx))
+			return compressed;
+		ndtf_mem_free(ctx, compressed);
+		*dataSize = size;
+	}
+
+	header->flags.codec = NDTF_CODEC_NONE;
+	return data;
+}
+
+// payload of a non segmented file, file->data itself when it is stored as is
+static void* ndtf_encodePayload(NDTF_File* file, NDTF_Header* header, size_t* dataSize, const NDTF_Context* ctx)
+{
+	if (header->flags.lossy)
+	{
+		ndtf_Bricks bricks;
+		ndtf_bricks_init(&bricks, header);
+		ndtf_LossyBound bound;
+		ndtf_lossy_resolveFile(&bound, file, NULL, ctx);
+		return ndtf_lossy_encode(header, file->data, bricks.size, &bound, 0, dataSize, ctx);
+	}
+
+	if (!ndtf_planar_enabled(header))
+	{
+		if (header->flags.codec != NDTF_CODEC_NONE)
+			return ndtf_compressPayload(file->data, header, dataSize, ctx);
+		return file->data;
+	}
+
+	NDTF_TexelFormat texelFormat = (NDTF_TexelFormat)header->texelFormat;
+	uint8_t* planes = (uint8_t*)ndtf_mem_alloc(ctx, *dataSize);
+	if (!planes)
+		return NULL;
+	ndtf_planar_split(texelFormat, file->data, planes, *dataSize / ndtf_getTexelSize(texelFormat), ctx);
+
+	if (header->flags.codec == NDTF_CODEC_NONE)
+		return planes;
 
-	uint8_t* data = (uint8_t*)malloc(fileSize);
+	void* compressed = ndtf_compressPayload(planes, header, dataSize, ctx);
+	if (compressed != planes)
+		ndtf_mem_free(ctx, planes);
+	return compressed;
+}
+
+void* ndtf_file_saveToData_ex(NDTF_File* file, size_t* size, const NDTF_Context* ctx)
+{
+	if (!ndtf_file_isValid(file) || !ndtf_transform_fits(ctx, (NDTF_TexelFormat)file->header.texelFormat)) return NULL;
 
-	if (!data) return NULL;
+	NDTF_Header header;
+	ndtf_header_prepare(&file->header, &header);
 
-	memcpy(data, &file->header, sizeof(NDTF_Header));
+	if (header.flags.segmented)
+	{
+		ndtf_EncodedSegments encoded;
+		if (!ndtf_file_encodeSegments(file, &encoded, ctx)) return NULL;
 
-	void* fileData = file->data;
-	if (ndtf_file_getZLibCompression(file))
-		fileData = ndtf_zLibCompressData(fileData, dataSize, &dataSize);
+		uint8_t* data = (uint8_t*)ndtf_mem_alloc(ctx, encoded.totalSize);
+		if (data)
+		{
+			size_t count = (size_t)encoded.table.count;
+			size_t headerSize = ndtf_header_encode(&header, data);
+			memcpy(data + headerSize, &encoded.table, sizeof(NDTF_SegmentTable));
+			memcpy(data + headerSize + sizeof(NDTF_SegmentTable), encoded.segments, count * sizeof(NDTF_Segment));
+			if (encoded.zoneMaps)
+			{
+				uint8_t* zone = data + headerSize + sizeof(NDTF_SegmentTable) + count * sizeof(NDTF_Segment);
+				memcpy(zone, &encoded.zoneTable, sizeof(NDTF_ZoneMapTable));
+				memcpy(zone + sizeof(NDTF_ZoneMapTable), encoded.zoneMaps, (size_t)encoded.zoneTable.count * sizeof(NDTF_ValueRange));
+			}
+			for (size_t i = 0; i < count; i++)
+			{
+				if (!encoded.original || encoded.original[i] == i)
+					memcpy(data + encoded.segments[i].offset, encoded.data[i], (size_t)encoded.segments[i].size);
+			}
+
+			if (size)
+				*size = encoded.totalSize;
+		}
+
+		ndtf_segments_freeEncoded(&encoded, ctx);
+		return data;
+	}
+
+	size_t dataSize = ndtf_file_getDataSize(file);
+
+	NDTF_File stored;
+	if (!ndtf_file_storedTexels(file, &stored, ctx)) return NULL;
+
+	if (ctx && ctx->texelStats)
+		ndtf_file_computeTexelStats(&stored, ctx->texelStats, ctx);
+
+	void* fileData = ndtf_encodePayload(&stored, &header, &dataSize, ctx);
+	// a transformed copy is only kept when it is the payload itself
+	if (stored.data != file->data && fileData != stored.data)
+		ndtf_mem_free(ctx, stored.data);
 	if (!fileData) return NULL;
 
-	memcpy(data + sizeof(NDTF_Header), fileData, dataSize);
+	size_t headerSize = ndtf_header_storedSize(&header);
+	size_t fileSize = headerSize + dataSize;
+
+	uint8_t* data = (uint8_t*)ndtf_mem_alloc(ctx, fileSize);
 
-	if (ndtf_file_getZLibCompression(file))
-		free(fileData);
+	if (data)
+	{
+		ndtf_header_encode(&header, data);
+		memcpy(data + headerSize, fileData, dataSize);
+
+		if (size)
+			*size = fileSize;
+	}
 
-	if (size)
-		*size = fileSize;
+	if (fileData != file->data)
+		ndtf_mem_free(ctx, fileData);
 
 	return data;
 }
-bool ndtf_file_saveToFile(NDTF_File* file, FILE* handle)
+bool ndtf_file_saveToFile_ex(NDTF_File* file, FILE* handle, const NDTF_Context* ctx)
 {
-	if (!ndtf_file_isValid(file)) return false;
+	if (!ndtf_file_isValid(file) || !ndtf_transform_fits(ctx, (NDTF_TexelFormat)file->header.texelFormat)) return false;
 
 	if (!handle) return false;
 
-	size_t bytesWritten;
+	NDTF_Header header;
+	ndtf_header_prepare(&file->header, &header);
 
-	bytesWritten = fwrite(&file->header, sizeof(uint8_t), sizeof(NDTF_Header), handle);
-	if (bytesWritten < sizeof(NDTF_Header)) return false;
+	if (header.flags.segmented)
+	{
+		ndtf_EncodedSegments encoded;
+		if (!ndtf_file_encodeSegments(file, &encoded, ctx)) return false;
+
+		size_t count = (size_t)encoded.table.count;
+
+		NDTF_SCOPE_BEGIN(segmentIoScope, ctx, NDTF_PHASE_IO, "fwrite");
+
+		bool written = ndtf_header_write(handle, &header) &&
+			fwrite(&encoded.table, sizeof(uint8_t), sizeof(NDTF_SegmentTable), handle) == sizeof(NDTF_SegmentTable) &&
+			fwrite(encoded.segments, sizeof(NDTF_Segment), count, handle) == count;
+		if (written && encoded.zoneMaps)
+		{
+			written = fwrite(&encoded.zoneTable, sizeof(uint8_t), sizeof(NDTF_ZoneMapTable), handle) == sizeof(NDTF_ZoneMapTable) &&
+				fwrite(encoded.zoneMaps, sizeof(NDTF_ValueRange), (size_t)encoded.zoneTable.count, handle) == encoded.zoneTable.count;
+		}
+		for (size_t i = 0; i < count && written; i++)
+		{
+			if (!encoded.original || encoded.original[i] == i)
+				written = fwrite(encoded.data[i], sizeof(uint8_t), (size_t)encoded.segments[i].size, handle) == encoded.segments[i].size;
+		}
+
+		NDTF_SCOPE_END(segmentIoScope, ctx, written ? encoded.totalSize : 0);
+
+		ndtf_segments_freeEncoded(&encoded, ctx);
+		return written;
+	}
 
 	size_t dataSize = ndtf_file_getDataSize(file);
 
-	void* fileData = file->data;
-	if (ndtf_file_getZLibCompression(file))
-		fileData = ndtf_zLibCompressData(fileData, dataSize, &dataSize);
+	NDTF_File stored;
+	if (!ndtf_file_storedTexels(file, &stored, ctx)) return false;
+
+	if (ctx && ctx->texelStats)
+		ndtf_file_computeTexelStats(&stored, ctx->texelStats, ctx);
+
+	void* fileData = ndtf_encodePayload(&stored, &header, &dataSize, ctx);
+	// a transformed copy is only kept when it is the payload itself
+	if (stored.data != file->data && fileData != stored.data)
+		ndtf_mem_free(ctx, stored.data);
 	if (!fileData) return false;
 
-	bytesWritten = fwrite(fileData, sizeof(uint8_t), dataSize, handle);
-	
-	if (ndtf_file_getZLibCompression(file))
-		free(fileData);
+	NDTF_SCOPE_BEGIN(ioScope, ctx, NDTF_PHASE_IO, "fwrite");
+
+	size_t headerSize = ndtf_header_storedSize(&header);
+	size_t bytesWritten = ndtf_header_write(handle, &header) ? headerSize : 0;
+	if (bytesWritten == headerSize)
+		bytesWritten += fwrite(fileData, sizeof(uint8_t), dataSize, handle);
 
-	if (bytesWritten < dataSize) return false;
+	NDTF_SCOPE_END(ioScope, ctx, bytesWritten);
+
+	if (fileData != file->data)
+		ndtf_mem_free(ctx, fileData);
+
+	if (bytesWritten < headerSize + dataSize) return false;
 
 	return true;
 }
-bool ndtf_file_save(NDTF_File* file, const char* filename)
+bool ndtf_file_save_ex(NDTF_File* file, const char* filename, const NDTF_Context* ctx)
 {
-	if (!ndtf_file_isValid(file)) return false;
+	if (!ndtf_file_isValid(file) || !ndtf_transform_fits(ctx, (NDTF_TexelFormat)file->header.texelFormat)) return false;
 
 	FILE* handle = fopen(filename, "wb");
 
 	if (handle != NULL)
 	{
-		if (!ndtf_file_saveToFile(file, handle))
+		if (!ndtf_file_saveToFile_ex(file, handle, ctx))
 		{
 			fclose(handle);
 			return false;
@@ -953,96 +1620,323 @@ bool ndtf_file_save(NDTF_File* file, const char* filename)
 
 bool ndtf_file_getZLibCompression(NDTF_File* file)
 {
-	return file->header.flags.zlib_compression;
+	return file->header.flags.codec == NDTF_CODEC_ZLIB;
 }
 
 void ndtf_file_setZLibCompression(NDTF_File* file, bool zlib_compression)
 {
-	file->header.flags.zlib_compression = zlib_compression;
+	if (zlib_compression)
+		file->header.flags.codec = NDTF_CODEC_ZLIB;
+	else if (file->header.flags.codec == NDTF_CODEC_ZLIB)
+		file->header.flags.codec = NDTF_CODEC_NONE;
 }
 
-void* ndtf_zLibCompressData(const void* data, size_t size, size_t* newSize)
+NDTF_Codec ndtf_file_getCodec(NDTF_File* file)
 {
-	struct libdeflate_compressor* compressor = libdeflate_alloc_compressor(9);
+	return (NDTF_Codec)file->header.flags.codec;
+}
 
-	uint64_t compSize = libdeflate_zlib_compress_bound(compressor, size);
+void ndtf_file_setCodec(NDTF_File* file, NDTF_Codec codec)
+{
+	if (codec >= NDTF_CODEC_NONE && codec <= NDTF_CODEC_MAX)
+		file->header.flags.codec = codec;
+}
 
-	uint8_t* compData = (uint8_t*)malloc(compSize + sizeof(uint64_t));
-	if (!compData)
+bool ndtf_file_getSegmented(NDTF_File* file)
+{
+	return file->header.flags.segmented || file->header.flags.checksums;
+}
+
+void ndtf_file_setSegmented(NDTF_File* file, bool segmented)
+{
+	file->header.flags.segmented = segmented;
+	if (!segmented)
 	{
-		libdeflate_free_compressor(compressor);
-		return NULL;
+		file->header.flags.checksums = 0;
+		file->header.flags.zoneMaps = 0;
+		file->header.flags.deduplicated = 0;
+		file->header.flags.deltaAxis = 0;
 	}
+}
 
-	size_t result = libdeflate_zlib_compress(compressor, data, size, compData + sizeof(uint64_t), compSize);
-	if (!result)
+size_t ndtf_file_getBrickExtent(NDTF_File* file, int axis)
+{
+	if (axis < 0 || axis >= NDTF_DIMENSIONS_MAX)
+		return 0;
+
+	ndtf_Bricks bricks;
+	ndtf_bricks_init(&bricks, &file->header);
+	return bricks.extent[axis];
+}
+
+void ndtf_file_setBrickSize(NDTF_File* file, const uint32_t brickSize[NDTF_DIMENSIONS_MAX])
+{
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
 	{
-		libdeflate_free_compressor(compressor);
-		free(compData);
-		return NULL;
+		uint8_t shift = 0;
+		if (brickSize && brickSize[i])
+		{
+			shift = 1;
+			while (shift < 32 && ((uint32_t)1 << (shift - 1)) < brickSize[i])
+				shift++;
+		}
+		file->header.brickSize[i] = shift;
+	}
+	file->header.flags.segmented = 1;
+}
+
+size_t ndtf_file_getSegmentCount(NDTF_File* file)
+{
+	if (!ndtf_file_getSegmented(file))
+		return 0;
+
+	NDTF_Header header = file->header;
+	header.flags.segmented = 1;
+
+	ndtf_Bricks bricks;
+	ndtf_bricks_init(&bricks, &header);
+	return bricks.count;
+}
+
+bool ndtf_file_getChecksums(NDTF_File* file)
+{
+	return file->header.flags.checksums;
+}
+
+void ndtf_file_setChecksums(NDTF_File* file, bool checksums)
+{
+	file->header.flags.checksums = checksums;
+	if (checksums)
+		file->header.flags.segmented = 1;
+}
+
+bool ndtf_file_getZoneMaps(NDTF_File* file)
+{
+	return file->header.flags.zoneMaps;
+}
+
+void ndtf_file_setZoneMaps(NDTF_File* file, bool zoneMaps)
+{
+	file->header.flags.zoneMaps = zoneMaps;
+	if (zoneMaps)
+		file->header.flags.segmented = 1;
+}
+
+bool ndtf_file_getDeduplicated(NDTF_File* file)
+{
+	return file->header.flags.deduplicated;
+}
+
+void ndtf_file_setDeduplicated(NDTF_File* file, bool deduplicated)
+{
+	file->header.flags.deduplicated = deduplicated;
+	if (deduplicated)
+		file->header.flags.segmented = 1;
+}
+
+bool ndtf_file_getPlanar(NDTF_File* file)
+{
+	return ndtf_planar_enabled(&file->header);
+}
+
+void ndtf_file_setPlanar(NDTF_File* file, bool planar)
+{
+	file->header.flags.planar = planar;
+}
+
+int ndtf_file_getDeltaAxis(NDTF_File* file)
+{
+	return ndtf_delta_axis(&file->header);
+}
+
+void ndtf_file_setDelta(NDTF_File* file, int axis, uint8_t keyframeInterval)
+{
+	if (axis < 0 || axis >= file->header.dimensions)
+	{
+		file->header.flags.deltaAxis = 0;
+		file->header.keyframeInterval = 0;
+		return;
+	}
+
+	file->header.flags.deltaAxis = (uint32_t)axis + 1;
+	file->header.keyframeInterval = keyframeInterval;
+	file->header.flags.segmented = 1;
+	file->header.brickSize[axis] = 1;
+}
+
+bool ndtf_file_getErrorBound(NDTF_File* file, NDTF_ErrorBound* bound)
+{
+	if (!ndtf_lossy_enabled(&file->header))
+		return false;
+
+	if (bound)
+		*bound = file->errorBound;
+	return true;
+}
+
+bool ndtf_file_setErrorBound(NDTF_File* file, NDTF_ErrorBoundMode mode, const float bound[NDTF_CHANNELS_RGBA])
+{
+	memset(&file->errorBound, 0, sizeof(NDTF_ErrorBound));
+	file->header.flags.lossy = 0;
+
+	if (mode == NDTF_ERRORBOUND_NONE)
+		return true;
+
+	NDTF_Header header = file->header;
+	header.flags.lossy = 1;
+	if (!bound || (mode != NDTF_ERRORBOUND_ABSOLUTE && mode != NDTF_ERRORBOUND_RELATIVE) || !ndtf_lossy_enabled(&header))
+		return false;
+
+	size_t channels = ndtf_getChannelCount((NDTF_TexelFormat)file->header.texelFormat);
+	for (size_t c = 0; c < channels; c++)
+	{
+		if (!(bound[c] >= 0.0f))
+			return false;
 	}
 
-	memcpy((void*)compData, (void*)&size, sizeof(uint64_t)); // store the uncompressed size
+	file->errorBound.mode = (uint8_t)mode;
+	memcpy(file->errorBound.bound, bound, channels * sizeof(float));
+	file->header.flags.lossy = 1;
+
+	// the quantized symbols need an entropy coder to pay off
+	if (file->header.flags.codec == NDTF_CODEC_NONE)
+		file->header.flags.codec = NDTF_CODEC_DEFLATE;
+	return true;
+}
+
+void* ndtf_zLibCompressData(const void* data, size_t size, size_t* newSize)
+{
+	return ndtf_compress(NDTF_CODEC_ZLIB, data, size, newSize, NULL);
+}
+
+void* ndtf_zLibDecompressData(const void* data, size_t size, size_t* newSize)
+{
+	return ndtf_decompress(NDTF_CODEC_ZLIB, data, size, newSize, NULL);
+}
+
+void* ndtf_compressData(NDTF_Codec codec, const void* data, size_t size, size_t* newSize)
+{
+	return ndtf_compress(codec, data, size, newSize, NULL);
+}
+
+void* ndtf_decompressData(NDTF_Codec codec, const void* data, size_t size, size_t* newSize)
+{
+	return ndtf_decompress(codec, data, size, newSize, NULL);
+}
+
+static void* ndtf_compress(NDTF_Codec codec, const void* data, size_t size, size_t* newSize, const NDTF_Context* ctx)
+{
+	size_t compSize = 0;
+	uint8_t* compData = ndtf_codec_compress(codec, data, size, sizeof(uint64_t), &compSize, ctx);
+	if (!compData) return NULL;
+
+	uint64_t uncompSize = size;
+	memcpy(compData, &uncompSize, sizeof(uint64_t)); // store the uncompressed size
 
 	if (newSize)
 	{
-		*newSize = result + sizeof(uint64_t);
+		*newSize = compSize + sizeof(uint64_t);
 	}
 
-	libdeflate_free_compressor(compressor);
 	return compData;
 }
 
-void* ndtf_zLibDecompressData(const void* data, size_t size, size_t* newSize)
+static void* ndtf_decompress(NDTF_Codec codec, const void* data, size_t size, size_t* newSize, const NDTF_Context* ctx)
 {
 	if (size < sizeof(uint64_t))
 	{
 		return NULL;
 	}
 
-	uint64_t uncompSize = *(uint64_t*)data;
+	uint64_t uncompSize;
+	memcpy(&uncompSize, data, sizeof(uint64_t));
+	if (uncompSize > SIZE_MAX) return NULL;
 
-	uint8_t* uncompData = (uint8_t*)malloc(uncompSize);
+	uint8_t* uncompData = (uint8_t*)ndtf_mem_alloc(ctx, (size_t)uncompSize);
 	if (!uncompData) return NULL;
 
-	const void* compData = (uint8_t*)data + sizeof(uint64_t);
-	uint64_t compSize = size - sizeof(uint64_t);
-
-	struct libdeflate_decompressor* decompressor = libdeflate_alloc_decompressor();
+	const uint8_t* compData = (const uint8_t*)data + sizeof(uint64_t);
+	size_t compSize = size - sizeof(uint64_t);
 
-	size_t actualSize = uncompSize;
-	enum libdeflate_result result = libdeflate_zlib_decompress(decompressor, compData, compSize, uncompData, uncompSize, &actualSize);
-	if (result != LIBDEFLATE_SUCCESS)
+	if (!ndtf_codec_decompress(codec, compData, compSize, uncompData, (size_t)uncompSize, ctx))
 	{
-		libdeflate_free_decompressor(decompressor);
-		free(uncompData);
+		ndtf_mem_free(ctx, uncompData);
 		return NULL;
 	}
 
 	if (newSize)
 	{
-		*newSize = actualSize;
+		*newSize = (size_t)uncompSize;
 	}
 
-	libdeflate_free_decompressor(decompressor);
 	return uncompData;
 }
 
+bool ndtf_payload_decode(const NDTF_Header* header, const uint8_t* payload, size_t payloadSize, uint8_t* volume, NDTF_ErrorBound* errorBound, const NDTF_Context* ctx)
+{
+	size_t dataSize;
+	if (!ndtf_header_getDataSize(header, &dataSize))
+		return false;
+
+	NDTF_Codec codec = (NDTF_Codec)header->flags.codec;
+	if (ndtf_lossy_enabled(header))
+	{
+		ndtf_Bricks bricks;
+		ndtf_bricks_init(&bricks, header);
+		return ndtf_lossy_decode(header, payload, payloadSize, volume, bricks.size, codec, errorBound, NULL, ctx);
+	}
+
+	NDTF_TexelFormat texelFormat = (NDTF_TexelFormat)header->texelFormat;
+	bool planar = ndtf_planar_enabled(header);
+	size_t texels = planar ? dataSize / ndtf_getTexelSize(texelFormat) : 0;
+
+	if (codec == NDTF_CODEC_NONE)
+	{
+		if (payloadSize != dataSize)
+			return false;
+
+		if (planar)
+			ndtf_planar_merge(texelFormat, payload, volume, texels, ctx);
+		else
+			memcpy(volume, payload, dataSize);
+		return true;
+	}
+
+	// compressed payloads start with their uncompressed size
+	uint64_t uncompSize;
+	if (payloadSize < sizeof(uint64_t))
+		return false;
+	memcpy(&uncompSize, payload, sizeof(uint64_t));
+	if (uncompSize != dataSize)
+		return false;
+
+	uint8_t* planes = planar ? (uint8_t*)ndtf_mem_alloc(ctx, dataSize) : NULL;
+	if (planar && !planes)
+		return false;
+
+	bool result = ndtf_codec_decompress(codec, payload + sizeof(uint64_t), payloadSize - sizeof(uint64_t), planar ? planes : volume, dataSize, ctx);
+	if (result && planar)
+		ndtf_planar_merge(texelFormat, planes, volume, texels, ctx);
+
+	ndtf_mem_free(ctx, planes);
+	return result;
+}
 
 size_t ndtf_file_getDataSize(NDTF_File* file)
 {
-	size_t totalTexels = 1;
-	for (int i = 0; i < file->header.dimensions; i++)
-		totalTexels *= file->header.size[i];
-	size_t bpp = ndtf_getTexelSize((NDTF_TexelFormat)file->header.texelFormat);
-	return totalTexels * bpp;
+	size_t size;
+	return ndtf_header_getDataSize(&file->header, &size) ? size : 0;
 }
 
 void ndtf_file_free(NDTF_File* file)
+{
+	ndtf_file_free_ex(file, NULL);
+}
+void ndtf_file_free_ex(NDTF_File* file, const NDTF_Context* ctx)
 {
 	if (ndtf_file_isValid(file))
 	{
-		free(file->data);
+		ndtf_mem_freeWith(ndtf_file_allocator(file), ctx, file->data);
 		file->header.width = 0;
 		file->header.height = 0;
 		file->header.depth = 0;
@@ -1071,6 +1965,10 @@ typedef uint32_t GLenum;
 #define GL_R16 0x822A
 #define GL_R32UI 0x8236
 #define GL_R32F 0x822E
+#define GL_COMPRESSED_RED_RGTC1 0x8DBB
+#define GL_COMPRESSED_RG_RGTC2 0x8DBD
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#define GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT 0x8E8F
 #define GL_RED 0x1903
 #define GL_RGB 0x1907
 #define GL_RGBA 0x1908
@@ -1107,6 +2005,14 @@ GLenum ndtf_glSizedTexelFormat(NDTF_TexelFormat texelFormat)
 		return GL_R32UI;
 	case NDTF_TEXELFORMAT_R32F:
 		return GL_R32F;
+	case NDTF_TEXELFORMAT_BC4:
+		return GL_COMPRESSED_RED_RGTC1;
+	case NDTF_TEXELFORMAT_BC5:
+		return GL_COMPRESSED_RG_RGTC2;
+	case NDTF_TEXELFORMAT_BC6H:
+		return GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT;
+	case NDTF_TEXELFORMAT_BC7:
+		return GL_COMPRESSED_RGBA_BPTC_UNORM;
 	}
 }
 
@@ -1119,16 +2025,20 @@ GLenum ndtf_glTexelFormat(NDTF_TexelFormat texelFormat)
 	case NDTF_TEXELFORMAT_RGBA16161616:
 	case NDTF_TEXELFORMAT_RGBA32323232:
 	case NDTF_TEXELFORMAT_RGBA32323232F:
+	case NDTF_TEXELFORMAT_BC7:
 		return GL_RGBA;
 	case NDTF_TEXELFORMAT_RGB888:
 	case NDTF_TEXELFORMAT_RGB161616:
 	case NDTF_TEXELFORMAT_RGB323232:
 	case NDTF_TEXELFORMAT_RGB323232F:
+	case NDTF_TEXELFORMAT_BC5:
+	case NDTF_TEXELFORMAT_BC6H:
 		return GL_RGB;
 	case NDTF_TEXELFORMAT_R8:
 	case NDTF_TEXELFORMAT_R16:
 	case NDTF_TEXELFORMAT_R32:
 	case NDTF_TEXELFORMAT_R32F:
+	case NDTF_TEXELFORMAT_BC4:
 		return GL_RED;
 	}
 }
@@ -1141,6 +2051,9 @@ GLenum ndtf_glTexelType(NDTF_TexelFormat texelFormat)
 	case NDTF_TEXELFORMAT_RGBA8888:
 	case NDTF_TEXELFORMAT_RGB888:
 	case NDTF_TEXELFORMAT_R8:
+	case NDTF_TEXELFORMAT_BC4:
+	case NDTF_TEXELFORMAT_BC5:
+	case NDTF_TEXELFORMAT_BC7:
 		return GL_UNSIGNED_BYTE;
 	case NDTF_TEXELFORMAT_RGBA16161616:
 	case NDTF_TEXELFORMAT_RGB161616:
@@ -1153,6 +2066,7 @@ GLenum ndtf_glTexelType(NDTF_TexelFormat texelFormat)
 	case NDTF_TEXELFORMAT_RGBA32323232F:
 	case NDTF_TEXELFORMAT_RGB323232F:
 	case NDTF_TEXELFORMAT_R32F:
+	case NDTF_TEXELFORMAT_BC6H:
 		return GL_FLOAT;
 	}
 }
@@ -0,0 +1,1508 @@
+#include "ndtf_internal.h"
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+	#define NDTF_BC_SSE2
+	#include <emmintrin.h>
+#endif
+
+// blocks cover 4x4 texels of a slice, texels past its edge replicate the last row and column while encoding.
+// BC4 and BC5 are encoded with their 8 and 6 value palettes, BC7 with mode 6 and on HIGH also mode 1 for
+// opaque blocks, BC6H with mode 11 and on HIGH also the others. the decoders handle every mode
+
+#define NDTF_BC_CHUNK 1024 // blocks per task
+
+#define NDTF_BC6H_MAX 0x7BFF // largest finite half
+
+static const uint8_t ndtf_bc_weights2[4] = { 0, 21, 43, 64 };
+static const uint8_t ndtf_bc_weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+static const uint8_t ndtf_bc_weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+static const uint8_t* ndtf_bc_weights(int indexBits)
+{
+	return indexBits == 2 ? ndtf_bc_weights2 : indexBits == 3 ? ndtf_bc_weights3 : ndtf_bc_weights4;
+}
+
+static int ndtf_bc_interpolate(int e0, int e1, int weight)
+{
+	return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+}
+
+// BC7 and BC6H partitions, bit i set when texel i belongs to the second subset
+static const uint16_t ndtf_bc_partitions2[64] = {
+	0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+	0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+	0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+	0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+	0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+	0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+	0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+	0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22,
+};
+
+static const char* const ndtf_bc_partitions3[64] = {
+	"0011001102212222", "0001001122112221", "0000200122112211", "0222002200110111",
+	"0000000011221122", "0011001100220022", "0022002211111111", "0011001122112211",
+	"0000000011112222", "0000111111112222", "0000111122222222", "0012001200120012",
+	"0112011201120112", "0122012201220122", "0011011211221222", "0011200122002220",
+	"0001001101121122", "0111001120012200", "0000112211221122", "0022002200221111",
+	"0111011102220222", "0001000122212221", "0000001101220122", "0000110022102210",
+	"0122012200110000", "0012001211222222", "0110122112210110", "0000011012211221",
+	"0022110211020022", "0110011020022222", "0011012201220011", "0000200022112221",
+	"0000000211221222", "0222002200120011", "0011001200220222", "0120012001200120",
+	"0000111122220000", "0120120120120120", "0120201212010120", "0011220011220011",
+	"0011112222000011", "0101010122222222", "0000000021212121", "0022112200221122",
+	"0022001100220011", "0220122102201221", "0101222222220101", "0000212121212121",
+	"0101010101012222", "0222011102220111", "0002111200021112", "0000211221122112",
+	"0222011101110222", "0002111211120002", "0110011001102222", "0000000021122112",
+	"0110011022222222", "0022001100110022", "0022112211220022", "0000000000002112",
+	"0002000100020001", "0222122202221222", "0101222222222222", "0111201122012220",
+};
+
+// anchor texels of the second and third subset, their top index bit is implied to be zero
+static const uint8_t ndtf_bc_anchors2[64] = {
+	15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+	15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+	15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6,
+	6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15,
+};
+
+static const uint8_t ndtf_bc_anchors3[2][64] = {
+	{
+		3, 3, 15, 15, 8, 3, 15, 15, 8, 8, 6, 6, 6, 5, 3, 3,
+		3, 3, 8, 15, 3, 3, 6, 10, 5, 8, 8, 6, 8, 5, 15, 15,
+		8, 15, 3, 5, 6, 10, 8, 15, 15, 3, 15, 5, 15, 15, 15, 15,
+		3, 15, 5, 5, 5, 8, 5, 10, 5, 10, 8, 13, 15, 12, 3, 3,
+	},
+	{
+		15, 8, 8, 3, 15, 15, 3, 8, 15, 15, 15, 15, 15, 15, 15, 8,
+		15, 8, 15, 3, 15, 8, 15, 8, 3, 15, 6, 10, 15, 15, 10, 8,
+		15, 3, 15, 10, 10, 8, 9, 10, 6, 15, 8, 15, 3, 6, 6, 8,
+		15, 3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3, 15, 15, 8,
+	},
+};
+
+static void ndtf_bc_partition(int subsets, int partition, uint8_t subsetOf[16])
+{
+	for (int i = 0; i < 16; i++)
+	{
+		if (subsets == 2)
+			subsetOf[i] = (uint8_t)((ndtf_bc_partitions2[partition] >> i) & 1);
+		else if (subsets == 3)
+			subsetOf[i] = (uint8_t)(ndtf_bc_partitions3[partition][i] - '0');
+		else
+			subsetOf[i] = 0;
+	}
+}
+
+static int ndtf_bc_anchor(int subsets, int partition, int subset)
+{
+	if (subset == 0)
+		return 0;
+	return subsets == 2 ? ndtf_bc_anchors2[partition] : ndtf_bc_anchors3[subset - 1][partition];
+}
+
+// 128 bit blocks, read and written from the lowest bit up
+
+typedef struct ndtf_BcBits
+{
+	uint64_t word[2];
+	int position;
+} ndtf_BcBits;
+
+static void ndtf_bcBits_load(ndtf_BcBits* bits, const uint8_t* block)
+{
+	bits->word[0] = bits->word[1] = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		bits->word[0] |= (uint64_t)block[i] << (i * 8);
+		bits->word[1] |= (uint64_t)block[i + 8] << (i * 8);
+	}
+	bits->position = 0;
+}
+
+static void ndtf_bcBits_store(const ndtf_BcBits* bits, uint8_t* block)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		block[i] = (uint8_t)(bits->word[0] >> (i * 8));
+		block[i + 8] = (uint8_t)(bits->word[1] >> (i * 8));
+	}
+}
+
+static uint32_t ndtf_bcBits_read(ndtf_BcBits* bits, int count)
+{
+	int p = bits->position;
+	uint64_t value = bits->word[p >> 6] >> (p & 63);
+	if ((p & 63) + count > 64)
+		value |= bits->word[1] << (64 - (p & 63));
+	bits->position += count;
+	return (uint32_t)(value & (((uint64_t)1 << count) - 1));
+}
+
+static void ndtf_bcBits_write(ndtf_BcBits* bits, uint32_t value, int count)
+{
+	int p = bits->position;
+	bits->word[p >> 6] |= (uint64_t)value << (p & 63);
+	if ((p & 63) + count > 64)
+		bits->word[1] |= (uint64_t)value >> (64 - (p & 63));
+	bits->position += count;
+}
+
+// unsigned halves, the only ones BC6H is encoded from
+
+static uint16_t ndtf_bc_floatToHalf(float value)
+{
+	if (!(value > 0.0f))
+		return 0;
+	if (value >= 65504.0f)
+		return NDTF_BC6H_MAX;
+
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(float));
+	int exponent = (int)(bits >> 23) - 127 + 15;
+	uint32_t mantissa = bits & 0x7FFFFF;
+	if (exponent <= 0)
+	{
+		if (exponent < -10)
+			return 0;
+		int shift = 14 - exponent;
+		mantissa |= 0x800000;
+		return (uint16_t)((mantissa + ((uint32_t)1 << (shift - 1))) >> shift);
+	}
+
+	uint32_t half = ((uint32_t)exponent << 10) + ((mantissa + 0x1000) >> 13);
+	return (uint16_t)min(half, NDTF_BC6H_MAX);
+}
+
+static float ndtf_bc_halfToFloat(uint16_t half)
+{
+	uint32_t exponent = (half >> 10) & 0x1F;
+	uint32_t mantissa = half & 0x3FF;
+	uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+
+	uint32_t bits;
+	if (exponent == 0)
+	{
+		float value = (float)mantissa * (1.0f / 16777216.0f);
+		return sign ? -value : value;
+	}
+	else if (exponent == 31)
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	else
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+
+	float value;
+	memcpy(&value, &bits, sizeof(float));
+	return value;
+}
+
+// endpoint fitting shared by the BC7 and BC6H encoders, texels are given as channel planes
+
+// index of the nearest palette entry for the texels of subset (every texel when subsetOf is NULL),
+// returns their summed squared distance
+static float ndtf_bc_assign(const float planes[4][16], int channels, const float palette[16][4], int count, const uint8_t* subsetOf, int subset, uint8_t indices[16])
+{
+	float error = 0.0f;
+#ifdef NDTF_BC_SSE2
+	for (int i = 0; i < 16; i += 4)
+	{
+		__m128 best = _mm_set1_ps(FLT_MAX);
+		__m128i bestIndex = _mm_setzero_si128();
+		for (int j = 0; j < count; j++)
+		{
+			__m128 distance = _mm_setzero_ps();
+			for (int c = 0; c < channels; c++)
+			{
+				__m128 d = _mm_sub_ps(_mm_loadu_ps(&planes[c][i]), _mm_set1_ps(palette[j][c]));
+				distance = _mm_add_ps(distance, _mm_mul_ps(d, d));
+			}
+			__m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+			best = _mm_min_ps(distance, best);
+			bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(j)), _mm_andnot_si128(closer, bestIndex));
+		}
+
+		float distances[4];
+		int32_t nearest[4];
+		_mm_storeu_ps(distances, best);
+		_mm_storeu_si128((__m128i*)nearest, bestIndex);
+		for (int k = 0; k < 4; k++)
+		{
+			if (!subsetOf || subsetOf[i + k] == subset)
+			{
+				indices[i + k] = (uint8_t)nearest[k];
+				error += distances[k];
+			}
+		}
+	}
+#else
+	for (int i = 0; i < 16; i++)
+	{
+		if (subsetOf && subsetOf[i] != subset)
+			continue;
+
+		float best = FLT_MAX;
+		int bestIndex = 0;
+		for (int j = 0; j < count; j++)
+		{
+			float distance = 0.0f;
+			for (int c = 0; c < channels; c++)
+			{
+				float d = planes[c][i] - palette[j][c];
+				distance += d * d;
+			}
+			if (distance < best)
+			{
+				best = distance;
+				bestIndex = j;
+			}
+		}
+		indices[i] = (uint8_t)bestIndex;
+		error += best;
+	}
+#endif
+	return error;
+}
+
+// endpoints at the extreme projections of the texels of subset onto their principal axis. returns the
+// squared distance of the texels from that axis
+static float ndtf_bc_fitLine(const float planes[4][16], int channels, const uint8_t* subsetOf, int subset, float e0[4], float e1[4])
+{
+	float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	int count = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		if (subsetOf && subsetOf[i] != subset)
+			continue;
+		for (int c = 0; c < channels; c++)
+			mean[c] += planes[c][i];
+		count++;
+	}
+	for (int c = 0; c < channels; c++)
+		mean[c] /= (float)max(count, 1);
+
+	float covariance[4][4];
+	memset(covariance, 0, sizeof(covariance));
+	float spread = 0.0f;
+	for (int i = 0; i < 16; i++)
+	{
+		if (subsetOf && subsetOf[i] != subset)
+			continue;
+		float d[4];
+		for (int c = 0; c < channels; c++)
+			d[c] = planes[c][i] - mean[c];
+		for (int a = 0; a < channels; a++)
+		{
+			spread += d[a] * d[a];
+			for (int b = 0; b < channels; b++)
+				covariance[a][b] += d[a] * d[b];
+		}
+	}
+
+	// power iteration from the row of the channel that varies most
+	int largest = 0;
+	for (int c = 1; c < channels; c++)
+	{
+		if (covariance[c][c] > covariance[largest][largest])
+			largest = c;
+	}
+	float axis[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	for (int c = 0; c < channels; c++)
+		axis[c] = covariance[largest][c];
+	for (int k = 0; k < 8; k++)
+	{
+		float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float scale = 0.0f;
+		for (int a = 0; a < channels; a++)
+		{
+			for (int b = 0; b < channels; b++)
+				next[a] += covariance[a][b] * axis[b];
+			scale = fmaxf(scale, fabsf(next[a]));
+		}
+		if (scale <= 0.0f)
+			break;
+		for (int c = 0; c < channels; c++)
+			axis[c] = next[c] / scale;
+	}
+
+	float length = 0.0f;
+	for (int c = 0; c < channels; c++)
+		length += axis[c] * axis[c];
+	length = sqrtf(length);
+	if (length < 1e-6f)
+	{
+		memcpy(e0, mean, sizeof(mean));
+		memcpy(e1, mean, sizeof(mean));
+		return spread;
+	}
+
+	float low = FLT_MAX, high = -FLT_MAX, along = 0.0f;
+	for (int i = 0; i < 16; i++)
+	{
+		if (subsetOf && subsetOf[i] != subset)
+			continue;
+		float t = 0.0f;
+		for (int c = 0; c < channels; c++)
+			t += (planes[c][i] - mean[c]) * axis[c] / length;
+		low = fminf(low, t);
+		high = fmaxf(high, t);
+		along += t * t;
+	}
+	for (int c = 0; c < channels; c++)
+	{
+		e0[c] = mean[c] + low * axis[c] / length;
+		e1[c] = mean[c] + high * axis[c] / length;
+	}
+	return fmaxf(spread - along, 0.0f);
+}
+
+// least squares endpoints of the texels of subset for their current indices, false when the indices
+// do not determine them
+static bool ndtf_bc_refine(const float planes[4][16], int channels, const uint8_t* subsetOf, int subset, const uint8_t indices[16], const uint8_t* weights, float limit, float e0[4], float e1[4])
+{
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	float ax[4] = { 0.0f, 0.0f, 0.0f, 0.0f }, bx[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+	{
+		if (subsetOf && subsetOf[i] != subset)
+			continue;
+		float b = (float)weights[indices[i]] / 64.0f;
+		float a = 1.0f - b;
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		for (int c = 0; c < channels; c++)
+		{
+			ax[c] += a * planes[c][i];
+			bx[c] += b * planes[c][i];
+		}
+	}
+
+	float determinant = aa * bb - ab * ab;
+	if (fabsf(determinant) < 1e-6f)
+		return false;
+
+	for (int c = 0; c < channels; c++)
+	{
+		e0[c] = fminf(fmaxf((bb * ax[c] - ab * bx[c]) / determinant, 0.0f), limit);
+		e1[c] = fminf(fmaxf((aa * bx[c] - ab * ax[c]) / determinant, 0.0f), limit);
+	}
+	return true;
+}
+
+#define NDTF_BC_CANDIDATES 4 // two subset partitions that are fully encoded on HIGH
+
+// the best two subset partitions among the first ones, ranked by the distance of their texels from the
+// principal axes of their subsets
+static void ndtf_bc_rankPartitions(const float planes[4][16], int channels, int partitions, int candidates[NDTF_BC_CANDIDATES])
+{
+	float scores[NDTF_BC_CANDIDATES];
+	for (int k = 0; k < NDTF_BC_CANDIDATES; k++)
+	{
+		candidates[k] = -1;
+		scores[k] = FLT_MAX;
+	}
+	for (int p = 0; p < partitions; p++)
+	{
+		uint8_t subsetOf[16];
+		ndtf_bc_partition(2, p, subsetOf);
+		float e0[4], e1[4];
+		float score = ndtf_bc_fitLine(planes, channels, subsetOf, 0, e0, e1) + ndtf_bc_fitLine(planes, channels, subsetOf, 1, e0, e1);
+		for (int k = 0; k < NDTF_BC_CANDIDATES; k++)
+		{
+			if (score < scores[k])
+			{
+				memmove(&scores[k + 1], &scores[k], (NDTF_BC_CANDIDATES - 1 - k) * sizeof(float));
+				memmove(&candidates[k + 1], &candidates[k], (NDTF_BC_CANDIDATES - 1 - k) * sizeof(int));
+				scores[k] = score;
+				candidates[k] = p;
+				break;
+			}
+		}
+	}
+}
+
+// BC4 and BC5
+
+// interpolated values are rounded to the nearest integer, as the exact values of the format are
+static void ndtf_bc4_palette(int a0, int a1, int palette[8])
+{
+	palette[0] = a0;
+	palette[1] = a1;
+	if (a0 > a1)
+	{
+		for (int i = 2; i < 8; i++)
+			palette[i] = ((8 - i) * a0 + (i - 1) * a1 + 3) / 7;
+	}
+	else
+	{
+		for (int i = 2; i < 6; i++)
+			palette[i] = ((6 - i) * a0 + (i - 1) * a1 + 2) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+static uint32_t ndtf_bc4_fit(const uint8_t values[16], int a0, int a1, uint8_t indices[16])
+{
+	int palette[8];
+	ndtf_bc4_palette(a0, a1, palette);
+
+	uint32_t error = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		int best = INT32_MAX, bestIndex = 0;
+		for (int j = 0; j < 8; j++)
+		{
+			int d = values[i] - palette[j];
+			if (d * d < best)
+			{
+				best = d * d;
+				bestIndex = j;
+			}
+		}
+		indices[i] = (uint8_t)bestIndex;
+		error += (uint32_t)best;
+	}
+	return error;
+}
+
+static void ndtf_bc4_encodeBlock(const uint8_t values[16], uint8_t* block, NDTF_BlockQuality quality)
+{
+	int low = 255, high = 0, innerLow = 255, innerHigh = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		low = min(low, values[i]);
+		high = max(high, values[i]);
+		if (values[i] != 0 && values[i] != 255)
+		{
+			innerLow = min(innerLow, values[i]);
+			innerHigh = max(innerHigh, values[i]);
+		}
+	}
+
+	uint8_t indices[16], candidate[16];
+	int a0 = high, a1 = low;
+	uint32_t error = ndtf_bc4_fit(values, a0, a1, indices);
+
+	// the 6 value palette keeps its steps for the texels between exact 0 and 255
+	if (quality != NDTF_BLOCKQUALITY_FAST && error && innerLow <= innerHigh)
+	{
+		uint32_t inner = ndtf_bc4_fit(values, innerLow, innerHigh, candidate);
+		if (inner < error)
+		{
+			error = inner;
+			a0 = innerLow;
+			a1 = innerHigh;
+			memcpy(indices, candidate, sizeof(indices));
+		}
+	}
+
+	// endpoints inside the range may place the interpolated values better
+	if (quality == NDTF_BLOCKQUALITY_HIGH && error && high > low)
+	{
+		for (int e0 = max(high - 2, 0); e0 <= min(high + 2, 255) && error; e0++)
+		{
+			for (int e1 = max(low - 2, 0); e1 <= min(low + 2, 255) && error; e1++)
+			{
+				if (e0 <= e1)
+					continue;
+				uint32_t moved = ndtf_bc4_fit(values, e0, e1, candidate);
+				if (moved < error)
+				{
+					error = moved;
+					a0 = e0;
+					a1 = e1;
+					memcpy(indices, candidate, sizeof(indices));
+				}
+			}
+		}
+	}
+
+	uint64_t bits = 0;
+	for (int i = 0; i < 16; i++)
+		bits |= (uint64_t)indices[i] << (i * 3);
+	block[0] = (uint8_t)a0;
+	block[1] = (uint8_t)a1;
+	for (int i = 0; i < 6; i++)
+		block[2 + i] = (uint8_t)(bits >> (i * 8));
+}
+
+static void ndtf_bc4_decodeBlock(const uint8_t* block, uint8_t values[16])
+{
+	int palette[8];
+	ndtf_bc4_palette(block[0], block[1], palette);
+
+	uint64_t bits = 0;
+	for (int i = 0; i < 6; i++)
+		bits |= (uint64_t)block[2 + i] << (i * 8);
+	for (int i = 0; i < 16; i++)
+		values[i] = (uint8_t)palette[(bits >> (i * 3)) & 7];
+}
+
+// BC7
+
+typedef struct ndtf_Bc7Mode
+{
+	uint8_t subsets, partitionBits, rotationBits, selectionBits;
+	uint8_t colorBits, alphaBits, endpointPBits, sharedPBits;
+	uint8_t indexBits, index2Bits;
+} ndtf_Bc7Mode;
+
+static const ndtf_Bc7Mode ndtf_bc7_modes[8] = {
+	{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+	{ 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+	{ 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+	{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+	{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+	{ 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+	{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+	{ 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 },
+};
+
+// endpoint of bits (and a p-bit when pbit >= 0) expanded to 8 bits
+static int ndtf_bc7_unquantize(int value, int bits, int pbit)
+{
+	if (pbit >= 0)
+	{
+		value = (value << 1) | pbit;
+		bits++;
+	}
+	return bits >= 8 ? value : (value << (8 - bits)) | (value >> (2 * bits - 8));
+}
+
+static int ndtf_bc7_quantize(float value, int bits, int pbit)
+{
+	int stored = bits + (pbit >= 0);
+	int estimate = (int)(value * (float)((1 << stored) - 1) / 255.0f + 0.5f);
+	if (pbit >= 0)
+		estimate >>= 1;
+
+	int best = 0;
+	float bestError = FLT_MAX;
+	for (int q = max(estimate - 1, 0); q <= min(estimate + 1, (1 << bits) - 1); q++)
+	{
+		float error = fabsf((float)ndtf_bc7_unquantize(q, bits, pbit) - value);
+		if (error < bestError)
+		{
+			bestError = error;
+			best = q;
+		}
+	}
+	return best;
+}
+
+static void ndtf_bc7_decodeBlock(const uint8_t* block, uint8_t texels[16][4])
+{
+	ndtf_BcBits bits;
+	ndtf_bcBits_load(&bits, block);
+
+	int mode = 0;
+	while (mode < 8 && !ndtf_bcBits_read(&bits, 1))
+		mode++;
+	if (mode == 8)
+	{
+		memset(texels, 0, 16 * 4);
+		return;
+	}
+
+	const ndtf_Bc7Mode* m = &ndtf_bc7_modes[mode];
+	int partition = (int)ndtf_bcBits_read(&bits, m->partitionBits);
+	int rotation = (int)ndtf_bcBits_read(&bits, m->rotationBits);
+	int selection = (int)ndtf_bcBits_read(&bits, m->selectionBits);
+
+	int endpoints[3][2][4];
+	for (int c = 0; c < 4; c++)
+	{
+		int channelBits = c < 3 ? m->colorBits : m->alphaBits;
+		for (int s = 0; s < m->subsets; s++)
+		{
+			for (int e = 0; e < 2; e++)
+				endpoints[s][e][c] = (int)ndtf_bcBits_read(&bits, channelBits);
+		}
+	}
+
+	int pbits[3][2] = { { -1, -1 }, { -1, -1 }, { -1, -1 } };
+	for (int s = 0; s < m->subsets; s++)
+	{
+		if (m->endpointPBits)
+		{
+			pbits[s][0] = (int)ndtf_bcBits_read(&bits, 1);
+			pbits[s][1] = (int)ndtf_bcBits_read(&bits, 1);
+		}
+	}
+	for (int s = 0; s < m->subsets; s++)
+	{
+		if (m->sharedPBits)
+			pbits[s][0] = pbits[s][1] = (int)ndtf_bcBits_read(&bits, 1);
+	}
+
+	for (int s = 0; s < m->subsets; s++)
+	{
+		for (int e = 0; e < 2; e++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				int channelBits = c < 3 ? m->colorBits : m->alphaBits;
+				endpoints[s][e][c] = channelBits ? ndtf_bc7_unquantize(endpoints[s][e][c], channelBits, pbits[s][e]) : 255;
+			}
+		}
+	}
+
+	uint8_t subsetOf[16];
+	ndtf_bc_partition(m->subsets, partition, subsetOf);
+
+	uint8_t indices[16], indices2[16];
+	for (int i = 0; i < 16; i++)
+	{
+		bool anchor = i == ndtf_bc_anchor(m->subsets, partition, subsetOf[i]);
+		indices[i] = (uint8_t)ndtf_bcBits_read(&bits, m->indexBits - anchor);
+	}
+	for (int i = 0; i < 16 && m->index2Bits; i++)
+		indices2[i] = (uint8_t)ndtf_bcBits_read(&bits, m->index2Bits - (i == 0));
+
+	for (int i = 0; i < 16; i++)
+	{
+		const int* e0 = endpoints[subsetOf[i]][0];
+		const int* e1 = endpoints[subsetOf[i]][1];
+
+		// with two index streams the selection bit picks the one for the color
+		int colorWeight = ndtf_bc_weights(m->indexBits)[indices[i]];
+		int alphaWeight = colorWeight;
+		if (m->index2Bits)
+		{
+			int weight2 = ndtf_bc_weights(m->index2Bits)[indices2[i]];
+			if (selection)
+				colorWeight = weight2;
+			else
+				alphaWeight = weight2;
+		}
+
+		for (int c = 0; c < 3; c++)
+			texels[i][c] = (uint8_t)ndtf_bc_interpolate(e0[c], e1[c], colorWeight);
+		texels[i][3] = (uint8_t)ndtf_bc_interpolate(e0[3], e1[3], alphaWeight);
+
+		if (rotation)
+		{
+			uint8_t alpha = texels[i][3];
+			texels[i][3] = texels[i][rotation - 1];
+			texels[i][rotation - 1] = alpha;
+		}
+	}
+}
+
+// quantized endpoints and indices of one subset
+typedef struct ndtf_Bc7Fit
+{
+	int endpoints[2][4];
+	int pbits[2];
+	float error;
+} ndtf_Bc7Fit;
+
+static float ndtf_bc7_evaluate(const ndtf_Bc7Mode* m, const float planes[4][16], const uint8_t* subsetOf, int subset, const float e[2][4], const int pbits[2], ndtf_Bc7Fit* fit, uint8_t indices[16])
+{
+	int channels = m->alphaBits ? 4 : 3;
+	int expanded[2][4];
+	for (int k = 0; k < 2; k++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			int channelBits = c < 3 ? m->colorBits : m->alphaBits;
+			fit->endpoints[k][c] = channelBits ? ndtf_bc7_quantize(e[k][c], channelBits, pbits[k]) : 0;
+			expanded[k][c] = channelBits ? ndtf_bc7_unquantize(fit->endpoints[k][c], channelBits, pbits[k]) : 255;
+		}
+		fit->pbits[k] = pbits[k];
+	}
+
+	float palette[16][4];
+	int count = 1 << m->indexBits;
+	const uint8_t* weights = ndtf_bc_weights(m->indexBits);
+	for (int j = 0; j < count; j++)
+	{
+		for (int c = 0; c < 4; c++)
+			palette[j][c] = (float)ndtf_bc_interpolate(expanded[0][c], expanded[1][c], weights[j]);
+	}
+
+	fit->error = ndtf_bc_assign(planes, channels, palette, count, subsetOf, subset, indices);
+	return fit->error;
+}
+
+static void ndtf_bc7_encodeSubset(const ndtf_Bc7Mode* m, const float planes[4][16], const uint8_t* subsetOf, int subset, NDTF_BlockQuality quality, ndtf_Bc7Fit* best, uint8_t indices[16])
+{
+	int channels = m->alphaBits ? 4 : 3;
+	float e[2][4] = { { 0.0f, 0.0f, 0.0f, 255.0f }, { 0.0f, 0.0f, 0.0f, 255.0f } };
+	ndtf_bc_fitLine(planes, channels, subsetOf, subset, e[0], e[1]);
+
+	int combinations = m->endpointPBits ? 4 : m->sharedPBits ? 2 : 1;
+	int iterations = quality == NDTF_BLOCKQUALITY_FAST ? 0 : quality == NDTF_BLOCKQUALITY_HIGH ? 3 : 1;
+
+	best->error = FLT_MAX;
+	for (int iteration = 0; iteration <= iterations && best->error > 0.0f; iteration++)
+	{
+		if (iteration > 0 && !ndtf_bc_refine(planes, channels, subsetOf, subset, indices, ndtf_bc_weights(m->indexBits), 255.0f, e[0], e[1]))
+			break;
+
+		for (int p = 0; p < combinations; p++)
+		{
+			int pbits[2] = { -1, -1 };
+			if (m->endpointPBits)
+			{
+				pbits[0] = p & 1;
+				pbits[1] = p >> 1;
+			}
+			else if (m->sharedPBits)
+				pbits[0] = pbits[1] = p;
+
+			ndtf_Bc7Fit fit;
+			uint8_t candidate[16];
+			if (ndtf_bc7_evaluate(m, planes, subsetOf, subset, (const float(*)[4])e, pbits, &fit, candidate) < best->error)
+			{
+				*best = fit;
+				for (int i = 0; i < 16; i++)
+				{
+					if (!subsetOf || subsetOf[i] == subset)
+						indices[i] = candidate[i];
+				}
+			}
+		}
+	}
+}
+
+static void ndtf_bc7_writeBlock(int mode, int partition, ndtf_Bc7Fit fits[3], uint8_t indices[16], uint8_t* block)
+{
+	const ndtf_Bc7Mode* m = &ndtf_bc7_modes[mode];
+	uint8_t subsetOf[16];
+	ndtf_bc_partition(m->subsets, partition, subsetOf);
+
+	// anchors drop their top index bit, subsets that need it set are flipped
+	int top = (1 << m->indexBits) - 1;
+	for (int s = 0; s < m->subsets; s++)
+	{
+		if (!(indices[ndtf_bc_anchor(m->subsets, partition, s)] >> (m->indexBits - 1)))
+			continue;
+
+		ndtf_Bc7Fit flipped = fits[s];
+		for (int k = 0; k < 2; k++)
+		{
+			memcpy(flipped.endpoints[k], fits[s].endpoints[1 - k], sizeof(flipped.endpoints[k]));
+			flipped.pbits[k] = fits[s].pbits[1 - k];
+		}
+		fits[s] = flipped;
+		for (int i = 0; i < 16; i++)
+		{
+			if (subsetOf[i] == s)
+				indices[i] = (uint8_t)(top - indices[i]);
+		}
+	}
+
+	ndtf_BcBits bits;
+	memset(&bits, 0, sizeof(ndtf_BcBits));
+	ndtf_bcBits_write(&bits, 1u << mode, mode + 1);
+	ndtf_bcBits_write(&bits, (uint32_t)partition, m->partitionBits);
+	for (int c = 0; c < 4; c++)
+	{
+		int channelBits = c < 3 ? m->colorBits : m->alphaBits;
+		for (int s = 0; s < m->subsets && channelBits; s++)
+		{
+			for (int k = 0; k < 2; k++)
+				ndtf_bcBits_write(&bits, (uint32_t)fits[s].endpoints[k][c], channelBits);
+		}
+	}
+	for (int s = 0; s < m->subsets; s++)
+	{
+		if (m->endpointPBits)
+		{
+			ndtf_bcBits_write(&bits, (uint32_t)fits[s].pbits[0], 1);
+			ndtf_bcBits_write(&bits, (uint32_t)fits[s].pbits[1], 1);
+		}
+		else if (m->sharedPBits)
+			ndtf_bcBits_write(&bits, (uint32_t)fits[s].pbits[0], 1);
+	}
+	for (int i = 0; i < 16; i++)
+	{
+		bool anchor = i == ndtf_bc_anchor(m->subsets, partition, subsetOf[i]);
+		ndtf_bcBits_write(&bits, indices[i], m->indexBits - anchor);
+	}
+	ndtf_bcBits_store(&bits, block);
+}
+
+static void ndtf_bc7_encodeBlock(const uint8_t texels[16][4], uint8_t* block, NDTF_BlockQuality quality)
+{
+	float planes[4][16];
+	bool opaque = true;
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 4; c++)
+			planes[c][i] = (float)texels[i][c];
+		opaque &= texels[i][3] == 255;
+	}
+
+	// mode 6: one subset of 7 bit RGBA endpoints with p-bits and 4 bit indices
+	ndtf_Bc7Fit fits[3];
+	uint8_t indices[16];
+	ndtf_bc7_encodeSubset(&ndtf_bc7_modes[6], (const float(*)[16])planes, NULL, 0, quality, &fits[0], indices);
+	int mode = 6, partition = 0;
+	float error = fits[0].error;
+
+	// mode 1: two subsets of 6 bit RGB endpoints with shared p-bits and 3 bit indices, on the best ranked partitions
+	if (quality == NDTF_BLOCKQUALITY_HIGH && opaque && error > 0.0f)
+	{
+		int candidates[NDTF_BC_CANDIDATES];
+		ndtf_bc_rankPartitions((const float(*)[16])planes, 3, 64, candidates);
+		for (int k = 0; k < NDTF_BC_CANDIDATES; k++)
+		{
+			uint8_t subsetOf[16];
+			ndtf_bc_partition(2, candidates[k], subsetOf);
+			ndtf_Bc7Fit split[3];
+			uint8_t splitIndices[16];
+			ndtf_bc7_encodeSubset(&ndtf_bc7_modes[1], (const float(*)[16])planes, subsetOf, 0, quality, &split[0], splitIndices);
+			ndtf_bc7_encodeSubset(&ndtf_bc7_modes[1], (const float(*)[16])planes, subsetOf, 1, quality, &split[1], splitIndices);
+			if (split[0].error + split[1].error < error)
+			{
+				error = split[0].error + split[1].error;
+				mode = 1;
+				partition = candidates[k];
+				memcpy(fits, split, sizeof(split));
+				memcpy(indices, splitIndices, sizeof(indices));
+			}
+		}
+	}
+
+	ndtf_bc7_writeBlock(mode, partition, fits, indices, block);
+}
+
+// BC6H, unsigned
+
+enum
+{
+	NDTF_BC6H_RW, NDTF_BC6H_RX, NDTF_BC6H_RY, NDTF_BC6H_RZ,
+	NDTF_BC6H_GW, NDTF_BC6H_GX, NDTF_BC6H_GY, NDTF_BC6H_GZ,
+	NDTF_BC6H_BW, NDTF_BC6H_BX, NDTF_BC6H_BY, NDTF_BC6H_BZ,
+	NDTF_BC6H_D,
+};
+
+// a run fills bits of a field from the stream, starting at bit `from` and stepping towards bit `to`
+typedef struct ndtf_Bc6hRun
+{
+	uint8_t field, to, from;
+} ndtf_Bc6hRun;
+
+typedef struct ndtf_Bc6hMode
+{
+	uint8_t transformed, regions, endpointBits, deltaBits[3];
+	ndtf_Bc6hRun runs[24];	// after the mode bits, ends at the first zero entry
+} ndtf_Bc6hMode;
+
+#define NDTF_BC6H_BITS(field, to, from) { NDTF_BC6H_##field, to, from }
+
+static const ndtf_Bc6hMode ndtf_bc6h_modes[14] = {
+	{ 1, 2, 10, { 5, 5, 5 }, {
+		NDTF_BC6H_BITS(GY, 4, 4), NDTF_BC6H_BITS(BY, 4, 4), NDTF_BC6H_BITS(BZ, 4, 4), NDTF_BC6H_BITS(RW, 9, 0),
+		NDTF_BC6H_BITS(GW, 9, 0), NDTF_BC6H_BITS(BW, 9, 0), NDTF_BC6H_BITS(RX, 4, 0), NDTF_BC6H_BITS(GZ, 4, 4),
+		NDTF_BC6H_BITS(GY, 3, 0), NDTF_BC6H_BITS(GX, 4, 0), NDTF_BC6H_BITS(BZ, 0, 0), NDTF_BC6H_BITS(GZ, 3, 0),
+		NDTF_BC6H_BITS(BX, 4, 0), NDTF_BC6H_BITS(BZ, 1, 1), NDTF_BC6H_BITS(BY, 3, 0), NDTF_BC6H_BITS(RY, 4, 0),
+		NDTF_BC6H_BITS(BZ, 2, 2), NDTF_BC6H_BITS(RZ, 4, 0), NDTF_BC6H_BITS(BZ, 3, 3), NDTF_BC6H_BITS(D, 4, 0) } },
+	{ 1, 2, 7, { 6, 6, 6 }, {
+		NDTF_BC6H_BITS(GY, 5, 5), NDTF_BC6H_BITS(GZ, 5, 4), NDTF_BC6H_BITS(RW, 6, 0), NDTF_BC6H_BITS(BZ, 1, 0),
+		NDTF_BC6H_BITS(BY, 4, 4), NDTF_BC6H_BITS(GW, 6, 0), NDTF_BC6H_BITS(BY, 5, 5), NDTF_BC6H_BITS(BZ, 2, 2),
+		NDTF_BC6H_BITS(GY, 4, 4), NDTF_BC6H_BITS(BW, 6, 0), NDTF_BC6H_BITS(BZ, 3, 3), NDTF_BC6H_BITS(BZ, 5, 5),
+		NDTF_BC6H_BITS(BZ, 4, 4), NDTF_BC6H_BITS(RX, 5, 0), NDTF_BC6H_BITS(GY, 3, 0), NDTF_BC6H_BITS(GX, 5, 0),
+		NDTF_BC6H_BITS(GZ, 3, 0), NDTF_BC6H_BITS(BX, 5, 0), NDTF_BC6H_BITS(BY, 3, 0), NDTF_BC6H_BITS(RY, 5, 0),
+		NDTF_BC6H_BITS(RZ, 5, 0), NDTF_BC6H_BITS(D, 4, 0) } },
+	{ 1, 2, 11, { 5, 4, 4 }, {
+		NDTF_BC6H_BITS(RW, 9, 0), NDTF_BC6H_BITS(GW, 9, 0), NDTF_BC6H_BITS(BW, 9, 0), NDTF_BC6H_BITS(RX, 4, 0),
+		NDTF_BC6H_BITS(RW, 10, 10), NDTF_BC6H_BITS(GY, 3, 0), NDTF_BC6H_BITS(GX, 3, 0), NDTF_BC6H_BITS(GW, 10, 10),
+		NDTF_BC6H_BITS(BZ, 0, 0), NDTF_BC6H_BITS(GZ, 3, 0), NDTF_BC6H_BITS(BX, 3, 0), NDTF_BC6H_BITS(BW, 10, 10),
+		NDTF_BC6H_BITS(BZ, 1, 1), NDTF_BC6H_BITS(BY, 3, 0), NDTF_BC6H_BITS(RY, 4, 0), NDTF_BC6H_BITS(BZ, 2, 2),
+		NDTF_BC6H_BITS(RZ, 4, 0), NDTF_BC6H_BITS(BZ, 3, 3), NDTF_BC6H_BITS(D, 4, 0) } },
+	{ 1, 2, 11, { 4, 5, 4 }, {
+		NDTF_BC6H_BITS(RW, 9, 0), NDTF_BC6H_BITS(GW, 9, 0), NDTF_BC6H_BITS(BW, 9, 0), NDTF_BC6H_BITS(RX, 3, 0),
+		NDTF_BC6H_BITS(RW, 10, 10), NDTF_BC6H_BITS(GZ, 4, 4), NDTF_BC6H_BITS(GY, 3, 0), NDTF_BC6H_BITS(GX, 4, 0),
+		NDTF_BC6H_BITS(GW, 10, 10), NDTF_BC6H_BITS(GZ, 3, 0), NDTF_BC6H_BITS(BX, 3, 0), NDTF_BC6H_BITS(BW, 10, 10),
+		NDTF_BC6H_BITS(BZ, 1, 1), NDTF_BC6H_BITS(BY, 3, 0), NDTF_BC6H_BITS(RY, 3, 0), NDTF_BC6H_BITS(BZ, 0, 0),
+		NDTF_BC6H_BITS(BZ, 2, 2), NDTF_BC6H_BITS(RZ, 3, 0), NDTF_BC6H_BITS(GY, 4, 4), NDTF_BC6H_BITS(BZ, 3, 3),
+		NDTF_BC6H_BITS(D, 4, 0) } },
+	{ 1, 2, 11, { 4, 4, 5 }, {
+		NDTF_BC6H_BITS(RW, 9, 0), NDTF_BC6H_BITS(GW, 9, 0), NDTF_BC6H_BITS(BW, 9, 0), NDTF_BC6H_BITS(RX, 3, 0),
+		NDTF_BC6H_BITS(RW, 10, 10), NDTF_BC6H_BITS(BY, 4, 4), NDTF_BC6H_BITS(GY, 3, 0), NDTF_BC6H_BITS(GX, 3, 0),
+		NDTF_BC6H_BITS(GW, 10, 10), NDTF_BC6H_BITS(BZ, 0, 0), NDTF_BC6H_BITS(GZ, 3, 0), NDTF_BC6H_BITS(BX, 4, 0),
+		NDTF_BC6H_BITS(BW, 10, 10), NDTF_BC6H_BITS(BY, 3, 0), NDTF_BC6H_BITS(RY, 3, 0), NDTF_BC6H_BITS(BZ, 2, 1),
+		NDTF_BC6H_BITS(RZ, 3, 0), NDTF_BC6H_BITS(BZ, 4, 4), NDTF_BC6H_BITS(BZ, 3, 3), NDTF_BC6H_BITS(D, 4, 0) } },
+	{ 1, 2, 9, { 5, 5, 5 }, {
+		NDTF_BC6H_BITS(RW, 8, 0), NDTF_BC6H_BITS(BY, 4, 4), NDTF_BC6H_BITS(GW, 8, 0), NDTF_BC6H_BITS(GY, 4, 4),
+		NDTF_BC6H_BITS(BW, 8, 0), NDTF_BC6H_BITS(BZ, 4, 4), NDTF_BC6H_BITS(RX, 4, 0), NDTF_BC6H_BITS(GZ, 4, 4),
+		NDTF_BC6H_BITS(GY, 3, 0), NDTF_BC6H_BITS(GX, 4, 0), NDTF_BC6H_BITS(BZ, 0, 0), NDTF_BC6H_BITS(GZ, 3, 0),
+		NDTF_BC6H_BITS(BX, 4, 0), NDTF_BC6H_BITS(BZ, 1, 1), NDTF_BC6H_BITS(BY, 3, 0), NDTF_BC6H_BITS(RY, 4, 0),
+		NDTF_BC6H_BITS(BZ, 2, 2), NDTF_BC6H_BITS(RZ, 4, 0), NDTF_BC6H_BITS(BZ, 3, 3), NDTF_BC6H_BITS(D, 4, 0) } },
+	{ 1, 2, 8, { 6, 5, 5 }, {
+		NDTF_BC6H_BITS(RW, 7, 0), NDTF_BC6H_BITS(GZ, 4, 4), NDTF_BC6H_BITS(BY, 4, 4), NDTF_BC6H_BITS(GW, 7, 0),
+		NDTF_BC6H_BITS(BZ, 2, 2), NDTF_BC6H_BITS(GY, 4, 4), NDTF_BC6H_BITS(BW, 7, 0), NDTF_BC6H_BITS(BZ, 4, 3),
+		NDTF_BC6H_BITS(RX, 5, 0), NDTF_BC6H_BITS(GY, 3, 0), NDTF_BC6H_BITS(GX, 4, 0), NDTF_BC6H_BITS(BZ, 0, 0),
+		NDTF_BC6H_BITS(GZ, 3, 0), NDTF_BC6H_BITS(BX, 4, 0), NDTF_BC6H_BITS(BZ, 1, 1), NDTF_BC6H_BITS(BY, 3, 0),
+		NDTF_BC6H_BITS(RY, 5, 0), NDTF_BC6H_BITS(RZ, 5, 0), NDTF_BC6H_BITS(D, 4, 0) } },
+	{ 1, 2, 8, { 5, 6, 5 }, {
+		NDTF_BC6H_BITS(RW, 7, 0), NDTF_BC6H_BITS(BZ, 0, 0), NDTF_BC6H_BITS(BY, 4, 4), NDTF_BC6H_BITS(GW, 7, 0),
+		NDTF_BC6H_BITS(GY, 4, 5), NDTF_BC6H_BITS(BW, 7, 0), NDTF_BC6H_BITS(GZ, 5, 5), NDTF_BC6H_BITS(BZ, 4, 4),
+		NDTF_BC6H_BITS(RX, 4, 0), NDTF_BC6H_BITS(GZ, 4, 4), NDTF_BC6H_BITS(GY, 3, 0), NDTF_BC6H_BITS(GX, 5, 0),
+		NDTF_BC6H_BITS(GZ, 3, 0), NDTF_BC6H_BITS(BX, 4, 0), NDTF_BC6H_BITS(BZ, 1, 1), NDTF_BC6H_BITS(BY, 3, 0),
+		NDTF_BC6H_BITS(RY, 4, 0), NDTF_BC6H_BITS(BZ, 2, 2), NDTF_BC6H_BITS(RZ, 4, 0), NDTF_BC6H_BITS(BZ, 3, 3),
+		NDTF_BC6H_BITS(D, 4, 0) } },
+	{ 1, 2, 8, { 5, 5, 6 }, {
+		NDTF_BC6H_BITS(RW, 7, 0), NDTF_BC6H_BITS(BZ, 1, 1), NDTF_BC6H_BITS(BY, 4, 4), NDTF_BC6H_BITS(GW, 7, 0),
+		NDTF_BC6H_BITS(BY, 5, 5), NDTF_BC6H_BITS(GY, 4, 4), NDTF_BC6H_BITS(BW, 7, 0), NDTF_BC6H_BITS(BZ, 4, 5),
+		NDTF_BC6H_BITS(RX, 4, 0), NDTF_BC6H_BITS(GZ, 4, 4), NDTF_BC6H_BITS(GY, 3, 0), NDTF_BC6H_BITS(GX, 4, 0),
+		NDTF_BC6H_BITS(BZ, 0, 0), NDTF_BC6H_BITS(GZ, 3, 0), NDTF_BC6H_BITS(BX, 5, 0), NDTF_BC6H_BITS(BY, 3, 0),
+		NDTF_BC6H_BITS(RY, 4, 0), NDTF_BC6H_BITS(BZ, 2, 2), NDTF_BC6H_BITS(RZ, 4, 0), NDTF_BC6H_BITS(BZ, 3, 3),
+		NDTF_BC6H_BITS(D, 4, 0) } },
+	{ 0, 2, 6, { 6, 6, 6 }, {
+		NDTF_BC6H_BITS(RW, 5, 0), NDTF_BC6H_BITS(GZ, 4, 4), NDTF_BC6H_BITS(BZ, 1, 0), NDTF_BC6H_BITS(BY, 4, 4),
+		NDTF_BC6H_BITS(GW, 5, 0), NDTF_BC6H_BITS(GY, 5, 5), NDTF_BC6H_BITS(BY, 5, 5), NDTF_BC6H_BITS(BZ, 2, 2),
+		NDTF_BC6H_BITS(GY, 4, 4), NDTF_BC6H_BITS(BW, 5, 0), NDTF_BC6H_BITS(GZ, 5, 5), NDTF_BC6H_BITS(BZ, 3, 3),
+		NDTF_BC6H_BITS(BZ, 5, 5), NDTF_BC6H_BITS(BZ, 4, 4), NDTF_BC6H_BITS(RX, 5, 0), NDTF_BC6H_BITS(GY, 3, 0),
+		NDTF_BC6H_BITS(GX, 5, 0), NDTF_BC6H_BITS(GZ, 3, 0), NDTF_BC6H_BITS(BX, 5, 0), NDTF_BC6H_BITS(BY, 3, 0),
+		NDTF_BC6H_BITS(RY, 5, 0), NDTF_BC6H_BITS(RZ, 5, 0), NDTF_BC6H_BITS(D, 4, 0) } },
+	{ 0, 1, 10, { 10, 10, 10 }, {
+		NDTF_BC6H_BITS(RW, 9, 0), NDTF_BC6H_BITS(GW, 9, 0), NDTF_BC6H_BITS(BW, 9, 0),
+		NDTF_BC6H_BITS(RX, 9, 0), NDTF_BC6H_BITS(GX, 9, 0), NDTF_BC6H_BITS(BX, 9, 0) } },
+	{ 1, 1, 11, { 9, 9, 9 }, {
+		NDTF_BC6H_BITS(RW, 9, 0), NDTF_BC6H_BITS(GW, 9, 0), NDTF_BC6H_BITS(BW, 9, 0), NDTF_BC6H_BITS(RX, 8, 0),
+		NDTF_BC6H_BITS(RW, 10, 10), NDTF_BC6H_BITS(GX, 8, 0), NDTF_BC6H_BITS(GW, 10, 10), NDTF_BC6H_BITS(BX, 8, 0),
+		NDTF_BC6H_BITS(BW, 10, 10) } },
+	{ 1, 1, 12, { 8, 8, 8 }, {
+		NDTF_BC6H_BITS(RW, 9, 0), NDTF_BC6H_BITS(GW, 9, 0), NDTF_BC6H_BITS(BW, 9, 0), NDTF_BC6H_BITS(RX, 7, 0),
+		NDTF_BC6H_BITS(RW, 10, 11), NDTF_BC6H_BITS(GX, 7, 0), NDTF_BC6H_BITS(GW, 10, 11), NDTF_BC6H_BITS(BX, 7, 0),
+		NDTF_BC6H_BITS(BW, 10, 11) } },
+	{ 1, 1, 16, { 4, 4, 4 }, {
+		NDTF_BC6H_BITS(RW, 9, 0), NDTF_BC6H_BITS(GW, 9, 0), NDTF_BC6H_BITS(BW, 9, 0), NDTF_BC6H_BITS(RX, 3, 0),
+		NDTF_BC6H_BITS(RW, 10, 15), NDTF_BC6H_BITS(GX, 3, 0), NDTF_BC6H_BITS(GW, 10, 15), NDTF_BC6H_BITS(BX, 3, 0),
+		NDTF_BC6H_BITS(BW, 10, 15) } },
+};
+
+// mode of the low 5 bits of a block, -1 for the reserved ones. modes 1 and 2 only use 2 bits
+static int ndtf_bc6h_mode(uint32_t code)
+{
+	if ((code & 3) < 2)
+		return (int)(code & 3);
+	switch (code)
+	{
+	case 2: return 2;
+	case 6: return 3;
+	case 10: return 4;
+	case 14: return 5;
+	case 18: return 6;
+	case 22: return 7;
+	case 26: return 8;
+	case 30: return 9;
+	case 3: return 10;
+	case 7: return 11;
+	case 11: return 12;
+	case 15: return 13;
+	default: return -1;
+	}
+}
+
+static int ndtf_bc6h_unquantize(int value, int bits)
+{
+	if (bits >= 15)
+		return value;
+	if (value == 0)
+		return 0;
+	if (value == (1 << bits) - 1)
+		return 0xFFFF;
+	return ((value << 16) + 0x8000) >> bits;
+}
+
+// interpolated unquantized value scaled to the bits of a half
+static int ndtf_bc6h_finish(int value)
+{
+	return (value * 31) >> 6;
+}
+
+static void ndtf_bc6h_decodeBlock(const uint8_t* block, uint16_t texels[16][3])
+{
+	ndtf_BcBits bits;
+	ndtf_bcBits_load(&bits, block);
+
+	uint32_t code = ndtf_bcBits_read(&bits, 2);
+	if (code >= 2)
+		code |= ndtf_bcBits_read(&bits, 3) << 2;
+	int mode = ndtf_bc6h_mode(code);
+	if (mode < 0)
+	{
+		memset(texels, 0, 16 * 3 * sizeof(uint16_t));
+		return;
+	}
+
+	const ndtf_Bc6hMode* m = &ndtf_bc6h_modes[mode];
+	int fields[NDTF_BC6H_D + 1];
+	memset(fields, 0, sizeof(fields));
+	for (int r = 0; r < 24 && (m->runs[r].to || m->runs[r].from || m->runs[r].field); r++)
+	{
+		const ndtf_Bc6hRun* run = &m->runs[r];
+		int step = run->to >= run->from ? 1 : -1;
+		for (int b = run->from;; b += step)
+		{
+			fields[run->field] |= (int)ndtf_bcBits_read(&bits, 1) << b;
+			if (b == run->to)
+				break;
+		}
+	}
+
+	// endpoints [channel][w x y z], transformed modes store the others as differences to w
+	int endpoints[3][4];
+	int mask = (1 << m->endpointBits) - 1;
+	for (int c = 0; c < 3; c++)
+	{
+		for (int e = 0; e < 4; e++)
+		{
+			int value = fields[c * 4 + e];
+			if (m->transformed && e > 0)
+			{
+				int deltaBits = m->deltaBits[c];
+				if (value & (1 << (deltaBits - 1)))
+					value -= 1 << deltaBits;
+				value = (fields[c * 4] + value) & mask;
+			}
+			endpoints[c][e] = ndtf_bc6h_unquantize(value, m->endpointBits);
+		}
+	}
+
+	int partition = fields[NDTF_BC6H_D];
+	uint8_t subsetOf[16];
+	ndtf_bc_partition(m->regions, partition, subsetOf);
+
+	int indexBits = m->regions == 2 ? 3 : 4;
+	bits.position = m->regions == 2 ? 82 : 65;
+	const uint8_t* weights = ndtf_bc_weights(indexBits);
+	for (int i = 0; i < 16; i++)
+	{
+		bool anchor = i == ndtf_bc_anchor(m->regions, partition, subsetOf[i]);
+		int weight = weights[ndtf_bcBits_read(&bits, indexBits - anchor)];
+		for (int c = 0; c < 3; c++)
+		{
+			int e0 = endpoints[c][subsetOf[i] * 2], e1 = endpoints[c][subsetOf[i] * 2 + 1];
+			texels[i][c] = (uint16_t)ndtf_bc6h_finish(ndtf_bc_interpolate(e0, e1, weight));
+		}
+	}
+}
+
+// low bits of the blocks of each mode, 2 of them for the first two and 5 for the others
+static const uint8_t ndtf_bc6h_codes[14] = { 0, 1, 2, 6, 10, 14, 18, 22, 26, 30, 3, 7, 11, 15 };
+
+// endpoint of bits whose decoded value is closest to a half
+static int ndtf_bc6h_quantize(float half, int bits)
+{
+	int top = (1 << bits) - 1;
+	int estimate = min((int)(half * (float)(1 << bits) / (31.0f * 1024.0f)), top);
+	int best = 0;
+	float bestError = FLT_MAX;
+	for (int q = max(estimate - 1, 0); q <= min(estimate + 1, top); q++)
+	{
+		float error = fabsf((float)ndtf_bc6h_finish(ndtf_bc6h_unquantize(q, bits)) - half);
+		if (error < bestError)
+		{
+			bestError = error;
+			best = q;
+		}
+	}
+	return best;
+}
+
+// quantizes the endpoints of a region to bits and assigns the texels of subset to its palette. a single
+// region has 4 bit indices (subsetOf is NULL), two regions have 3 bit ones
+static float ndtf_bc6h_evaluate(const float planes[4][16], const uint8_t* subsetOf, int subset, int bits, const float e[2][3], int q[2][3], uint8_t indices[16])
+{
+	int expanded[2][3];
+	for (int k = 0; k < 2; k++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			q[k][c] = ndtf_bc6h_quantize(e[k][c], bits);
+			expanded[k][c] = ndtf_bc6h_unquantize(q[k][c], bits);
+		}
+	}
+
+	float palette[16][4];
+	int count = subsetOf ? 8 : 16;
+	const uint8_t* weights = ndtf_bc_weights(subsetOf ? 3 : 4);
+	for (int j = 0; j < count; j++)
+	{
+		for (int c = 0; c < 3; c++)
+			palette[j][c] = (float)ndtf_bc6h_finish(ndtf_bc_interpolate(expanded[0][c], expanded[1][c], weights[j]));
+		palette[j][3] = 0.0f;
+	}
+	return ndtf_bc_assign(planes, 3, palette, count, subsetOf, subset, indices);
+}
+
+// endpoints of one region fitted on the bits of the halves, returns the error of the texels of subset and the
+// endpoints before quantization in fit
+static float ndtf_bc6h_encodeRegion(const float planes[4][16], const uint8_t* subsetOf, int subset, int bits, NDTF_BlockQuality quality, float fit[2][3], int q[2][3], uint8_t indices[16])
+{
+	float e[2][4];
+	ndtf_bc_fitLine(planes, 3, subsetOf, subset, e[0], e[1]);
+
+	const uint8_t* weights = ndtf_bc_weights(subsetOf ? 3 : 4);
+	float error = FLT_MAX;
+	int iterations = quality == NDTF_BLOCKQUALITY_FAST ? 0 : quality == NDTF_BLOCKQUALITY_HIGH ? 3 : 1;
+	for (int iteration = 0; iteration <= iterations && error > 0.0f; iteration++)
+	{
+		if (iteration > 0 && !ndtf_bc_refine(planes, 3, subsetOf, subset, indices, weights, (float)NDTF_BC6H_MAX, e[0], e[1]))
+			break;
+
+		float candidate[2][3];
+		for (int k = 0; k < 2; k++)
+		{
+			for (int c = 0; c < 3; c++)
+				candidate[k][c] = fminf(fmaxf(e[k][c], 0.0f), (float)NDTF_BC6H_MAX);
+		}
+
+		int candidateQ[2][3];
+		uint8_t candidateIndices[16];
+		float candidateError = ndtf_bc6h_evaluate(planes, subsetOf, subset, bits, (const float(*)[3])candidate, candidateQ, candidateIndices);
+		if (candidateError < error)
+		{
+			error = candidateError;
+			memcpy(fit, candidate, sizeof(candidate));
+			memcpy(q, candidateQ, sizeof(candidateQ));
+			for (int i = 0; i < 16; i++)
+			{
+				if (!subsetOf || subsetOf[i] == subset)
+					indices[i] = candidateIndices[i];
+			}
+		}
+	}
+	return error;
+}
+
+// fields of mode for the endpoints q[region][endpoint][channel]. regions whose anchor needs the top index bit are
+// flipped first. false when a transformed mode cannot hold the differences to the first endpoint
+static bool ndtf_bc6h_pack(int mode, int partition, int q[2][2][3], uint8_t indices[16], int fields[NDTF_BC6H_D + 1])
+{
+	const ndtf_Bc6hMode* m = &ndtf_bc6h_modes[mode];
+	uint8_t subsetOf[16];
+	ndtf_bc_partition(m->regions, partition, subsetOf);
+
+	int indexBits = m->regions == 2 ? 3 : 4;
+	for (int r = 0; r < m->regions; r++)
+	{
+		if (!(indices[ndtf_bc_anchor(m->regions, partition, r)] >> (indexBits - 1)))
+			continue;
+
+		for (int c = 0; c < 3; c++)
+		{
+			int swap = q[r][0][c];
+			q[r][0][c] = q[r][1][c];
+			q[r][1][c] = swap;
+		}
+		for (int i = 0; i < 16; i++)
+		{
+			if (subsetOf[i] == r)
+				indices[i] = (uint8_t)((1 << indexBits) - 1 - indices[i]);
+		}
+	}
+
+	memset(fields, 0, (NDTF_BC6H_D + 1) * sizeof(int));
+	for (int c = 0; c < 3; c++)
+	{
+		for (int e = 0; e < m->regions * 2; e++)
+		{
+			int value = q[e >> 1][e & 1][c];
+			if (m->transformed && e > 0)
+			{
+				int deltaBits = m->deltaBits[c];
+				value -= q[0][0][c];
+				if (value < -(1 << (deltaBits - 1)) || value >= 1 << (deltaBits - 1))
+					return false;
+				value &= (1 << deltaBits) - 1;
+			}
+			fields[c * 4 + e] = value;
+		}
+	}
+	fields[NDTF_BC6H_D] = partition;
+	return true;
+}
+
+static void ndtf_bc6h_writeBlock(int mode, const int fields[NDTF_BC6H_D + 1], const uint8_t indices[16], uint8_t* block)
+{
+	const ndtf_Bc6hMode* m = &ndtf_bc6h_modes[mode];
+	ndtf_BcBits bits;
+	memset(&bits, 0, sizeof(ndtf_BcBits));
+	ndtf_bcBits_write(&bits, ndtf_bc6h_codes[mode], mode < 2 ? 2 : 5);
+	for (int r = 0; r < 24 && (m->runs[r].to || m->runs[r].from || m->runs[r].field); r++)
+	{
+		const ndtf_Bc6hRun* run = &m->runs[r];
+		int step = run->to >= run->from ? 1 : -1;
+		for (int b = run->from;; b += step)
+		{
+			ndtf_bcBits_write(&bits, (uint32_t)(fields[run->field] >> b) & 1, 1);
+			if (b == run->to)
+				break;
+		}
+	}
+
+	int partition = fields[NDTF_BC6H_D];
+	uint8_t subsetOf[16];
+	ndtf_bc_partition(m->regions, partition, subsetOf);
+
+	int indexBits = m->regions == 2 ? 3 : 4;
+	bits.position = m->regions == 2 ? 82 : 65;
+	for (int i = 0; i < 16; i++)
+	{
+		bool anchor = i == ndtf_bc_anchor(m->regions, partition, subsetOf[i]);
+		ndtf_bcBits_write(&bits, indices[i], indexBits - anchor);
+	}
+	ndtf_bcBits_store(&bits, block);
+}
+
+// mode 11: one region of 10 bit endpoints and 4 bit indices. HIGH also tries the one region modes that store
+// wider endpoints as differences, and the two region modes on the best ranked partitions. their endpoints are
+// fitted once at the widest precision and quantized for each mode
+static void ndtf_bc6h_encodeBlock(const uint16_t texels[16][3], uint8_t* block, NDTF_BlockQuality quality)
+{
+	float planes[4][16];
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 3; c++)
+			planes[c][i] = (float)texels[i][c];
+		planes[3][i] = 0.0f;
+	}
+
+	float e[2][2][3];
+	int q[2][2][3];
+	uint8_t indices[16];
+	int fields[NDTF_BC6H_D + 1];
+	int mode = 10;
+	float error = ndtf_bc6h_encodeRegion((const float(*)[16])planes, NULL, 0, 10, quality, e[0], q[0], indices);
+	ndtf_bc6h_pack(mode, 0, q, indices, fields);
+	if (quality != NDTF_BLOCKQUALITY_HIGH || error <= 0.0f)
+	{
+		ndtf_bc6h_writeBlock(mode, fields, indices, block);
+		return;
+	}
+
+	// modes 12 to 14, when the endpoints are close enough for their differences
+	for (int other = 11; other < 14; other++)
+	{
+		int candidateQ[2][2][3], candidateFields[NDTF_BC6H_D + 1];
+		uint8_t candidateIndices[16];
+		float candidateError = ndtf_bc6h_evaluate((const float(*)[16])planes, NULL, 0, ndtf_bc6h_modes[other].endpointBits, (const float(*)[3])e[0], candidateQ[0], candidateIndices);
+		if (candidateError < error && ndtf_bc6h_pack(other, 0, candidateQ, candidateIndices, candidateFields))
+		{
+			error = candidateError;
+			mode = other;
+			memcpy(fields, candidateFields, sizeof(fields));
+			memcpy(indices, candidateIndices, sizeof(indices));
+		}
+	}
+
+	// modes 1 to 10, fitted with the 11 bit endpoints of modes 3 to 5
+	int candidates[NDTF_BC_CANDIDATES];
+	ndtf_bc_rankPartitions((const float(*)[16])planes, 3, 32, candidates);
+	for (int k = 0; k < NDTF_BC_CANDIDATES && error > 0.0f; k++)
+	{
+		uint8_t subsetOf[16];
+		ndtf_bc_partition(2, candidates[k], subsetOf);
+		int candidateQ[2][2][3], candidateFields[NDTF_BC6H_D + 1];
+		uint8_t candidateIndices[16];
+		ndtf_bc6h_encodeRegion((const float(*)[16])planes, subsetOf, 0, 11, quality, e[0], candidateQ[0], candidateIndices);
+		ndtf_bc6h_encodeRegion((const float(*)[16])planes, subsetOf, 1, 11, quality, e[1], candidateQ[1], candidateIndices);
+		for (int other = 0; other < 10; other++)
+		{
+			int bits = ndtf_bc6h_modes[other].endpointBits;
+			float candidateError = 0.0f;
+			for (int r = 0; r < 2; r++)
+				candidateError += ndtf_bc6h_evaluate((const float(*)[16])planes, subsetOf, r, bits, (const float(*)[3])e[r], candidateQ[r], candidateIndices);
+			if (candidateError < error && ndtf_bc6h_pack(other, candidates[k], candidateQ, candidateIndices, candidateFields))
+			{
+				error = candidateError;
+				mode = other;
+				memcpy(fields, candidateFields, sizeof(fields));
+				memcpy(indices, candidateIndices, sizeof(indices));
+			}
+		}
+	}
+
+	ndtf_bc6h_writeBlock(mode, fields, indices, block);
+}
+
+// volumes
+
+typedef struct ndtf_BcPass
+{
+	NDTF_TexelFormat blockFormat;
+	const uint8_t* src;
+	uint8_t* dst;
+	size_t width, height;
+	size_t blocksX, blocksY;
+	size_t rows;			// block rows of all slices
+	size_t rowsPerTask;
+	NDTF_BlockQuality quality;
+} ndtf_BcPass;
+
+static void ndtf_bc_encodeTask(void* taskData, size_t index)
+{
+	const ndtf_BcPass* pass = (const ndtf_BcPass*)taskData;
+	size_t blockSize = ndtf_getBlockSize(pass->blockFormat);
+	size_t texelSize = ndtf_getTexelSize(ndtf_getDecodedTexelFormat(pass->blockFormat));
+	size_t end = min((index + 1) * pass->rowsPerTask, pass->rows);
+
+	for (size_t r = index * pass->rowsPerTask; r < end; r++)
+	{
+		const uint8_t* slice = pass->src + (r / pass->blocksY) * pass->width * pass->height * texelSize;
+		size_t y0 = (r % pass->blocksY) * 4;
+
+		for (size_t bx = 0; bx < pass->blocksX; bx++)
+		{
+			uint8_t* block = pass->dst + (r * pass->blocksX + bx) * blockSize;
+			const uint8_t* texels[16];
+			for (int i = 0; i < 16; i++)
+			{
+				size_t x = min(bx * 4 + (size_t)(i & 3), pass->width - 1);
+				size_t y = min(y0 + (size_t)(i >> 2), pass->height - 1);
+				texels[i] = slice + (x + y * pass->width) * texelSize;
+			}
+
+			switch (pass->blockFormat)
+			{
+			case NDTF_TEXELFORMAT_BC4:
+			case NDTF_TEXELFORMAT_BC5:
+			{
+				// BC5 is a BC4 block for R followed by one for G
+				int channels = pass->blockFormat == NDTF_TEXELFORMAT_BC5 ? 2 : 1;
+				for (int c = 0; c < channels; c++)
+				{
+					uint8_t values[16];
+					for (int i = 0; i < 16; i++)
+						values[i] = texels[i][c];
+					ndtf_bc4_encodeBlock(values, block + c * 8, pass->quality);
+				}
+			} break;
+			case NDTF_TEXELFORMAT_BC6H:
+			{
+				uint16_t halves[16][3];
+				for (int i = 0; i < 16; i++)
+				{
+					float rgb[3];
+					memcpy(rgb, texels[i], sizeof(rgb));
+					for (int c = 0; c < 3; c++)
+						halves[i][c] = ndtf_bc_floatToHalf(rgb[c]);
+				}
+				ndtf_bc6h_encodeBlock((const uint16_t(*)[3])halves, block, pass->quality);
+			} break;
+			default:
+			{
+				uint8_t rgba[16][4];
+				for (int i = 0; i < 16; i++)
+					memcpy(rgba[i], texels[i], 4);
+				ndtf_bc7_encodeBlock((const uint8_t(*)[4])rgba, block, pass->quality);
+			} break;
+			}
+		}
+	}
+}
+
+static void ndtf_bc_decodeTask(void* taskData, size_t index)
+{
+	const ndtf_BcPass* pass = (const ndtf_BcPass*)taskData;
+	size_t blockSize = ndtf_getBlockSize(pass->blockFormat);
+	size_t texelSize = ndtf_getTexelSize(ndtf_getDecodedTexelFormat(pass->blockFormat));
+	size_t end = min((index + 1) * pass->rowsPerTask, pass->rows);
+
+	for (size_t r = index * pass->rowsPerTask; r < end; r++)
+	{
+		uint8_t* slice = pass->dst + (r / pass->blocksY) * pass->width * pass->height * texelSize;
+		size_t y0 = (r % pass->blocksY) * 4;
+
+		for (size_t bx = 0; bx < pass->blocksX; bx++)
+		{
+			const uint8_t* block = pass->src + (r * pass->blocksX + bx) * blockSize;
+
+			// texels of the block, 16 bytes each
+			uint8_t decoded[16][16];
+			switch (pass->blockFormat)
+			{
+			case NDTF_TEXELFORMAT_BC4:
+			{
+				uint8_t values[16];
+				ndtf_bc4_decodeBlock(block, values);
+				for (int i = 0; i < 16; i++)
+					decoded[i][0] = values[i];
+			} break;
+			case NDTF_TEXELFORMAT_BC5:
+			{
+				uint8_t values[2][16];
+				ndtf_bc4_decodeBlock(block, values[0]);
+				ndtf_bc4_decodeBlock(block + 8, values[1]);
+				for (int i = 0; i < 16; i++)
+				{
+					decoded[i][0] = values[0][i];
+					decoded[i][1] = values[1][i];
+					decoded[i][2] = 0;
+				}
+			} break;
+			case NDTF_TEXELFORMAT_BC6H:
+			{
+				uint16_t halves[16][3];
+				ndtf_bc6h_decodeBlock(block, halves);
+				for (int i = 0; i < 16; i++)
+				{
+					float rgb[3];
+					for (int c = 0; c < 3; c++)
+						rgb[c] = ndtf_bc_halfToFloat(halves[i][c]);
+					memcpy(decoded[i], rgb, sizeof(rgb));
+				}
+			} break;
+			default:
+			{
+				uint8_t rgba[16][4];
+				ndtf_bc7_decodeBlock(block, rgba);
+				for (int i = 0; i < 16; i++)
+					memcpy(decoded[i], rgba[i], 4);
+			} break;
+			}
+
+			size_t columns = min(pass->width - bx * 4, (size_t)4);
+			size_t rows = min(pass->height - y0, (size_t)4);
+			for (size_t y = 0; y < rows; y++)
+			{
+				for (size_t x = 0; x < columns; x++)
+					memcpy(slice + (bx * 4 + x + (y0 + y) * pass->width) * texelSize, decoded[x + y * 4], texelSize);
+			}
+		}
+	}
+}
+
+static void ndtf_bc_run(NDTF_TaskFunc task, NDTF_TexelFormat blockFormat, const uint8_t* src, uint8_t* dst, size_t width, size_t height, size_t slices, const NDTF_Context* ctx)
+{
+	ndtf_BcPass pass;
+	pass.blockFormat = blockFormat;
+	pass.src = src;
+	pass.dst = dst;
+	pass.width = width;
+	pass.height = height;
+	pass.blocksX = (width + 3) / 4;
+	pass.blocksY = (height + 3) / 4;
+	pass.rows = pass.blocksY * slices;
+	pass.rowsPerTask = max(NDTF_BC_CHUNK / max(pass.blocksX, 1), 1);
+	pass.quality = ctx && ctx->blockQuality != NDTF_BLOCKQUALITY_DEFAULT ? ctx->blockQuality : NDTF_BLOCKQUALITY_NORMAL;
+	if (!pass.blocksX || !pass.rows)
+		return;
+
+	ndtf_parallelFor(ctx, task, &pass, (pass.rows + pass.rowsPerTask - 1) / pass.rowsPerTask);
+}
+
+void ndtf_bc_encode(NDTF_TexelFormat blockFormat, const uint8_t* texels, uint8_t* blocks, size_t width, size_t height, size_t slices, const NDTF_Context* ctx)
+{
+	NDTF_SCOPE_BEGIN(encodeScope, ctx, NDTF_PHASE_CONVERT, "bc encode");
+	ndtf_bc_run(ndtf_bc_encodeTask, blockFormat, texels, blocks, width, height, slices, ctx);
+	NDTF_SCOPE_END(encodeScope, ctx, ((width + 3) / 4) * ((height + 3) / 4) * slices * ndtf_getBlockSize(blockFormat));
+}
+
+void ndtf_bc_decode(NDTF_TexelFormat blockFormat, const uint8_t* blocks, uint8_t* texels, size_t width, size_t height, size_t slices, const NDTF_Context* ctx)
+{
+	NDTF_SCOPE_BEGIN(decodeScope, ctx, NDTF_PHASE_CONVERT, "bc decode");
+	ndtf_bc_run(ndtf_bc_decodeTask, blockFormat, blocks, texels, width, height, slices, ctx);
+	NDTF_SCOPE_END(decodeScope, ctx, width * height * slices * ndtf_getTexelSize(ndtf_getDecodedTexelFormat(blockFormat)));
+}
@@ -0,0 +1,516 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+	#define _POSIX_C_SOURCE 200809L
+	#define _DEFAULT_SOURCE // d_type
+#endif
+
+#include "ndtf_internal.h"
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+	#include <dirent.h>
+#endif
+
+#define NDTF_CATALOG_SIGNATURE "NDTC"
+#define NDTF_CATALOG_VERSION 2 // entries hold the v2.0 in-memory header
+#define NDTF_CATALOG_EXTENSION ".ndtf"
+
+// growable list of relative paths, stored back to back in one buffer
+typedef struct ndtf_PathList
+{
+	char* data;
+	size_t size;
+	size_t capacity;
+	size_t* offsets;
+	size_t count;
+	size_t offsetCapacity;
+	const NDTF_Context* ctx;
+} ndtf_PathList;
+
+static bool ndtf_pathList_add(ndtf_PathList* list, const char* path, size_t length)
+{
+	if (list->size + length + 1 > list->capacity)
+	{
+		size_t capacity = max(list->capacity * 2, list->size + length + 1 + 4096);
+		char* data = (char*)ndtf_mem_realloc(list->ctx, list->data, list->capacity, capacity);
+		if (!data) return false;
+		list->data = data;
+		list->capacity = capacity;
+	}
+	if (list->count == list->offsetCapacity)
+	{
+		size_t capacity = max(list->offsetCapacity * 2, 1024);
+		size_t* offsets = (size_t*)ndtf_mem_realloc(list->ctx, list->offsets, list->offsetCapacity * sizeof(size_t), capacity * sizeof(size_t));
+		if (!offsets) return false;
+		list->offsets = offsets;
+		list->offsetCapacity = capacity;
+	}
+
+	list->offsets[list->count++] = list->size;
+	memcpy(list->data + list->size, path, length);
+	list->data[list->size + length] = '\0';
+	list->size += length + 1;
+
+	return true;
+}
+
+static bool ndtf_hasExtension(const char* name, size_t length)
+{
+	size_t extLength = sizeof(NDTF_CATALOG_EXTENSION) - 1;
+	if (length < extLength)
+		return false;
+
+	const char* ext = name + length - extLength;
+	for (size_t i = 0; i < extLength; i++)
+	{
+		char c = ext[i];
+		if (c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+		if (c != NDTF_CATALOG_EXTENSION[i])
+			return false;
+	}
+	return true;
+}
+
+// collects the relative paths of all .ndtf files below root, directories are walked iteratively
+static bool ndtf_collectFiles(ndtf_PathList* files, const char* root, const NDTF_Context* ctx)
+{
+	ndtf_PathList dirs;
+	memset(&dirs, 0, sizeof(ndtf_PathList));
+	dirs.ctx = ctx;
+
+	if (!ndtf_pathList_add(&dirs, "", 0))
+		return false;
+
+	size_t rootLength = strlen(root);
+	char* path = NULL;
+	size_t pathCapacity = 0;
+	bool result = true;
+
+	for (size_t d = 0; d < dirs.count && result; d++)
+	{
+		size_t relLength = strlen(dirs.data + dirs.offsets[d]);
+		size_t needed = rootLength + relLength + 8;
+		if (needed > pathCapacity)
+		{
+			char* newPath = (char*)ndtf_mem_realloc(ctx, path, pathCapacity, needed * 2);
+			if (!newPath) { result = false; break; }
+			path = newPath;
+			pathCapacity = needed * 2;
+		}
+
+		// dirs.data may move while adding, copy the relative path first
+		memcpy(path, root, rootLength);
+		path[rootLength] = '/';
+		memcpy(path + rootLength + 1, dirs.data + dirs.offsets[d], relLength + 1);
+		size_t dirLength = rootLength + 1 + relLength;
+
+		char rel[4096];
+		if (relLength + 2 >= sizeof(rel))
+			continue;
+		memcpy(rel, dirs.data + dirs.offsets[d], relLength);
+		if (relLength) rel[relLength++] = '/';
+
+#ifdef _WIN32
+		memcpy(path + dirLength, "/*", 3);
+
+		WIN32_FIND_DATAA find;
+		HANDLE handle = FindFirstFileA(path, &find);
+		if (handle == INVALID_HANDLE_VALUE)
+			continue;
+
+		do
+		{
+			const char* name = find.cFileName;
+			// links to directories are not followed, one pointing to a parent would scan forever
+			bool isDir = (find.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && !(find.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT);
+#else
+		DIR* dir = opendir(path);
+		if (!dir)
+			continue;
+
+		struct dirent* ent;
+		while ((ent = readdir(dir)) != NULL)
+		{
+			const char* name = ent->d_name;
+			bool isDir = false;
+	#ifdef DT_DIR
+			if (ent->d_type == DT_DIR)
+				isDir = true;
+			else if (ent->d_type == DT_UNKNOWN)
+	#endif
+			{
+				struct stat st;
+				size_t nameLength = strlen(name);
+				char* full = (char*)ndtf_mem_alloc(ctx, dirLength + nameLength + 2);
+				if (full)
+				{
+					memcpy(full, path, dirLength);
+					full[dirLength] = '/';
+					memcpy(full + dirLength + 1, name, nameLength + 1);
+					// lstat like d_type, links to directories are not followed
+					isDir = lstat(full, &st) == 0 && S_ISDIR(st.st_mode);
+					ndtf_mem_free(ctx, full);
+				}
+			}
+#endif
+			if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+				continue;
+
+			size_t nameLength = strlen(name);
+			if (relLength + nameLength >= sizeof(rel))
+				continue;
+			memcpy(rel + relLength, name, nameLength);
+
+			if (isDir)
+				result = ndtf_pathList_add(&dirs, rel, relLength + nameLength);
+			else if (ndtf_hasExtension(name, nameLength))
+				result = ndtf_pathList_add(files, rel, relLength + nameLength);
+
+			if (!result)
+				break;
+		}
+#ifdef _WIN32
+		while (FindNextFileA(handle, &find));
+		FindClose(handle);
+#else
+		closedir(dir);
+#endif
+	}
+
+	ndtf_mem_free(ctx, path);
+	ndtf_mem_free(ctx, dirs.data);
+	ndtf_mem_free(ctx, dirs.offsets);
+
+	return result;
+}
+
+typedef struct ndtf_CatalogScan
+{
+	const char* root;
+	size_t rootLength;
+	const ndtf_PathList* files;
+	const NDTF_Catalog* previous;
+	NDTF_CatalogEntry* entries;
+	bool* valid;
+	const NDTF_Context* ctx;
+} ndtf_CatalogScan;
+
+#define NDTF_CATALOG_BATCH 256
+
+static void ndtf_catalog_scanTask(void* taskData, size_t index)
+{
+	ndtf_CatalogScan* scan = (ndtf_CatalogScan*)taskData;
+
+	char path[4096 + 256];
+
+	size_t first = index * NDTF_CATALOG_BATCH;
+	size_t last = min(first + NDTF_CATALOG_BATCH, scan->files->count);
+	for (size_t i = first; i < last; i++)
+	{
+		const char* rel = scan->files->data + scan->files->offsets[i];
+		size_t relLength = strlen(rel);
+		if (scan->rootLength + relLength + 2 > sizeof(path))
+			continue;
+
+		memcpy(path, scan->root, scan->rootLength);
+		path[scan->rootLength] = '/';
+		memcpy(path + scan->rootLength + 1, rel, relLength + 1);
+
+		NDTF_CatalogEntry* entry = &scan->entries[i];
+		entry->path = rel;
+
+#ifdef _WIN32
+		struct __stat64 st;
+		if (_stat64(path, &st) != 0)
+			continue;
+		entry->mtime = (int64_t)st.st_mtime * 1000000000ll;
+#else
+		struct stat st;
+		if (stat(path, &st) != 0)
+			continue;
+	#ifdef __APPLE__
+		entry->mtime = (int64_t)st.st_mtimespec.tv_sec * 1000000000ll + st.st_mtimespec.tv_nsec;
+	#else
+		entry->mtime = (int64_t)st.st_mtim.tv_sec * 1000000000ll + st.st_mtim.tv_nsec;
+	#endif
+#endif
+		entry->fileSize = (uint64_t)st.st_size;
+
+		if (scan->previous)
+		{
+			const NDTF_CatalogEntry* old = ndtf_catalog_find(scan->previous, rel);
+			if (old && old->fileSize == entry->fileSize && old->mtime == entry->mtime)
+			{
+				entry->header = old->header;
+				scan->valid[i] = true;
+				continue;
+			}
+		}
+
+		NDTF_SCOPE_BEGIN(ioScope, scan->ctx, NDTF_PHASE_IO, "probe");
+		scan->valid[i] = ndtf_probe(path, &entry->header);
+		NDTF_SCOPE_END(ioScope, scan->ctx, sizeof(NDTF_Header));
+	}
+}
+
+static int ndtf_catalog_compareEntries(const void* a, const void* b)
+{
+	return strcmp(((const NDTF_CatalogEntry*)a)->path, ((const NDTF_CatalogEntry*)b)->path);
+}
+
+bool ndtf_catalog_build(NDTF_Catalog* catalog, const char* directory, const NDTF_Catalog* previous, const NDTF_Context* ctx)
+{
+	if (!catalog || !directory)
+		return false;
+
+	memset(catalog, 0, sizeof(NDTF_Catalog));
+	catalog->allocator = ndtf_mem_allocator(ctx);
+
+	ndtf_PathList files;
+	memset(&files, 0, sizeof(ndtf_PathList));
+	files.ctx = ctx;
+
+	size_t rootLength = strlen(directory);
+	while (rootLength > 1 && (directory[rootLength - 1] == '/' || directory[rootLength - 1] == '\\'))
+		rootLength--;
+
+	char* root = (char*)ndtf_mem_alloc(ctx, rootLength + 1);
+	if (!root)
+		return false;
+	memcpy(root, directory, rootLength);
+	root[rootLength] = '\0';
+
+	if (!ndtf_collectFiles(&files, root, ctx))
+	{
+		ndtf_mem_free(ctx, root);
+		ndtf_mem_free(ctx, files.data);
+		ndtf_mem_free(ctx, files.offsets);
+		return false;
+	}
+
+	NDTF_CatalogEntry* entries = NULL;
+	bool* valid = NULL;
+	if (files.count)
+	{
+		entries = (NDTF_CatalogEntry*)ndtf_mem_alloc(ctx, files.count * sizeof(NDTF_CatalogEntry));
+		valid = (bool*)ndtf_mem_alloc(ctx, files.count * sizeof(bool));
+		if (!entries || !valid)
+		{
+			ndtf_mem_free(ctx, entries);
+			ndtf_mem_free(ctx, valid);
+			ndtf_mem_free(ctx, root);
+			ndtf_mem_free(ctx, files.data);
+			ndtf_mem_free(ctx, files.offsets);
+			return false;
+		}
+		memset(entries, 0, files.count * sizeof(NDTF_CatalogEntry));
+		memset(valid, 0, files.count * sizeof(bool));
+	}
+
+	ndtf_CatalogScan scan;
+	scan.root = root;
+	scan.rootLength = rootLength;
+	scan.files = &files;
+	scan.previous = previous;
+	scan.entries = entries;
+	scan.valid = valid;
+	scan.ctx = ctx;
+
+	ndtf_parallelFor(ctx, ndtf_catalog_scanTask, &scan, (files.count + NDTF_CATALOG_BATCH - 1) / NDTF_CATALOG_BATCH);
+
+	// drop files that are not valid ndtf files or vanished during the scan
+	size_t count = 0;
+	for (size_t i = 0; i < files.count; i++)
+	{
+		if (valid[i])
+			entries[count++] = entries[i];
+	}
+
+	qsort(entries, count, sizeof(NDTF_CatalogEntry), ndtf_catalog_compareEntries);
+
+	catalog->entries = entries;
+	catalog->count = count;
+	catalog->paths = files.data;
+	catalog->pathsSize = files.size;
+
+	ndtf_mem_free(ctx, valid);
+	ndtf_mem_free(ctx, root);
+	ndtf_mem_free(ctx, files.offsets);
+
+	return true;
+}
+
+// index file: signature, version, entry count, path pool size, then per entry
+// header, file size, mtime and path offset, followed by the path pool
+typedef struct ndtf_CatalogFileHeader
+{
+	char signature[4];
+	uint32_t version;
+	uint64_t count;
+	uint64_t pathsSize;
+} ndtf_CatalogFileHeader;
+
+typedef struct ndtf_CatalogFileEntry
+{
+	NDTF_Header header;
+	uint64_t fileSize;
+	int64_t mtime;
+	uint64_t pathOffset;
+} ndtf_CatalogFileEntry;
+
+bool ndtf_catalog_save(const NDTF_Catalog* catalog, const char* filename)
+{
+	if (!catalog || !filename)
+		return false;
+
+	FILE* handle = fopen(filename, "wb");
+	if (!handle)
+		return false;
+
+	ndtf_CatalogFileHeader fileHeader;
+	memset(&fileHeader, 0, sizeof(ndtf_CatalogFileHeader));
+	memcpy(fileHeader.signature, NDTF_CATALOG_SIGNATURE, 4);
+	fileHeader.version = NDTF_CATALOG_VERSION;
+	fileHeader.count = catalog->count;
+
+	for (size_t i = 0; i < catalog->count; i++)
+		fileHeader.pathsSize += strlen(catalog->entries[i].path) + 1;
+
+	bool result = fwrite(&fileHeader, sizeof(ndtf_CatalogFileHeader), 1, handle) == 1;
+
+	// paths are written compacted in entry order, entries of a rebuilt catalog may reference a larger pool
+	uint64_t pathOffset = 0;
+	for (size_t i = 0; i < catalog->count && result; i++)
+	{
+		ndtf_CatalogFileEntry entry;
+		memset(&entry, 0, sizeof(ndtf_CatalogFileEntry));
+		entry.header = catalog->entries[i].header;
+		entry.fileSize = catalog->entries[i].fileSize;
+		entry.mtime = catalog->entries[i].mtime;
+		entry.pathOffset = pathOffset;
+		pathOffset += strlen(catalog->entries[i].path) + 1;
+
+		result = fwrite(&entry, sizeof(ndtf_CatalogFileEntry), 1, handle) == 1;
+	}
+	for (size_t i = 0; i < catalog->count && result; i++)
+	{
+		const char* path = catalog->entries[i].path;
+		result = fwrite(path, 1, strlen(path) + 1, handle) == strlen(path) + 1;
+	}
+
+	if (fclose(handle) != 0)
+		result = false;
+
+	return result;
+}
+
+bool ndtf_catalog_load(NDTF_Catalog* catalog, const char* filename, const NDTF_Context* ctx)
+{
+	if (!catalog || !filename)
+		return false;
+
+	memset(catalog, 0, sizeof(NDTF_Catalog));
+	catalog->allocator = ndtf_mem_allocator(ctx);
+
+	FILE* handle = fopen(filename, "rb");
+	if (!handle)
+		return false;
+
+	ndtf_CatalogFileHeader fileHeader;
+	if (fread(&fileHeader, sizeof(ndtf_CatalogFileHeader), 1, handle) != 1 ||
+		memcmp(fileHeader.signature, NDTF_CATALOG_SIGNATURE, 4) != 0 ||
+		fileHeader.version != NDTF_CATALOG_VERSION ||
+		fileHeader.count > SIZE_MAX / sizeof(ndtf_CatalogFileEntry))
+	{
+		fclose(handle);
+		return false;
+	}
+
+	size_t count = (size_t)fileHeader.count;
+	size_t pathsSize = (size_t)fileHeader.pathsSize;
+
+	ndtf_CatalogFileEntry* fileEntries = (ndtf_CatalogFileEntry*)ndtf_mem_alloc(ctx, max(count, 1) * sizeof(ndtf_CatalogFileEntry));
+	NDTF_CatalogEntry* entries = (NDTF_CatalogEntry*)ndtf_mem_alloc(ctx, max(count, 1) * sizeof(NDTF_CatalogEntry));
+	char* paths = (char*)ndtf_mem_alloc(ctx, max(pathsSize, 1));
+
+	bool result = fileEntries && entries && paths &&
+		fread(fileEntries, sizeof(ndtf_CatalogFileEntry), count, handle) == count &&
+		fread(paths, 1, pathsSize, handle) == pathsSize &&
+		(pathsSize == 0 || paths[pathsSize - 1] == '\0');
+
+	for (size_t i = 0; i < count && result; i++)
+	{
+		if (fileEntries[i].pathOffset >= pathsSize)
+		{
+			result = false;
+			break;
+		}
+		entries[i].path = paths + fileEntries[i].pathOffset;
+		entries[i].header = fileEntries[i].header;
+		entries[i].fileSize = fileEntries[i].fileSize;
+		entries[i].mtime = fileEntries[i].mtime;
+	}
+
+	fclose(handle);
+	ndtf_mem_free(ctx, fileEntries);
+
+	if (!result)
+	{
+		ndtf_mem_free(ctx, entries);
+		ndtf_mem_free(ctx, paths);
+		return false;
+	}
+
+	catalog->entries = entries;
+	catalog->count = count;
+	catalog->paths = paths;
+	catalog->pathsSize = pathsSize;
+
+	return true;
+}
+
+bool ndtf_catalog_refresh(NDTF_Catalog* catalog, const char* directory, const char* indexFilename, const NDTF_Context* ctx)
+{
+	NDTF_Catalog previous;
+	bool hasPrevious = ndtf_catalog_load(&previous, indexFilename, ctx);
+
+	bool result = ndtf_catalog_build(catalog, directory, hasPrevious ? &previous : NULL, ctx);
+
+	if (hasPrevious)
+		ndtf_catalog_free(&previous);
+
+	if (result)
+		result = ndtf_catalog_save(catalog, indexFilename);
+
+	return result;
+}
+
+const NDTF_CatalogEntry* ndtf_catalog_find(const NDTF_Catalog* catalog, const char* path)
+{
+	size_t lo = 0;
+	size_t hi = catalog->count;
+	while (lo < hi)
+	{
+		size_t mid = lo + (hi - lo) / 2;
+		int cmp = strcmp(catalog->entries[mid].path, path);
+		if (cmp == 0)
+			return &catalog->entries[mid];
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return NULL;
+}
+
+void ndtf_catalog_free(NDTF_Catalog* catalog)
+{
+	const NDTF_Allocator* allocator = catalog->allocator ? catalog->allocator : ndtf_mem_allocator(NULL);
+
+	ndtf_mem_freeWith(allocator, NULL, catalog->entries);
+	ndtf_mem_freeWith(allocator, NULL, catalog->paths);
+
+	memset(catalog, 0, sizeof(NDTF_Catalog));
+}
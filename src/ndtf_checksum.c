@@ -0,0 +1,303 @@
+#include "ndtf_internal.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+	#define NDTF_CRC32C_X64
+	#include <nmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+	#define NDTF_CRC32C_ARM64
+	#include <arm_acle.h>
+#endif
+
+#define NDTF_CRC32C_POLY 0x82F63B78u // reflected Castagnoli polynomial
+
+// all functions below work on the raw crc register (no pre/post inversion)
+
+static uint32_t crcTable[8][256];
+
+static void ndtf_crc32c_initTable(void)
+{
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		uint32_t crc = i;
+		for (int j = 0; j < 8; j++)
+			crc = (crc & 1) ? (crc >> 1) ^ NDTF_CRC32C_POLY : crc >> 1;
+		crcTable[0][i] = crc;
+	}
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		for (int t = 1; t < 8; t++)
+			crcTable[t][i] = (crcTable[t - 1][i] >> 8) ^ crcTable[0][crcTable[t - 1][i] & 0xFF];
+	}
+}
+
+static uint32_t ndtf_crc32c_sw(uint32_t crc, const uint8_t* data, size_t size)
+{
+	while (size && ((uintptr_t)data & 7))
+	{
+		crc = crcTable[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+		size--;
+	}
+	while (size >= 8)
+	{
+		uint64_t v;
+		memcpy(&v, data, 8);
+		v ^= crc; // little endian
+		crc = crcTable[7][v & 0xFF] ^ crcTable[6][(v >> 8) & 0xFF] ^
+			crcTable[5][(v >> 16) & 0xFF] ^ crcTable[4][(v >> 24) & 0xFF] ^
+			crcTable[3][(v >> 32) & 0xFF] ^ crcTable[2][(v >> 40) & 0xFF] ^
+			crcTable[1][(v >> 48) & 0xFF] ^ crcTable[0][v >> 56];
+		data += 8;
+		size -= 8;
+	}
+	while (size--)
+		crc = crcTable[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+
+	return crc;
+}
+
+// multiplication modulo the polynomial, used to shift a crc over zero bytes when combining streams
+static uint32_t ndtf_crc32c_multiply(uint32_t a, uint32_t b)
+{
+	uint32_t m = 1u << 31;
+	uint32_t p = 0;
+	for (;;)
+	{
+		if (a & m)
+		{
+			p ^= b;
+			if ((a & (m - 1)) == 0)
+				break;
+		}
+		m >>= 1;
+		b = (b & 1) ? (b >> 1) ^ NDTF_CRC32C_POLY : b >> 1;
+	}
+	return p;
+}
+
+// x^(8 * bytes) modulo the polynomial
+static uint32_t ndtf_crc32c_shiftConstant(size_t bytes)
+{
+	uint32_t power = 1u << 30; // x^1
+	uint32_t result = 1u << 31; // x^0
+
+	uint64_t bits = (uint64_t)bytes * 8;
+	while (bits)
+	{
+		if (bits & 1)
+			result = ndtf_crc32c_multiply(power, result);
+		power = ndtf_crc32c_multiply(power, power);
+		bits >>= 1;
+	}
+	return result;
+}
+
+#if defined(NDTF_CRC32C_X64) || defined(NDTF_CRC32C_ARM64)
+
+#if defined(NDTF_CRC32C_X64) && (defined(__GNUC__) || defined(__clang__))
+	#define NDTF_TARGET_CRC __attribute__((target("sse4.2")))
+#else
+	#define NDTF_TARGET_CRC
+#endif
+
+#ifdef NDTF_CRC32C_X64
+	#define NDTF_CRC_U8(crc, v) _mm_crc32_u8(crc, v)
+	#define NDTF_CRC_U64(crc, v) (uint32_t)_mm_crc32_u64(crc, v)
+#else
+	#define NDTF_CRC_U8(crc, v) __crc32cb(crc, v)
+	#define NDTF_CRC_U64(crc, v) __crc32cd(crc, v)
+#endif
+
+// three independent streams hide the latency of the crc instruction
+#define NDTF_CRC32C_BLOCK 4096
+
+static uint32_t shiftBlock, shiftTwoBlocks;
+
+NDTF_TARGET_CRC static uint32_t ndtf_crc32c_hw(uint32_t crc, const uint8_t* data, size_t size)
+{
+	while (size && ((uintptr_t)data & 7))
+	{
+		crc = NDTF_CRC_U8(crc, *data++);
+		size--;
+	}
+
+	while (size >= 3 * NDTF_CRC32C_BLOCK)
+	{
+		uint32_t crc1 = 0;
+		uint32_t crc2 = 0;
+		const uint8_t* end = data + NDTF_CRC32C_BLOCK;
+		while (data < end)
+		{
+			uint64_t v0, v1, v2;
+			memcpy(&v0, data, 8);
+			memcpy(&v1, data + NDTF_CRC32C_BLOCK, 8);
+			memcpy(&v2, data + 2 * NDTF_CRC32C_BLOCK, 8);
+			crc = NDTF_CRC_U64(crc, v0);
+			crc1 = NDTF_CRC_U64(crc1, v1);
+			crc2 = NDTF_CRC_U64(crc2, v2);
+			data += 8;
+		}
+		crc = ndtf_crc32c_multiply(shiftTwoBlocks, crc) ^ ndtf_crc32c_multiply(shiftBlock, crc1) ^ crc2;
+		data += 2 * NDTF_CRC32C_BLOCK;
+		size -= 3 * NDTF_CRC32C_BLOCK;
+	}
+
+	while (size >= 8)
+	{
+		uint64_t v;
+		memcpy(&v, data, 8);
+		crc = NDTF_CRC_U64(crc, v);
+		data += 8;
+		size -= 8;
+	}
+	while (size--)
+		crc = NDTF_CRC_U8(crc, *data++);
+
+	return crc;
+}
+
+static bool crcHardware;
+
+static void ndtf_crc32c_initHardware(void)
+{
+#if defined(NDTF_CRC32C_ARM64)
+	crcHardware = true;
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	crcHardware = (info[2] & (1 << 20)) != 0;
+#else
+	__builtin_cpu_init();
+	crcHardware = __builtin_cpu_supports("sse4.2");
+#endif
+
+	shiftBlock = ndtf_crc32c_shiftConstant(NDTF_CRC32C_BLOCK);
+	shiftTwoBlocks = ndtf_crc32c_shiftConstant(2 * NDTF_CRC32C_BLOCK);
+}
+
+#endif
+
+// the tables and the hardware check are written once, before any thread reads them
+#ifdef _WIN32
+static INIT_ONCE crcOnce = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK ndtf_crc32c_init(PINIT_ONCE once, PVOID param, PVOID* context)
+#else
+static pthread_once_t crcOnce = PTHREAD_ONCE_INIT;
+
+static void ndtf_crc32c_init(void)
+#endif
+{
+	ndtf_crc32c_initTable();
+#if defined(NDTF_CRC32C_X64) || defined(NDTF_CRC32C_ARM64)
+	ndtf_crc32c_initHardware();
+#endif
+#ifdef _WIN32
+	return TRUE;
+#endif
+}
+
+static void ndtf_crc32c_setup(void)
+{
+#ifdef _WIN32
+	InitOnceExecuteOnce(&crcOnce, ndtf_crc32c_init, NULL, NULL);
+#else
+	pthread_once(&crcOnce, ndtf_crc32c_init);
+#endif
+}
+
+uint32_t ndtf_crc32c(uint32_t crc, const void* data, size_t size)
+{
+	ndtf_crc32c_setup();
+	crc = ~crc;
+#if defined(NDTF_CRC32C_X64) || defined(NDTF_CRC32C_ARM64)
+	if (crcHardware)
+		return ~ndtf_crc32c_hw(crc, (const uint8_t*)data, size);
+#endif
+	return ~ndtf_crc32c_sw(crc, (const uint8_t*)data, size);
+}
+
+uint32_t ndtf_crc32c_combine(uint32_t crcA, uint32_t crcB, size_t sizeB)
+{
+	// with finalized crcs the inversions cancel out: crc(A || B) = crc(A) * x^(8 * |B|) + crc(B)
+	return ndtf_crc32c_multiply(ndtf_crc32c_shiftConstant(sizeB), crcA) ^ crcB;
+}
+
+// MurmurHash3 x64 128 (public domain, Austin Appleby), read little endian
+
+static inline uint64_t ndtf_rotl64(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t ndtf_hash_fmix64(uint64_t k)
+{
+	k ^= k >> 33;
+	k *= 0xFF51AFD7ED558CCDull;
+	k ^= k >> 33;
+	k *= 0xC4CEB9FE1A85EC53ull;
+	k ^= k >> 33;
+	return k;
+}
+
+ndtf_Hash128 ndtf_hash128(const void* data, size_t size, uint64_t seed)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+	const uint64_t c1 = 0x87C37B91114253D5ull;
+	const uint64_t c2 = 0x4CF5AD432745937Full;
+
+	uint64_t h1 = seed;
+	uint64_t h2 = seed;
+
+	size_t blocks = size / 16;
+	for (size_t i = 0; i < blocks; i++)
+	{
+		uint64_t k1, k2;
+		memcpy(&k1, bytes + i * 16, 8);
+		memcpy(&k2, bytes + i * 16 + 8, 8);
+
+		k1 *= c1; k1 = ndtf_rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+		h1 = ndtf_rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52DCE729;
+		k2 *= c2; k2 = ndtf_rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+		h2 = ndtf_rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495AB5;
+	}
+
+	const uint8_t* tail = bytes + blocks * 16;
+	uint64_t k1 = 0;
+	uint64_t k2 = 0;
+	switch (size & 15)
+	{
+	case 15: k2 ^= (uint64_t)tail[14] << 48; // fall through
+	case 14: k2 ^= (uint64_t)tail[13] << 40; // fall through
+	case 13: k2 ^= (uint64_t)tail[12] << 32; // fall through
+	case 12: k2 ^= (uint64_t)tail[11] << 24; // fall through
+	case 11: k2 ^= (uint64_t)tail[10] << 16; // fall through
+	case 10: k2 ^= (uint64_t)tail[9] << 8; // fall through
+	case 9: k2 ^= (uint64_t)tail[8];
+		k2 *= c2; k2 = ndtf_rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+		// fall through
+	case 8: k1 ^= (uint64_t)tail[7] << 56; // fall through
+	case 7: k1 ^= (uint64_t)tail[6] << 48; // fall through
+	case 6: k1 ^= (uint64_t)tail[5] << 40; // fall through
+	case 5: k1 ^= (uint64_t)tail[4] << 32; // fall through
+	case 4: k1 ^= (uint64_t)tail[3] << 24; // fall through
+	case 3: k1 ^= (uint64_t)tail[2] << 16; // fall through
+	case 2: k1 ^= (uint64_t)tail[1] << 8; // fall through
+	case 1: k1 ^= (uint64_t)tail[0];
+		k1 *= c1; k1 = ndtf_rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+	}
+
+	h1 ^= (uint64_t)size;
+	h2 ^= (uint64_t)size;
+	h1 += h2;
+	h2 += h1;
+	h1 = ndtf_hash_fmix64(h1);
+	h2 = ndtf_hash_fmix64(h2);
+	h1 += h2;
+	h2 += h1;
+
+	ndtf_Hash128 hash;
+	hash.low = h1;
+	hash.high = h2;
+	return hash;
+}
@@ -0,0 +1,256 @@
+#include "ndtf_internal.h"
+#include <string.h>
+#include <math.h>
+#include <libdeflate.h>
+
+// libdeflate based codecs, a compressor/decompressor is allocated per call so calls can run concurrently. callers
+// decoding many segments on one thread keep theirs in an ndtf_CodecState
+
+static size_t ndtf_zlibBound(size_t size, void* user)
+{
+	return libdeflate_zlib_compress_bound(NULL, size);
+}
+
+static size_t ndtf_zlibCompress(const void* src, size_t srcSize, void* dst, size_t dstCapacity, int level, void* user)
+{
+	struct libdeflate_compressor* compressor = libdeflate_alloc_compressor(level);
+	if (!compressor) return 0;
+
+	size_t result = libdeflate_zlib_compress(compressor, src, srcSize, dst, dstCapacity);
+
+	libdeflate_free_compressor(compressor);
+	return result;
+}
+
+static bool ndtf_zlibDecompressWith(struct libdeflate_decompressor* decompressor, const void* src, size_t srcSize, void* dst, size_t dstSize)
+{
+	size_t actualSize = 0;
+	enum libdeflate_result result = libdeflate_zlib_decompress(decompressor, src, srcSize, dst, dstSize, &actualSize);
+	return result == LIBDEFLATE_SUCCESS && actualSize == dstSize;
+}
+
+static bool ndtf_zlibDecompress(const void* src, size_t srcSize, void* dst, size_t dstSize, void* user)
+{
+	struct libdeflate_decompressor* decompressor = libdeflate_alloc_decompressor();
+	if (!decompressor) return false;
+
+	bool result = ndtf_zlibDecompressWith(decompressor, src, srcSize, dst, dstSize);
+
+	libdeflate_free_decompressor(decompressor);
+	return result;
+}
+
+static size_t ndtf_deflateBound(size_t size, void* user)
+{
+	return libdeflate_deflate_compress_bound(NULL, size);
+}
+
+static size_t ndtf_deflateCompress(const void* src, size_t srcSize, void* dst, size_t dstCapacity, int level, void* user)
+{
+	struct libdeflate_compressor* compressor = libdeflate_alloc_compressor(level);
+	if (!compressor) return 0;
+
+	size_t result = libdeflate_deflate_compress(compressor, src, srcSize, dst, dstCapacity);
+
+	libdeflate_free_compressor(compressor);
+	return result;
+}
+
+static bool ndtf_deflateDecompressWith(struct libdeflate_decompressor* decompressor, const void* src, size_t srcSize, void* dst, size_t dstSize)
+{
+	return libdeflate_deflate_decompress(decompressor, src, srcSize, dst, dstSize, NULL) == LIBDEFLATE_SUCCESS;
+}
+
+static bool ndtf_deflateDecompress(const void* src, size_t srcSize, void* dst, size_t dstSize, void* user)
+{
+	struct libdeflate_decompressor* decompressor = libdeflate_alloc_decompressor();
+	if (!decompressor) return false;
+
+	bool result = ndtf_deflateDecompressWith(decompressor, src, srcSize, dst, dstSize);
+
+	libdeflate_free_decompressor(decompressor);
+	return result;
+}
+
+static size_t ndtf_lzBound(size_t size, void* user)
+{
+	return ndtf_lz_compressBound(size);
+}
+
+static size_t ndtf_lzCompress(const void* src, size_t srcSize, void* dst, size_t dstCapacity, int level, void* user)
+{
+	return ndtf_lz_compress(src, srcSize, dst, dstCapacity);
+}
+
+static bool ndtf_lzDecompress(const void* src, size_t srcSize, void* dst, size_t dstSize, void* user)
+{
+	return ndtf_lz_decompress(src, srcSize, dst, dstSize);
+}
+
+static NDTF_CodecInfo codecs[NDTF_CODEC_MAX + 1] = {
+	[NDTF_CODEC_ZLIB] = { "zlib", ndtf_zlibBound, ndtf_zlibCompress, ndtf_zlibDecompress, 9, NULL },
+	[NDTF_CODEC_DEFLATE] = { "deflate", ndtf_deflateBound, ndtf_deflateCompress, ndtf_deflateDecompress, 9, NULL },
+	[NDTF_CODEC_LZ] = { "lz", ndtf_lzBound, ndtf_lzCompress, ndtf_lzDecompress, 1, NULL },
+};
+
+bool ndtf_registerCodec(NDTF_Codec codec, const NDTF_CodecInfo* info)
+{
+	if (codec < NDTF_CODEC_USER || codec > NDTF_CODEC_MAX)
+		return false;
+
+	if (info && (!info->compressBound || !info->compress || !info->decompress))
+		return false;
+
+	if (info)
+		codecs[codec] = *info;
+	else
+		memset(&codecs[codec], 0, sizeof(NDTF_CodecInfo));
+
+	return true;
+}
+
+const NDTF_CodecInfo* ndtf_getCodec(NDTF_Codec codec)
+{
+	if (codec <= NDTF_CODEC_NONE || codec > NDTF_CODEC_MAX || !codecs[codec].compress)
+		return NULL;
+	return &codecs[codec];
+}
+
+uint8_t* ndtf_codec_compress(NDTF_Codec codec, const void* data, size_t size, size_t prefix, size_t* compressedSize, const NDTF_Context* ctx)
+{
+	const NDTF_CodecInfo* info = ndtf_getCodec(codec);
+	if (!info) return NULL;
+
+	size_t bound = info->compressBound(size, info->user);
+	uint8_t* buffer = (uint8_t*)ndtf_mem_alloc(ctx, prefix + bound);
+	if (!buffer) return NULL;
+
+	int level = ctx && ctx->compressionLevel ? ctx->compressionLevel : info->defaultLevel;
+
+	NDTF_SCOPE_BEGIN(compressScope, ctx, NDTF_PHASE_COMPRESS, info->name);
+
+	size_t result = info->compress(data, size, buffer + prefix, bound, level, info->user);
+
+	NDTF_SCOPE_END(compressScope, ctx, size);
+
+	if (!result)
+	{
+		ndtf_mem_free(ctx, buffer);
+		return NULL;
+	}
+
+	*compressedSize = result;
+	return buffer;
+}
+
+bool ndtf_codec_decompress(NDTF_Codec codec, const void* src, size_t srcSize, void* dst, size_t dstSize, const NDTF_Context* ctx)
+{
+	return ndtf_codec_decompressWith(codec, NULL, src, srcSize, dst, dstSize, ctx);
+}
+
+bool ndtf_codec_decompressWith(NDTF_Codec codec, ndtf_CodecState* state, const void* src, size_t srcSize, void* dst, size_t dstSize, const NDTF_Context* ctx)
+{
+	const NDTF_CodecInfo* info = ndtf_getCodec(codec);
+	if (!info) return false;
+
+	// the built in libdeflate codecs cannot be replaced, so their decompressor can be kept
+	bool kept = state && (codec == NDTF_CODEC_ZLIB || codec == NDTF_CODEC_DEFLATE);
+	if (kept && !state->decompressor)
+	{
+		state->decompressor = libdeflate_alloc_decompressor();
+		if (!state->decompressor) return false;
+	}
+
+	NDTF_SCOPE_BEGIN(decompressScope, ctx, NDTF_PHASE_DECOMPRESS, info->name);
+
+	bool result;
+	if (!kept)
+		result = info->decompress(src, srcSize, dst, dstSize, info->user);
+	else if (codec == NDTF_CODEC_ZLIB)
+		result = ndtf_zlibDecompressWith((struct libdeflate_decompressor*)state->decompressor, src, srcSize, dst, dstSize);
+	else
+		result = ndtf_deflateDecompressWith((struct libdeflate_decompressor*)state->decompressor, src, srcSize, dst, dstSize);
+
+	NDTF_SCOPE_END(decompressScope, ctx, result ? dstSize : 0);
+
+	return result;
+}
+
+void ndtf_codec_freeState(ndtf_CodecState* state)
+{
+	if (state->decompressor)
+		libdeflate_free_decompressor((struct libdeflate_decompressor*)state->decompressor);
+	state->decompressor = NULL;
+}
+
+// samples spread over data judge whether it compresses: an order 0 entropy well below 8 bits a byte always does,
+// otherwise the samples are compressed at the fastest level. that level saves less than the one used for the data,
+// so only samples below half the least gain are taken as incompressible. registered codecs always run, they may
+// do more than compress
+
+#define NDTF_CODEC_SAMPLES 4
+#define NDTF_CODEC_SAMPLE_SIZE ((size_t)16 << 10)
+
+static float ndtf_codec_minGain(NDTF_Codec codec, const NDTF_Context* ctx)
+{
+	if (codec >= NDTF_CODEC_USER)
+		return -1.0f;
+	return ctx && ctx->minCompressionGain ? ctx->minCompressionGain : NDTF_DEFAULT_COMPRESSION_GAIN;
+}
+
+bool ndtf_codec_isPromising(NDTF_Codec codec, const void* data, size_t size, const NDTF_Context* ctx)
+{
+	float gain = ndtf_codec_minGain(codec, ctx);
+	const NDTF_CodecInfo* info = ndtf_getCodec(codec);
+	size_t total = NDTF_CODEC_SAMPLES * NDTF_CODEC_SAMPLE_SIZE;
+
+	// small data is compressed and checked afterwards
+	if (gain <= 0.0f || !info || size < total * 4)
+		return true;
+
+	const uint8_t* bytes = (const uint8_t*)data;
+	size_t stride = (size - NDTF_CODEC_SAMPLE_SIZE) / (NDTF_CODEC_SAMPLES - 1);
+
+	uint32_t histogram[256];
+	memset(histogram, 0, sizeof(histogram));
+	for (size_t s = 0; s < NDTF_CODEC_SAMPLES; s++)
+	{
+		const uint8_t* sample = bytes + s * stride;
+		for (size_t i = 0; i < NDTF_CODEC_SAMPLE_SIZE; i++)
+			histogram[sample[i]]++;
+	}
+
+	double bits = 0.0;
+	for (int v = 0; v < 256; v++)
+	{
+		if (histogram[v])
+		{
+			double p = (double)histogram[v] / (double)total;
+			bits -= p * log2(p);
+		}
+	}
+	if (1.0 - bits / 8.0 >= 2.0 * gain)
+		return true;
+
+	size_t bound = info->compressBound(total, info->user);
+	uint8_t* trial = (uint8_t*)ndtf_mem_alloc(ctx, total + bound);
+	if (!trial)
+		return true;
+	for (size_t s = 0; s < NDTF_CODEC_SAMPLES; s++)
+		memcpy(trial + s * NDTF_CODEC_SAMPLE_SIZE, bytes + s * stride, NDTF_CODEC_SAMPLE_SIZE);
+
+	NDTF_SCOPE_BEGIN(trialScope, ctx, NDTF_PHASE_COMPRESS, "trial");
+	size_t compressedSize = info->compress(trial, total, trial + total, bound, 1, info->user);
+	NDTF_SCOPE_END(trialScope, ctx, total);
+
+	ndtf_mem_free(ctx, trial);
+	return !compressedSize || (compressedSize < total && (double)(total - compressedSize) >= 0.5 * gain * (double)total);
+}
+
+bool ndtf_codec_pays(NDTF_Codec codec, size_t size, size_t compressedSize, const NDTF_Context* ctx)
+{
+	float gain = ndtf_codec_minGain(codec, ctx);
+	if (gain < 0.0f)
+		return true;
+	return compressedSize < size && (double)(size - compressedSize) >= gain * (double)size;
+}
@@ -0,0 +1,140 @@
+#include "ndtf_internal.h"
+#include <string.h>
+
+#define NDTF_DELTA_CHUNK ((size_t)1 << 16) // texels per undo task
+
+int ndtf_delta_axis(const NDTF_Header* header)
+{
+	int axis = (int)header->flags.deltaAxis - 1;
+	if (axis < 0 || axis >= header->dimensions || !header->flags.segmented || ndtf_lossy_enabled(header))
+		return -1;
+
+	// every brick holds a single slice, so it only depends on the brick before it along the axis
+	ndtf_Bricks bricks;
+	ndtf_bricks_init(&bricks, header);
+	return bricks.extent[axis] == 1 ? axis : -1;
+}
+
+bool ndtf_delta_isKeyframe(const NDTF_Header* header, size_t slice)
+{
+	return header->keyframeInterval ? slice % header->keyframeInterval == 0 : slice == 0;
+}
+
+// integer channels are subtracted with wrap around, float channels are XORed on their bits
+
+#define NDTF_DELTA_KERNELS(type)																	\
+static void ndtf_delta_encode_##type(const type* current, const type* previous, type* out, size_t count)	\
+{																									\
+	for (size_t i = 0; i < count; i++)																\
+		out[i] = (type)(current[i] - previous[i]);													\
+}																									\
+static void ndtf_delta_decode_##type(type* data, const type* previous, size_t count)				\
+{																									\
+	for (size_t i = 0; i < count; i++)																\
+		data[i] = (type)(data[i] + previous[i]);													\
+}
+
+NDTF_DELTA_KERNELS(uint8_t)
+NDTF_DELTA_KERNELS(uint16_t)
+NDTF_DELTA_KERNELS(uint32_t)
+
+static void ndtf_delta_xor(const uint32_t* a, const uint32_t* b, uint32_t* out, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		out[i] = a[i] ^ b[i];
+}
+
+void ndtf_delta_encode(NDTF_TexelFormat texelFormat, const uint8_t* current, const uint8_t* previous, uint8_t* out, size_t texels)
+{
+	size_t count = texels * ndtf_getChannelCount(texelFormat);
+	switch (ndtf_getChannelSize(texelFormat))
+	{
+	case 1: ndtf_delta_encode_uint8_t(current, previous, out, count); break;
+	case 2: ndtf_delta_encode_uint16_t((const uint16_t*)current, (const uint16_t*)previous, (uint16_t*)out, count); break;
+	case 4:
+		if (ndtf_getChannelIsFloat(texelFormat))
+			ndtf_delta_xor((const uint32_t*)current, (const uint32_t*)previous, (uint32_t*)out, count);
+		else
+			ndtf_delta_encode_uint32_t((const uint32_t*)current, (const uint32_t*)previous, (uint32_t*)out, count);
+		break;
+	}
+}
+
+void ndtf_delta_decode(NDTF_TexelFormat texelFormat, uint8_t* data, const uint8_t* previous, size_t texels)
+{
+	size_t count = texels * ndtf_getChannelCount(texelFormat);
+	switch (ndtf_getChannelSize(texelFormat))
+	{
+	case 1: ndtf_delta_decode_uint8_t(data, previous, count); break;
+	case 2: ndtf_delta_decode_uint16_t((uint16_t*)data, (const uint16_t*)previous, count); break;
+	case 4:
+		if (ndtf_getChannelIsFloat(texelFormat))
+			ndtf_delta_xor((const uint32_t*)data, (const uint32_t*)previous, (uint32_t*)data, count);
+		else
+			ndtf_delta_decode_uint32_t((uint32_t*)data, (const uint32_t*)previous, count);
+		break;
+	}
+}
+
+typedef struct ndtf_DeltaUndo
+{
+	NDTF_TexelFormat format;
+	uint8_t* volume;
+	size_t texelSize;
+	size_t inner;		// texels of one slice below the axis
+	size_t slices;
+	size_t groups;		// keyframe groups along the axis
+	size_t interval;
+	size_t chunks;		// pieces of a slice
+} ndtf_DeltaUndo;
+
+// accumulates one piece of one keyframe group, slice by slice
+static void ndtf_delta_undoTask(void* taskData, size_t index)
+{
+	const ndtf_DeltaUndo* undo = (const ndtf_DeltaUndo*)taskData;
+
+	size_t chunk = index % undo->chunks;
+	index /= undo->chunks;
+	size_t group = index % undo->groups;
+	size_t outer = index / undo->groups;
+
+	size_t first = chunk * NDTF_DELTA_CHUNK;
+	size_t texels = min(undo->inner - first, NDTF_DELTA_CHUNK);
+	size_t sliceBytes = undo->inner * undo->texelSize;
+	uint8_t* base = undo->volume + outer * undo->slices * sliceBytes + first * undo->texelSize;
+
+	size_t begin = group * undo->interval;
+	size_t end = min(begin + undo->interval, undo->slices);
+	for (size_t t = begin + 1; t < end; t++)
+		ndtf_delta_decode(undo->format, base + t * sliceBytes, base + (t - 1) * sliceBytes, texels);
+}
+
+void ndtf_delta_undo(const NDTF_Header* header, uint8_t* volume, const NDTF_Context* ctx)
+{
+	int axis = ndtf_delta_axis(header);
+	if (axis < 0)
+		return;
+
+	ndtf_Bricks bricks;
+	ndtf_bricks_init(&bricks, header);
+
+	ndtf_DeltaUndo undo;
+	undo.format = (NDTF_TexelFormat)header->texelFormat;
+	undo.volume = volume;
+	undo.texelSize = bricks.texelSize;
+	undo.inner = 1;
+	for (int i = 0; i < axis; i++)
+		undo.inner *= bricks.size[i];
+	undo.slices = bricks.size[axis];
+	undo.interval = header->keyframeInterval ? header->keyframeInterval : undo.slices;
+	undo.groups = (undo.slices + undo.interval - 1) / undo.interval;
+	undo.chunks = (undo.inner + NDTF_DELTA_CHUNK - 1) / NDTF_DELTA_CHUNK;
+
+	size_t outer = 1;
+	for (int i = axis + 1; i < NDTF_DIMENSIONS_MAX; i++)
+		outer *= bricks.size[i];
+
+	NDTF_SCOPE_BEGIN(undoScope, ctx, NDTF_PHASE_DECOMPRESS, "delta");
+	ndtf_parallelFor(ctx, ndtf_delta_undoTask, &undo, outer * undo.groups * undo.chunks);
+	NDTF_SCOPE_END(undoScope, ctx, outer * undo.slices * undo.inner * undo.texelSize);
+}
@@ -0,0 +1,131 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+	#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "ndtf_internal.h"
+#include <string.h>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <time.h>
+#endif
+
+uint64_t ndtf_timeNanoseconds(void)
+{
+#ifdef _WIN32
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (uint64_t)((double)counter.QuadPart * 1000000000.0 / (double)frequency.QuadPart);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+#ifdef NDTF_INSTRUMENTATION
+
+static NDTF_Stats globalStats;
+static NDTF_Instrumentation instrumentation;
+
+static void ndtf_stats_addPhase(NDTF_Stats* stats, NDTF_Phase phase, uint64_t bytes, uint64_t nanoseconds)
+{
+	ndtf_atomic_add_u64(&stats->phases[phase].count, 1);
+	ndtf_atomic_add_u64(&stats->phases[phase].bytes, bytes);
+	ndtf_atomic_add_u64(&stats->phases[phase].nanoseconds, nanoseconds);
+}
+
+void ndtf_scope_begin(ndtf_Scope* scope, const NDTF_Context* ctx, NDTF_Phase phase, const char* name)
+{
+	scope->phase = phase;
+	scope->name = name;
+
+	if (instrumentation.begin)
+		instrumentation.begin(phase, name, instrumentation.user);
+
+	scope->start = ndtf_timeNanoseconds();
+}
+
+void ndtf_scope_end(ndtf_Scope* scope, const NDTF_Context* ctx, uint64_t bytes)
+{
+	uint64_t nanoseconds = ndtf_timeNanoseconds() - scope->start;
+
+	ndtf_stats_addPhase(&globalStats, scope->phase, bytes, nanoseconds);
+	if (ctx && ctx->stats)
+		ndtf_stats_addPhase(ctx->stats, scope->phase, bytes, nanoseconds);
+
+	if (instrumentation.end)
+		instrumentation.end(scope->phase, scope->name, bytes, nanoseconds, instrumentation.user);
+}
+
+void ndtf_stats_countAlloc(const NDTF_Context* ctx, size_t size)
+{
+	ndtf_atomic_add_u64(&globalStats.allocations, 1);
+	if (ctx && ctx->stats)
+		ndtf_atomic_add_u64(&ctx->stats->allocations, 1);
+}
+
+void ndtf_stats_countFree(const NDTF_Context* ctx)
+{
+	ndtf_atomic_add_u64(&globalStats.frees, 1);
+	if (ctx && ctx->stats)
+		ndtf_atomic_add_u64(&ctx->stats->frees, 1);
+}
+
+#endif // NDTF_INSTRUMENTATION
+
+bool ndtf_instrumentationEnabled(void)
+{
+#ifdef NDTF_INSTRUMENTATION
+	return true;
+#else
+	return false;
+#endif
+}
+
+void ndtf_setInstrumentation(const NDTF_Instrumentation* callbacks)
+{
+#ifdef NDTF_INSTRUMENTATION
+	if (callbacks)
+		instrumentation = *callbacks;
+	else
+		memset(&instrumentation, 0, sizeof(NDTF_Instrumentation));
+#endif
+}
+
+void ndtf_getGlobalStats(NDTF_Stats* stats)
+{
+	if (!stats) return;
+
+	memset(stats, 0, sizeof(NDTF_Stats));
+
+#ifdef NDTF_INSTRUMENTATION
+	for (int i = 0; i < NDTF_PHASE_COUNT; i++)
+	{
+		stats->phases[i].count = ndtf_atomic_load_u64(&globalStats.phases[i].count);
+		stats->phases[i].bytes = ndtf_atomic_load_u64(&globalStats.phases[i].bytes);
+		stats->phases[i].nanoseconds = ndtf_atomic_load_u64(&globalStats.phases[i].nanoseconds);
+	}
+	stats->allocations = ndtf_atomic_load_u64(&globalStats.allocations);
+	stats->frees = ndtf_atomic_load_u64(&globalStats.frees);
+#endif
+}
+
+void ndtf_resetGlobalStats(void)
+{
+#ifdef NDTF_INSTRUMENTATION
+	for (int i = 0; i < NDTF_PHASE_COUNT; i++)
+	{
+		ndtf_atomic_store_u64(&globalStats.phases[i].count, 0);
+		ndtf_atomic_store_u64(&globalStats.phases[i].bytes, 0);
+		ndtf_atomic_store_u64(&globalStats.phases[i].nanoseconds, 0);
+	}
+	ndtf_atomic_store_u64(&globalStats.allocations, 0);
+	ndtf_atomic_store_u64(&globalStats.frees, 0);
+#endif
+}
@@ -0,0 +1,418 @@
+#ifndef _NDTF_INTERNAL_H_
+#define _NDTF_INTERNAL_H_
+
+#include <ndtf/ndtf.h>
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+#ifdef _WIN32
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+#else
+	#include <pthread.h>
+#endif
+
+#ifndef max
+	#define max(a,b) (((a) > (b)) ? (a) : (b))
+#endif
+#ifndef min
+	#define min(a,b) (((a) < (b)) ? (a) : (b))
+#endif
+
+// atomics
+
+static inline uint64_t ndtf_atomic_add_u64(volatile uint64_t* target, uint64_t value)
+{
+#ifdef _MSC_VER
+	return (uint64_t)_InterlockedExchangeAdd64((volatile long long*)target, (long long)value);
+#else
+	return __atomic_fetch_add(target, value, __ATOMIC_RELAXED);
+#endif
+}
+
+static inline uint64_t ndtf_atomic_load_u64(volatile uint64_t* target)
+{
+#ifdef _MSC_VER
+	return (uint64_t)_InterlockedOr64((volatile long long*)target, 0);
+#else
+	return __atomic_load_n(target, __ATOMIC_RELAXED);
+#endif
+}
+
+static inline void ndtf_atomic_store_u64(volatile uint64_t* target, uint64_t value)
+{
+#ifdef _MSC_VER
+	_InterlockedExchange64((volatile long long*)target, (long long)value);
+#else
+	__atomic_store_n(target, value, __ATOMIC_RELAXED);
+#endif
+}
+
+// threads
+
+#ifdef _WIN32
+typedef SRWLOCK ndtf_Mutex;
+typedef CONDITION_VARIABLE ndtf_Cond;
+typedef HANDLE ndtf_Thread;
+#else
+typedef pthread_mutex_t ndtf_Mutex;
+typedef pthread_cond_t ndtf_Cond;
+typedef pthread_t ndtf_Thread;
+#endif
+
+typedef void (*ndtf_ThreadFunc)(void* arg);
+
+void ndtf_mutex_init(ndtf_Mutex* mutex);
+void ndtf_mutex_destroy(ndtf_Mutex* mutex);
+void ndtf_mutex_lock(ndtf_Mutex* mutex);
+void ndtf_mutex_unlock(ndtf_Mutex* mutex);
+void ndtf_cond_init(ndtf_Cond* cond);
+void ndtf_cond_destroy(ndtf_Cond* cond);
+void ndtf_cond_wait(ndtf_Cond* cond, ndtf_Mutex* mutex);
+void ndtf_cond_signal(ndtf_Cond* cond);
+void ndtf_cond_broadcast(ndtf_Cond* cond);
+bool ndtf_thread_create(ndtf_Thread* thread, ndtf_ThreadFunc func, void* arg);
+void ndtf_thread_join(ndtf_Thread* thread);
+
+// runs task for every index in [0, count) on the context's executor, inline when count <= 1
+void ndtf_parallelFor(const NDTF_Context* ctx, NDTF_TaskFunc task, void* taskData, size_t count);
+size_t ndtf_concurrency(const NDTF_Context* ctx);
+
+// files
+
+static inline int ndtf_fseek64(FILE* file, int64_t offset, int origin)
+{
+#ifdef _WIN32
+	return _fseeki64(file, offset, origin);
+#else
+	return fseeko(file, (off_t)offset, origin);
+#endif
+}
+
+static inline int64_t ndtf_ftell64(FILE* file)
+{
+#ifdef _WIN32
+	return _ftelli64(file);
+#else
+	return (int64_t)ftello(file);
+#endif
+}
+
+// time
+
+uint64_t ndtf_timeNanoseconds(void);
+
+// instrumentation
+
+#ifdef NDTF_INSTRUMENTATION
+
+typedef struct ndtf_Scope
+{
+	NDTF_Phase phase;
+	const char* name;
+	uint64_t start;
+} ndtf_Scope;
+
+void ndtf_scope_begin(ndtf_Scope* scope, const NDTF_Context* ctx, NDTF_Phase phase, const char* name);
+void ndtf_scope_end(ndtf_Scope* scope, const NDTF_Context* ctx, uint64_t bytes);
+void ndtf_stats_countAlloc(const NDTF_Context* ctx, size_t size);
+void ndtf_stats_countFree(const NDTF_Context* ctx);
+
+#define NDTF_SCOPE_BEGIN(scope, ctx, phase, name) ndtf_Scope scope; ndtf_scope_begin(&scope, ctx, phase, name)
+#define NDTF_SCOPE_END(scope, ctx, bytes) ndtf_scope_end(&scope, ctx, (uint64_t)(bytes))
+#define NDTF_COUNT_ALLOC(ctx, size) ndtf_stats_countAlloc(ctx, size)
+#define NDTF_COUNT_FREE(ctx) ndtf_stats_countFree(ctx)
+
+#else
+
+#define NDTF_SCOPE_BEGIN(scope, ctx, phase, name) ((void)0)
+#define NDTF_SCOPE_END(scope, ctx, bytes) ((void)0)
+#define NDTF_COUNT_ALLOC(ctx, size) ((void)0)
+#define NDTF_COUNT_FREE(ctx) ((void)0)
+
+#endif // NDTF_INSTRUMENTATION
+
+// allocation
+
+// ctx only selects the allocator and the stats sink, both may be NULL
+const NDTF_Allocator* ndtf_mem_allocator(const NDTF_Context* ctx);
+void* ndtf_mem_allocWith(const NDTF_Allocator* allocator, const NDTF_Context* ctx, size_t size);
+void* ndtf_mem_reallocWith(const NDTF_Allocator* allocator, const NDTF_Context* ctx, void* ptr, size_t oldSize, size_t newSize);
+void ndtf_mem_freeWith(const NDTF_Allocator* allocator, const NDTF_Context* ctx, void* ptr);
+
+#define ndtf_mem_alloc(ctx, size) ndtf_mem_allocWith(ndtf_mem_allocator(ctx), ctx, size)
+#define ndtf_mem_realloc(ctx, ptr, oldSize, newSize) ndtf_mem_reallocWith(ndtf_mem_allocator(ctx), ctx, ptr, oldSize, newSize)
+#define ndtf_mem_free(ctx, ptr) ndtf_mem_freeWith(ndtf_mem_allocator(ctx), ctx, ptr)
+
+// allocator owning the data of a file
+#define ndtf_file_allocator(file) ((file)->allocator ? (file)->allocator : ndtf_mem_allocator(NULL))
+
+// codecs
+
+// compresses into a buffer allocated with prefix free bytes in front of the stream
+uint8_t* ndtf_codec_compress(NDTF_Codec codec, const void* data, size_t size, size_t prefix, size_t* compressedSize, const NDTF_Context* ctx);
+bool ndtf_codec_decompress(NDTF_Codec codec, const void* src, size_t srcSize, void* dst, size_t dstSize, const NDTF_Context* ctx);
+// decompressors kept by the caller across calls, used by one thread at a time. zeroed to start
+typedef struct ndtf_CodecState
+{
+	void* decompressor;		// libdeflate, allocated on first use
+} ndtf_CodecState;
+bool ndtf_codec_decompressWith(NDTF_Codec codec, ndtf_CodecState* state, const void* src, size_t srcSize, void* dst, size_t dstSize, const NDTF_Context* ctx);
+void ndtf_codec_freeState(ndtf_CodecState* state);
+// whether size bytes of data are worth compressing, judged from samples. false only when they clearly fall short of
+// the least gain of ctx
+bool ndtf_codec_isPromising(NDTF_Codec codec, const void* data, size_t size, const NDTF_Context* ctx);
+// whether compressedSize saves the least gain of ctx over size
+bool ndtf_codec_pays(NDTF_Codec codec, size_t size, size_t compressedSize, const NDTF_Context* ctx);
+
+// buffers of segment decodes kept by the caller across calls, used by one thread at a time. zeroed to start
+typedef struct ndtf_DecodeScratch
+{
+	ndtf_CodecState codec;
+	uint8_t* planes;		// compressed planes of planar bricks, set by the caller to a buffer of the largest brick
+	uint8_t* codes;			// symbols of lossy bricks, grown on demand
+	size_t codesCapacity;
+} ndtf_DecodeScratch;
+// frees what the scratch allocated, planes stay with the caller
+void ndtf_decodeScratch_free(ndtf_DecodeScratch* scratch, const NDTF_Context* ctx);
+
+// lossy
+bool ndtf_lossy_enabled(const NDTF_Header* header);
+// finite value range per channel that relative bounds are taken against, low > high while empty
+typedef struct ndtf_LossyRange
+{
+	float low[NDTF_CHANNELS_RGBA], high[NDTF_CHANNELS_RGBA];
+} ndtf_LossyRange;
+void ndtf_lossyRange_init(ndtf_LossyRange* range);
+// widens the range by texels packed texels of data, transformed first when transform (optional) is set
+void ndtf_lossyRange_add(ndtf_LossyRange* range, const NDTF_Header* header, const uint8_t* data, size_t texels, const NDTF_Transform* transform, const NDTF_Context* ctx);
+// the bound as requested and the absolute bound it applies per channel
+typedef struct ndtf_LossyBound
+{
+	NDTF_ErrorBound requested;
+	float absolute[NDTF_CHANNELS_RGBA];
+} ndtf_LossyBound;
+void ndtf_lossy_resolve(ndtf_LossyBound* resolved, const NDTF_Header* header, const NDTF_ErrorBound* bound, const ndtf_LossyRange* range);
+// resolves the error bound of file against the range of its whole volume
+void ndtf_lossy_resolveFile(ndtf_LossyBound* resolved, NDTF_File* file, const NDTF_Transform* transform, const NDTF_Context* ctx);
+uint8_t* ndtf_lossy_encode(const NDTF_Header* header, const uint8_t* data, const size_t extent[NDTF_DIMENSIONS_MAX], const ndtf_LossyBound* bound, size_t prefix, size_t* size, const NDTF_Context* ctx);
+// scratch (optional) keeps the decompressor and the symbol buffer across calls
+bool ndtf_lossy_decode(const NDTF_Header* header, const uint8_t* src, size_t srcSize, uint8_t* dst, const size_t extent[NDTF_DIMENSIONS_MAX], NDTF_Codec codec, NDTF_ErrorBound* bound, ndtf_DecodeScratch* scratch, const NDTF_Context* ctx);
+bool ndtf_lossy_readBound(const uint8_t* src, size_t srcSize, NDTF_ErrorBound* bound);
+
+size_t ndtf_lz_compressBound(size_t size);
+size_t ndtf_lz_compress(const void* src, size_t srcSize, void* dst, size_t dstCapacity);
+bool ndtf_lz_decompress(const void* src, size_t srcSize, void* dst, size_t dstSize);
+
+// delta encoding along an axis
+
+// axis of delta encoded bricks, -1 when the file is not delta encoded
+int ndtf_delta_axis(const NDTF_Header* header);
+bool ndtf_delta_isKeyframe(const NDTF_Header* header, size_t slice);
+void ndtf_delta_encode(NDTF_TexelFormat texelFormat, const uint8_t* current, const uint8_t* previous, uint8_t* out, size_t texels);
+void ndtf_delta_decode(NDTF_TexelFormat texelFormat, uint8_t* data, const uint8_t* previous, size_t texels);
+// turns the decoded differences of a whole volume back into texels
+void ndtf_delta_undo(const NDTF_Header* header, uint8_t* volume, const NDTF_Context* ctx);
+
+// texel formats
+
+// converts count texels like ndtf_file_reformat, src and dst do not overlap
+void ndtf_reformat_convert(NDTF_TexelFormat oldFormat, const uint8_t* src, NDTF_TexelFormat newFormat, uint8_t* dst, size_t count, const NDTF_Context* ctx);
+
+// block compression
+
+// slices of width x height texels in ndtf_getDecodedTexelFormat(blockFormat) to and from 4x4 blocks, x-fastest.
+// the blocks of a slice follow those of the slice before it
+void ndtf_bc_encode(NDTF_TexelFormat blockFormat, const uint8_t* texels, uint8_t* blocks, size_t width, size_t height, size_t slices, const NDTF_Context* ctx);
+void ndtf_bc_decode(NDTF_TexelFormat blockFormat, const uint8_t* blocks, uint8_t* texels, size_t width, size_t height, size_t slices, const NDTF_Context* ctx);
+
+// pointwise transforms
+
+// count packed texels from src to dst on the calling thread, src == dst transforms in place
+void ndtf_transform_run(const NDTF_Transform* transform, const uint8_t* src, uint8_t* dst, size_t count);
+// whether the transform of ctx (if any) applies to texelFormat
+bool ndtf_transform_fits(const NDTF_Context* ctx, NDTF_TexelFormat texelFormat);
+void ndtf_transform_runParallel(const NDTF_Transform* transform, const uint8_t* src, uint8_t* dst, size_t count, const NDTF_Context* ctx);
+
+// planar layout
+
+// channels of the payload are stored as planes, the flag is ignored for single channel and lossy files
+bool ndtf_planar_enabled(const NDTF_Header* header);
+// converts count texels into channel planes that follow each other and back
+void ndtf_planar_split(NDTF_TexelFormat texelFormat, const uint8_t* texels, uint8_t* planes, size_t count, const NDTF_Context* ctx);
+void ndtf_planar_merge(NDTF_TexelFormat texelFormat, const uint8_t* planes, uint8_t* texels, size_t count, const NDTF_Context* ctx);
+void ndtf_planar_extract(NDTF_TexelFormat texelFormat, int channel, const uint8_t* texels, uint8_t* values, size_t count);
+
+// payloads
+
+// decodes the payload of a non segmented file into volume (the data size of header)
+bool ndtf_payload_decode(const NDTF_Header* header, const uint8_t* payload, size_t payloadSize, uint8_t* volume, NDTF_ErrorBound* errorBound, const NDTF_Context* ctx);
+
+// texel statistics
+
+typedef struct ndtf_TexelStatsPartial
+{
+	double min[NDTF_CHANNELS_RGBA], max[NDTF_CHANNELS_RGBA];
+	double sum[NDTF_CHANNELS_RGBA], sumSquares[NDTF_CHANNELS_RGBA];
+	uint64_t count[NDTF_CHANNELS_RGBA];
+	uint64_t nanCount[NDTF_CHANNELS_RGBA], infCount[NDTF_CHANNELS_RGBA];
+} ndtf_TexelStatsPartial;
+
+// collects statistics from pieces of a volume added from any thread
+typedef struct ndtf_TexelStatsSink
+{
+	NDTF_TexelStats* stats;
+	NDTF_TexelFormat format;
+	double low, high;	// histogram range
+	ndtf_TexelStatsPartial partial;
+	ndtf_Mutex mutex;
+	volatile uint64_t failed;
+} ndtf_TexelStatsSink;
+
+bool ndtf_texelStats_begin(ndtf_TexelStatsSink* sink, NDTF_TexelStats* stats, NDTF_TexelFormat texelFormat);
+void ndtf_texelStats_compute(const uint8_t* data, size_t texels, NDTF_TexelFormat texelFormat, ndtf_TexelStatsPartial* partial);
+void ndtf_texelStats_add(ndtf_TexelStatsSink* sink, const uint8_t* data, size_t texels, const NDTF_Context* ctx);
+// adds a piece whose partial statistics were already computed with ndtf_texelStats_compute
+void ndtf_texelStats_addComputed(ndtf_TexelStatsSink* sink, const ndtf_TexelStatsPartial* partial, const uint8_t* data, size_t texels, const NDTF_Context* ctx);
+void ndtf_texelStats_addParallel(ndtf_TexelStatsSink* sink, const uint8_t* data, size_t texels, const NDTF_Context* ctx);
+bool ndtf_texelStats_end(ndtf_TexelStatsSink* sink);
+
+// checksums
+
+uint32_t ndtf_crc32c_combine(uint32_t crcA, uint32_t crcB, size_t sizeB);
+
+typedef struct ndtf_Hash128
+{
+	uint64_t low, high;
+} ndtf_Hash128;
+
+// content hash of bricks for deduplication
+ndtf_Hash128 ndtf_hash128(const void* data, size_t size, uint64_t seed);
+
+// overflow checked size math
+
+static inline bool ndtf_size_mul(size_t a, size_t b, size_t* result)
+{
+	if (b && a > SIZE_MAX / b)
+		return false;
+	*result = a * b;
+	return true;
+}
+
+static inline bool ndtf_size_add(size_t a, size_t b, size_t* result)
+{
+	if (a > SIZE_MAX - b)
+		return false;
+	*result = a + b;
+	return true;
+}
+
+// headers
+
+#define NDTF_HEADER_SIZE_V1 32	// v1.x header with uint16 extents
+
+typedef struct ndtf_HeaderV1
+{
+	char signature[4];
+	uint16_t version;
+	uint8_t dimensions;
+	uint8_t texelFormat;
+	NDTF_Flags flags;
+	uint16_t size[NDTF_DIMENSIONS_MAX];
+	uint8_t brickSize[NDTF_DIMENSIONS_MAX];
+	uint8_t keyframeInterval;
+	uint32_t checksum;
+} ndtf_HeaderV1;
+
+bool ndtf_header_getTexelCount(const NDTF_Header* header, size_t* texels);
+// bytes of the header in the file, depends on its version
+size_t ndtf_header_storedSize(const NDTF_Header* header);
+// writes the header as it is stored in the file and returns its size
+size_t ndtf_header_encode(const NDTF_Header* header, uint8_t out[sizeof(NDTF_Header)]);
+// reads and validates a stored header, returns its size or 0
+size_t ndtf_header_decode(const uint8_t* data, size_t size, NDTF_Header* header);
+// reads and validates a stored header at the current position of file
+bool ndtf_header_read(FILE* file, NDTF_Header* header);
+bool ndtf_header_write(FILE* file, const NDTF_Header* header);
+// header as it is written: minimal version for the used features and a fresh checksum
+void ndtf_header_prepare(const NDTF_Header* header, NDTF_Header* out);
+uint32_t ndtf_header_computeChecksum(const NDTF_Header* header);
+
+// bricks of segmented files
+
+typedef struct ndtf_Bricks
+{
+	size_t size[NDTF_DIMENSIONS_MAX];	// volume extent per axis (1 past the used dimensions)
+	size_t extent[NDTF_DIMENSIONS_MAX];	// full brick extent per axis
+	size_t grid[NDTF_DIMENSIONS_MAX];	// bricks per axis
+	size_t count;
+	size_t texelSize;
+} ndtf_Bricks;
+
+void ndtf_bricks_init(ndtf_Bricks* bricks, const NDTF_Header* header);
+// origin and extent of a brick, edge bricks are clipped to the volume. returns the brick size in bytes
+size_t ndtf_bricks_get(const ndtf_Bricks* bricks, size_t index, size_t origin[NDTF_DIMENSIONS_MAX], size_t extent[NDTF_DIMENSIONS_MAX]);
+size_t ndtf_bricks_offset(const ndtf_Bricks* bricks, const size_t origin[NDTF_DIMENSIONS_MAX]);
+// a brick is contiguous in the volume when it spans all axes below its outermost non-unit axis
+bool ndtf_bricks_isContiguous(const ndtf_Bricks* bricks, const size_t extent[NDTF_DIMENSIONS_MAX]);
+void ndtf_bricks_gather(const ndtf_Bricks* bricks, const uint8_t* volume, const size_t origin[NDTF_DIMENSIONS_MAX], const size_t extent[NDTF_DIMENSIONS_MAX], uint8_t* brick);
+void ndtf_bricks_scatter(const ndtf_Bricks* bricks, uint8_t* volume, const size_t origin[NDTF_DIMENSIONS_MAX], const size_t extent[NDTF_DIMENSIONS_MAX], const uint8_t* brick);
+
+// segmented payloads
+
+typedef struct ndtf_EncodedSegments
+{
+	NDTF_SegmentTable table;
+	NDTF_Segment* segments;
+	const uint8_t** data;	// stored bytes of every segment
+	uint8_t** buffers;		// owned encode buffers (NULL where data points into the file)
+	NDTF_ZoneMapTable zoneTable;
+	NDTF_ValueRange* zoneMaps;	// flags.zoneMaps
+	size_t* original;		// flags.deduplicated: brick whose stored bytes a brick shares, itself when unique
+	size_t totalSize;		// header, tables and all segments
+} ndtf_EncodedSegments;
+
+// bytes of the segment entries and the zone maps that follow the segment table
+size_t ndtf_segments_tableSize(const NDTF_Header* header, size_t count);
+// validates a table read from a file of fileSize bytes, entries holds ndtf_segments_tableSize bytes.
+// the entries are copied into an allocated array
+bool ndtf_segments_validate(const NDTF_Header* header, const NDTF_SegmentTable* table, const uint8_t* entries, uint64_t fileSize, NDTF_Segment** segments, const NDTF_Context* ctx);
+bool ndtf_segments_parse(const NDTF_Header* header, const uint8_t* data, size_t size, NDTF_Segment** segments, size_t* count, const NDTF_Context* ctx);
+// decodes all bricks of the volume described by header, segment offsets are relative to base
+bool ndtf_segments_decode(const NDTF_Header* header, const NDTF_Segment* segments, size_t count, const uint8_t* base, uint8_t* volume, ndtf_TexelStatsSink* texelStats, const NDTF_Transform* transform, const NDTF_Context* ctx);
+// decodes the stored bytes of one segment into a packed brick of outSize bytes. scratch (optional) keeps the
+// decoder buffers across calls, without it they are allocated per call
+bool ndtf_segment_decode(const NDTF_Header* header, const NDTF_Segment* segment, const uint8_t* stored, uint8_t* out, size_t outSize, const size_t extent[NDTF_DIMENSIONS_MAX], ndtf_DecodeScratch* scratch, const NDTF_Context* ctx);
+// called with every decoded brick, its texels packed x-fastest. calls may run concurrently
+typedef bool (*ndtf_BrickFunc)(void* user, const size_t origin[NDTF_DIMENSIONS_MAX], const size_t extent[NDTF_DIMENSIONS_MAX], const uint8_t* brick);
+// decodes the bricks one by one without assembling the volume, transform (optional) is applied to every brick before
+// func sees it. fails on delta encoded files
+bool ndtf_segments_decodeBricks(const NDTF_Header* header, const NDTF_Segment* segments, size_t count, const uint8_t* base, const NDTF_Transform* transform, ndtf_BrickFunc func, void* user, const NDTF_Context* ctx);
+// texelStats (optional) collects every decoded or encoded brick, after transform (optional) is applied to it
+bool ndtf_segments_load(NDTF_File* file, const uint8_t* data, size_t size, ndtf_TexelStatsSink* texelStats, const NDTF_Transform* transform, const NDTF_Context* ctx);
+// errorBound (optional) is the resolved bound of a file that is part of a larger volume, else it is resolved from file
+bool ndtf_segments_encode(NDTF_File* file, ndtf_EncodedSegments* encoded, ndtf_TexelStatsSink* texelStats, const NDTF_Transform* transform, const ndtf_LossyBound* errorBound, const NDTF_Context* ctx);
+// encodes only the listed bricks into their entries of encoded, without offsets, table checksums or deduplication
+bool ndtf_segments_encodeBricks(NDTF_File* file, const size_t* bricks, size_t count, ndtf_EncodedSegments* encoded, const NDTF_Transform* transform, const NDTF_Context* ctx);
+void ndtf_segments_freeEncoded(ndtf_EncodedSegments* encoded, const NDTF_Context* ctx);
+
+// zone maps
+
+// value ranges of one brick from its statistics, widened by the error bound of lossy files
+void ndtf_zoneMaps_fromStats(const NDTF_Header* header, const ndtf_LossyBound* errorBound, const ndtf_TexelStatsPartial* partial, NDTF_ValueRange* ranges);
+
+// readers
+
+// scratch buffers of reads taken from the pool of the reader, a thread that reads repeatedly holds one across its
+// reads and hands it back once done. NULL when they cannot be allocated
+typedef struct ndtf_ReaderScratch ndtf_ReaderScratch;
+ndtf_ReaderScratch* ndtf_reader_acquire(NDTF_Reader* reader);
+void ndtf_reader_release(NDTF_Reader* reader, ndtf_ReaderScratch* scratch);
+// ndtf_reader_readRegion with the scratch of the calling thread, NULL takes one from the pool for the call
+bool ndtf_reader_readRegionWith(NDTF_Reader* reader, ndtf_ReaderScratch* scratch, const uint32_t origin[NDTF_DIMENSIONS_MAX], const uint32_t extent[NDTF_DIMENSIONS_MAX], void* texels);
+
+#endif // !_NDTF_INTERNAL_H_
@@ -0,0 +1,562 @@
+#include "ndtf_internal.h"
+#include <string.h>
+#include <math.h>
+
+// error bounded lossy encoding of float channels: every value is predicted from already reconstructed
+// neighbours (3D Lorenzo predictor), the residual is quantized to bins of twice the error bound and the
+// bin numbers are written as varints that the codec entropy codes. values that can not be reconstructed
+// within the bound (including NaN and infinity) are stored verbatim. the slices are split into chunks that
+// are predicted on their own, so every chunk of every channel is encoded and decoded in parallel
+
+#define NDTF_LOSSY_MAX_CHANNELS 4
+#define NDTF_LOSSY_MAX_BIN (1 << 30)
+#define NDTF_LOSSY_MAX_SYMBOL 5 // bytes of the largest symbol, an escape followed by a raw float
+#define NDTF_LOSSY_CHUNK_TEXELS (1 << 18) // texels per chunk (at least one slice) and per range task
+#define NDTF_LOSSY_RANGE_PIECE 1024 // texels transformed at once when gathering a range
+
+// followed by the end offset of the symbols of every chunk (uint64_t, channel-major), then by the symbols
+typedef struct ndtf_LossyPreamble
+{
+	uint64_t codeSize[NDTF_LOSSY_MAX_CHANNELS];	// symbol bytes per channel before entropy coding
+	uint8_t mode;								// enum NDTF_ErrorBoundMode as requested
+	uint8_t channels;
+	uint8_t __padding__[2];
+	uint32_t chunkDepth;						// slices per chunk
+	float bound[NDTF_LOSSY_MAX_CHANNELS];		// as requested
+	float absolute[NDTF_LOSSY_MAX_CHANNELS];	// absolute bound applied per channel
+} ndtf_LossyPreamble;
+
+bool ndtf_lossy_enabled(const NDTF_Header* header)
+{
+	NDTF_TexelFormat format = (NDTF_TexelFormat)header->texelFormat;
+	return header->flags.lossy && ndtf_getChannelIsFloat(format) && ndtf_getChannelSize(format) == sizeof(float);
+}
+
+void ndtf_lossyRange_init(ndtf_LossyRange* range)
+{
+	for (size_t c = 0; c < NDTF_CHANNELS_RGBA; c++)
+	{
+		range->low[c] = INFINITY;
+		range->high[c] = -INFINITY;
+	}
+}
+
+typedef struct ndtf_LossyRangeTask
+{
+	ndtf_LossyRange* range;
+	const float* data;
+	size_t texels;
+	size_t channels;
+	const NDTF_Transform* transform;
+	ndtf_Mutex mutex;
+} ndtf_LossyRangeTask;
+
+static void ndtf_lossyRange_task(void* taskData, size_t index)
+{
+	ndtf_LossyRangeTask* task = (ndtf_LossyRangeTask*)taskData;
+	size_t channels = task->channels;
+	size_t begin = index * NDTF_LOSSY_CHUNK_TEXELS;
+	size_t end = min(begin + NDTF_LOSSY_CHUNK_TEXELS, task->texels);
+
+	ndtf_LossyRange range;
+	ndtf_lossyRange_init(&range);
+
+	float piece[NDTF_LOSSY_RANGE_PIECE * NDTF_LOSSY_MAX_CHANNELS];
+	for (size_t first = begin; first < end; first += NDTF_LOSSY_RANGE_PIECE)
+	{
+		size_t count = min((size_t)NDTF_LOSSY_RANGE_PIECE, end - first);
+		const float* values = task->data + first * channels;
+		if (task->transform)
+		{
+			ndtf_transform_run(task->transform, (const uint8_t*)values, (uint8_t*)piece, count);
+			values = piece;
+		}
+
+		for (size_t i = 0; i < count * channels; i++)
+		{
+			float value = values[i];
+			size_t c = i % channels;
+			if (isfinite(value))
+			{
+				range.low[c] = value < range.low[c] ? value : range.low[c];
+				range.high[c] = value > range.high[c] ? value : range.high[c];
+			}
+		}
+	}
+
+	ndtf_mutex_lock(&task->mutex);
+	for (size_t c = 0; c < channels; c++)
+	{
+		task->range->low[c] = min(task->range->low[c], range.low[c]);
+		task->range->high[c] = max(task->range->high[c], range.high[c]);
+	}
+	ndtf_mutex_unlock(&task->mutex);
+}
+
+void ndtf_lossyRange_add(ndtf_LossyRange* range, const NDTF_Header* header, const uint8_t* data, size_t texels, const NDTF_Transform* transform, const NDTF_Context* ctx)
+{
+	ndtf_LossyRangeTask task;
+	task.range = range;
+	task.data = (const float*)data;
+	task.texels = texels;
+	task.channels = ndtf_getChannelCount((NDTF_TexelFormat)header->texelFormat);
+	task.transform = transform;
+	ndtf_mutex_init(&task.mutex);
+
+	NDTF_SCOPE_BEGIN(rangeScope, ctx, NDTF_PHASE_COMPRESS, "range");
+	ndtf_parallelFor(ctx, ndtf_lossyRange_task, &task, (texels + NDTF_LOSSY_CHUNK_TEXELS - 1) / NDTF_LOSSY_CHUNK_TEXELS);
+	NDTF_SCOPE_END(rangeScope, ctx, texels * task.channels * sizeof(float));
+
+	ndtf_mutex_destroy(&task.mutex);
+}
+
+void ndtf_lossy_resolve(ndtf_LossyBound* resolved, const NDTF_Header* header, const NDTF_ErrorBound* bound, const ndtf_LossyRange* range)
+{
+	memset(resolved, 0, sizeof(ndtf_LossyBound));
+	resolved->requested.mode = bound->mode;
+
+	size_t channels = ndtf_getChannelCount((NDTF_TexelFormat)header->texelFormat);
+	for (size_t c = 0; c < channels && c < NDTF_CHANNELS_RGBA; c++)
+	{
+		resolved->requested.bound[c] = bound->bound[c] > 0.0f ? bound->bound[c] : 0.0f;
+		resolved->absolute[c] = resolved->requested.bound[c];
+
+		if (bound->mode == NDTF_ERRORBOUND_RELATIVE)
+		{
+			float low = range->low[c], high = range->high[c];
+			resolved->absolute[c] = high > low ? (float)((double)resolved->requested.bound[c] * ((double)high - low)) : 0.0f;
+		}
+	}
+}
+
+void ndtf_lossy_resolveFile(ndtf_LossyBound* resolved, NDTF_File* file, const NDTF_Transform* transform, const NDTF_Context* ctx)
+{
+	ndtf_LossyRange range;
+	ndtf_lossyRange_init(&range);
+
+	// only a relative bound needs the range, it is the one of the whole volume
+	if (file->errorBound.mode == NDTF_ERRORBOUND_RELATIVE)
+	{
+		size_t texelSize = ndtf_getTexelSize((NDTF_TexelFormat)file->header.texelFormat);
+		ndtf_lossyRange_add(&range, &file->header, file->data, ndtf_file_getDataSize(file) / max(texelSize, 1), transform, ctx);
+	}
+
+	ndtf_lossy_resolve(resolved, &file->header, &file->errorBound, &range);
+}
+
+typedef struct ndtf_LossyGeometry
+{
+	size_t width, height, depth;	// dimensions past the third are folded into the depth
+	size_t channels;
+	size_t chunkDepth, chunks;		// chunks per channel
+} ndtf_LossyGeometry;
+
+static void ndtf_lossy_geometry(ndtf_LossyGeometry* geometry, const NDTF_Header* header, const size_t extent[NDTF_DIMENSIONS_MAX])
+{
+	geometry->width = extent[0];
+	geometry->height = extent[1];
+	geometry->depth = extent[2] * extent[3] * extent[4];
+	geometry->channels = ndtf_getChannelCount((NDTF_TexelFormat)header->texelFormat);
+}
+
+static void ndtf_lossy_setChunkDepth(ndtf_LossyGeometry* geometry, size_t chunkDepth)
+{
+	geometry->chunkDepth = chunkDepth;
+	geometry->chunks = geometry->width && geometry->height ? (geometry->depth + chunkDepth - 1) / chunkDepth : 0;
+}
+
+// encoder and decoder must evaluate the prediction identically
+static inline double ndtf_lossy_predict(const float* p, size_t x, size_t y, size_t z, size_t sx, size_t sy, size_t sz)
+{
+	double a = x ? p[-(ptrdiff_t)sx] : 0.0;
+	double b = y ? p[-(ptrdiff_t)sy] : 0.0;
+	double c = z ? p[-(ptrdiff_t)sz] : 0.0;
+	double ab = x && y ? p[-(ptrdiff_t)(sx + sy)] : 0.0;
+	double ac = x && z ? p[-(ptrdiff_t)(sx + sz)] : 0.0;
+	double bc = y && z ? p[-(ptrdiff_t)(sy + sz)] : 0.0;
+	double abc = x && y && z ? p[-(ptrdiff_t)(sx + sy + sz)] : 0.0;
+	return a + b + c - ab - ac - bc + abc;
+}
+
+static inline uint8_t* ndtf_lossy_writeVarint(uint8_t* out, uint32_t value)
+{
+	while (value >= 0x80)
+	{
+		*out++ = (uint8_t)(value | 0x80);
+		value >>= 7;
+	}
+	*out++ = (uint8_t)value;
+	return out;
+}
+
+static inline const uint8_t* ndtf_lossy_readVarint(const uint8_t* in, const uint8_t* end, uint32_t* value)
+{
+	uint32_t result = 0;
+	for (int shift = 0; shift < 35 && in < end; shift += 7)
+	{
+		uint8_t b = *in++;
+		result |= (uint32_t)(b & 0x7F) << shift;
+		if (!(b & 0x80))
+		{
+			*value = result;
+			return in;
+		}
+	}
+	return NULL;
+}
+
+// chunks hold whole slices, as many as fit NDTF_LOSSY_CHUNK_TEXELS and at least one
+static size_t ndtf_lossy_chunkDepth(const ndtf_LossyGeometry* geometry)
+{
+	size_t plane = geometry->width * geometry->height;
+	return plane ? min(max(NDTF_LOSSY_CHUNK_TEXELS / plane, 1), max(geometry->depth, 1)) : 1;
+}
+
+// chunk index of channel index / chunks starts at slice index % chunks
+static void ndtf_lossy_chunk(const ndtf_LossyGeometry* geometry, size_t index, size_t* channel, size_t* first, size_t* depth)
+{
+	*channel = index / geometry->chunks;
+	*first = index % geometry->chunks * geometry->chunkDepth;
+	*depth = min(geometry->chunkDepth, geometry->depth - *first);
+}
+
+// end of the symbols of chunk index in the table that follows the preamble
+static uint64_t ndtf_lossy_chunkEnd(const uint8_t* ends, size_t index)
+{
+	uint64_t end;
+	memcpy(&end, ends + index * sizeof(uint64_t), sizeof(uint64_t));
+	return end;
+}
+
+typedef struct ndtf_LossyEncode
+{
+	ndtf_LossyGeometry geometry;
+	const float* data;
+	float* recon;
+	uint8_t* codes;			// room for the largest symbol of every texel, channel after channel
+	uint64_t* chunkSize;	// symbol bytes per chunk, channel-major
+	float absolute[NDTF_LOSSY_MAX_CHANNELS];
+} ndtf_LossyEncode;
+
+// where the symbols of a chunk are written before they are concatenated
+static uint8_t* ndtf_lossy_chunkCodes(const ndtf_LossyEncode* encode, size_t index)
+{
+	const ndtf_LossyGeometry* g = &encode->geometry;
+	size_t c, first, depth;
+	ndtf_lossy_chunk(g, index, &c, &first, &depth);
+	return encode->codes + (c * g->depth + first) * g->width * g->height * NDTF_LOSSY_MAX_SYMBOL;
+}
+
+static void ndtf_lossy_encodeChunk(void* taskData, size_t index)
+{
+	ndtf_LossyEncode* encode = (ndtf_LossyEncode*)taskData;
+	const ndtf_LossyGeometry* g = &encode->geometry;
+
+	size_t sx = g->channels;
+	size_t sy = sx * g->width;
+	size_t sz = sy * g->height;
+
+	size_t c, first, depth;
+	ndtf_lossy_chunk(g, index, &c, &first, &depth);
+
+	double bound = encode->absolute[c];
+	double bin = 2.0 * bound;
+	uint8_t* codes = ndtf_lossy_chunkCodes(encode, index);
+	uint8_t* out = codes;
+
+	// z counts from the first slice of the chunk, nothing is predicted from the chunk before
+	size_t i = c + first * sz;
+	for (size_t z = 0; z < depth; z++)
+	{
+		for (size_t y = 0; y < g->height; y++)
+		{
+			for (size_t x = 0; x < g->width; x++, i += sx)
+			{
+				float value = encode->data[i];
+				double prediction = ndtf_lossy_predict(encode->recon + i, x, y, z, sx, sy, sz);
+
+				if (isfinite(value))
+				{
+					double q = bin > 0.0 ? nearbyint((value - prediction) / bin) : 0.0;
+					if (fabs(q) < NDTF_LOSSY_MAX_BIN)
+					{
+						float reconstructed = (float)(prediction + q * bin);
+						if (fabs((double)reconstructed - value) <= bound)
+						{
+							int32_t bin32 = (int32_t)q;
+							uint32_t zigzag = ((uint32_t)bin32 << 1) ^ (uint32_t)(bin32 >> 31);
+							out = ndtf_lossy_writeVarint(out, zigzag + 1);
+							encode->recon[i] = reconstructed;
+							continue;
+						}
+					}
+				}
+
+				*out++ = 0;
+				memcpy(out, &value, sizeof(float));
+				out += sizeof(float);
+				encode->recon[i] = value;
+			}
+		}
+	}
+
+	encode->chunkSize[index] = (uint64_t)(out - codes);
+}
+
+uint8_t* ndtf_lossy_encode(const NDTF_Header* header, const uint8_t* data, const size_t extent[NDTF_DIMENSIONS_MAX], const ndtf_LossyBound* bound, size_t prefix, size_t* size, const NDTF_Context* ctx)
+{
+	ndtf_LossyEncode encode;
+	memset(&encode, 0, sizeof(ndtf_LossyEncode));
+	ndtf_lossy_geometry(&encode.geometry, header, extent);
+	ndtf_lossy_setChunkDepth(&encode.geometry, ndtf_lossy_chunkDepth(&encode.geometry));
+	encode.data = (const float*)data;
+
+	size_t channels = encode.geometry.channels;
+	size_t texels = encode.geometry.width * encode.geometry.height * encode.geometry.depth;
+	size_t tasks = encode.geometry.chunks * channels;
+
+	ndtf_LossyPreamble preamble;
+	memset(&preamble, 0, sizeof(ndtf_LossyPreamble));
+	preamble.mode = bound->requested.mode;
+	preamble.channels = (uint8_t)channels;
+	preamble.chunkDepth = (uint32_t)encode.geometry.chunkDepth;
+
+	for (size_t c = 0; c < channels; c++)
+	{
+		preamble.bound[c] = bound->requested.bound[c];
+		preamble.absolute[c] = bound->absolute[c];
+		encode.absolute[c] = bound->absolute[c];
+	}
+
+	// every chunk writes its symbols into its own slice of one buffer, they are concatenated in place
+	size_t codesSize = 0;
+	uint8_t* codes = NULL;
+	if (ndtf_size_mul(texels * channels, NDTF_LOSSY_MAX_SYMBOL, &codesSize))
+	{
+		encode.recon = (float*)ndtf_mem_alloc(ctx, max(texels * channels * sizeof(float), 1));
+		encode.chunkSize = (uint64_t*)ndtf_mem_alloc(ctx, max(tasks * sizeof(uint64_t), 1));
+		codes = (uint8_t*)ndtf_mem_alloc(ctx, max(codesSize, 1));
+	}
+	encode.codes = codes;
+
+	uint8_t* result = NULL;
+	if (encode.recon && encode.chunkSize && codes)
+	{
+		NDTF_SCOPE_BEGIN(convertScope, ctx, NDTF_PHASE_COMPRESS, "quantize");
+		ndtf_parallelFor(ctx, ndtf_lossy_encodeChunk, &encode, tasks);
+		NDTF_SCOPE_END(convertScope, ctx, texels * channels * sizeof(float));
+
+		// the codec entropy codes the symbols of all chunks as one stream, the table keeps where every chunk ends
+		size_t codeSize = 0;
+		for (size_t t = 0; t < tasks; t++)
+		{
+			size_t chunkSize = (size_t)encode.chunkSize[t];
+			memmove(codes + codeSize, ndtf_lossy_chunkCodes(&encode, t), chunkSize);
+			preamble.codeSize[t / encode.geometry.chunks] += chunkSize;
+			codeSize += chunkSize;
+			encode.chunkSize[t] = codeSize;
+		}
+
+		size_t tableSize = tasks * sizeof(uint64_t);
+		size_t streamPrefix = prefix + sizeof(ndtf_LossyPreamble) + tableSize;
+		size_t compressedSize = 0;
+		if (header->flags.codec == NDTF_CODEC_NONE)
+		{
+			result = (uint8_t*)ndtf_mem_alloc(ctx, streamPrefix + codeSize);
+			if (result)
+				memcpy(result + streamPrefix, codes, codeSize);
+			compressedSize = codeSize;
+		}
+		else
+			result = ndtf_codec_compress((NDTF_Codec)header->flags.codec, codes, codeSize, streamPrefix, &compressedSize, ctx);
+
+		if (result)
+		{
+			memcpy(result + prefix, &preamble, sizeof(ndtf_LossyPreamble));
+			memcpy(result + prefix + sizeof(ndtf_LossyPreamble), encode.chunkSize, tableSize);
+			*size = sizeof(ndtf_LossyPreamble) + tableSize + compressedSize;
+		}
+	}
+
+	ndtf_mem_free(ctx, codes);
+	ndtf_mem_free(ctx, encode.chunkSize);
+	ndtf_mem_free(ctx, encode.recon);
+
+	return result;
+}
+
+typedef struct ndtf_LossyDecode
+{
+	ndtf_LossyGeometry geometry;
+	float* out;
+	const uint8_t* codes;
+	const uint8_t* ends;	// table of chunk ends, not aligned
+	float absolute[NDTF_LOSSY_MAX_CHANNELS];
+	volatile uint64_t failed;
+} ndtf_LossyDecode;
+
+static void ndtf_lossy_decodeChunk(void* taskData, size_t index)
+{
+	ndtf_LossyDecode* decode = (ndtf_LossyDecode*)taskData;
+	const ndtf_LossyGeometry* g = &decode->geometry;
+
+	size_t sx = g->channels;
+	size_t sy = sx * g->width;
+	size_t sz = sy * g->height;
+
+	size_t c, first, depth;
+	ndtf_lossy_chunk(g, index, &c, &first, &depth);
+
+	double bin = 2.0 * decode->absolute[c];
+	const uint8_t* in = decode->codes + (index ? (size_t)ndtf_lossy_chunkEnd(decode->ends, index - 1) : 0);
+	const uint8_t* end = decode->codes + (size_t)ndtf_lossy_chunkEnd(decode->ends, index);
+
+	size_t i = c + first * sz;
+	for (size_t z = 0; z < depth; z++)
+	{
+		for (size_t y = 0; y < g->height; y++)
+		{
+			for (size_t x = 0; x < g->width; x++, i += sx)
+			{
+				uint32_t symbol;
+				in = ndtf_lossy_readVarint(in, end, &symbol);
+				if (!in)
+				{
+					ndtf_atomic_store_u64(&decode->failed, 1);
+					return;
+				}
+
+				if (symbol == 0)
+				{
+					if (end - in < (ptrdiff_t)sizeof(float))
+					{
+						ndtf_atomic_store_u64(&decode->failed, 1);
+						return;
+					}
+					memcpy(&decode->out[i], in, sizeof(float));
+					in += sizeof(float);
+					continue;
+				}
+
+				uint32_t zigzag = symbol - 1;
+				int32_t q = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+				double prediction = ndtf_lossy_predict(decode->out + i, x, y, z, sx, sy, sz);
+				decode->out[i] = (float)(prediction + q * bin);
+			}
+		}
+	}
+
+	if (in != end)
+		ndtf_atomic_store_u64(&decode->failed, 1);
+}
+
+bool ndtf_lossy_decode(const NDTF_Header* header, const uint8_t* src, size_t srcSize, uint8_t* dst, const size_t extent[NDTF_DIMENSIONS_MAX], NDTF_Codec codec, NDTF_ErrorBound* bound, ndtf_DecodeScratch* scratch, const NDTF_Context* ctx)
+{
+	ndtf_LossyDecode decode;
+	memset(&decode, 0, sizeof(ndtf_LossyDecode));
+	ndtf_lossy_geometry(&decode.geometry, header, extent);
+	decode.out = (float*)dst;
+
+	size_t channels = decode.geometry.channels;
+	size_t plane = decode.geometry.width * decode.geometry.height;
+	size_t texels = plane * decode.geometry.depth;
+
+	ndtf_LossyPreamble preamble;
+	if (srcSize < sizeof(ndtf_LossyPreamble))
+		return false;
+	memcpy(&preamble, src, sizeof(ndtf_LossyPreamble));
+	if (preamble.channels != channels || !preamble.chunkDepth)
+		return false;
+
+	ndtf_lossy_setChunkDepth(&decode.geometry, preamble.chunkDepth);
+	size_t chunks = decode.geometry.chunks;
+	size_t tasks = chunks * channels;
+	size_t tableSize;
+	if (!ndtf_size_mul(tasks, sizeof(uint64_t), &tableSize) || srcSize - sizeof(ndtf_LossyPreamble) < tableSize)
+		return false;
+	decode.ends = src + sizeof(ndtf_LossyPreamble);
+
+	// a chunk holds at most the largest symbol of each of its texels, the chunks of a channel add up to its symbols
+	for (size_t t = 0; t < tasks; t++)
+	{
+		size_t c, first, depth;
+		ndtf_lossy_chunk(&decode.geometry, t, &c, &first, &depth);
+		uint64_t begin = t ? ndtf_lossy_chunkEnd(decode.ends, t - 1) : 0;
+		uint64_t end = ndtf_lossy_chunkEnd(decode.ends, t);
+		if (end < begin || end - begin > (uint64_t)depth * plane * NDTF_LOSSY_MAX_SYMBOL)
+			return false;
+	}
+
+	size_t codeSize = 0;
+	for (size_t c = 0; c < channels; c++)
+	{
+		if (preamble.codeSize[c] > (uint64_t)texels * NDTF_LOSSY_MAX_SYMBOL)
+			return false;
+		codeSize += (size_t)preamble.codeSize[c];
+		if (chunks && ndtf_lossy_chunkEnd(decode.ends, (c + 1) * chunks - 1) != codeSize)
+			return false;
+	}
+
+	const uint8_t* stream = src + sizeof(ndtf_LossyPreamble) + tableSize;
+	size_t streamSize = srcSize - sizeof(ndtf_LossyPreamble) - tableSize;
+
+	// symbols are decompressed into the buffer of the scratch when there is one
+	uint8_t* codes = NULL;
+	if (codec == NDTF_CODEC_NONE)
+	{
+		if (streamSize != codeSize)
+			return false;
+	}
+	else
+	{
+		// a scratch grows to the most symbols a brick of this size can hold, so it grows once
+		size_t capacity = max(codeSize, 1);
+		if (scratch && scratch->codesCapacity < capacity)
+		{
+			size_t bound;
+			if (ndtf_size_mul(texels * channels, NDTF_LOSSY_MAX_SYMBOL, &bound))
+				capacity = max(capacity, bound);
+			ndtf_mem_free(ctx, scratch->codes);
+			scratch->codes = (uint8_t*)ndtf_mem_alloc(ctx, capacity);
+			scratch->codesCapacity = scratch->codes ? capacity : 0;
+		}
+		uint8_t* buffer = scratch ? scratch->codes : (uint8_t*)ndtf_mem_alloc(ctx, capacity);
+		codes = scratch ? NULL : buffer;
+		if (!buffer || !ndtf_codec_decompressWith(codec, scratch ? &scratch->codec : NULL, stream, streamSize, buffer, codeSize, ctx))
+		{
+			ndtf_mem_free(ctx, codes);
+			return false;
+		}
+		stream = buffer;
+	}
+
+	decode.codes = stream;
+	for (size_t c = 0; c < channels; c++)
+		decode.absolute[c] = preamble.absolute[c];
+
+	NDTF_SCOPE_BEGIN(convertScope, ctx, NDTF_PHASE_DECOMPRESS, "dequantize");
+	ndtf_parallelFor(ctx, ndtf_lossy_decodeChunk, &decode, tasks);
+	NDTF_SCOPE_END(convertScope, ctx, texels * channels * sizeof(float));
+
+	ndtf_mem_free(ctx, codes);
+
+	if (decode.failed)
+		return false;
+
+	if (bound)
+		ndtf_lossy_readBound(src, srcSize, bound);
+	return true;
+}
+
+bool ndtf_lossy_readBound(const uint8_t* src, size_t srcSize, NDTF_ErrorBound* bound)
+{
+	ndtf_LossyPreamble preamble;
+	if (srcSize < sizeof(ndtf_LossyPreamble))
+		return false;
+	memcpy(&preamble, src, sizeof(ndtf_LossyPreamble));
+
+	memset(bound, 0, sizeof(NDTF_ErrorBound));
+	bound->mode = preamble.mode;
+	memcpy(bound->bound, preamble.bound, sizeof(bound->bound));
+	return true;
+}
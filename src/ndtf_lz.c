@@ -0,0 +1,213 @@
+#include "ndtf_internal.h"
+#include <string.h>
+
+// byte oriented LZ77 producing LZ4 block format streams: a token with the literal and match length,
+// the literals, a 16 bit offset and length extension bytes. trades ratio for very fast decoding
+
+#define NDTF_LZ_MIN_MATCH 4
+#define NDTF_LZ_LAST_LITERALS 5		// the stream always ends with at least this many literals
+#define NDTF_LZ_MATCH_LIMIT 12		// no match starts within this many bytes of the end
+#define NDTF_LZ_MAX_OFFSET 65535
+#define NDTF_LZ_HASH_BITS 12
+
+static inline uint32_t ndtf_lz_read32(const uint8_t* p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(uint32_t));
+	return v;
+}
+
+static inline uint32_t ndtf_lz_hash(uint32_t v)
+{
+	return (v * 2654435761u) >> (32 - NDTF_LZ_HASH_BITS);
+}
+
+// writes a length extension, returns false if it does not fit
+static inline bool ndtf_lz_writeLength(uint8_t** op, const uint8_t* end, size_t length)
+{
+	while (length >= 255)
+	{
+		if (*op >= end) return false;
+		*(*op)++ = 255;
+		length -= 255;
+	}
+	if (*op >= end) return false;
+	*(*op)++ = (uint8_t)length;
+	return true;
+}
+
+static bool ndtf_lz_writeSequence(uint8_t** op, const uint8_t* end, const uint8_t* literals, size_t literalCount, size_t offset, size_t matchLength, bool last)
+{
+	if (*op >= end) return false;
+
+	uint8_t* token = (*op)++;
+	*token = (uint8_t)(min(literalCount, 15) << 4);
+	if (literalCount >= 15 && !ndtf_lz_writeLength(op, end, literalCount - 15))
+		return false;
+
+	if ((size_t)(end - *op) < literalCount)
+		return false;
+	memcpy(*op, literals, literalCount);
+	*op += literalCount;
+
+	if (last)
+		return true;
+
+	if (end - *op < 2) return false;
+	*(*op)++ = (uint8_t)offset;
+	*(*op)++ = (uint8_t)(offset >> 8);
+
+	size_t length = matchLength - NDTF_LZ_MIN_MATCH;
+	*token |= (uint8_t)min(length, 15);
+	if (length >= 15 && !ndtf_lz_writeLength(op, end, length - 15))
+		return false;
+
+	return true;
+}
+
+size_t ndtf_lz_compressBound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+size_t ndtf_lz_compress(const void* src, size_t srcSize, void* dst, size_t dstCapacity)
+{
+	const uint8_t* in = (const uint8_t*)src;
+	uint8_t* op = (uint8_t*)dst;
+	const uint8_t* end = op + dstCapacity;
+
+	size_t table[1 << NDTF_LZ_HASH_BITS];
+	memset(table, 0, sizeof(table));
+
+	size_t anchor = 0;
+	if (srcSize > NDTF_LZ_MATCH_LIMIT)
+	{
+		size_t limit = srcSize - NDTF_LZ_MATCH_LIMIT;
+		size_t matchEnd = srcSize - NDTF_LZ_LAST_LITERALS;
+
+		size_t ip = 0;
+		while (ip < limit)
+		{
+			uint32_t v = ndtf_lz_read32(in + ip);
+			uint32_t h = ndtf_lz_hash(v);
+			size_t ref = table[h];
+			table[h] = ip;
+
+			if (ref >= ip || ip - ref > NDTF_LZ_MAX_OFFSET || ndtf_lz_read32(in + ref) != v)
+			{
+				// step faster through data that does not compress
+				ip += 1 + ((ip - anchor) >> 6);
+				continue;
+			}
+
+			while (ip > anchor && ref > 0 && in[ip - 1] == in[ref - 1])
+			{
+				ip--;
+				ref--;
+			}
+
+			size_t length = NDTF_LZ_MIN_MATCH;
+			while (ip + length < matchEnd && in[ip + length] == in[ref + length])
+				length++;
+
+			if (!ndtf_lz_writeSequence(&op, end, in + anchor, ip - anchor, ip - ref, length, false))
+				return 0;
+
+			ip += length;
+			anchor = ip;
+
+			if (ip < limit)
+				table[ndtf_lz_hash(ndtf_lz_read32(in + ip - 2))] = ip - 2;
+		}
+	}
+
+	if (!ndtf_lz_writeSequence(&op, end, in + anchor, srcSize - anchor, 0, 0, true))
+		return 0;
+
+	return (size_t)(op - (uint8_t*)dst);
+}
+
+bool ndtf_lz_decompress(const void* src, size_t srcSize, void* dst, size_t dstSize)
+{
+	const uint8_t* ip = (const uint8_t*)src;
+	const uint8_t* inEnd = ip + srcSize;
+	uint8_t* out = (uint8_t*)dst;
+	uint8_t* op = out;
+	uint8_t* outEnd = out + dstSize;
+
+	for (;;)
+	{
+		if (ip >= inEnd) return false;
+		uint8_t token = *ip++;
+
+		size_t literalCount = token >> 4;
+		if (literalCount == 15)
+		{
+			uint8_t b;
+			do
+			{
+				if (ip >= inEnd) return false;
+				b = *ip++;
+				literalCount += b;
+			} while (b == 255);
+		}
+
+		if (literalCount > (size_t)(inEnd - ip) || literalCount > (size_t)(outEnd - op))
+			return false;
+		// short runs are copied with a fixed size, the overshoot is overwritten by the following bytes
+		if (literalCount <= 16 && inEnd - ip >= 16 && outEnd - op >= 16)
+			memcpy(op, ip, 16);
+		else
+			memcpy(op, ip, literalCount);
+		ip += literalCount;
+		op += literalCount;
+
+		if (ip == inEnd)
+			return op == outEnd;
+
+		if (inEnd - ip < 2) return false;
+		size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > (size_t)(op - out))
+			return false;
+
+		size_t length = token & 15;
+		if (length == 15)
+		{
+			uint8_t b;
+			do
+			{
+				if (ip >= inEnd) return false;
+				b = *ip++;
+				length += b;
+			} while (b == 255);
+		}
+		length += NDTF_LZ_MIN_MATCH;
+
+		if (length > (size_t)(outEnd - op))
+			return false;
+
+		const uint8_t* match = op - offset;
+		if (offset >= 16 && (size_t)(outEnd - op) >= length + 16)
+		{
+			// every 16 byte step only reads bytes that are already written
+			for (size_t i = 0; i < length; i += 16)
+				memcpy(op + i, match + i, 16);
+		}
+		else if (offset >= length)
+			memcpy(op, match, length);
+		else
+		{
+			// overlapping match repeats the last offset bytes, double the copied run each step
+			memcpy(op, match, offset);
+			size_t copied = offset;
+			while (copied < length)
+			{
+				size_t n = min(copied, length - copied);
+				memcpy(op + copied, op, n);
+				copied += n;
+			}
+		}
+		op += length;
+	}
+}
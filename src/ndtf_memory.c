@@ -0,0 +1,181 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+	#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "ndtf_internal.h"
+#include <string.h>
+#include <libdeflate.h>
+
+#ifdef _WIN32
+	#include <malloc.h>
+#endif
+
+static void* ndtf_defaultAlloc(size_t size, size_t alignment, void* user)
+{
+#ifdef _WIN32
+	return _aligned_malloc(size ? size : 1, alignment);
+#else
+	void* ptr = NULL;
+	if (posix_memalign(&ptr, alignment, size ? size : 1) != 0)
+		return NULL;
+	return ptr;
+#endif
+}
+
+static void* ndtf_defaultRealloc(void* ptr, size_t oldSize, size_t newSize, size_t alignment, void* user)
+{
+#ifdef _WIN32
+	return _aligned_realloc(ptr, newSize ? newSize : 1, alignment);
+#else
+	// realloc does not keep the alignment, try it first and fall back to a copy. ptr is gone once realloc
+	// succeeded, so without memory for the copy the unaligned block is returned, it still holds the data
+	void* result = realloc(ptr, newSize ? newSize : 1);
+	if (!result || ((uintptr_t)result & (alignment - 1)) == 0)
+		return result;
+
+	void* aligned = ndtf_defaultAlloc(newSize, alignment, user);
+	if (!aligned)
+		return result;
+	memcpy(aligned, result, min(oldSize, newSize));
+	free(result);
+	return aligned;
+#endif
+}
+
+static void ndtf_defaultFree(void* ptr, void* user)
+{
+#ifdef _WIN32
+	_aligned_free(ptr);
+#else
+	free(ptr);
+#endif
+}
+
+static const NDTF_Allocator defaultAllocator = { ndtf_defaultAlloc, ndtf_defaultRealloc, ndtf_defaultFree, NULL };
+
+// every allocator that was made global stays alive, buffers keep a pointer to the one they came from and are
+// still freed by it after ndtf_setAllocator
+typedef struct ndtf_AllocatorNode
+{
+	NDTF_Allocator allocator;
+	struct ndtf_AllocatorNode* next;
+} ndtf_AllocatorNode;
+
+static ndtf_AllocatorNode* installedAllocators = NULL;
+static const NDTF_Allocator* globalAllocator = &defaultAllocator;
+
+static bool ndtf_allocator_equal(const NDTF_Allocator* a, const NDTF_Allocator* b)
+{
+	return a->alloc == b->alloc && a->realloc == b->realloc && a->free == b->free && a->user == b->user;
+}
+
+// libdeflate only knows about a global malloc/free pair
+static void* ndtf_libdeflateMalloc(size_t size)
+{
+	return globalAllocator->alloc(size, NDTF_DEFAULT_ALIGNMENT, globalAllocator->user);
+}
+static void ndtf_libdeflateFree(void* ptr)
+{
+	if (ptr)
+		globalAllocator->free(ptr, globalAllocator->user);
+}
+
+void ndtf_setAllocator(const NDTF_Allocator* allocator)
+{
+	if (!allocator || !allocator->alloc || !allocator->free || ndtf_allocator_equal(allocator, &defaultAllocator))
+	{
+		globalAllocator = &defaultAllocator;
+		libdeflate_set_memory_allocator(malloc, free);
+		return;
+	}
+
+	ndtf_AllocatorNode* node = installedAllocators;
+	while (node && !ndtf_allocator_equal(&node->allocator, allocator))
+		node = node->next;
+	if (!node)
+	{
+		node = (ndtf_AllocatorNode*)malloc(sizeof(ndtf_AllocatorNode));
+		if (!node)
+			return;
+		node->allocator = *allocator;
+		node->next = installedAllocators;
+		installedAllocators = node;
+	}
+
+	globalAllocator = &node->allocator;
+	libdeflate_set_memory_allocator(ndtf_libdeflateMalloc, ndtf_libdeflateFree);
+}
+
+const NDTF_Allocator* ndtf_getAllocator(void)
+{
+	return globalAllocator;
+}
+
+const NDTF_Allocator* ndtf_getDefaultAllocator(void)
+{
+	return &defaultAllocator;
+}
+
+void* ndtf_alloc(size_t size)
+{
+	return ndtf_mem_alloc(NULL, size);
+}
+
+void ndtf_free(void* ptr)
+{
+	ndtf_mem_free(NULL, ptr);
+}
+
+const NDTF_Allocator* ndtf_mem_allocator(const NDTF_Context* ctx)
+{
+	if (ctx && ctx->allocator)
+		return ctx->allocator;
+	return globalAllocator;
+}
+
+void* ndtf_mem_allocWith(const NDTF_Allocator* allocator, const NDTF_Context* ctx, size_t size)
+{
+	NDTF_SCOPE_BEGIN(scope, ctx, NDTF_PHASE_ALLOCATE, "alloc");
+
+	void* ptr = allocator->alloc(size, NDTF_DEFAULT_ALIGNMENT, allocator->user);
+
+	NDTF_SCOPE_END(scope, ctx, ptr ? size : 0);
+	if (ptr)
+		NDTF_COUNT_ALLOC(ctx, size);
+
+	return ptr;
+}
+
+void* ndtf_mem_reallocWith(const NDTF_Allocator* allocator, const NDTF_Context* ctx, void* ptr, size_t oldSize, size_t newSize)
+{
+	if (!ptr)
+		return ndtf_mem_allocWith(allocator, ctx, newSize);
+
+	NDTF_SCOPE_BEGIN(scope, ctx, NDTF_PHASE_ALLOCATE, "realloc");
+
+	void* result;
+	if (allocator->realloc)
+		result = allocator->realloc(ptr, oldSize, newSize, NDTF_DEFAULT_ALIGNMENT, allocator->user);
+	else
+	{
+		result = allocator->alloc(newSize, NDTF_DEFAULT_ALIGNMENT, allocator->user);
+		if (result)
+		{
+			memcpy(result, ptr, min(oldSize, newSize));
+			allocator->free(ptr, allocator->user);
+		}
+	}
+
+	NDTF_SCOPE_END(scope, ctx, result ? newSize : 0);
+
+	return result;
+}
+
+void ndtf_mem_freeWith(const NDTF_Allocator* allocator, const NDTF_Context* ctx, void* ptr)
+{
+	if (!ptr) return;
+
+	allocator->free(ptr, allocator->user);
+
+	NDTF_COUNT_FREE(ctx);
+}
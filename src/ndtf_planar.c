@@ -0,0 +1,592 @@
+#include "ndtf_internal.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+	#define NDTF_PLANAR_SSE2
+	#include <emmintrin.h>
+#endif
+
+#define NDTF_PLANAR_CHUNK ((size_t)1 << 18) // texels per task
+
+bool ndtf_planar_enabled(const NDTF_Header* header)
+{
+	NDTF_TexelFormat texelFormat = (NDTF_TexelFormat)header->texelFormat;
+	return header->flags.planar && ndtf_getChannelCount(texelFormat) > 1 && !ndtf_getIsBlockCompressed(texelFormat) && !ndtf_lossy_enabled(header);
+}
+
+// the generic kernels handle the remainder behind the vectorized part and the 3 channel formats
+
+#define NDTF_PLANAR_KERNELS(type)																		\
+static void ndtf_planar_deinterleave_##type(const type* texels, type* const planes[NDTF_CHANNELS_RGBA], size_t channels, size_t first, size_t end)	\
+{																										\
+	for (size_t c = 0; c < channels; c++)																\
+	{																									\
+		type* plane = planes[c];																		\
+		for (size_t i = first; i < end; i++)															\
+			plane[i] = texels[i * channels + c];														\
+	}																									\
+}																										\
+static void ndtf_planar_interleave_##type(type* const planes[NDTF_CHANNELS_RGBA], type* texels, size_t channels, size_t first, size_t end)	\
+{																										\
+	for (size_t c = 0; c < channels; c++)																\
+	{																									\
+		const type* plane = planes[c];																	\
+		for (size_t i = first; i < end; i++)															\
+			texels[i * channels + c] = plane[i];														\
+	}																									\
+}
+
+NDTF_PLANAR_KERNELS(uint8_t)
+NDTF_PLANAR_KERNELS(uint16_t)
+NDTF_PLANAR_KERNELS(uint32_t)
+
+#ifdef NDTF_PLANAR_SSE2
+
+// 4 channel formats, one iteration moves 16 texels of 8 bit, 8 of 16 bit and 4 of 32 bit channels
+
+static size_t ndtf_planar_deinterleave4_u8(const uint8_t* texels, uint8_t* const planes[NDTF_CHANNELS_RGBA], size_t count)
+{
+	const __m128i low = _mm_set1_epi32(0xFF);
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i v[4], channel[4][4];
+		for (int k = 0; k < 4; k++)
+		{
+			v[k] = _mm_loadu_si128((const __m128i*)(texels + i * 4 + k * 16));
+			channel[0][k] = _mm_and_si128(v[k], low);
+			channel[1][k] = _mm_and_si128(_mm_srli_epi32(v[k], 8), low);
+			channel[2][k] = _mm_and_si128(_mm_srli_epi32(v[k], 16), low);
+			channel[3][k] = _mm_srli_epi32(v[k], 24);
+		}
+		for (int c = 0; c < 4; c++)
+		{
+			__m128i a = _mm_packs_epi32(channel[c][0], channel[c][1]);
+			__m128i b = _mm_packs_epi32(channel[c][2], channel[c][3]);
+			_mm_storeu_si128((__m128i*)(planes[c] + i), _mm_packus_epi16(a, b));
+		}
+	}
+	return i;
+}
+
+static size_t ndtf_planar_interleave4_u8(uint8_t* const planes[NDTF_CHANNELS_RGBA], uint8_t* texels, size_t count)
+{
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i r = _mm_loadu_si128((const __m128i*)(planes[0] + i));
+		__m128i g = _mm_loadu_si128((const __m128i*)(planes[1] + i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(planes[2] + i));
+		__m128i a = _mm_loadu_si128((const __m128i*)(planes[3] + i));
+		__m128i rgLow = _mm_unpacklo_epi8(r, g), rgHigh = _mm_unpackhi_epi8(r, g);
+		__m128i baLow = _mm_unpacklo_epi8(b, a), baHigh = _mm_unpackhi_epi8(b, a);
+		_mm_storeu_si128((__m128i*)(texels + i * 4), _mm_unpacklo_epi16(rgLow, baLow));
+		_mm_storeu_si128((__m128i*)(texels + i * 4 + 16), _mm_unpackhi_epi16(rgLow, baLow));
+		_mm_storeu_si128((__m128i*)(texels + i * 4 + 32), _mm_unpacklo_epi16(rgHigh, baHigh));
+		_mm_storeu_si128((__m128i*)(texels + i * 4 + 48), _mm_unpackhi_epi16(rgHigh, baHigh));
+	}
+	return i;
+}
+
+static size_t ndtf_planar_deinterleave4_u16(const uint16_t* texels, uint16_t* const planes[NDTF_CHANNELS_RGBA], size_t count)
+{
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i v0 = _mm_loadu_si128((const __m128i*)(texels + i * 4));
+		__m128i v1 = _mm_loadu_si128((const __m128i*)(texels + i * 4 + 8));
+		__m128i v2 = _mm_loadu_si128((const __m128i*)(texels + i * 4 + 16));
+		__m128i v3 = _mm_loadu_si128((const __m128i*)(texels + i * 4 + 24));
+		__m128i t0 = _mm_unpacklo_epi16(v0, v1), t1 = _mm_unpackhi_epi16(v0, v1);
+		__m128i t2 = _mm_unpacklo_epi16(v2, v3), t3 = _mm_unpackhi_epi16(v2, v3);
+		__m128i u0 = _mm_unpacklo_epi16(t0, t1), u1 = _mm_unpackhi_epi16(t0, t1);
+		__m128i u2 = _mm_unpacklo_epi16(t2, t3), u3 = _mm_unpackhi_epi16(t2, t3);
+		_mm_storeu_si128((__m128i*)(planes[0] + i), _mm_unpacklo_epi64(u0, u2));
+		_mm_storeu_si128((__m128i*)(planes[1] + i), _mm_unpackhi_epi64(u0, u2));
+		_mm_storeu_si128((__m128i*)(planes[2] + i), _mm_unpacklo_epi64(u1, u3));
+		_mm_storeu_si128((__m128i*)(planes[3] + i), _mm_unpackhi_epi64(u1, u3));
+	}
+	return i;
+}
+
+static size_t ndtf_planar_interleave4_u16(uint16_t* const planes[NDTF_CHANNELS_RGBA], uint16_t* texels, size_t count)
+{
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i r = _mm_loadu_si128((const __m128i*)(planes[0] + i));
+		__m128i g = _mm_loadu_si128((const __m128i*)(planes[1] + i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(planes[2] + i));
+		__m128i a = _mm_loadu_si128((const __m128i*)(planes[3] + i));
+		__m128i rgLow = _mm_unpacklo_epi16(r, g), rgHigh = _mm_unpackhi_epi16(r, g);
+		__m128i baLow = _mm_unpacklo_epi16(b, a), baHigh = _mm_unpackhi_epi16(b, a);
+		_mm_storeu_si128((__m128i*)(texels + i * 4), _mm_unpacklo_epi32(rgLow, baLow));
+		_mm_storeu_si128((__m128i*)(texels + i * 4 + 8), _mm_unpackhi_epi32(rgLow, baLow));
+		_mm_storeu_si128((__m128i*)(texels + i * 4 + 16), _mm_unpacklo_epi32(rgHigh, baHigh));
+		_mm_storeu_si128((__m128i*)(texels + i * 4 + 24), _mm_unpackhi_epi32(rgHigh, baHigh));
+	}
+	return i;
+}
+
+static size_t ndtf_planar_deinterleave4_u32(const uint32_t* texels, uint32_t* const planes[NDTF_CHANNELS_RGBA], size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i v0 = _mm_loadu_si128((const __m128i*)(texels + i * 4));
+		__m128i v1 = _mm_loadu_si128((const __m128i*)(texels + i * 4 + 4));
+		__m128i v2 = _mm_loadu_si128((const __m128i*)(texels + i * 4 + 8));
+		__m128i v3 = _mm_loadu_si128((const __m128i*)(texels + i * 4 + 12));
+		__m128i t0 = _mm_unpacklo_epi32(v0, v1), t1 = _mm_unpackhi_epi32(v0, v1);
+		__m128i t2 = _mm_unpacklo_epi32(v2, v3), t3 = _mm_unpackhi_epi32(v2, v3);
+		_mm_storeu_si128((__m128i*)(planes[0] + i), _mm_unpacklo_epi64(t0, t2));
+		_mm_storeu_si128((__m128i*)(planes[1] + i), _mm_unpackhi_epi64(t0, t2));
+		_mm_storeu_si128((__m128i*)(planes[2] + i), _mm_unpacklo_epi64(t1, t3));
+		_mm_storeu_si128((__m128i*)(planes[3] + i), _mm_unpackhi_epi64(t1, t3));
+	}
+	return i;
+}
+
+static size_t ndtf_planar_interleave4_u32(uint32_t* const planes[NDTF_CHANNELS_RGBA], uint32_t* texels, size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i r = _mm_loadu_si128((const __m128i*)(planes[0] + i));
+		__m128i g = _mm_loadu_si128((const __m128i*)(planes[1] + i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(planes[2] + i));
+		__m128i a = _mm_loadu_si128((const __m128i*)(planes[3] + i));
+		__m128i rgLow = _mm_unpacklo_epi32(r, g), rgHigh = _mm_unpackhi_epi32(r, g);
+		__m128i baLow = _mm_unpacklo_epi32(b, a), baHigh = _mm_unpackhi_epi32(b, a);
+		_mm_storeu_si128((__m128i*)(texels + i * 4), _mm_unpacklo_epi64(rgLow, baLow));
+		_mm_storeu_si128((__m128i*)(texels + i * 4 + 4), _mm_unpackhi_epi64(rgLow, baLow));
+		_mm_storeu_si128((__m128i*)(texels + i * 4 + 8), _mm_unpacklo_epi64(rgHigh, baHigh));
+		_mm_storeu_si128((__m128i*)(texels + i * 4 + 12), _mm_unpackhi_epi64(rgHigh, baHigh));
+	}
+	return i;
+}
+
+#endif // NDTF_PLANAR_SSE2
+
+// planes point at texel 0 of every channel, texels [first, end) are converted
+static void ndtf_planar_convert(NDTF_TexelFormat texelFormat, uint8_t* texels, uint8_t* const planes[NDTF_CHANNELS_RGBA], size_t first, size_t end, bool toPlanes)
+{
+	size_t channels = ndtf_getChannelCount(texelFormat);
+	size_t channelSize = ndtf_getChannelSize(texelFormat);
+
+	// the vector kernels start at the first texel of the range
+	size_t done = first;
+#ifdef NDTF_PLANAR_SSE2
+	if (channels == 4)
+	{
+		uint8_t* offsetPlanes[NDTF_CHANNELS_RGBA];
+		for (size_t c = 0; c < channels; c++)
+			offsetPlanes[c] = planes[c] + first * channelSize;
+		uint8_t* offsetTexels = texels + first * channels * channelSize;
+		size_t count = end - first;
+
+		switch (channelSize)
+		{
+		case 1:
+			done += toPlanes ? ndtf_planar_deinterleave4_u8(offsetTexels, offsetPlanes, count) : ndtf_planar_interleave4_u8(offsetPlanes, offsetTexels, count);
+			break;
+		case 2:
+			done += toPlanes ? ndtf_planar_deinterleave4_u16((const uint16_t*)offsetTexels, (uint16_t* const*)offsetPlanes, count) :
+				ndtf_planar_interleave4_u16((uint16_t* const*)offsetPlanes, (uint16_t*)offsetTexels, count);
+			break;
+		case 4:
+			done += toPlanes ? ndtf_planar_deinterleave4_u32((const uint32_t*)offsetTexels, (uint32_t* const*)offsetPlanes, count) :
+				ndtf_planar_interleave4_u32((uint32_t* const*)offsetPlanes, (uint32_t*)offsetTexels, count);
+			break;
+		}
+	}
+#endif
+
+	switch (channelSize)
+	{
+	case 1:
+		if (toPlanes)
+			ndtf_planar_deinterleave_uint8_t(texels, planes, channels, done, end);
+		else
+			ndtf_planar_interleave_uint8_t(planes, texels, channels, done, end);
+		break;
+	case 2:
+		if (toPlanes)
+			ndtf_planar_deinterleave_uint16_t((const uint16_t*)texels, (uint16_t* const*)planes, channels, done, end);
+		else
+			ndtf_planar_interleave_uint16_t((uint16_t* const*)planes, (uint16_t*)texels, channels, done, end);
+		break;
+	case 4:
+		if (toPlanes)
+			ndtf_planar_deinterleave_uint32_t((const uint32_t*)texels, (uint32_t* const*)planes, channels, done, end);
+		else
+			ndtf_planar_interleave_uint32_t((uint32_t* const*)planes, (uint32_t*)texels, channels, done, end);
+		break;
+	}
+}
+
+typedef struct ndtf_PlanarConvert
+{
+	NDTF_TexelFormat format;
+	uint8_t* texels;
+	uint8_t* planes[NDTF_CHANNELS_RGBA];
+	size_t count;
+	bool toPlanes;
+} ndtf_PlanarConvert;
+
+static void ndtf_planar_convertTask(void* taskData, size_t index)
+{
+	const ndtf_PlanarConvert* convert = (const ndtf_PlanarConvert*)taskData;
+	size_t first = index * NDTF_PLANAR_CHUNK;
+	ndtf_planar_convert(convert->format, convert->texels, convert->planes, first, min(first + NDTF_PLANAR_CHUNK, convert->count), convert->toPlanes);
+}
+
+static void ndtf_planar_run(NDTF_TexelFormat texelFormat, uint8_t* texels, uint8_t* const planes[NDTF_CHANNELS_RGBA], size_t count, bool toPlanes, const NDTF_Context* ctx)
+{
+	ndtf_PlanarConvert convert;
+	convert.format = texelFormat;
+	convert.texels = texels;
+	memcpy(convert.planes, planes, sizeof(convert.planes));
+	convert.count = count;
+	convert.toPlanes = toPlanes;
+
+	NDTF_SCOPE_BEGIN(convertScope, ctx, NDTF_PHASE_CONVERT, toPlanes ? "deinterleave" : "interleave");
+	ndtf_parallelFor(ctx, ndtf_planar_convertTask, &convert, (count + NDTF_PLANAR_CHUNK - 1) / NDTF_PLANAR_CHUNK);
+	NDTF_SCOPE_END(convertScope, ctx, count * ndtf_getTexelSize(texelFormat));
+}
+
+static void ndtf_planar_contiguous(NDTF_TexelFormat texelFormat, uint8_t* planes, size_t count, uint8_t* pointers[NDTF_CHANNELS_RGBA])
+{
+	size_t channels = ndtf_getChannelCount(texelFormat);
+	size_t planeSize = count * ndtf_getChannelSize(texelFormat);
+	for (size_t c = 0; c < NDTF_CHANNELS_RGBA; c++)
+		pointers[c] = c < channels ? planes + c * planeSize : NULL;
+}
+
+void ndtf_planar_split(NDTF_TexelFormat texelFormat, const uint8_t* texels, uint8_t* planes, size_t count, const NDTF_Context* ctx)
+{
+	uint8_t* pointers[NDTF_CHANNELS_RGBA];
+	ndtf_planar_contiguous(texelFormat, planes, count, pointers);
+	ndtf_planar_run(texelFormat, (uint8_t*)texels, pointers, count, true, ctx);
+}
+
+void ndtf_planar_merge(NDTF_TexelFormat texelFormat, const uint8_t* planes, uint8_t* texels, size_t count, const NDTF_Context* ctx)
+{
+	uint8_t* pointers[NDTF_CHANNELS_RGBA];
+	ndtf_planar_contiguous(texelFormat, (uint8_t*)planes, count, pointers);
+	ndtf_planar_run(texelFormat, texels, pointers, count, false, ctx);
+}
+
+void ndtf_planar_extract(NDTF_TexelFormat texelFormat, int channel, const uint8_t* texels, uint8_t* values, size_t count)
+{
+	size_t channels = ndtf_getChannelCount(texelFormat);
+	size_t channelSize = ndtf_getChannelSize(texelFormat);
+	if (channels == 1)
+	{
+		memcpy(values, texels, count * channelSize);
+		return;
+	}
+
+	texels += (size_t)channel * channelSize;
+	switch (channelSize)
+	{
+	case 1:
+		for (size_t i = 0; i < count; i++)
+			values[i] = texels[i * channels];
+		break;
+	case 2:
+		for (size_t i = 0; i < count; i++)
+			memcpy(values + i * 2, texels + i * channels * 2, 2);
+		break;
+	case 4:
+		for (size_t i = 0; i < count; i++)
+			memcpy(values + i * 4, texels + i * channels * 4, 4);
+		break;
+	}
+}
+
+void ndtf_deinterleave(const void* texels, size_t count, NDTF_TexelFormat texelFormat, void* const planes[NDTF_CHANNELS_RGBA], const NDTF_Context* ctx)
+{
+	ndtf_planar_run(texelFormat, (uint8_t*)texels, (uint8_t* const*)planes, count, true, ctx);
+}
+
+void ndtf_interleave(const void* const planes[NDTF_CHANNELS_RGBA], size_t count, NDTF_TexelFormat texelFormat, void* texels, const NDTF_Context* ctx)
+{
+	ndtf_planar_run(texelFormat, (uint8_t*)texels, (uint8_t* const*)planes, count, false, ctx);
+}
+
+// single channel loading
+
+static NDTF_TexelFormat ndtf_planar_channelFormat(NDTF_TexelFormat texelFormat)
+{
+	switch (ndtf_getChannelSize(texelFormat))
+	{
+	case 1: return NDTF_TEXELFORMAT_R8;
+	case 2: return NDTF_TEXELFORMAT_R16;
+	case 4: return ndtf_getChannelIsFloat(texelFormat) ? NDTF_TEXELFORMAT_R32F : NDTF_TEXELFORMAT_R32;
+	default: return NDTF_TEXELFORMAT_NONE;
+	}
+}
+
+// the single channel file that receives channel of a file with header, its data is allocated
+static bool ndtf_planar_createChannel(const NDTF_Header* header, int channel, NDTF_File* result, const NDTF_Context* ctx)
+{
+	memset(result, 0, sizeof(NDTF_File));
+	NDTF_TexelFormat format = (NDTF_TexelFormat)header->texelFormat;
+	if (channel < 0 || (size_t)channel >= ndtf_getChannelCount(format) || ndtf_getIsBlockCompressed(format))
+		return false;
+
+	*result = ndtf_file_create_ND_ex((NDTF_Dimensions)header->dimensions, ndtf_planar_channelFormat(format), header->size, ctx);
+	if (!result->data)
+		return false;
+
+	result->header.version = header->version;
+	return true;
+}
+
+typedef struct ndtf_ChannelLoad
+{
+	NDTF_TexelFormat format;
+	int channel;
+	ndtf_Bricks bricks;		// of the single channel volume
+	uint8_t* volume;
+	const NDTF_Context* ctx;
+} ndtf_ChannelLoad;
+
+static bool ndtf_planar_channelBrick(void* user, const size_t origin[NDTF_DIMENSIONS_MAX], const size_t extent[NDTF_DIMENSIONS_MAX], const uint8_t* brick)
+{
+	const ndtf_ChannelLoad* load = (const ndtf_ChannelLoad*)user;
+
+	size_t texels = 1;
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+		texels *= extent[i];
+
+	if (ndtf_bricks_isContiguous(&load->bricks, extent))
+	{
+		ndtf_planar_extract(load->format, load->channel, brick, load->volume + ndtf_bricks_offset(&load->bricks, origin), texels);
+		return true;
+	}
+
+	uint8_t* values = (uint8_t*)ndtf_mem_alloc(load->ctx, texels * load->bricks.texelSize);
+	if (!values)
+		return false;
+	ndtf_planar_extract(load->format, load->channel, brick, values, texels);
+	ndtf_bricks_scatter(&load->bricks, load->volume, origin, extent, values);
+	ndtf_mem_free(load->ctx, values);
+	return true;
+}
+
+NDTF_File ndtf_file_loadChannelFromData(const uint8_t* data, size_t size, int channel, const NDTF_Context* ctx)
+{
+	NDTF_File result;
+	NDTF_Header header;
+	size_t headerSize = ndtf_header_decode(data, size, &header);
+	if (!headerSize || !ndtf_planar_createChannel(&header, channel, &result, ctx))
+	{
+		memset(&result, 0, sizeof(NDTF_File));
+		return result;
+	}
+
+	NDTF_TexelFormat format = (NDTF_TexelFormat)header.texelFormat;
+	size_t planeSize = ndtf_file_getDataSize(&result);
+
+	bool loaded;
+	if (!header.flags.segmented && header.flags.codec == NDTF_CODEC_NONE && !ndtf_lossy_enabled(&header))
+	{
+		// stored texels are used as they are
+		loaded = size - headerSize == planeSize * ndtf_getChannelCount(format);
+		if (loaded && ndtf_planar_enabled(&header))
+			memcpy(result.data, data + headerSize + (size_t)channel * planeSize, planeSize);
+		else if (loaded)
+			ndtf_planar_extract(format, channel, data + headerSize, result.data, planeSize / ndtf_getChannelSize(format));
+	}
+	else if (header.flags.segmented && ndtf_delta_axis(&header) < 0)
+	{
+		// bricks are decoded one at a time, only the channel is kept
+		ndtf_ChannelLoad load;
+		load.format = format;
+		load.channel = channel;
+		ndtf_bricks_init(&load.bricks, &result.header);
+		load.volume = result.data;
+		load.ctx = ctx;
+
+		NDTF_Segment* segments;
+		size_t count;
+		loaded = ndtf_segments_parse(&header, data, size, &segments, &count, ctx);
+		if (loaded)
+		{
+			loaded = ndtf_segments_decodeBricks(&header, segments, count, data, NULL, ndtf_planar_channelBrick, &load, ctx);
+			ndtf_mem_free(ctx, segments);
+		}
+	}
+	else
+	{
+		// statistics would cover every channel of the whole file, channels are loaded as they are stored
+		NDTF_Context wholeCtx;
+		memset(&wholeCtx, 0, sizeof(NDTF_Context));
+		if (ctx)
+			wholeCtx = *ctx;
+		wholeCtx.texelStats = NULL;
+		wholeCtx.transform = NULL;
+
+		NDTF_File whole = ndtf_file_loadFromData_ex((uint8_t*)data, size, NULL, NDTF_TEXELFORMAT_NONE, &wholeCtx);
+		loaded = ndtf_file_isValid(&whole);
+		if (loaded)
+			ndtf_planar_extract(format, channel, whole.data, result.data, planeSize / ndtf_getChannelSize(format));
+		ndtf_file_free_ex(&whole, ctx);
+	}
+
+	if (!loaded)
+	{
+		ndtf_file_free_ex(&result, ctx);
+		memset(&result, 0, sizeof(NDTF_File));
+	}
+	return result;
+}
+
+// reads values of one stored plane, seeking to each part
+static bool ndtf_planar_readPlane(FILE* file, uint64_t offset, uint8_t* out, size_t size, const NDTF_Context* ctx)
+{
+	if (ndtf_fseek64(file, (int64_t)offset, SEEK_SET) != 0)
+		return false;
+
+	NDTF_SCOPE_BEGIN(ioScope, ctx, NDTF_PHASE_IO, "fread");
+	size_t bytesRead = fread(out, 1, size, file);
+	NDTF_SCOPE_END(ioScope, ctx, bytesRead);
+
+	return bytesRead == size;
+}
+
+// planar files whose channel planes are stored uncompressed are read plane by plane, checksummed segments are read whole
+static bool ndtf_planar_readChannel(FILE* file, const NDTF_Header* header, int64_t fileSize, int channel, NDTF_File* result, const NDTF_Context* ctx)
+{
+	NDTF_TexelFormat format = (NDTF_TexelFormat)header->texelFormat;
+	size_t channels = ndtf_getChannelCount(format);
+	size_t planeSize = ndtf_file_getDataSize(result);
+	uint64_t headerSize = ndtf_header_storedSize(header);
+
+	if (!header->flags.segmented)
+		return (uint64_t)fileSize == headerSize + (uint64_t)planeSize * channels &&
+			ndtf_planar_readPlane(file, headerSize + (uint64_t)channel * planeSize, result->data, planeSize, ctx);
+
+	NDTF_SegmentTable table;
+	if (ndtf_fseek64(file, (int64_t)headerSize, SEEK_SET) != 0 ||
+		fread(&table, 1, sizeof(NDTF_SegmentTable), file) != sizeof(NDTF_SegmentTable) ||
+		table.count > (uint64_t)fileSize / sizeof(NDTF_Segment))
+		return false;
+
+	size_t entriesSize = ndtf_segments_tableSize(header, (size_t)table.count);
+	uint8_t* entries = (uint8_t*)ndtf_mem_alloc(ctx, max(entriesSize, 1));
+	if (!entries)
+		return false;
+
+	NDTF_Segment* segments = NULL;
+	bool valid = fread(entries, 1, entriesSize, file) == entriesSize &&
+		ndtf_segments_validate(header, &table, entries, (uint64_t)fileSize, &segments, ctx);
+	ndtf_mem_free(ctx, entries);
+	if (!valid)
+		return false;
+
+	ndtf_Bricks bricks;
+	ndtf_bricks_init(&bricks, &result->header);
+
+	size_t origin[NDTF_DIMENSIONS_MAX];
+	size_t extent[NDTF_DIMENSIONS_MAX];
+	for (size_t i = 0; i < bricks.count && valid; i++)
+	{
+		size_t brickPlane = ndtf_bricks_get(&bricks, i, origin, extent);
+		valid = segments[i].codec == NDTF_CODEC_NONE && segments[i].size == (uint64_t)brickPlane * channels;
+	}
+
+	uint8_t* values = NULL;
+	for (size_t i = 0; i < bricks.count && valid; i++)
+	{
+		size_t brickPlane = ndtf_bricks_get(&bricks, i, origin, extent);
+
+		bool contiguous = ndtf_bricks_isContiguous(&bricks, extent);
+		if (!contiguous && !values)
+		{
+			values = (uint8_t*)ndtf_mem_alloc(ctx, brickPlane);
+			valid = values != NULL;
+		}
+
+		uint8_t* out = contiguous ? result->data + ndtf_bricks_offset(&bricks, origin) : values;
+		valid = valid && ndtf_planar_readPlane(file, segments[i].offset + (uint64_t)channel * brickPlane, out, brickPlane, ctx);
+		if (valid && !contiguous)
+			ndtf_bricks_scatter(&bricks, result->data, origin, extent, values);
+	}
+
+	// planes of delta encoded files hold differences like the whole texels, they are summed up per channel
+	if (valid)
+	{
+		NDTF_Header channelHeader = *header;
+		channelHeader.texelFormat = result->header.texelFormat;
+		ndtf_delta_undo(&channelHeader, result->data, ctx);
+	}
+
+	ndtf_mem_free(ctx, values);
+	ndtf_mem_free(ctx, segments);
+	return valid;
+}
+
+static bool ndtf_planar_isReadable(const NDTF_Header* header)
+{
+	if (!ndtf_planar_enabled(header) || header->flags.checksums)
+		return false;
+	return header->flags.segmented || header->flags.codec == NDTF_CODEC_NONE;
+}
+
+NDTF_File ndtf_file_loadChannelFromFile(FILE* file, int channel, const NDTF_Context* ctx)
+{
+	NDTF_File result;
+	memset(&result, 0, sizeof(NDTF_File));
+
+	NDTF_Header header;
+	if (!file || ndtf_fseek64(file, 0, SEEK_END) != 0)
+		return result;
+	int64_t fileSize = ndtf_ftell64(file);
+	if (fileSize < 0 || (uint64_t)fileSize > SIZE_MAX || ndtf_fseek64(file, 0, SEEK_SET) != 0 || !ndtf_header_read(file, &header))
+		return result;
+
+	if (ndtf_planar_isReadable(&header))
+	{
+		if (!ndtf_planar_createChannel(&header, channel, &result, ctx))
+			return result;
+		if (ndtf_planar_readChannel(file, &header, fileSize, channel, &result, ctx))
+			return result;
+
+		// segments that are stored compressed are decoded with the rest of the file
+		ndtf_file_free_ex(&result, ctx);
+		memset(&result, 0, sizeof(NDTF_File));
+	}
+
+	uint8_t* data = (uint8_t*)ndtf_mem_alloc(ctx, max((size_t)fileSize, 1));
+	if (!data)
+		return result;
+
+	NDTF_SCOPE_BEGIN(ioScope, ctx, NDTF_PHASE_IO, "fread");
+	size_t bytesRead = ndtf_fseek64(file, 0, SEEK_SET) == 0 ? fread(data, 1, (size_t)fileSize, file) : 0;
+	NDTF_SCOPE_END(ioScope, ctx, bytesRead);
+
+	if (bytesRead == (size_t)fileSize)
+		result = ndtf_file_loadChannelFromData(data, (size_t)fileSize, channel, ctx);
+	ndtf_mem_free(ctx, data);
+
+	return result;
+}
+
+NDTF_File ndtf_file_loadChannel(const char* filename, int channel, const NDTF_Context* ctx)
+{
+	NDTF_File result;
+
+	FILE* file = fopen(filename, "rb");
+	if (file != NULL)
+	{
+		result = ndtf_file_loadChannelFromFile(file, channel, ctx);
+		fclose(file);
+	}
+	else
+		memset(&result, 0, sizeof(NDTF_File));
+
+	return result;
+}
@@ -0,0 +1,372 @@
+#include "ndtf_internal.h"
+#include <string.h>
+
+// playback: the frames from the current one on are handed to background threads in order, each into a free buffer of
+// the ring. a seek bumps the generation, frames of older generations are dropped when their read returns and reads
+// check it between slabs of bricks, so they stop early
+
+#define NDTF_PLAYBACK_PREFETCH 3
+#define NDTF_PLAYBACK_ALIGN ((size_t)64)
+
+typedef enum ndtf_SlotState
+{
+	NDTF_SLOT_FREE = 0,
+	NDTF_SLOT_READING,
+	NDTF_SLOT_READY,
+	NDTF_SLOT_FAILED,
+	NDTF_SLOT_HELD,
+} ndtf_SlotState;
+
+typedef struct ndtf_PlaybackSlot
+{
+	uint8_t* texels;
+	uint64_t sequence;		// position in the playback, the frame is sequence % frameCount
+	uint64_t generation;
+	ndtf_SlotState state;
+} ndtf_PlaybackSlot;
+
+struct NDTF_Playback
+{
+	NDTF_Reader* reader;
+	int axis;
+	int outer;				// outermost other axis with more than one texel, -1 = none
+	size_t slab;			// texels along outer read at once, a brick row
+	size_t slabBytes;		// bytes of one texel along outer
+	uint64_t frameCount;
+	size_t frameSize;
+	bool loop;
+
+	ndtf_PlaybackSlot* slots;
+	size_t slotCount;
+	size_t held;
+	uint8_t* buffers;
+
+	ndtf_Mutex mutex;
+	ndtf_Cond work;			// a slot became free or the playback closes
+	ndtf_Cond ready;		// a slot was read
+	uint64_t cursor;		// sequence of the next acquired frame
+	uint64_t next;			// sequence of the next frame read
+	volatile uint64_t generation;
+	bool closing;
+
+	ndtf_Thread* threads;
+	size_t threadCount;
+
+	NDTF_Context context;
+	const NDTF_Context* ctx;
+};
+
+// one frame in slabs along the outer axis, false when it failed or went stale
+static bool ndtf_playback_read(NDTF_Playback* playback, ndtf_ReaderScratch* scratch, uint64_t frame, uint64_t generation, uint8_t* out)
+{
+	const NDTF_Header* header = ndtf_reader_getHeader(playback->reader);
+
+	uint32_t origin[NDTF_DIMENSIONS_MAX];
+	uint32_t extent[NDTF_DIMENSIONS_MAX];
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+	{
+		origin[i] = 0;
+		extent[i] = i < header->dimensions ? max(header->size[i], 1) : 1;
+	}
+	origin[playback->axis] = (uint32_t)frame;
+	extent[playback->axis] = 1;
+
+	if (playback->outer < 0)
+		return ndtf_reader_readRegionWith(playback->reader, scratch, origin, extent, out);
+
+	size_t size = extent[playback->outer];
+	for (size_t first = 0; first < size; first += playback->slab)
+	{
+		if (ndtf_atomic_load_u64(&playback->generation) != generation)
+			return false;
+
+		origin[playback->outer] = (uint32_t)first;
+		extent[playback->outer] = (uint32_t)min(size - first, playback->slab);
+		if (!ndtf_reader_readRegionWith(playback->reader, scratch, origin, extent, out + first * playback->slabBytes))
+			return false;
+	}
+	return true;
+}
+
+// claims a free slot for the next frame. playback->mutex must be held
+static ndtf_PlaybackSlot* ndtf_playback_schedule(NDTF_Playback* playback)
+{
+	if (!playback->loop && playback->next >= playback->frameCount)
+		return NULL;
+
+	for (size_t i = 0; i < playback->slotCount; i++)
+	{
+		ndtf_PlaybackSlot* slot = &playback->slots[i];
+		if (slot->state != NDTF_SLOT_FREE)
+			continue;
+
+		slot->sequence = playback->next++;
+		slot->generation = playback->generation;
+		slot->state = NDTF_SLOT_READING;
+		return slot;
+	}
+	return NULL;
+}
+
+// every worker keeps the same reader scratch, so frames are read without allocating
+static void ndtf_playback_worker(void* arg)
+{
+	NDTF_Playback* playback = (NDTF_Playback*)arg;
+	ndtf_ReaderScratch* scratch = ndtf_reader_acquire(playback->reader);
+
+	ndtf_mutex_lock(&playback->mutex);
+	while (!playback->closing)
+	{
+		ndtf_PlaybackSlot* slot = ndtf_playback_schedule(playback);
+		if (!slot)
+		{
+			ndtf_cond_wait(&playback->work, &playback->mutex);
+			continue;
+		}
+
+		uint64_t generation = slot->generation;
+		uint64_t frame = slot->sequence % playback->frameCount;
+		ndtf_mutex_unlock(&playback->mutex);
+		bool result = ndtf_playback_read(playback, scratch, frame, generation, slot->texels);
+		ndtf_mutex_lock(&playback->mutex);
+
+		if (slot->generation != playback->generation)
+		{
+			slot->state = NDTF_SLOT_FREE;
+			continue;
+		}
+		slot->state = result ? NDTF_SLOT_READY : NDTF_SLOT_FAILED;
+		ndtf_cond_broadcast(&playback->ready);
+	}
+	ndtf_mutex_unlock(&playback->mutex);
+
+	if (scratch)
+		ndtf_reader_release(playback->reader, scratch);
+}
+
+NDTF_Playback* ndtf_playback_open(const char* filename, const NDTF_PlaybackOptions* options, const NDTF_Context* ctx)
+{
+	NDTF_Playback* playback = (NDTF_Playback*)ndtf_mem_alloc(ctx, sizeof(NDTF_Playback));
+	if (!playback)
+		return NULL;
+
+	memset(playback, 0, sizeof(NDTF_Playback));
+	if (ctx)
+	{
+		playback->context = *ctx;
+		playback->context.texelStats = NULL;
+		playback->ctx = &playback->context;
+	}
+	ndtf_mutex_init(&playback->mutex);
+	ndtf_cond_init(&playback->work);
+	ndtf_cond_init(&playback->ready);
+
+	playback->reader = ndtf_reader_open(filename, playback->ctx);
+	if (!playback->reader)
+	{
+		ndtf_playback_close(playback);
+		return NULL;
+	}
+
+	const NDTF_Header* header = ndtf_reader_getHeader(playback->reader);
+	playback->axis = options ? options->axis : header->dimensions - 1;
+	playback->loop = options && options->loop;
+	if (playback->axis < 0 || playback->axis >= header->dimensions)
+	{
+		ndtf_playback_close(playback);
+		return NULL;
+	}
+
+	ndtf_Bricks bricks;
+	ndtf_bricks_init(&bricks, header);
+	playback->frameCount = bricks.size[playback->axis];
+
+	bool valid = true;
+	playback->outer = -1;
+	playback->frameSize = bricks.texelSize;
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+	{
+		if (i == playback->axis)
+			continue;
+		if (bricks.size[i] > 1)
+			playback->outer = i;
+		valid = valid && ndtf_size_mul(playback->frameSize, bricks.size[i], &playback->frameSize);
+	}
+	if (playback->outer >= 0)
+	{
+		playback->slab = bricks.extent[playback->outer];
+		playback->slabBytes = playback->frameSize / bricks.size[playback->outer];
+	}
+
+	uint32_t prefetch = options && options->prefetch ? options->prefetch : NDTF_PLAYBACK_PREFETCH;
+	playback->slotCount = (size_t)prefetch + 1;
+
+	size_t stride = 0, buffersSize = 0;
+	valid = valid && ndtf_size_add(playback->frameSize, NDTF_PLAYBACK_ALIGN - 1, &stride);
+	stride &= ~(NDTF_PLAYBACK_ALIGN - 1);
+	valid = valid && ndtf_size_mul(stride, playback->slotCount, &buffersSize);
+	if (valid)
+	{
+		playback->buffers = (uint8_t*)ndtf_mem_alloc(playback->ctx, max(buffersSize, 1));
+		playback->slots = (ndtf_PlaybackSlot*)ndtf_mem_alloc(playback->ctx, playback->slotCount * sizeof(ndtf_PlaybackSlot));
+	}
+
+	size_t threads = options && options->threads ? options->threads : min((size_t)prefetch, ndtf_getHardwareConcurrency());
+	playback->threads = (ndtf_Thread*)ndtf_mem_alloc(playback->ctx, max(threads, 1) * sizeof(ndtf_Thread));
+	if (!playback->buffers || !playback->slots || !playback->threads)
+	{
+		ndtf_playback_close(playback);
+		return NULL;
+	}
+
+	memset(playback->slots, 0, playback->slotCount * sizeof(ndtf_PlaybackSlot));
+	for (size_t i = 0; i < playback->slotCount; i++)
+		playback->slots[i].texels = playback->buffers + i * stride;
+
+	for (size_t i = 0; i < threads; i++)
+	{
+		if (!ndtf_thread_create(&playback->threads[playback->threadCount], ndtf_playback_worker, playback))
+			break;
+		playback->threadCount++;
+	}
+	if (playback->threadCount == 0)
+	{
+		ndtf_playback_close(playback);
+		return NULL;
+	}
+	return playback;
+}
+
+void ndtf_playback_close(NDTF_Playback* playback)
+{
+	if (!playback)
+		return;
+
+	ndtf_mutex_lock(&playback->mutex);
+	playback->closing = true;
+	ndtf_atomic_store_u64(&playback->generation, playback->generation + 1);
+	ndtf_cond_broadcast(&playback->work);
+	ndtf_mutex_unlock(&playback->mutex);
+
+	for (size_t i = 0; i < playback->threadCount; i++)
+		ndtf_thread_join(&playback->threads[i]);
+
+	// the playback holds the context copy it was allocated with
+	NDTF_Context context = playback->context;
+	const NDTF_Context* ctx = playback->ctx ? &context : NULL;
+
+	ndtf_reader_close(playback->reader);
+	ndtf_mem_free(ctx, playback->threads);
+	ndtf_mem_free(ctx, playback->slots);
+	ndtf_mem_free(ctx, playback->buffers);
+	ndtf_cond_destroy(&playback->ready);
+	ndtf_cond_destroy(&playback->work);
+	ndtf_mutex_destroy(&playback->mutex);
+	ndtf_mem_free(ctx, playback);
+}
+
+const NDTF_Header* ndtf_playback_getHeader(const NDTF_Playback* playback)
+{
+	return ndtf_reader_getHeader(playback->reader);
+}
+
+uint64_t ndtf_playback_getFrameCount(const NDTF_Playback* playback)
+{
+	return playback->frameCount;
+}
+
+size_t ndtf_playback_getFrameSize(const NDTF_Playback* playback)
+{
+	return playback->frameSize;
+}
+
+NDTF_PlaybackStatus ndtf_playback_acquire(NDTF_Playback* playback, NDTF_Frame* frame, bool wait)
+{
+	if (!playback || !frame)
+		return NDTF_PLAYBACK_ERROR;
+
+	NDTF_PlaybackStatus status = NDTF_PLAYBACK_PENDING;
+	ndtf_mutex_lock(&playback->mutex);
+	for (;;)
+	{
+		if (!playback->loop && playback->cursor >= playback->frameCount)
+		{
+			status = NDTF_PLAYBACK_END;
+			break;
+		}
+
+		ndtf_PlaybackSlot* slot = NULL;
+		for (size_t i = 0; i < playback->slotCount && !slot; i++)
+		{
+			ndtf_PlaybackSlot* candidate = &playback->slots[i];
+			if ((candidate->state == NDTF_SLOT_READY || candidate->state == NDTF_SLOT_FAILED) && candidate->sequence == playback->cursor)
+				slot = candidate;
+		}
+
+		if (slot)
+		{
+			playback->cursor++;
+			if (slot->state == NDTF_SLOT_FAILED)
+			{
+				slot->state = NDTF_SLOT_FREE;
+				ndtf_cond_signal(&playback->work);
+				status = NDTF_PLAYBACK_ERROR;
+				break;
+			}
+
+			slot->state = NDTF_SLOT_HELD;
+			playback->held++;
+			frame->texels = slot->texels;
+			frame->index = slot->sequence % playback->frameCount;
+			status = NDTF_PLAYBACK_READY;
+			break;
+		}
+
+		// with every buffer held the frame is never read
+		if (!wait || playback->held == playback->slotCount)
+			break;
+		ndtf_cond_wait(&playback->ready, &playback->mutex);
+	}
+	ndtf_mutex_unlock(&playback->mutex);
+	return status;
+}
+
+void ndtf_playback_release(NDTF_Playback* playback, const NDTF_Frame* frame)
+{
+	if (!playback || !frame)
+		return;
+
+	ndtf_mutex_lock(&playback->mutex);
+	for (size_t i = 0; i < playback->slotCount; i++)
+	{
+		ndtf_PlaybackSlot* slot = &playback->slots[i];
+		if (slot->state == NDTF_SLOT_HELD && slot->texels == frame->texels)
+		{
+			slot->state = NDTF_SLOT_FREE;
+			playback->held--;
+			ndtf_cond_signal(&playback->work);
+			break;
+		}
+	}
+	ndtf_mutex_unlock(&playback->mutex);
+}
+
+bool ndtf_playback_seek(NDTF_Playback* playback, uint64_t index)
+{
+	if (!playback || index >= playback->frameCount)
+		return false;
+
+	ndtf_mutex_lock(&playback->mutex);
+	ndtf_atomic_store_u64(&playback->generation, playback->generation + 1);
+	playback->cursor = index;
+	playback->next = index;
+	for (size_t i = 0; i < playback->slotCount; i++)
+	{
+		ndtf_PlaybackSlot* slot = &playback->slots[i];
+		if (slot->state == NDTF_SLOT_READY || slot->state == NDTF_SLOT_FAILED)
+			slot->state = NDTF_SLOT_FREE;
+	}
+	ndtf_cond_broadcast(&playback->work);
+	ndtf_mutex_unlock(&playback->mutex);
+	return true;
+}
@@ -0,0 +1,554 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+	#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "ndtf_internal.h"
+#include <string.h>
+
+#ifndef _WIN32
+	#include <errno.h>
+	#include <fcntl.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+// concurrent reader: every read names its file offset, so threads never share a file position. the scratch
+// buffers of a read are taken from a pool and handed back afterwards, so a thread reuses them across reads. threads
+// reading continuously hold one for as long as they run
+
+#define NDTF_READER_CHUNK ((size_t)1 << 16) // texels per channel read of planar files that are not segmented
+#define NDTF_READER_ALIGN ((size_t)64)
+
+struct ndtf_ReaderScratch
+{
+	uint8_t* stored;		// stored bytes of the largest segment
+	uint8_t* bricks[2];		// decoded brick and, for delta files, the brick of the slice before
+	uint8_t* planes;		// compressed planes of a brick or channel runs of a payload
+	ndtf_DecodeScratch decode;	// decompressor and lossy symbols kept between bricks, decode.planes is planes
+	struct ndtf_ReaderScratch* next;
+};
+
+struct NDTF_Reader
+{
+#ifdef _WIN32
+	HANDLE file;
+#else
+	int file;
+#endif
+	NDTF_Header header;
+	size_t headerSize;
+	ndtf_Bricks bricks;
+	NDTF_Segment* segments;	// segmented files
+	uint8_t* volume;		// a single compressed payload, decoded when opening
+	int deltaAxis;
+	bool planar;
+
+	size_t storedMax;
+	size_t brickMax;
+	size_t planesSize;
+
+	ndtf_Mutex mutex;
+	ndtf_ReaderScratch* scratch;	// free list
+
+	NDTF_Context context;
+	const NDTF_Context* ctx;
+};
+
+static bool ndtf_reader_pread(NDTF_Reader* reader, void* dst, size_t size, uint64_t offset)
+{
+	NDTF_SCOPE_BEGIN(ioScope, reader->ctx, NDTF_PHASE_IO, "pread");
+
+	uint8_t* out = (uint8_t*)dst;
+	size_t done = 0;
+	while (done < size)
+	{
+#ifdef _WIN32
+		DWORD chunk = (DWORD)min(size - done, (size_t)1 << 30);
+		uint64_t position = offset + done;
+		OVERLAPPED overlapped;
+		memset(&overlapped, 0, sizeof(OVERLAPPED));
+		overlapped.Offset = (DWORD)position;
+		overlapped.OffsetHigh = (DWORD)(position >> 32);
+		DWORD read = 0;
+		if (!ReadFile(reader->file, out + done, chunk, &read, &overlapped) || read == 0)
+			break;
+#else
+		ssize_t read = pread(reader->file, out + done, size - done, (off_t)(offset + done));
+		if (read < 0 && errno == EINTR)
+			continue;
+		if (read <= 0)
+			break;
+#endif
+		done += (size_t)read;
+	}
+
+	NDTF_SCOPE_END(ioScope, reader->ctx, done);
+	return done == size;
+}
+
+ndtf_ReaderScratch* ndtf_reader_acquire(NDTF_Reader* reader)
+{
+	ndtf_mutex_lock(&reader->mutex);
+	ndtf_ReaderScratch* scratch = reader->scratch;
+	if (scratch)
+		reader->scratch = scratch->next;
+	ndtf_mutex_unlock(&reader->mutex);
+
+	if (scratch)
+		return scratch;
+
+	// one block: the scratch itself followed by its buffers
+	size_t head = (sizeof(ndtf_ReaderScratch) + NDTF_READER_ALIGN - 1) & ~(NDTF_READER_ALIGN - 1);
+	size_t stored = (reader->storedMax + NDTF_READER_ALIGN - 1) & ~(NDTF_READER_ALIGN - 1);
+	size_t brick = (reader->brickMax + NDTF_READER_ALIGN - 1) & ~(NDTF_READER_ALIGN - 1);
+	size_t bricks = reader->deltaAxis >= 0 ? 2 : 1;
+
+	uint8_t* block = (uint8_t*)ndtf_mem_alloc(reader->ctx, head + stored + brick * bricks + reader->planesSize);
+	if (!block)
+		return NULL;
+
+	scratch = (ndtf_ReaderScratch*)block;
+	scratch->stored = block + head;
+	scratch->bricks[0] = scratch->stored + stored;
+	scratch->bricks[1] = bricks > 1 ? scratch->bricks[0] + brick : NULL;
+	scratch->planes = scratch->bricks[0] + brick * bricks;
+	memset(&scratch->decode, 0, sizeof(ndtf_DecodeScratch));
+	scratch->decode.planes = reader->planar ? scratch->planes : NULL;
+	scratch->next = NULL;
+	return scratch;
+}
+
+void ndtf_reader_release(NDTF_Reader* reader, ndtf_ReaderScratch* scratch)
+{
+	ndtf_mutex_lock(&reader->mutex);
+	scratch->next = reader->scratch;
+	reader->scratch = scratch;
+	ndtf_mutex_unlock(&reader->mutex);
+}
+
+static bool ndtf_reader_openSegments(NDTF_Reader* reader, uint64_t fileSize)
+{
+	NDTF_SegmentTable table;
+	if (!ndtf_reader_pread(reader, &table, sizeof(NDTF_SegmentTable), reader->headerSize) ||
+		table.count > fileSize / sizeof(NDTF_Segment))
+		return false;
+
+	size_t entriesSize = ndtf_segments_tableSize(&reader->header, (size_t)table.count);
+	uint8_t* entries = (uint8_t*)ndtf_mem_alloc(reader->ctx, max(entriesSize, 1));
+	if (!entries)
+		return false;
+
+	bool valid = ndtf_reader_pread(reader, entries, entriesSize, reader->headerSize + sizeof(NDTF_SegmentTable)) &&
+		ndtf_segments_validate(&reader->header, &table, entries, fileSize, &reader->segments, reader->ctx);
+	ndtf_mem_free(reader->ctx, entries);
+	if (!valid)
+		return false;
+
+	for (size_t i = 0; i < reader->bricks.count; i++)
+	{
+		if (reader->segments[i].size > SIZE_MAX)
+			return false;
+		reader->storedMax = max(reader->storedMax, (size_t)reader->segments[i].size);
+	}
+
+	reader->brickMax = reader->bricks.texelSize;
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+	{
+		if (!ndtf_size_mul(reader->brickMax, reader->bricks.extent[i], &reader->brickMax))
+			return false;
+	}
+	reader->planesSize = reader->planar ? reader->brickMax : 0;
+	return true;
+}
+
+static bool ndtf_reader_openPayload(NDTF_Reader* reader, uint64_t fileSize)
+{
+	size_t dataSize;
+	if (!ndtf_header_getDataSize(&reader->header, &dataSize))
+		return false;
+
+	uint64_t payloadSize = fileSize - reader->headerSize;
+	if (reader->header.flags.codec == NDTF_CODEC_NONE && !ndtf_lossy_enabled(&reader->header))
+	{
+		// read in place
+		if (payloadSize < dataSize)
+			return false;
+		reader->planesSize = reader->planar ? NDTF_READER_CHUNK * reader->bricks.texelSize : 0;
+		return true;
+	}
+
+	if (payloadSize > SIZE_MAX)
+		return false;
+
+	uint8_t* payload = (uint8_t*)ndtf_mem_alloc(reader->ctx, max((size_t)payloadSize, 1));
+	reader->volume = (uint8_t*)ndtf_mem_alloc(reader->ctx, max(dataSize, 1));
+	bool result = payload && reader->volume &&
+		ndtf_reader_pread(reader, payload, (size_t)payloadSize, reader->headerSize) &&
+		ndtf_payload_decode(&reader->header, payload, (size_t)payloadSize, reader->volume, NULL, reader->ctx);
+	ndtf_mem_free(reader->ctx, payload);
+	return result;
+}
+
+NDTF_Reader* ndtf_reader_open(const char* filename, const NDTF_Context* ctx)
+{
+	NDTF_Reader* reader = (NDTF_Reader*)ndtf_mem_alloc(ctx, sizeof(NDTF_Reader));
+	if (!reader)
+		return NULL;
+
+	memset(reader, 0, sizeof(NDTF_Reader));
+#ifdef _WIN32
+	reader->file = INVALID_HANDLE_VALUE;
+#else
+	reader->file = -1;
+#endif
+	if (ctx)
+	{
+		reader->context = *ctx;
+		reader->context.texelStats = NULL;
+		reader->ctx = &reader->context;
+	}
+	ndtf_mutex_init(&reader->mutex);
+
+	uint64_t fileSize = 0;
+#ifdef _WIN32
+	reader->file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	LARGE_INTEGER size;
+	bool opened = reader->file != INVALID_HANDLE_VALUE && GetFileSizeEx(reader->file, &size);
+	if (opened)
+		fileSize = (uint64_t)size.QuadPart;
+#else
+	reader->file = open(filename, O_RDONLY | O_CLOEXEC);
+	struct stat info;
+	bool opened = reader->file >= 0 && fstat(reader->file, &info) == 0;
+	if (opened)
+		fileSize = (uint64_t)info.st_size;
+#endif
+	if (!opened)
+	{
+		ndtf_reader_close(reader);
+		return NULL;
+	}
+
+	NDTF_SCOPE_BEGIN(headerScope, reader->ctx, NDTF_PHASE_HEADER, "header");
+	uint8_t stored[sizeof(NDTF_Header)];
+	size_t storedSize = (size_t)min(fileSize, (uint64_t)sizeof(NDTF_Header));
+	reader->headerSize = ndtf_reader_pread(reader, stored, storedSize, 0) ? ndtf_header_decode(stored, storedSize, &reader->header) : 0;
+	NDTF_SCOPE_END(headerScope, reader->ctx, reader->headerSize);
+
+	if (!reader->headerSize || ndtf_getIsBlockCompressed((NDTF_TexelFormat)reader->header.texelFormat))
+	{
+		ndtf_reader_close(reader);
+		return NULL;
+	}
+
+	ndtf_bricks_init(&reader->bricks, &reader->header);
+	reader->deltaAxis = ndtf_delta_axis(&reader->header);
+	reader->planar = ndtf_planar_enabled(&reader->header);
+
+	bool result = reader->header.flags.segmented ? ndtf_reader_openSegments(reader, fileSize) : ndtf_reader_openPayload(reader, fileSize);
+	if (!result)
+	{
+		ndtf_reader_close(reader);
+		return NULL;
+	}
+	return reader;
+}
+
+void ndtf_reader_close(NDTF_Reader* reader)
+{
+	if (!reader)
+		return;
+
+	// the reader holds the context copy it was allocated with
+	NDTF_Context context = reader->context;
+	const NDTF_Context* ctx = reader->ctx ? &context : NULL;
+
+	while (reader->scratch)
+	{
+		ndtf_ReaderScratch* next = reader->scratch->next;
+		ndtf_decodeScratch_free(&reader->scratch->decode, ctx);
+		ndtf_mem_free(ctx, reader->scratch);
+		reader->scratch = next;
+	}
+
+#ifdef _WIN32
+	if (reader->file != INVALID_HANDLE_VALUE)
+		CloseHandle(reader->file);
+#else
+	if (reader->file >= 0)
+		close(reader->file);
+#endif
+
+	ndtf_mem_free(ctx, reader->segments);
+	ndtf_mem_free(ctx, reader->volume);
+	ndtf_mutex_destroy(&reader->mutex);
+	ndtf_mem_free(ctx, reader);
+}
+
+const NDTF_Header* ndtf_reader_getHeader(const NDTF_Reader* reader)
+{
+	return &reader->header;
+}
+
+size_t ndtf_reader_getBrickCount(const NDTF_Reader* reader)
+{
+	return reader->header.flags.segmented ? reader->bricks.count : 1;
+}
+
+// copies the overlap [low, high) of two packed boxes
+static void ndtf_reader_copyBox(const uint8_t* src, const size_t srcOrigin[NDTF_DIMENSIONS_MAX], const size_t srcExtent[NDTF_DIMENSIONS_MAX],
+	uint8_t* dst, const size_t dstOrigin[NDTF_DIMENSIONS_MAX], const size_t dstExtent[NDTF_DIMENSIONS_MAX],
+	const size_t low[NDTF_DIMENSIONS_MAX], const size_t high[NDTF_DIMENSIONS_MAX], size_t texelSize)
+{
+	size_t rowBytes = (high[0] - low[0]) * texelSize;
+	size_t pos[NDTF_DIMENSIONS_MAX];
+	memcpy(pos, low, sizeof(pos));
+
+	for (;;)
+	{
+		size_t srcIndex = 0, dstIndex = 0;
+		for (int i = NDTF_DIMENSIONS_MAX - 1; i >= 0; i--)
+		{
+			srcIndex = srcIndex * srcExtent[i] + pos[i] - srcOrigin[i];
+			dstIndex = dstIndex * dstExtent[i] + pos[i] - dstOrigin[i];
+		}
+		memcpy(dst + dstIndex * texelSize, src + srcIndex * texelSize, rowBytes);
+
+		int i = 1;
+		for (; i < NDTF_DIMENSIONS_MAX; i++)
+		{
+			if (++pos[i] < high[i])
+				break;
+			pos[i] = low[i];
+		}
+		if (i == NDTF_DIMENSIONS_MAX)
+			return;
+	}
+}
+
+// count texels starting at texel index first of a payload that is read in place
+static bool ndtf_reader_readRun(NDTF_Reader* reader, ndtf_ReaderScratch* scratch, size_t first, size_t count, uint8_t* out)
+{
+	size_t texelSize = reader->bricks.texelSize;
+	if (!reader->planar)
+		return ndtf_reader_pread(reader, out, count * texelSize, reader->headerSize + (uint64_t)first * texelSize);
+
+	NDTF_TexelFormat texelFormat = (NDTF_TexelFormat)reader->header.texelFormat;
+	size_t channels = ndtf_getChannelCount(texelFormat);
+	size_t channelSize = ndtf_getChannelSize(texelFormat);
+	uint64_t planeBytes = channelSize;
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+		planeBytes *= reader->bricks.size[i];
+
+	for (size_t done = 0; done < count; done += NDTF_READER_CHUNK)
+	{
+		size_t chunk = min(count - done, NDTF_READER_CHUNK);
+		for (size_t c = 0; c < channels; c++)
+		{
+			uint64_t offset = reader->headerSize + planeBytes * c + (uint64_t)(first + done) * channelSize;
+			if (!ndtf_reader_pread(reader, scratch->planes + c * chunk * channelSize, chunk * channelSize, offset))
+				return false;
+		}
+		ndtf_planar_merge(texelFormat, scratch->planes, out + done * texelSize, chunk, reader->ctx);
+	}
+	return true;
+}
+
+// region of a file that is not segmented, in runs of texels that are contiguous in the volume and the region
+static bool ndtf_reader_readPayload(NDTF_Reader* reader, ndtf_ReaderScratch* scratch, const size_t origin[NDTF_DIMENSIONS_MAX], const size_t extent[NDTF_DIMENSIONS_MAX], uint8_t* out)
+{
+	const size_t* size = reader->bricks.size;
+	size_t texelSize = reader->bricks.texelSize;
+
+	size_t run = extent[0];
+	int inner = 1;
+	while (inner < NDTF_DIMENSIONS_MAX && extent[inner - 1] == size[inner - 1])
+		run *= extent[inner++];
+
+	size_t pos[NDTF_DIMENSIONS_MAX];
+	memcpy(pos, origin, sizeof(pos));
+
+	for (;;)
+	{
+		size_t first = 0;
+		for (int i = NDTF_DIMENSIONS_MAX - 1; i >= 0; i--)
+			first = first * size[i] + pos[i];
+
+		if (reader->volume)
+			memcpy(out, reader->volume + first * texelSize, run * texelSize);
+		else if (!ndtf_reader_readRun(reader, scratch, first, run, out))
+			return false;
+		out += run * texelSize;
+
+		int i = inner;
+		for (; i < NDTF_DIMENSIONS_MAX; i++)
+		{
+			if (++pos[i] < origin[i] + extent[i])
+				break;
+			pos[i] = origin[i];
+		}
+		if (i >= NDTF_DIMENSIONS_MAX)
+			return true;
+	}
+}
+
+static bool ndtf_reader_decodeBrick(NDTF_Reader* reader, ndtf_ReaderScratch* scratch, size_t index, uint8_t* out, size_t brickSize, const size_t extent[NDTF_DIMENSIONS_MAX])
+{
+	const NDTF_Segment* segment = &reader->segments[index];
+	size_t storedSize = (size_t)segment->size;
+
+	// raw texels are read straight into the brick
+	if (segment->codec == NDTF_CODEC_NONE && !reader->planar && !ndtf_lossy_enabled(&reader->header))
+	{
+		return storedSize == brickSize && ndtf_reader_pread(reader, out, brickSize, segment->offset) &&
+			(!reader->header.flags.checksums || ndtf_crc32c(0, out, brickSize) == segment->checksum);
+	}
+
+	if (!ndtf_reader_pread(reader, scratch->stored, storedSize, segment->offset))
+		return false;
+	if (reader->header.flags.checksums && ndtf_crc32c(0, scratch->stored, storedSize) != segment->checksum)
+		return false;
+	return ndtf_segment_decode(&reader->header, segment, scratch->stored, out, brickSize, extent, &scratch->decode, reader->ctx);
+}
+
+// decodes every brick overlapping the region. delta encoded bricks are accumulated along the axis from the
+// keyframe before the region, one column of bricks at a time
+static bool ndtf_reader_readBricks(NDTF_Reader* reader, ndtf_ReaderScratch* scratch, const size_t origin[NDTF_DIMENSIONS_MAX], const size_t extent[NDTF_DIMENSIONS_MAX], uint8_t* out)
+{
+	const ndtf_Bricks* bricks = &reader->bricks;
+	int axis = reader->deltaAxis;
+
+	size_t first[NDTF_DIMENSIONS_MAX], last[NDTF_DIMENSIONS_MAX];
+	size_t columns = 1;
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+	{
+		first[i] = origin[i] / bricks->extent[i];
+		last[i] = (origin[i] + extent[i] - 1) / bricks->extent[i];
+		if (i != axis)
+			columns *= last[i] - first[i] + 1;
+	}
+
+	size_t start = 0, end = 0;
+	if (axis >= 0)
+	{
+		size_t interval = reader->header.keyframeInterval;
+		start = interval ? first[axis] - first[axis] % interval : 0;
+		end = last[axis];
+	}
+
+	size_t brick[NDTF_DIMENSIONS_MAX];
+	for (size_t column = 0; column < columns; column++)
+	{
+		size_t rest = column;
+		for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+		{
+			if (i == axis)
+				continue;
+			size_t count = last[i] - first[i] + 1;
+			brick[i] = first[i] + rest % count;
+			rest /= count;
+		}
+
+		uint8_t* previous = NULL;
+		for (size_t slice = start; slice <= end; slice++)
+		{
+			if (axis >= 0)
+				brick[axis] = slice;
+
+			size_t index = 0;
+			for (int i = NDTF_DIMENSIONS_MAX - 1; i >= 0; i--)
+				index = index * bricks->grid[i] + brick[i];
+
+			size_t brickOrigin[NDTF_DIMENSIONS_MAX];
+			size_t brickExtent[NDTF_DIMENSIONS_MAX];
+			size_t brickSize = ndtf_bricks_get(bricks, index, brickOrigin, brickExtent);
+
+			uint8_t* decoded = scratch->bricks[previous == scratch->bricks[0] ? 1 : 0];
+			if (!ndtf_reader_decodeBrick(reader, scratch, index, decoded, brickSize, brickExtent))
+				return false;
+			if (previous && !ndtf_delta_isKeyframe(&reader->header, slice))
+				ndtf_delta_decode((NDTF_TexelFormat)reader->header.texelFormat, decoded, previous, brickSize / bricks->texelSize);
+			previous = axis >= 0 ? decoded : NULL;
+
+			if (axis >= 0 && slice < first[axis])
+				continue;
+
+			size_t low[NDTF_DIMENSIONS_MAX], high[NDTF_DIMENSIONS_MAX];
+			for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+			{
+				low[i] = max(brickOrigin[i], origin[i]);
+				high[i] = min(brickOrigin[i] + brickExtent[i], origin[i] + extent[i]);
+			}
+			ndtf_reader_copyBox(decoded, brickOrigin, brickExtent, out, origin, extent, low, high, bricks->texelSize);
+		}
+	}
+	return true;
+}
+
+// held is the scratch of the calling thread, NULL takes one from the pool
+static bool ndtf_reader_read(NDTF_Reader* reader, ndtf_ReaderScratch* held, const size_t origin[NDTF_DIMENSIONS_MAX], const size_t extent[NDTF_DIMENSIONS_MAX], uint8_t* out)
+{
+	ndtf_ReaderScratch* scratch = held;
+	if (!scratch && !reader->volume)
+	{
+		scratch = ndtf_reader_acquire(reader);
+		if (!scratch)
+			return false;
+	}
+
+	bool result = reader->header.flags.segmented ? ndtf_reader_readBricks(reader, scratch, origin, extent, out) : ndtf_reader_readPayload(reader, scratch, origin, extent, out);
+
+	if (scratch && !held)
+		ndtf_reader_release(reader, scratch);
+	return result;
+}
+
+bool ndtf_reader_readRegion(NDTF_Reader* reader, const uint32_t origin[NDTF_DIMENSIONS_MAX], const uint32_t extent[NDTF_DIMENSIONS_MAX], void* texels)
+{
+	return ndtf_reader_readRegionWith(reader, NULL, origin, extent, texels);
+}
+
+bool ndtf_reader_readRegionWith(NDTF_Reader* reader, ndtf_ReaderScratch* scratch, const uint32_t origin[NDTF_DIMENSIONS_MAX], const uint32_t extent[NDTF_DIMENSIONS_MAX], void* texels)
+{
+	if (!reader || !origin || !extent || !texels)
+		return false;
+
+	size_t regionOrigin[NDTF_DIMENSIONS_MAX];
+	size_t regionExtent[NDTF_DIMENSIONS_MAX];
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+	{
+		bool used = i < reader->header.dimensions;
+		regionOrigin[i] = used ? origin[i] : 0;
+		regionExtent[i] = used ? extent[i] : 1;
+		if (regionExtent[i] == 0 || regionOrigin[i] >= reader->bricks.size[i] || regionExtent[i] > reader->bricks.size[i] - regionOrigin[i])
+			return false;
+	}
+
+	return ndtf_reader_read(reader, scratch, regionOrigin, regionExtent, (uint8_t*)texels);
+}
+
+bool ndtf_reader_readBrick(NDTF_Reader* reader, uint64_t brick, void* texels, uint32_t origin[NDTF_DIMENSIONS_MAX], uint32_t extent[NDTF_DIMENSIONS_MAX])
+{
+	if (!reader || !texels || brick >= ndtf_reader_getBrickCount(reader))
+		return false;
+
+	size_t brickOrigin[NDTF_DIMENSIONS_MAX];
+	size_t brickExtent[NDTF_DIMENSIONS_MAX];
+	if (reader->header.flags.segmented)
+		ndtf_bricks_get(&reader->bricks, (size_t)brick, brickOrigin, brickExtent);
+	else
+	{
+		memset(brickOrigin, 0, sizeof(brickOrigin));
+		memcpy(brickExtent, reader->bricks.size, sizeof(brickExtent));
+	}
+
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+	{
+		if (origin)
+			origin[i] = (uint32_t)brickOrigin[i];
+		if (extent)
+			extent[i] = (uint32_t)brickExtent[i];
+	}
+
+	return ndtf_reader_read(reader, NULL, brickOrigin, brickExtent, (uint8_t*)texels);
+}
@@ -0,0 +1,476 @@
+#include "ndtf_internal.h"
+#include <string.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+	#define NDTF_RESIZE_SSE2
+	#include <emmintrin.h>
+#endif
+
+// separable resampling: one pass per resized axis, the axes that shrink the most first. passes between the
+// first and the last one work on float volumes, the first reads and the last writes the texel format itself.
+// nearest sampling copies texels and stays in the texel format throughout.
+// a pass filters lines along its axis, blocks of neighbouring lines are loaded as floats once and every output
+// sample of them is a weighted sum of whole source rows of the block
+
+#define NDTF_RESIZE_CHUNK ((size_t)1 << 16)		// output elements per task
+#define NDTF_RESIZE_COLUMN ((size_t)1 << 14)	// floats of a loaded block of lines
+
+#define NDTF_RESIZE_PI 3.14159265358979323846
+
+typedef enum ndtf_ResizeType
+{
+	NDTF_RESIZE_F32,
+	NDTF_RESIZE_U8,
+	NDTF_RESIZE_U16,
+	NDTF_RESIZE_U32,
+} ndtf_ResizeType;
+
+static ndtf_ResizeType ndtf_resize_type(NDTF_TexelFormat texelFormat)
+{
+	switch (ndtf_getChannelSize(texelFormat))
+	{
+	case 1: return NDTF_RESIZE_U8;
+	case 2: return NDTF_RESIZE_U16;
+	default: return ndtf_getChannelIsFloat(texelFormat) ? NDTF_RESIZE_F32 : NDTF_RESIZE_U32;
+	}
+}
+
+static size_t ndtf_resize_typeSize(ndtf_ResizeType type)
+{
+	return type == NDTF_RESIZE_U8 ? 1 : type == NDTF_RESIZE_U16 ? 2 : 4;
+}
+
+// filters
+
+static double ndtf_resize_support(NDTF_Filter filter)
+{
+	switch (filter)
+	{
+	case NDTF_FILTER_LINEAR: return 1.0;
+	case NDTF_FILTER_CUBIC: return 2.0;
+	case NDTF_FILTER_LANCZOS: return 3.0;
+	default: return 0.5;
+	}
+}
+
+static double ndtf_resize_kernel(NDTF_Filter filter, double x)
+{
+	x = fabs(x);
+	switch (filter)
+	{
+	case NDTF_FILTER_LINEAR:
+		return x < 1.0 ? 1.0 - x : 0.0;
+	case NDTF_FILTER_CUBIC:
+		// Catmull-Rom
+		if (x < 1.0)
+			return (1.5 * x - 2.5) * x * x + 1.0;
+		if (x < 2.0)
+			return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+		return 0.0;
+	case NDTF_FILTER_LANCZOS:
+		if (x < 1e-8)
+			return 1.0;
+		if (x >= 3.0)
+			return 0.0;
+		return 3.0 * sin(NDTF_RESIZE_PI * x) * sin(NDTF_RESIZE_PI * x / 3.0) / (NDTF_RESIZE_PI * NDTF_RESIZE_PI * x * x);
+	default:
+		return 1.0;
+	}
+}
+
+// weight table of one axis: every output sample is the sum of taps source samples from first on
+typedef struct ndtf_ResizeWeights
+{
+	size_t taps;
+	size_t* first;
+	float* weights;
+} ndtf_ResizeWeights;
+
+static bool ndtf_resizeWeights_init(ndtf_ResizeWeights* table, size_t srcCount, size_t dstCount, const NDTF_ResizeOptions* options, const NDTF_Context* ctx)
+{
+	NDTF_Filter filter = options->filter;
+	double scale = options->alignCorners ? (dstCount > 1 ? (double)(srcCount - 1) / (double)(dstCount - 1) : 0.0) : (double)srcCount / (double)dstCount;
+
+	// shrinking widens the filter over the source samples one output sample covers, aligned corners sample a
+	// function at grid points and interpolate only
+	double stretch = filter != NDTF_FILTER_NEAREST && !options->alignCorners && scale > 1.0 ? scale : 1.0;
+	double radius = ndtf_resize_support(filter) * stretch;
+	size_t taps = filter == NDTF_FILTER_NEAREST ? 1 : min((size_t)ceil(radius * 2.0), srcCount);
+	taps = max(taps, 1);
+
+	table->taps = taps;
+	table->first = (size_t*)ndtf_mem_alloc(ctx, dstCount * sizeof(size_t));
+	table->weights = (float*)ndtf_mem_alloc(ctx, dstCount * taps * sizeof(float));
+	if (!table->first || !table->weights)
+		return false;
+	memset(table->weights, 0, dstCount * taps * sizeof(float));
+
+	for (size_t j = 0; j < dstCount; j++)
+	{
+		double center;
+		if (options->alignCorners)
+			center = dstCount > 1 ? (double)j * scale : (double)(srcCount - 1) * 0.5;
+		else
+			center = ((double)j + 0.5) * scale - 0.5;
+
+		float* weights = table->weights + j * taps;
+		if (filter == NDTF_FILTER_NEAREST)
+		{
+			double nearest = floor(center + 0.5);
+			table->first[j] = nearest < 0.0 ? 0 : min((size_t)nearest, srcCount - 1);
+			weights[0] = 1.0f;
+			continue;
+		}
+
+		// samples past the edges repeat the edge sample, so their weights land on it
+		double low = floor(center - radius) + 1.0;
+		double high = floor(center + radius);
+		size_t lowClamped = low < 0.0 ? 0 : min((size_t)low, srcCount - 1);
+		size_t first = min(lowClamped, srcCount - taps);
+		table->first[j] = first;
+
+		double sum = 0.0;
+		for (double p = low; p <= high; p += 1.0)
+		{
+			size_t index = p < 0.0 ? 0 : min((size_t)p, srcCount - 1);
+			double weight = ndtf_resize_kernel(filter, (p - center) / stretch);
+			weights[index - first] += (float)weight;
+			sum += weight;
+		}
+
+		if (sum == 0.0)
+			weights[0] = 1.0f;
+		else
+		{
+			for (size_t k = 0; k < taps; k++)
+				weights[k] = (float)(weights[k] / sum);
+		}
+	}
+	return true;
+}
+
+static void ndtf_resizeWeights_free(ndtf_ResizeWeights* table, const NDTF_Context* ctx)
+{
+	ndtf_mem_free(ctx, table->first);
+	ndtf_mem_free(ctx, table->weights);
+}
+
+// conversion of contiguous elements
+
+static void ndtf_resize_load(ndtf_ResizeType type, const uint8_t* src, float* dst, size_t count)
+{
+	switch (type)
+	{
+	case NDTF_RESIZE_U8:
+		for (size_t i = 0; i < count; i++)
+			dst[i] = (float)src[i];
+		break;
+	case NDTF_RESIZE_U16:
+		for (size_t i = 0; i < count; i++)
+			dst[i] = (float)((const uint16_t*)src)[i];
+		break;
+	case NDTF_RESIZE_U32:
+		for (size_t i = 0; i < count; i++)
+			dst[i] = (float)((const uint32_t*)src)[i];
+		break;
+	default:
+		memcpy(dst, src, count * sizeof(float));
+		break;
+	}
+}
+
+// integer channels are rounded and clamped to their range, ringing of the cubic and Lanczos filters included
+#define NDTF_RESIZE_STORE(type, maximum)												\
+static void ndtf_resize_store_##type(const float* src, type* dst, size_t count)		\
+{																						\
+	for (size_t i = 0; i < count; i++)													\
+	{																					\
+		float value = src[i] + 0.5f;													\
+		dst[i] = !(value > 0.0f) ? 0 : value >= (float)(maximum) ? (type)(maximum) : (type)value;	\
+	}																					\
+}
+
+NDTF_RESIZE_STORE(uint8_t, UINT8_MAX)
+NDTF_RESIZE_STORE(uint16_t, UINT16_MAX)
+NDTF_RESIZE_STORE(uint32_t, UINT32_MAX)
+
+static void ndtf_resize_store(ndtf_ResizeType type, const float* src, uint8_t* dst, size_t count)
+{
+	switch (type)
+	{
+	case NDTF_RESIZE_U8: ndtf_resize_store_uint8_t(src, dst, count); break;
+	case NDTF_RESIZE_U16: ndtf_resize_store_uint16_t(src, (uint16_t*)dst, count); break;
+	case NDTF_RESIZE_U32: ndtf_resize_store_uint32_t(src, (uint32_t*)dst, count); break;
+	default: memcpy(dst, src, count * sizeof(float)); break;
+	}
+}
+
+// out = sum of weights[k] * rows[k * lanes], count elements
+static void ndtf_resize_filterRows(const float* rows, size_t lanes, const float* weights, size_t taps, float* out)
+{
+	size_t i = 0;
+#ifdef NDTF_RESIZE_SSE2
+	for (; i + 8 <= lanes; i += 8)
+	{
+		__m128i zero = _mm_setzero_si128();
+		__m128 low = _mm_castsi128_ps(zero), high = _mm_castsi128_ps(zero);
+		for (size_t k = 0; k < taps; k++)
+		{
+			__m128 weight = _mm_set1_ps(weights[k]);
+			const float* row = rows + k * lanes + i;
+			low = _mm_add_ps(low, _mm_mul_ps(weight, _mm_loadu_ps(row)));
+			high = _mm_add_ps(high, _mm_mul_ps(weight, _mm_loadu_ps(row + 4)));
+		}
+		_mm_storeu_ps(out + i, low);
+		_mm_storeu_ps(out + i + 4, high);
+	}
+	for (; i + 4 <= lanes; i += 4)
+	{
+		__m128 sum = _mm_setzero_ps();
+		for (size_t k = 0; k < taps; k++)
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows + k * lanes + i)));
+		_mm_storeu_ps(out + i, sum);
+	}
+#endif
+	for (; i < lanes; i++)
+	{
+		float sum = 0.0f;
+		for (size_t k = 0; k < taps; k++)
+			sum += weights[k] * rows[k * lanes + i];
+		out[i] = sum;
+	}
+}
+
+typedef struct ndtf_ResizePass
+{
+	const uint8_t* src;
+	ndtf_ResizeType srcType;
+	uint8_t* dst;
+	ndtf_ResizeType dstType;
+	size_t inner;		// elements between neighbours along the axis
+	size_t outer;		// lines above the axis
+	size_t srcCount, dstCount;
+	size_t lanes;		// neighbouring lines filtered together
+	size_t blocks;		// blocks of lanes per outer index
+	size_t unitsPerTask;
+	const ndtf_ResizeWeights* weights;
+	volatile uint64_t failed;
+	const NDTF_Context* ctx;
+} ndtf_ResizePass;
+
+static void ndtf_resize_passTask(void* taskData, size_t index)
+{
+	ndtf_ResizePass* pass = (ndtf_ResizePass*)taskData;
+	if (ndtf_atomic_load_u64(&pass->failed))
+		return;
+
+	size_t lanes = pass->lanes;
+	float* column = (float*)ndtf_mem_alloc(pass->ctx, (pass->srcCount + pass->dstCount) * lanes * sizeof(float));
+	if (!column)
+	{
+		ndtf_atomic_store_u64(&pass->failed, 1);
+		return;
+	}
+	float* result = column + pass->srcCount * lanes;
+
+	size_t srcSize = ndtf_resize_typeSize(pass->srcType);
+	size_t dstSize = ndtf_resize_typeSize(pass->dstType);
+	size_t units = pass->outer * pass->blocks;
+	size_t first = index * pass->unitsPerTask;
+	size_t end = min(first + pass->unitsPerTask, units);
+
+	for (size_t unit = first; unit < end; unit++)
+	{
+		size_t outer = unit / pass->blocks;
+		size_t lane = (unit % pass->blocks) * lanes;
+		size_t count = min(lanes, pass->inner - lane);
+
+		const uint8_t* src = pass->src + ((outer * pass->srcCount) * pass->inner + lane) * srcSize;
+		const ndtf_ResizeWeights* weights = pass->weights;
+		uint8_t* dst = pass->dst + ((outer * pass->dstCount) * pass->inner + lane) * dstSize;
+
+		// single taps pick source rows, copied as they are
+		if (weights->taps == 1 && pass->srcType == pass->dstType)
+		{
+			for (size_t j = 0; j < pass->dstCount; j++)
+				memcpy(dst + j * pass->inner * dstSize, src + weights->first[j] * pass->inner * srcSize, count * srcSize);
+			continue;
+		}
+
+		// blocks of whole lines are contiguous in both volumes and converted at once
+		bool contiguous = count == pass->inner;
+		if (contiguous)
+			ndtf_resize_load(pass->srcType, src, column, pass->srcCount * count);
+		else
+		{
+			for (size_t s = 0; s < pass->srcCount; s++)
+				ndtf_resize_load(pass->srcType, src + s * pass->inner * srcSize, column + s * count, count);
+		}
+
+		for (size_t j = 0; j < pass->dstCount; j++)
+		{
+			float* row = result + (contiguous ? j * count : 0);
+			ndtf_resize_filterRows(column + weights->first[j] * count, count, weights->weights + j * weights->taps, weights->taps, row);
+			if (!contiguous)
+				ndtf_resize_store(pass->dstType, row, dst + j * pass->inner * dstSize, count);
+		}
+		if (contiguous)
+			ndtf_resize_store(pass->dstType, result, dst, pass->dstCount * count);
+	}
+
+	ndtf_mem_free(pass->ctx, column);
+}
+
+static bool ndtf_resize_pass(const uint8_t* src, ndtf_ResizeType srcType, uint8_t* dst, ndtf_ResizeType dstType, const size_t extent[NDTF_DIMENSIONS_MAX], size_t channels, int axis, size_t dstCount, const NDTF_ResizeOptions* options, const NDTF_Context* ctx)
+{
+	ndtf_ResizePass pass;
+	memset(&pass, 0, sizeof(ndtf_ResizePass));
+	pass.src = src;
+	pass.srcType = srcType;
+	pass.dst = dst;
+	pass.dstType = dstType;
+	pass.inner = channels;
+	for (int i = 0; i < axis; i++)
+		pass.inner *= extent[i];
+	pass.outer = 1;
+	for (int i = axis + 1; i < NDTF_DIMENSIONS_MAX; i++)
+		pass.outer *= extent[i];
+	pass.srcCount = extent[axis];
+	pass.dstCount = dstCount;
+	pass.ctx = ctx;
+
+	// along the x axis a line is a single texel wide, along the others a block of lines shares its loads
+	pass.lanes = axis == 0 ? channels : min(pass.inner, max(NDTF_RESIZE_COLUMN / pass.srcCount, channels));
+	pass.blocks = (pass.inner + pass.lanes - 1) / pass.lanes;
+	pass.unitsPerTask = max(NDTF_RESIZE_CHUNK / max(pass.dstCount * pass.lanes, 1), 1);
+
+	ndtf_ResizeWeights weights;
+	memset(&weights, 0, sizeof(ndtf_ResizeWeights));
+	bool result = ndtf_resizeWeights_init(&weights, pass.srcCount, dstCount, options, ctx);
+	if (result)
+	{
+		pass.weights = &weights;
+		size_t units = pass.outer * pass.blocks;
+
+		NDTF_SCOPE_BEGIN(resizeScope, ctx, NDTF_PHASE_CONVERT, "resize");
+		ndtf_parallelFor(ctx, ndtf_resize_passTask, &pass, (units + pass.unitsPerTask - 1) / pass.unitsPerTask);
+		NDTF_SCOPE_END(resizeScope, ctx, pass.outer * pass.inner * dstCount * ndtf_resize_typeSize(dstType));
+
+		result = !pass.failed;
+	}
+	ndtf_resizeWeights_free(&weights, ctx);
+	return result;
+}
+
+NDTF_File ndtf_file_resize(NDTF_File* file, const uint32_t size[NDTF_DIMENSIONS_MAX], const NDTF_ResizeOptions* options, const NDTF_Context* ctx)
+{
+	NDTF_File result;
+	memset(&result, 0, sizeof(NDTF_File));
+
+	if (!ndtf_file_isValid(file) || !size || (options && options->filter > NDTF_FILTER_LANCZOS) ||
+		ndtf_getIsBlockCompressed((NDTF_TexelFormat)file->header.texelFormat))
+		return result;
+
+	NDTF_ResizeOptions defaults;
+	memset(&defaults, 0, sizeof(NDTF_ResizeOptions));
+	defaults.filter = NDTF_FILTER_LINEAR;
+	if (!options)
+		options = &defaults;
+
+	ndtf_Bricks bricks;
+	ndtf_bricks_init(&bricks, &file->header);
+
+	// resized axes, the one shrinking the most first so the later passes have less to do
+	uint32_t target[NDTF_DIMENSIONS_MAX];
+	int order[NDTF_DIMENSIONS_MAX];
+	int passes = 0;
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+	{
+		target[i] = i < file->header.dimensions && size[i] ? size[i] : (uint32_t)bricks.size[i];
+		if (target[i] == bricks.size[i])
+			continue;
+
+		int p = passes++;
+		double ratio = (double)target[i] / (double)bricks.size[i];
+		while (p > 0 && (double)target[order[p - 1]] / (double)bricks.size[order[p - 1]] > ratio)
+		{
+			order[p] = order[p - 1];
+			p--;
+		}
+		order[p] = i;
+	}
+
+	NDTF_TexelFormat texelFormat = (NDTF_TexelFormat)file->header.texelFormat;
+	result = ndtf_file_create_ND_ex((NDTF_Dimensions)file->header.dimensions, texelFormat, target, ctx);
+	if (!ndtf_file_isValid(&result))
+		return result;
+
+	result.header.flags = file->header.flags;
+	memcpy(result.header.brickSize, file->header.brickSize, sizeof(result.header.brickSize));
+	result.header.keyframeInterval = file->header.keyframeInterval;
+	result.errorBound = file->errorBound;
+
+	if (passes == 0)
+	{
+		memcpy(result.data, file->data, ndtf_file_getDataSize(file));
+		return result;
+	}
+
+	// float volumes between the passes, the largest one decides their size
+	size_t channels = ndtf_getChannelCount(texelFormat);
+	size_t extent[NDTF_DIMENSIONS_MAX];
+	memcpy(extent, bricks.size, sizeof(extent));
+
+	size_t largest = 0;
+	for (int p = 0; p + 1 < passes; p++)
+	{
+		extent[order[p]] = target[order[p]];
+		size_t elements = channels;
+		for (int i = 0; i < NDTF_DIMENSIONS_MAX && elements; i++)
+		{
+			if (!ndtf_size_mul(elements, extent[i], &elements))
+				elements = 0;
+		}
+		if (!elements || !ndtf_size_mul(elements, sizeof(float), &elements))
+		{
+			ndtf_file_free_ex(&result, ctx);
+			return result;
+		}
+		largest = max(largest, elements);
+	}
+
+	float* buffers[2] = { NULL, NULL };
+	bool valid = true;
+	if (passes > 1)
+	{
+		buffers[0] = (float*)ndtf_mem_alloc(ctx, largest);
+		buffers[1] = passes > 2 ? (float*)ndtf_mem_alloc(ctx, largest) : NULL;
+		valid = buffers[0] && (passes <= 2 || buffers[1]);
+	}
+
+	ndtf_ResizeType type = ndtf_resize_type(texelFormat);
+	memcpy(extent, bricks.size, sizeof(extent));
+	const uint8_t* src = file->data;
+	ndtf_ResizeType srcType = type;
+	for (int p = 0; p < passes && valid; p++)
+	{
+		bool last = p + 1 == passes;
+		uint8_t* dst = last ? result.data : (uint8_t*)buffers[p % 2];
+		ndtf_ResizeType dstType = last || options->filter == NDTF_FILTER_NEAREST ? type : NDTF_RESIZE_F32;
+
+		int axis = order[p];
+		valid = ndtf_resize_pass(src, srcType, dst, dstType, extent, channels, axis, target[axis], options, ctx);
+
+		extent[axis] = target[axis];
+		src = dst;
+		srcType = dstType;
+	}
+
+	ndtf_mem_free(ctx, buffers[0]);
+	ndtf_mem_free(ctx, buffers[1]);
+
+	if (!valid)
+		ndtf_file_free_ex(&result, ctx);
+	return result;
+}
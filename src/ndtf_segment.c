@@ -0,0 +1,1244 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+	#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "ndtf_internal.h"
+#include <string.h>
+#include <stdlib.h>
+
+uint32_t ndtf_header_computeChecksum(const NDTF_Header* header)
+{
+	// over the header as it is stored, so v1.x checksums keep matching
+	NDTF_Header copy = *header;
+	copy.checksum = 0;
+
+	uint8_t stored[sizeof(NDTF_Header)];
+	size_t size = ndtf_header_encode(&copy, stored);
+	return ndtf_crc32c(0, stored, size);
+}
+
+void ndtf_header_prepare(const NDTF_Header* header, NDTF_Header* out)
+{
+	*out = *header;
+
+	// blocks are stored as one payload as they are, they only pass through a codec
+	if (ndtf_getIsBlockCompressed((NDTF_TexelFormat)out->texelFormat))
+	{
+		out->flags.segmented = 0;
+		out->flags.checksums = 0;
+		out->flags.zoneMaps = 0;
+		out->flags.deduplicated = 0;
+		out->flags.deltaAxis = 0;
+		out->flags.lossy = 0;
+		out->flags.planar = 0;
+	}
+
+	if (out->flags.checksums || out->flags.zoneMaps || out->flags.deduplicated || out->flags.deltaAxis)
+		out->flags.segmented = 1;
+
+	if (!out->flags.segmented)
+		memset(out->brickSize, 0, sizeof(out->brickSize));
+
+	if (!ndtf_lossy_enabled(out))
+		out->flags.lossy = 0;
+
+	if (!ndtf_planar_enabled(out))
+		out->flags.planar = 0;
+
+	// delta encoded bricks are never shared, their stored bytes depend on the slice before them
+	if (ndtf_delta_axis(out) < 0)
+	{
+		out->flags.deltaAxis = 0;
+		out->keyframeInterval = 0;
+	}
+	else
+		out->flags.deduplicated = 0;
+
+	bool wideExtents = false;
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+		wideExtents |= out->size[i] > UINT16_MAX;
+
+	// zlib was the only codec of v1.0, files that fit a v1.x header keep it for older readers
+	bool blocks = ndtf_getIsBlockCompressed((NDTF_TexelFormat)out->texelFormat);
+	if (wideExtents)
+		out->version = NDTF_CREATE_VERSION(2, blocks ? 2 : out->flags.planar ? 1 : 0);
+	else if (blocks)
+		out->version = NDTF_CREATE_VERSION(1, 3);
+	else if (out->flags.planar)
+		out->version = NDTF_CREATE_VERSION(1, 2);
+	else if (out->flags.segmented || out->flags.codec > NDTF_CODEC_ZLIB || out->flags.lossy)
+		out->version = NDTF_CREATE_VERSION(1, 1);
+	else
+		out->version = NDTF_CREATE_VERSION(1, 0);
+
+	out->checksum = 0;
+	if (out->flags.checksums)
+		out->checksum = ndtf_header_computeChecksum(out);
+}
+
+void ndtf_bricks_init(ndtf_Bricks* bricks, const NDTF_Header* header)
+{
+	bricks->count = 1;
+	bricks->texelSize = ndtf_getTexelSize((NDTF_TexelFormat)header->texelFormat);
+
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+	{
+		size_t size = i < header->dimensions ? max(header->size[i], 1) : 1;
+		size_t extent = size;
+
+		uint8_t shift = header->brickSize[i];
+		if (header->flags.segmented && shift && (size_t)(shift - 1) < sizeof(size_t) * 8 - 1)
+			extent = min((size_t)1 << (shift - 1), size);
+
+		bricks->size[i] = size;
+		bricks->extent[i] = extent;
+		bricks->grid[i] = (size + extent - 1) / extent;
+		bricks->count *= bricks->grid[i];
+	}
+}
+
+size_t ndtf_bricks_get(const ndtf_Bricks* bricks, size_t index, size_t origin[NDTF_DIMENSIONS_MAX], size_t extent[NDTF_DIMENSIONS_MAX])
+{
+	size_t bytes = bricks->texelSize;
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+	{
+		size_t b = index % bricks->grid[i];
+		index /= bricks->grid[i];
+
+		origin[i] = b * bricks->extent[i];
+		extent[i] = min(bricks->extent[i], bricks->size[i] - origin[i]);
+		bytes *= extent[i];
+	}
+	return bytes;
+}
+
+size_t ndtf_bricks_offset(const ndtf_Bricks* bricks, const size_t origin[NDTF_DIMENSIONS_MAX])
+{
+	size_t offset = 0;
+	for (int i = NDTF_DIMENSIONS_MAX - 1; i >= 0; i--)
+		offset = offset * bricks->size[i] + origin[i];
+	return offset * bricks->texelSize;
+}
+
+bool ndtf_bricks_isContiguous(const ndtf_Bricks* bricks, const size_t extent[NDTF_DIMENSIONS_MAX])
+{
+	int outer = NDTF_DIMENSIONS_MAX - 1;
+	while (outer > 0 && extent[outer] == 1)
+		outer--;
+
+	for (int i = 0; i < outer; i++)
+	{
+		if (extent[i] != bricks->size[i])
+			return false;
+	}
+	return true;
+}
+
+// copies rows of a brick between the volume and a packed brick buffer
+static void ndtf_bricks_copy(const ndtf_Bricks* bricks, uint8_t* volume, const size_t origin[NDTF_DIMENSIONS_MAX], const size_t extent[NDTF_DIMENSIONS_MAX], uint8_t* brick, bool toBrick)
+{
+	size_t rowBytes = extent[0] * bricks->texelSize;
+	size_t rows = 1;
+	for (int i = 1; i < NDTF_DIMENSIONS_MAX; i++)
+		rows *= extent[i];
+
+	size_t pos[NDTF_DIMENSIONS_MAX];
+	memcpy(pos, origin, sizeof(pos));
+
+	for (size_t r = 0; r < rows; r++)
+	{
+		uint8_t* row = volume + ndtf_bricks_offset(bricks, pos);
+		if (toBrick)
+			memcpy(brick, row, rowBytes);
+		else
+			memcpy(row, brick, rowBytes);
+		brick += rowBytes;
+
+		for (int i = 1; i < NDTF_DIMENSIONS_MAX; i++)
+		{
+			if (++pos[i] < origin[i] + extent[i])
+				break;
+			pos[i] = origin[i];
+		}
+	}
+}
+
+void ndtf_bricks_gather(const ndtf_Bricks* bricks, const uint8_t* volume, const size_t origin[NDTF_DIMENSIONS_MAX], const size_t extent[NDTF_DIMENSIONS_MAX], uint8_t* brick)
+{
+	ndtf_bricks_copy(bricks, (uint8_t*)volume, origin, extent, brick, true);
+}
+
+void ndtf_bricks_scatter(const ndtf_Bricks* bricks, uint8_t* volume, const size_t origin[NDTF_DIMENSIONS_MAX], const size_t extent[NDTF_DIMENSIONS_MAX], const uint8_t* brick)
+{
+	ndtf_bricks_copy(bricks, volume, origin, extent, (uint8_t*)brick, false);
+}
+
+size_t ndtf_segments_tableSize(const NDTF_Header* header, size_t count)
+{
+	size_t size = count * sizeof(NDTF_Segment);
+	if (header->flags.zoneMaps)
+		size += sizeof(NDTF_ZoneMapTable) + count * ndtf_getChannelCount((NDTF_TexelFormat)header->texelFormat) * sizeof(NDTF_ValueRange);
+	return size;
+}
+
+bool ndtf_segments_validate(const NDTF_Header* header, const NDTF_SegmentTable* table, const uint8_t* entries, uint64_t fileSize, NDTF_Segment** segments, const NDTF_Context* ctx)
+{
+	ndtf_Bricks bricks;
+	ndtf_bricks_init(&bricks, header);
+	if (table->count != bricks.count || table->count > fileSize / sizeof(NDTF_Segment))
+		return false;
+
+	size_t entriesSize = (size_t)table->count * sizeof(NDTF_Segment);
+	uint64_t tableEnd = ndtf_header_storedSize(header) + sizeof(NDTF_SegmentTable) + ndtf_segments_tableSize(header, (size_t)table->count);
+	if (tableEnd > fileSize)
+		return false;
+
+	if (header->flags.checksums && ndtf_crc32c(0, entries, entriesSize) != table->checksum)
+		return false;
+
+	if (header->flags.zoneMaps)
+	{
+		NDTF_ZoneMapTable zoneTable;
+		memcpy(&zoneTable, entries + entriesSize, sizeof(NDTF_ZoneMapTable));
+
+		size_t rangeCount = (size_t)table->count * ndtf_getChannelCount((NDTF_TexelFormat)header->texelFormat);
+		if (zoneTable.count != rangeCount)
+			return false;
+		if (header->flags.checksums && ndtf_crc32c(0, entries + entriesSize + sizeof(NDTF_ZoneMapTable), rangeCount * sizeof(NDTF_ValueRange)) != zoneTable.checksum)
+			return false;
+	}
+
+	NDTF_Segment* result = (NDTF_Segment*)ndtf_mem_alloc(ctx, max(entriesSize, 1));
+	if (!result)
+		return false;
+	memcpy(result, entries, entriesSize);
+
+	for (size_t i = 0; i < (size_t)table->count; i++)
+	{
+		if (result[i].offset < tableEnd || result[i].offset > fileSize || result[i].size > fileSize - result[i].offset)
+		{
+			ndtf_mem_free(ctx, result);
+			return false;
+		}
+	}
+
+	*segments = result;
+	return true;
+}
+
+bool ndtf_segments_parse(const NDTF_Header* header, const uint8_t* data, size_t size, NDTF_Segment** segments, size_t* count, const NDTF_Context* ctx)
+{
+	size_t headerSize = ndtf_header_storedSize(header);
+	if (size < headerSize + sizeof(NDTF_SegmentTable))
+		return false;
+
+	NDTF_SegmentTable table;
+	memcpy(&table, data + headerSize, sizeof(NDTF_SegmentTable));
+
+	if (!ndtf_segments_validate(header, &table, data + headerSize + sizeof(NDTF_SegmentTable), size, segments, ctx))
+		return false;
+
+	*count = (size_t)table.count;
+	return true;
+}
+
+typedef struct ndtf_SegmentLoad
+{
+	const NDTF_Header* header;
+	ndtf_Bricks bricks;
+	const NDTF_Segment* segments;
+	const uint8_t* data;
+	uint8_t* volume;
+	bool verify;
+	ndtf_TexelStatsSink* texelStats;
+	const NDTF_Transform* transform;
+	const size_t* original;	// deduplicated bricks, NULL = every brick is decoded
+	volatile uint64_t failed;
+	const NDTF_Context* ctx;
+} ndtf_SegmentLoad;
+
+void ndtf_decodeScratch_free(ndtf_DecodeScratch* scratch, const NDTF_Context* ctx)
+{
+	ndtf_codec_freeState(&scratch->codec);
+	ndtf_mem_free(ctx, scratch->codes);
+	scratch->codes = NULL;
+	scratch->codesCapacity = 0;
+}
+
+bool ndtf_segment_decode(const NDTF_Header* header, const NDTF_Segment* segment, const uint8_t* stored, uint8_t* out, size_t outSize, const size_t extent[NDTF_DIMENSIONS_MAX], ndtf_DecodeScratch* scratch, const NDTF_Context* ctx)
+{
+	if (ndtf_lossy_enabled(header))
+		return ndtf_lossy_decode(header, stored, (size_t)segment->size, out, extent, (NDTF_Codec)segment->codec, NULL, scratch, ctx);
+
+	NDTF_TexelFormat texelFormat = (NDTF_TexelFormat)header->texelFormat;
+	bool planar = ndtf_planar_enabled(header);
+
+	if (segment->codec == NDTF_CODEC_NONE)
+	{
+		if (segment->size != outSize)
+			return false;
+		if (planar)
+			ndtf_planar_merge(texelFormat, stored, out, outSize / ndtf_getTexelSize(texelFormat), ctx);
+		else
+			memcpy(out, stored, outSize);
+		return true;
+	}
+
+	ndtf_CodecState* state = scratch ? &scratch->codec : NULL;
+	if (!planar)
+		return ndtf_codec_decompressWith((NDTF_Codec)segment->codec, state, stored, (size_t)segment->size, out, outSize, ctx);
+
+	uint8_t* planes = scratch ? scratch->planes : NULL;
+	uint8_t* owned = planes ? NULL : (uint8_t*)ndtf_mem_alloc(ctx, outSize);
+	if (!planes)
+		planes = owned;
+	bool result = planes && ndtf_codec_decompressWith((NDTF_Codec)segment->codec, state, stored, (size_t)segment->size, planes, outSize, ctx);
+	if (result)
+		ndtf_planar_merge(texelFormat, planes, out, outSize / ndtf_getTexelSize(texelFormat), ctx);
+	ndtf_mem_free(ctx, owned);
+	return result;
+}
+
+static void ndtf_segments_loadTask(void* taskData, size_t index)
+{
+	ndtf_SegmentLoad* load = (ndtf_SegmentLoad*)taskData;
+	if (ndtf_atomic_load_u64(&load->failed) || (load->original && load->original[index] != index))
+		return;
+
+	const NDTF_Segment* segment = &load->segments[index];
+	const uint8_t* stored = load->data + segment->offset;
+
+	if (load->verify && ndtf_crc32c(0, stored, (size_t)segment->size) != segment->checksum)
+	{
+		ndtf_atomic_store_u64(&load->failed, 1);
+		return;
+	}
+
+	size_t origin[NDTF_DIMENSIONS_MAX];
+	size_t extent[NDTF_DIMENSIONS_MAX];
+	size_t brickSize = ndtf_bricks_get(&load->bricks, index, origin, extent);
+
+	bool ok;
+	if (ndtf_bricks_isContiguous(&load->bricks, extent))
+	{
+		uint8_t* out = load->volume + ndtf_bricks_offset(&load->bricks, origin);
+		ok = ndtf_segment_decode(load->header, segment, stored, out, brickSize, extent, NULL, load->ctx);
+		if (ok && load->transform)
+			ndtf_transform_run(load->transform, out, out, brickSize / load->bricks.texelSize);
+		if (ok && load->texelStats)
+			ndtf_texelStats_add(load->texelStats, out, brickSize / load->bricks.texelSize, load->ctx);
+	}
+	else
+	{
+		uint8_t* scratch = (uint8_t*)ndtf_mem_alloc(load->ctx, brickSize);
+		ok = scratch && ndtf_segment_decode(load->header, segment, stored, scratch, brickSize, extent, NULL, load->ctx);
+		if (ok && load->transform)
+			ndtf_transform_run(load->transform, scratch, scratch, brickSize / load->bricks.texelSize);
+		if (ok && load->texelStats)
+			ndtf_texelStats_add(load->texelStats, scratch, brickSize / load->bricks.texelSize, load->ctx);
+		if (ok)
+			ndtf_bricks_scatter(&load->bricks, load->volume, origin, extent, scratch);
+		ndtf_mem_free(load->ctx, scratch);
+	}
+
+	if (!ok)
+		ndtf_atomic_store_u64(&load->failed, 1);
+}
+
+// copies a deduplicated brick from the already decoded brick it shares its segment with
+static void ndtf_segments_copyTask(void* taskData, size_t index)
+{
+	ndtf_SegmentLoad* load = (ndtf_SegmentLoad*)taskData;
+	size_t original = load->original[index];
+	if (ndtf_atomic_load_u64(&load->failed) || original == index)
+		return;
+
+	size_t origin[NDTF_DIMENSIONS_MAX];
+	size_t extent[NDTF_DIMENSIONS_MAX];
+	size_t sourceOrigin[NDTF_DIMENSIONS_MAX];
+	size_t brickSize = ndtf_bricks_get(&load->bricks, index, origin, extent);
+	ndtf_bricks_get(&load->bricks, original, sourceOrigin, extent);
+
+	if (ndtf_bricks_isContiguous(&load->bricks, extent))
+	{
+		uint8_t* out = load->volume + ndtf_bricks_offset(&load->bricks, origin);
+		memcpy(out, load->volume + ndtf_bricks_offset(&load->bricks, sourceOrigin), brickSize);
+		if (load->texelStats)
+			ndtf_texelStats_add(load->texelStats, out, brickSize / load->bricks.texelSize, load->ctx);
+		return;
+	}
+
+	uint8_t* scratch = (uint8_t*)ndtf_mem_alloc(load->ctx, brickSize);
+	if (!scratch)
+	{
+		ndtf_atomic_store_u64(&load->failed, 1);
+		return;
+	}
+	ndtf_bricks_gather(&load->bricks, load->volume, sourceOrigin, extent, scratch);
+	if (load->texelStats)
+		ndtf_texelStats_add(load->texelStats, scratch, brickSize / load->bricks.texelSize, load->ctx);
+	ndtf_bricks_scatter(&load->bricks, load->volume, origin, extent, scratch);
+	ndtf_mem_free(load->ctx, scratch);
+}
+
+typedef struct ndtf_SegmentRef
+{
+	uint64_t offset;
+	uint64_t size;
+	size_t index;
+} ndtf_SegmentRef;
+
+static int ndtf_segmentRef_compare(const void* a, const void* b)
+{
+	const ndtf_SegmentRef* x = (const ndtf_SegmentRef*)a;
+	const ndtf_SegmentRef* y = (const ndtf_SegmentRef*)b;
+	if (x->offset != y->offset)
+		return x->offset < y->offset ? -1 : 1;
+	if (x->size != y->size)
+		return x->size < y->size ? -1 : 1;
+	return x->index < y->index ? -1 : x->index > y->index;
+}
+
+// bricks that share a segment with an earlier brick of the same extent refer to it, the others to themselves
+static size_t* ndtf_segments_findShared(const ndtf_Bricks* bricks, const NDTF_Segment* segments, size_t count, const NDTF_Context* ctx)
+{
+	size_t* original = (size_t*)ndtf_mem_alloc(ctx, max(count * sizeof(size_t), 1));
+	ndtf_SegmentRef* refs = (ndtf_SegmentRef*)ndtf_mem_alloc(ctx, max(count * sizeof(ndtf_SegmentRef), 1));
+	if (!original || !refs)
+	{
+		ndtf_mem_free(ctx, original);
+		ndtf_mem_free(ctx, refs);
+		return NULL;
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		refs[i].offset = segments[i].offset;
+		refs[i].size = segments[i].size;
+		refs[i].index = i;
+		original[i] = i;
+	}
+	qsort(refs, count, sizeof(ndtf_SegmentRef), ndtf_segmentRef_compare);
+
+	for (size_t first = 0; first < count; )
+	{
+		size_t end = first + 1;
+		while (end < count && refs[end].offset == refs[first].offset && refs[end].size == refs[first].size)
+			end++;
+
+		size_t origin[NDTF_DIMENSIONS_MAX];
+		size_t extent[NDTF_DIMENSIONS_MAX];
+		size_t otherExtent[NDTF_DIMENSIONS_MAX];
+		ndtf_bricks_get(bricks, refs[first].index, origin, extent);
+		for (size_t i = first + 1; i < end; i++)
+		{
+			ndtf_bricks_get(bricks, refs[i].index, origin, otherExtent);
+			if (memcmp(extent, otherExtent, sizeof(extent)) == 0)
+				original[refs[i].index] = refs[first].index;
+		}
+		first = end;
+	}
+
+	ndtf_mem_free(ctx, refs);
+	return original;
+}
+
+bool ndtf_segments_decode(const NDTF_Header* header, const NDTF_Segment* segments, size_t count, const uint8_t* base, uint8_t* volume, ndtf_TexelStatsSink* texelStats, const NDTF_Transform* transform, const NDTF_Context* ctx)
+{
+	ndtf_SegmentLoad load;
+	memset(&load, 0, sizeof(ndtf_SegmentLoad));
+	load.header = header;
+	ndtf_bricks_init(&load.bricks, header);
+	load.segments = segments;
+	load.data = base;
+	load.volume = volume;
+	load.verify = header->flags.checksums;
+	load.texelStats = texelStats;
+	load.transform = transform;
+	load.ctx = ctx;
+
+	if (count != load.bricks.count)
+		return false;
+
+	// bricks of delta encoded files hold differences until the whole volume is decoded
+	bool delta = ndtf_delta_axis(header) >= 0;
+	if (delta)
+	{
+		load.texelStats = NULL;
+		load.transform = NULL;
+	}
+
+	// shared segments are decoded once, the other bricks are copied from the first one
+	size_t* original = NULL;
+	if (header->flags.deduplicated)
+	{
+		original = ndtf_segments_findShared(&load.bricks, segments, count, ctx);
+		if (!original)
+			return false;
+		load.original = original;
+	}
+
+	ndtf_parallelFor(ctx, ndtf_segments_loadTask, &load, count);
+	if (original && !load.failed)
+		ndtf_parallelFor(ctx, ndtf_segments_copyTask, &load, count);
+
+	if (delta && !load.failed)
+	{
+		ndtf_delta_undo(header, volume, ctx);
+
+		size_t texels = 1;
+		for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+			texels *= load.bricks.size[i];
+		if (transform)
+			ndtf_transform_runParallel(transform, volume, volume, texels, ctx);
+		if (texelStats)
+			ndtf_texelStats_addParallel(texelStats, volume, texels, ctx);
+	}
+
+	ndtf_mem_free(ctx, original);
+	return !load.failed;
+}
+
+typedef struct ndtf_BrickDecode
+{
+	const NDTF_Header* header;
+	ndtf_Bricks bricks;
+	const NDTF_Segment* segments;
+	const uint8_t* data;
+	const NDTF_Transform* transform;
+	ndtf_BrickFunc func;
+	void* user;
+	volatile uint64_t failed;
+	const NDTF_Context* ctx;
+} ndtf_BrickDecode;
+
+static void ndtf_segments_brickTask(void* taskData, size_t index)
+{
+	ndtf_BrickDecode* decode = (ndtf_BrickDecode*)taskData;
+	if (ndtf_atomic_load_u64(&decode->failed))
+		return;
+
+	const NDTF_Segment* segment = &decode->segments[index];
+	const uint8_t* stored = decode->data + segment->offset;
+
+	size_t origin[NDTF_DIMENSIONS_MAX];
+	size_t extent[NDTF_DIMENSIONS_MAX];
+	size_t brickSize = ndtf_bricks_get(&decode->bricks, index, origin, extent);
+
+	uint8_t* scratch = (uint8_t*)ndtf_mem_alloc(decode->ctx, brickSize);
+	bool ok = scratch && (!decode->header->flags.checksums || ndtf_crc32c(0, stored, (size_t)segment->size) == segment->checksum) &&
+		ndtf_segment_decode(decode->header, segment, stored, scratch, brickSize, extent, NULL, decode->ctx);
+	if (ok && decode->transform)
+		ndtf_transform_run(decode->transform, scratch, scratch, brickSize / decode->bricks.texelSize);
+	ok = ok && decode->func(decode->user, origin, extent, scratch);
+	ndtf_mem_free(decode->ctx, scratch);
+
+	if (!ok)
+		ndtf_atomic_store_u64(&decode->failed, 1);
+}
+
+bool ndtf_segments_decodeBricks(const NDTF_Header* header, const NDTF_Segment* segments, size_t count, const uint8_t* base, const NDTF_Transform* transform, ndtf_BrickFunc func, void* user, const NDTF_Context* ctx)
+{
+	ndtf_BrickDecode decode;
+	memset(&decode, 0, sizeof(ndtf_BrickDecode));
+	decode.header = header;
+	ndtf_bricks_init(&decode.bricks, header);
+	decode.segments = segments;
+	decode.data = base;
+	decode.transform = transform;
+	decode.func = func;
+	decode.user = user;
+	decode.ctx = ctx;
+
+	if (count != decode.bricks.count || ndtf_delta_axis(header) >= 0)
+		return false;
+
+	ndtf_parallelFor(ctx, ndtf_segments_brickTask, &decode, count);
+	return !decode.failed;
+}
+
+bool ndtf_segments_load(NDTF_File* file, const uint8_t* data, size_t size, ndtf_TexelStatsSink* texelStats, const NDTF_Transform* transform, const NDTF_Context* ctx)
+{
+	NDTF_Segment* segments;
+	size_t count;
+	if (!ndtf_segments_parse(&file->header, data, size, &segments, &count, ctx))
+		return false;
+
+	uint8_t* volume = (uint8_t*)ndtf_mem_alloc(ctx, ndtf_file_getDataSize(file));
+	if (!volume)
+	{
+		ndtf_mem_free(ctx, segments);
+		return false;
+	}
+
+	bool result = ndtf_segments_decode(&file->header, segments, count, data, volume, texelStats, transform, ctx);
+
+	if (result && ndtf_lossy_enabled(&file->header) && count)
+		ndtf_lossy_readBound(data + segments[0].offset, (size_t)segments[0].size, &file->errorBound);
+
+	ndtf_mem_free(ctx, segments);
+
+	if (!result)
+	{
+		ndtf_mem_free(ctx, volume);
+		return false;
+	}
+
+	file->data = volume;
+	return true;
+}
+
+typedef struct ndtf_SegmentEncode
+{
+	const NDTF_Header* header;
+	const ndtf_LossyBound* errorBound;	// lossy encoding, NULL = lossless
+	ndtf_LossyBound resolvedBound;
+	ndtf_Bricks bricks;
+	const uint8_t* volume;
+	ndtf_EncodedSegments* encoded;
+	NDTF_Codec codec;
+	bool checksums;
+	ndtf_TexelStatsSink* texelStats;
+	const NDTF_Transform* transform;	// encoded bricks are transformed copies
+	size_t channels;
+	ndtf_Hash128* hashes;	// flags.deduplicated
+	int deltaAxis;			// -1 = bricks are encoded on their own
+	size_t deltaStride;		// bricks between neighbours along the delta axis
+	const size_t* indices;	// bricks to encode, NULL = all of them
+	volatile uint64_t failed;
+	const NDTF_Context* ctx;
+} ndtf_SegmentEncode;
+
+// texels of a brick, gathered into an allocated buffer when they are not contiguous in the volume
+static const uint8_t* ndtf_segments_brickData(ndtf_SegmentEncode* encode, const size_t origin[NDTF_DIMENSIONS_MAX], const size_t extent[NDTF_DIMENSIONS_MAX], size_t brickSize, uint8_t** gathered)
+{
+	*gathered = NULL;
+	if (ndtf_bricks_isContiguous(&encode->bricks, extent))
+		return encode->volume + ndtf_bricks_offset(&encode->bricks, origin);
+
+	*gathered = (uint8_t*)ndtf_mem_alloc(encode->ctx, brickSize);
+	if (!*gathered)
+	{
+		ndtf_atomic_store_u64(&encode->failed, 1);
+		return NULL;
+	}
+	ndtf_bricks_gather(&encode->bricks, encode->volume, origin, extent, *gathered);
+	return *gathered;
+}
+
+static void ndtf_segments_hashTask(void* taskData, size_t index)
+{
+	ndtf_SegmentEncode* encode = (ndtf_SegmentEncode*)taskData;
+	if (ndtf_atomic_load_u64(&encode->failed))
+		return;
+
+	size_t origin[NDTF_DIMENSIONS_MAX];
+	size_t extent[NDTF_DIMENSIONS_MAX];
+	size_t brickSize = ndtf_bricks_get(&encode->bricks, index, origin, extent);
+
+	uint8_t* gathered;
+	const uint8_t* raw = ndtf_segments_brickData(encode, origin, extent, brickSize, &gathered);
+	if (raw)
+		encode->hashes[index] = ndtf_hash128(raw, brickSize, 0);
+	ndtf_mem_free(encode->ctx, gathered);
+}
+
+// links every brick to the first brick with the same hash and extent, the texels are compared when encoding
+static bool ndtf_segments_findDuplicates(ndtf_SegmentEncode* encode, size_t* original, size_t count)
+{
+	size_t capacity = 16;
+	while (capacity < count * 2)
+		capacity *= 2;
+
+	size_t* slots = (size_t*)ndtf_mem_alloc(encode->ctx, capacity * sizeof(size_t));
+	if (!slots)
+		return false;
+	for (size_t i = 0; i < capacity; i++)
+		slots[i] = SIZE_MAX;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		original[i] = i;
+
+		size_t origin[NDTF_DIMENSIONS_MAX];
+		size_t extent[NDTF_DIMENSIONS_MAX];
+		size_t otherExtent[NDTF_DIMENSIONS_MAX];
+		ndtf_bricks_get(&encode->bricks, i, origin, extent);
+
+		const ndtf_Hash128* hash = &encode->hashes[i];
+		for (size_t slot = (size_t)hash->low & (capacity - 1); ; slot = (slot + 1) & (capacity - 1))
+		{
+			size_t other = slots[slot];
+			if (other == SIZE_MAX)
+			{
+				slots[slot] = i;
+				break;
+			}
+
+			if (encode->hashes[other].low == hash->low && encode->hashes[other].high == hash->high)
+			{
+				ndtf_bricks_get(&encode->bricks, other, origin, otherExtent);
+				if (memcmp(extent, otherExtent, sizeof(extent)) == 0)
+				{
+					original[i] = other;
+					break;
+				}
+			}
+		}
+	}
+
+	ndtf_mem_free(encode->ctx, slots);
+	return true;
+}
+
+static bool ndtf_segments_isDuplicate(ndtf_SegmentEncode* encode, size_t index, const uint8_t* raw, size_t brickSize)
+{
+	size_t original = encode->encoded->original[index];
+	if (original == index)
+		return false;
+
+	size_t origin[NDTF_DIMENSIONS_MAX];
+	size_t extent[NDTF_DIMENSIONS_MAX];
+	ndtf_bricks_get(&encode->bricks, original, origin, extent);
+
+	uint8_t* gathered;
+	const uint8_t* other = ndtf_segments_brickData(encode, origin, extent, brickSize, &gathered);
+	bool same = other && memcmp(raw, other, brickSize) == 0;
+	ndtf_mem_free(encode->ctx, gathered);
+
+	// a hash collision keeps the brick on its own
+	if (!same)
+		encode->encoded->original[index] = index;
+	return same;
+}
+
+// transformed copy of a brick, replaces the gathered buffer or is made in it
+static const uint8_t* ndtf_segments_transformBrick(ndtf_SegmentEncode* encode, const uint8_t* raw, size_t brickSize, uint8_t** gathered)
+{
+	if (!*gathered)
+		*gathered = (uint8_t*)ndtf_mem_alloc(encode->ctx, brickSize);
+	if (!*gathered)
+	{
+		ndtf_atomic_store_u64(&encode->failed, 1);
+		return NULL;
+	}
+	ndtf_transform_run(encode->transform, raw, *gathered, brickSize / encode->bricks.texelSize);
+	return *gathered;
+}
+
+// difference of a brick to the brick of the previous slice, replaces the gathered buffer
+static const uint8_t* ndtf_segments_deltaBrick(ndtf_SegmentEncode* encode, size_t index, const uint8_t* raw, size_t brickSize, uint8_t** gathered)
+{
+	size_t origin[NDTF_DIMENSIONS_MAX];
+	size_t extent[NDTF_DIMENSIONS_MAX];
+	ndtf_bricks_get(&encode->bricks, index - encode->deltaStride, origin, extent);
+
+	uint8_t* previousGathered;
+	const uint8_t* previous = ndtf_segments_brickData(encode, origin, extent, brickSize, &previousGathered);
+	if (previous && encode->transform)
+		previous = ndtf_segments_transformBrick(encode, previous, brickSize, &previousGathered);
+	uint8_t* delta = previous ? (uint8_t*)ndtf_mem_alloc(encode->ctx, brickSize) : NULL;
+	if (delta)
+		ndtf_delta_encode((NDTF_TexelFormat)encode->header->texelFormat, raw, previous, delta, brickSize / encode->bricks.texelSize);
+	else
+		ndtf_atomic_store_u64(&encode->failed, 1);
+
+	ndtf_mem_free(encode->ctx, previousGathered);
+	ndtf_mem_free(encode->ctx, *gathered);
+	*gathered = delta;
+	return delta;
+}
+
+// brick split into its channel planes, replaces the gathered buffer
+static const uint8_t* ndtf_segments_planarBrick(ndtf_SegmentEncode* encode, const uint8_t* raw, size_t brickSize, uint8_t** gathered)
+{
+	uint8_t* planes = (uint8_t*)ndtf_mem_alloc(encode->ctx, brickSize);
+	if (planes)
+		ndtf_planar_split((NDTF_TexelFormat)encode->header->texelFormat, raw, planes, brickSize / encode->bricks.texelSize, encode->ctx);
+	else
+		ndtf_atomic_store_u64(&encode->failed, 1);
+
+	ndtf_mem_free(encode->ctx, *gathered);
+	*gathered = planes;
+	return planes;
+}
+
+static void ndtf_segments_encodeTask(void* taskData, size_t index)
+{
+	ndtf_SegmentEncode* encode = (ndtf_SegmentEncode*)taskData;
+	if (ndtf_atomic_load_u64(&encode->failed))
+		return;
+
+	if (encode->indices)
+		index = encode->indices[index];
+	NDTF_Segment* segment = &encode->encoded->segments[index];
+
+	size_t origin[NDTF_DIMENSIONS_MAX];
+	size_t extent[NDTF_DIMENSIONS_MAX];
+	size_t brickSize = ndtf_bricks_get(&encode->bricks, index, origin, extent);
+
+	uint8_t* gathered;
+	const uint8_t* raw = ndtf_segments_brickData(encode, origin, extent, brickSize, &gathered);
+	if (!raw)
+		return;
+
+	// duplicates are found on the texels of the file, they stay duplicates once transformed
+	bool duplicate = encode->encoded->original && ndtf_segments_isDuplicate(encode, index, raw, brickSize);
+
+	if (encode->transform)
+	{
+		raw = ndtf_segments_transformBrick(encode, raw, brickSize, &gathered);
+		if (!raw)
+			return;
+	}
+
+	// one pass over the brick serves both the zone map and the statistics
+	if (encode->encoded->zoneMaps || encode->texelStats)
+	{
+		size_t texels = brickSize / encode->bricks.texelSize;
+		ndtf_TexelStatsPartial partial;
+		ndtf_texelStats_compute(raw, texels, (NDTF_TexelFormat)encode->header->texelFormat, &partial);
+
+		if (encode->encoded->zoneMaps)
+			ndtf_zoneMaps_fromStats(encode->header, encode->errorBound, &partial, encode->encoded->zoneMaps + index * encode->channels);
+		if (encode->texelStats)
+			ndtf_texelStats_addComputed(encode->texelStats, &partial, raw, texels, encode->ctx);
+	}
+
+	// duplicates take over the segment of their original once all bricks are encoded
+	if (duplicate)
+	{
+		ndtf_mem_free(encode->ctx, gathered);
+		return;
+	}
+
+	if (encode->deltaAxis >= 0 && !ndtf_delta_isKeyframe(encode->header, origin[encode->deltaAxis]))
+	{
+		raw = ndtf_segments_deltaBrick(encode, index, raw, brickSize, &gathered);
+		if (!raw)
+			return;
+	}
+
+	if (!encode->errorBound && ndtf_planar_enabled(encode->header))
+	{
+		raw = ndtf_segments_planarBrick(encode, raw, brickSize, &gathered);
+		if (!raw)
+			return;
+	}
+
+	segment->codec = encode->codec;
+
+	// lossless bricks that do not shrink by the least gain are stored raw, their segment says so
+	bool compressed = encode->errorBound || (encode->codec != NDTF_CODEC_NONE && ndtf_codec_isPromising(encode->codec, raw, brickSize, encode->ctx));
+	if (compressed)
+	{
+		size_t compressedSize = 0;
+		uint8_t* buffer;
+		if (encode->errorBound)
+			buffer = ndtf_lossy_encode(encode->header, raw, extent, encode->errorBound, 0, &compressedSize, encode->ctx);
+		else
+			buffer = ndtf_codec_compress(encode->codec, raw, brickSize, 0, &compressedSize, encode->ctx);
+
+		if (!buffer)
+		{
+			ndtf_mem_free(encode->ctx, gathered);
+			ndtf_atomic_store_u64(&encode->failed, 1);
+			return;
+		}
+
+		compressed = encode->errorBound || ndtf_codec_pays(encode->codec, brickSize, compressedSize, encode->ctx);
+		if (compressed)
+		{
+			ndtf_mem_free(encode->ctx, gathered);
+			encode->encoded->buffers[index] = buffer;
+			encode->encoded->data[index] = buffer;
+			segment->size = compressedSize;
+		}
+		else
+			ndtf_mem_free(encode->ctx, buffer);
+	}
+	if (!compressed)
+	{
+		segment->codec = NDTF_CODEC_NONE;
+		encode->encoded->buffers[index] = gathered;
+		encode->encoded->data[index] = raw;
+		segment->size = brickSize;
+	}
+
+	if (encode->checksums)
+		segment->checksum = ndtf_crc32c(0, encode->encoded->data[index], (size_t)segment->size);
+}
+
+static bool ndtf_segments_encodeInit(NDTF_File* file, ndtf_EncodedSegments* encoded, ndtf_SegmentEncode* encode, ndtf_TexelStatsSink* texelStats, const NDTF_Transform* transform, const ndtf_LossyBound* errorBound, const NDTF_Context* ctx)
+{
+	memset(encoded, 0, sizeof(ndtf_EncodedSegments));
+
+	memset(encode, 0, sizeof(ndtf_SegmentEncode));
+	encode->header = &file->header;
+	if (ndtf_lossy_enabled(&file->header))
+	{
+		if (!errorBound)
+		{
+			ndtf_lossy_resolveFile(&encode->resolvedBound, file, transform, ctx);
+			errorBound = &encode->resolvedBound;
+		}
+		encode->errorBound = errorBound;
+	}
+	ndtf_bricks_init(&encode->bricks, &file->header);
+	encode->volume = file->data;
+	encode->encoded = encoded;
+	encode->codec = ndtf_file_getCodec(file);
+	encode->checksums = ndtf_file_getChecksums(file);
+	encode->texelStats = texelStats;
+	encode->transform = transform;
+	encode->channels = ndtf_getChannelCount((NDTF_TexelFormat)file->header.texelFormat);
+	encode->deltaAxis = ndtf_delta_axis(&file->header);
+	encode->deltaStride = 1;
+	for (int i = 0; i < encode->deltaAxis; i++)
+		encode->deltaStride *= encode->bricks.grid[i];
+	encode->ctx = ctx;
+
+	size_t count = encode->bricks.count;
+	encoded->table.count = count;
+	encoded->segments = (NDTF_Segment*)ndtf_mem_alloc(ctx, count * sizeof(NDTF_Segment));
+	encoded->data = (const uint8_t**)ndtf_mem_alloc(ctx, count * sizeof(uint8_t*));
+	encoded->buffers = (uint8_t**)ndtf_mem_alloc(ctx, count * sizeof(uint8_t*));
+	if (file->header.flags.zoneMaps)
+	{
+		encoded->zoneTable.count = count * encode->channels;
+		encoded->zoneMaps = (NDTF_ValueRange*)ndtf_mem_alloc(ctx, max(count * encode->channels * sizeof(NDTF_ValueRange), 1));
+	}
+	if (!encoded->segments || !encoded->data || !encoded->buffers || (file->header.flags.zoneMaps && !encoded->zoneMaps))
+	{
+		ndtf_segments_freeEncoded(encoded, ctx);
+		return false;
+	}
+	memset(encoded->segments, 0, count * sizeof(NDTF_Segment));
+	memset(encoded->buffers, 0, count * sizeof(uint8_t*));
+	return true;
+}
+
+bool ndtf_segments_encode(NDTF_File* file, ndtf_EncodedSegments* encoded, ndtf_TexelStatsSink* texelStats, const NDTF_Transform* transform, const ndtf_LossyBound* errorBound, const NDTF_Context* ctx)
+{
+	ndtf_SegmentEncode encode;
+	if (!ndtf_segments_encodeInit(file, encoded, &encode, texelStats, transform, errorBound, ctx))
+		return false;
+	size_t count = encode.bricks.count;
+
+	if (file->header.flags.deduplicated && encode.deltaAxis < 0)
+	{
+		encoded->original = (size_t*)ndtf_mem_alloc(ctx, max(count * sizeof(size_t), 1));
+		encode.hashes = (ndtf_Hash128*)ndtf_mem_alloc(ctx, max(count * sizeof(ndtf_Hash128), 1));
+		if (encode.hashes && encoded->original)
+		{
+			ndtf_parallelFor(ctx, ndtf_segments_hashTask, &encode, count);
+			if (!encode.failed && !ndtf_segments_findDuplicates(&encode, encoded->original, count))
+				encode.failed = 1;
+		}
+		else
+			encode.failed = 1;
+		ndtf_mem_free(ctx, encode.hashes);
+	}
+
+	if (!encode.failed)
+		ndtf_parallelFor(ctx, ndtf_segments_encodeTask, &encode, count);
+
+	if (encode.failed)
+	{
+		ndtf_segments_freeEncoded(encoded, ctx);
+		return false;
+	}
+
+	// originals always come first, so their offsets are known when a duplicate refers to them
+	NDTF_Header stored;
+	ndtf_header_prepare(&file->header, &stored);
+	size_t offset = ndtf_header_storedSize(&stored) + sizeof(NDTF_SegmentTable) + ndtf_segments_tableSize(&file->header, count);
+	for (size_t i = 0; i < count; i++)
+	{
+		if (encoded->original && encoded->original[i] != i)
+		{
+			encoded->segments[i] = encoded->segments[encoded->original[i]];
+			encoded->data[i] = encoded->data[encoded->original[i]];
+			continue;
+		}
+		encoded->segments[i].offset = offset;
+		offset += (size_t)encoded->segments[i].size;
+	}
+	encoded->totalSize = offset;
+
+	if (encode.checksums)
+	{
+		encoded->table.checksum = ndtf_crc32c(0, encoded->segments, count * sizeof(NDTF_Segment));
+		if (encoded->zoneMaps)
+			encoded->zoneTable.checksum = ndtf_crc32c(0, encoded->zoneMaps, (size_t)encoded->zoneTable.count * sizeof(NDTF_ValueRange));
+	}
+
+	return true;
+}
+
+bool ndtf_segments_encodeBricks(NDTF_File* file, const size_t* bricks, size_t count, ndtf_EncodedSegments* encoded, const NDTF_Transform* transform, const NDTF_Context* ctx)
+{
+	ndtf_SegmentEncode encode;
+	if (!ndtf_segments_encodeInit(file, encoded, &encode, NULL, transform, NULL, ctx))
+		return false;
+	encode.indices = bricks;
+
+	ndtf_parallelFor(ctx, ndtf_segments_encodeTask, &encode, count);
+
+	if (encode.failed)
+	{
+		ndtf_segments_freeEncoded(encoded, ctx);
+		return false;
+	}
+	return true;
+}
+
+void ndtf_segments_freeEncoded(ndtf_EncodedSegments* encoded, const NDTF_Context* ctx)
+{
+	if (encoded->buffers)
+	{
+		for (size_t i = 0; i < (size_t)encoded->table.count; i++)
+			ndtf_mem_free(ctx, encoded->buffers[i]);
+	}
+	ndtf_mem_free(ctx, encoded->buffers);
+	ndtf_mem_free(ctx, (void*)encoded->data);
+	ndtf_mem_free(ctx, encoded->segments);
+	ndtf_mem_free(ctx, encoded->zoneMaps);
+	ndtf_mem_free(ctx, encoded->original);
+	memset(encoded, 0, sizeof(ndtf_EncodedSegments));
+}
+
+// verification
+
+#define NDTF_VERIFY_PIECE (4u << 20)
+#define NDTF_VERIFY_MIN_PIECE (256u << 10)
+#define NDTF_VERIFY_WINDOW (32u << 20) // bytes of a file read and checked at once
+#define NDTF_VERIFY_WINDOW_PIECES 4096
+
+typedef struct ndtf_VerifyPiece
+{
+	size_t segment;
+	const uint8_t* data;
+	size_t size;
+	uint32_t crc;
+} ndtf_VerifyPiece;
+
+// checksum of the segment the pieces belong to so far
+typedef struct ndtf_VerifyFold
+{
+	uint64_t done;
+	uint32_t crc;
+} ndtf_VerifyFold;
+
+static void ndtf_verifyTask(void* taskData, size_t index)
+{
+	ndtf_VerifyPiece* piece = &((ndtf_VerifyPiece*)taskData)[index];
+	piece->crc = ndtf_crc32c(0, piece->data, piece->size);
+}
+
+// combines the checksums of pieces that follow each other in segment order, false on the first segment that does
+// not match. a segment may continue in the pieces of the next call
+static bool ndtf_verify_fold(const NDTF_Segment* segments, const ndtf_VerifyPiece* pieces, size_t count, ndtf_VerifyFold* fold)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		const ndtf_VerifyPiece* piece = &pieces[i];
+		fold->crc = fold->done ? ndtf_crc32c_combine(fold->crc, piece->crc, piece->size) : piece->crc;
+		fold->done += piece->size;
+		if (fold->done == segments[piece->segment].size)
+		{
+			if (fold->crc != segments[piece->segment].checksum)
+				return false;
+			fold->done = 0;
+		}
+	}
+	return true;
+}
+
+NDTF_VerifyResult ndtf_verifyData(const uint8_t* data, size_t size, const NDTF_Context* ctx)
+{
+	NDTF_Header header;
+	if (!ndtf_header_decode(data, size, &header))
+		return NDTF_VERIFY_BAD_HEADER;
+
+	if (!header.flags.segmented)
+		return NDTF_VERIFY_NO_CHECKSUMS;
+
+	NDTF_Segment* segments;
+	size_t count;
+	if (!ndtf_segments_parse(&header, data, size, &segments, &count, ctx))
+		return NDTF_VERIFY_BAD_SEGMENT_TABLE;
+
+	if (!header.flags.checksums)
+	{
+		ndtf_mem_free(ctx, segments);
+		return NDTF_VERIFY_NO_CHECKSUMS;
+	}
+
+	// large segments are split into pieces so a single huge segment still uses every core
+	size_t pieceCount = 0;
+	for (size_t i = 0; i < count; i++)
+		pieceCount += max(((size_t)segments[i].size + NDTF_VERIFY_PIECE - 1) / NDTF_VERIFY_PIECE, 1);
+
+	ndtf_VerifyPiece* pieces = (ndtf_VerifyPiece*)ndtf_mem_alloc(ctx, pieceCount * sizeof(ndtf_VerifyPiece));
+	if (!pieces)
+	{
+		ndtf_mem_free(ctx, segments);
+		return NDTF_VERIFY_IO_ERROR;
+	}
+
+	size_t p = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t offset = 0;
+		do
+		{
+			pieces[p].segment = i;
+			pieces[p].data = data + segments[i].offset + offset;
+			pieces[p].size = min((size_t)segments[i].size - offset, NDTF_VERIFY_PIECE);
+			offset += pieces[p].size;
+			p++;
+		} while (offset < segments[i].size);
+	}
+
+	ndtf_parallelFor(ctx, ndtf_verifyTask, pieces, pieceCount);
+
+	ndtf_VerifyFold fold;
+	memset(&fold, 0, sizeof(ndtf_VerifyFold));
+	NDTF_VerifyResult result = ndtf_verify_fold(segments, pieces, pieceCount, &fold) ? NDTF_VERIFY_OK : NDTF_VERIFY_BAD_SEGMENT;
+
+	ndtf_mem_free(ctx, pieces);
+	ndtf_mem_free(ctx, segments);
+
+	return result;
+}
+
+NDTF_VerifyResult ndtf_verifyFile(FILE* file, const NDTF_Context* ctx)
+{
+	if (!file)
+		return NDTF_VERIFY_IO_ERROR;
+
+	if (ndtf_fseek64(file, 0, SEEK_END) != 0)
+		return NDTF_VERIFY_IO_ERROR;
+	int64_t fileSize = ndtf_ftell64(file);
+	if (fileSize < 0 || ndtf_fseek64(file, 0, SEEK_SET) != 0)
+		return NDTF_VERIFY_IO_ERROR;
+
+	NDTF_Header header;
+	if (!ndtf_header_read(file, &header))
+		return NDTF_VERIFY_BAD_HEADER;
+
+	if (!header.flags.segmented)
+		return NDTF_VERIFY_NO_CHECKSUMS;
+
+	// the table is read into memory, segments are streamed through a bounded window
+	NDTF_SegmentTable table;
+	if (fread(&table, 1, sizeof(NDTF_SegmentTable), file) != sizeof(NDTF_SegmentTable) ||
+		table.count > (uint64_t)fileSize / sizeof(NDTF_Segment))
+		return NDTF_VERIFY_BAD_SEGMENT_TABLE;
+
+	size_t entriesSize = ndtf_segments_tableSize(&header, (size_t)table.count);
+	uint8_t* entries = (uint8_t*)ndtf_mem_alloc(ctx, max(entriesSize, 1));
+	if (!entries)
+		return NDTF_VERIFY_IO_ERROR;
+
+	NDTF_Segment* segments = NULL;
+	bool valid = fread(entries, 1, entriesSize, file) == entriesSize &&
+		ndtf_segments_validate(&header, &table, entries, (uint64_t)fileSize, &segments, ctx);
+	ndtf_mem_free(ctx, entries);
+
+	if (!valid)
+		return NDTF_VERIFY_BAD_SEGMENT_TABLE;
+
+	if (!header.flags.checksums)
+	{
+		ndtf_mem_free(ctx, segments);
+		return NDTF_VERIFY_NO_CHECKSUMS;
+	}
+
+	uint8_t* window = (uint8_t*)ndtf_mem_alloc(ctx, NDTF_VERIFY_WINDOW);
+	ndtf_VerifyPiece* pieces = (ndtf_VerifyPiece*)ndtf_mem_alloc(ctx, NDTF_VERIFY_WINDOW_PIECES * sizeof(ndtf_VerifyPiece));
+	if (!window || !pieces)
+	{
+		ndtf_mem_free(ctx, window);
+		ndtf_mem_free(ctx, pieces);
+		ndtf_mem_free(ctx, segments);
+		return NDTF_VERIFY_IO_ERROR;
+	}
+
+	// a window is cut into about two pieces per thread
+	size_t pieceSize = NDTF_VERIFY_WINDOW / (2 * max(ndtf_getHardwareConcurrency(), 1));
+	pieceSize = min(max(pieceSize, NDTF_VERIFY_MIN_PIECE), NDTF_VERIFY_PIECE);
+
+	// every window is filled with the next pieces in segment order, checked in parallel and folded into the
+	// checksums of their segments
+	ndtf_VerifyFold fold;
+	memset(&fold, 0, sizeof(ndtf_VerifyFold));
+	NDTF_VerifyResult result = NDTF_VERIFY_OK;
+	size_t segment = 0;
+	uint64_t offset = 0;	// within segment
+	int64_t position = -1;	// of file
+	while (segment < (size_t)table.count && result == NDTF_VERIFY_OK)
+	{
+		size_t used = 0, count = 0;
+		while (segment < (size_t)table.count && count < NDTF_VERIFY_WINDOW_PIECES && used < NDTF_VERIFY_WINDOW)
+		{
+			const NDTF_Segment* stored = &segments[segment];
+			size_t size = (size_t)min(stored->size - offset, (uint64_t)min(pieceSize, NDTF_VERIFY_WINDOW - used));
+			int64_t start = (int64_t)(stored->offset + offset);
+			if (start != position && ndtf_fseek64(file, start, SEEK_SET) != 0)
+			{
+				result = NDTF_VERIFY_IO_ERROR;
+				break;
+			}
+
+			NDTF_SCOPE_BEGIN(ioScope, ctx, NDTF_PHASE_IO, "fread");
+			size_t bytesRead = fread(window + used, 1, size, file);
+			NDTF_SCOPE_END(ioScope, ctx, bytesRead);
+
+			if (bytesRead != size)
+			{
+				result = NDTF_VERIFY_IO_ERROR;
+				break;
+			}
+			position = start + (int64_t)size;
+
+			pieces[count].segment = segment;
+			pieces[count].data = window + used;
+			pieces[count].size = size;
+			count++;
+			used += size;
+			offset += size;
+			if (offset == stored->size)
+			{
+				segment++;
+				offset = 0;
+			}
+		}
+
+		if (result != NDTF_VERIFY_OK)
+			break;
+
+		ndtf_parallelFor(ctx, ndtf_verifyTask, pieces, count);
+		if (!ndtf_verify_fold(segments, pieces, count, &fold))
+			result = NDTF_VERIFY_BAD_SEGMENT;
+	}
+
+	ndtf_mem_free(ctx, pieces);
+	ndtf_mem_free(ctx, window);
+	ndtf_mem_free(ctx, segments);
+
+	return result;
+}
+
+NDTF_VerifyResult ndtf_verify(const char* filename, const NDTF_Context* ctx)
+{
+	FILE* file = fopen(filename, "rb");
+	if (!file)
+		return NDTF_VERIFY_IO_ERROR;
+
+	NDTF_VerifyResult result = ndtf_verifyFile(file, ctx);
+	fclose(file);
+
+	return result;
+}
@@ -0,0 +1,311 @@
+#include "ndtf_internal.h"
+#include <string.h>
+
+// every file is placed along the outermost axis of the stack, so each one fills a contiguous block of the output
+// and is decoded straight into it. headers are probed first, the files are then loaded in parallel. the transform of
+// the context is fused into the decode of segmented files and otherwise applied to the block of each file once it is
+// in place
+
+typedef struct ndtf_Stack
+{
+	const char* const* filenames;
+	NDTF_Header* headers;
+	size_t* offsets;				// of every file in volume, in bytes
+	uint8_t* volume;
+	NDTF_TexelFormat texelFormat;	// of volume
+	const NDTF_Transform* transform;
+	volatile uint64_t failed;
+	const NDTF_Context* ctx;
+} ndtf_Stack;
+
+// target of the bricks of one file converted while they are decoded
+typedef struct ndtf_StackBricks
+{
+	uint8_t* volume;
+	size_t size[NDTF_DIMENSIONS_MAX];
+	NDTF_TexelFormat srcFormat, dstFormat;
+	size_t texelSize;				// of dstFormat
+	const NDTF_Transform* transform;
+	const NDTF_Context* ctx;
+} ndtf_StackBricks;
+
+static void ndtf_stack_probeTask(void* taskData, size_t index)
+{
+	ndtf_Stack* stack = (ndtf_Stack*)taskData;
+	if (!ndtf_probe(stack->filenames[index], &stack->headers[index]) || !ndtf_header_isValid(&stack->headers[index]))
+		ndtf_atomic_store_u64(&stack->failed, 1);
+}
+
+static bool ndtf_stack_brick(void* user, const size_t origin[NDTF_DIMENSIONS_MAX], const size_t extent[NDTF_DIMENSIONS_MAX], const uint8_t* brick)
+{
+	const ndtf_StackBricks* target = (const ndtf_StackBricks*)user;
+	size_t rows = extent[1] * extent[2] * extent[3] * extent[4];
+	size_t srcRow = extent[0] * ndtf_getTexelSize(target->srcFormat);
+	const size_t* size = target->size;
+
+	for (size_t r = 0; r < rows; r++)
+	{
+		size_t rest = r;
+		size_t y = origin[1] + rest % extent[1];
+		rest /= extent[1];
+		size_t z = origin[2] + rest % extent[2];
+		rest /= extent[2];
+		size_t w = origin[3] + rest % extent[3];
+		size_t v = origin[4] + rest / extent[3];
+
+		size_t texel = origin[0] + size[0] * (y + size[1] * (z + size[2] * (w + size[3] * v)));
+		uint8_t* row = target->volume + texel * target->texelSize;
+		ndtf_reformat_convert(target->srcFormat, brick + r * srcRow, target->dstFormat, row, extent[0], target->ctx);
+		if (target->transform)
+			ndtf_transform_run(target->transform, row, row, extent[0]);
+	}
+	return true;
+}
+
+static bool ndtf_stack_readAll(FILE* handle, size_t size, uint8_t** data, const NDTF_Context* ctx)
+{
+	*data = (uint8_t*)ndtf_mem_alloc(ctx, max(size, 1));
+	if (!*data)
+		return false;
+
+	NDTF_SCOPE_BEGIN(ioScope, ctx, NDTF_PHASE_IO, "fread");
+	size_t bytesRead = fread(*data, 1, size, handle);
+	NDTF_SCOPE_END(ioScope, ctx, bytesRead);
+
+	return bytesRead == size;
+}
+
+static bool ndtf_stack_loadFile(const ndtf_Stack* stack, size_t index)
+{
+	const NDTF_Context* ctx = stack->ctx;
+	const NDTF_Header* probed = &stack->headers[index];
+	uint8_t* dst = stack->volume + stack->offsets[index];
+
+	FILE* handle = fopen(stack->filenames[index], "rb");
+	if (!handle)
+		return false;
+
+	int64_t fileSize = -1;
+	if (ndtf_fseek64(handle, 0, SEEK_END) == 0)
+		fileSize = ndtf_ftell64(handle);
+	if (fileSize < 0 || (uint64_t)fileSize > SIZE_MAX || ndtf_fseek64(handle, 0, SEEK_SET) != 0)
+	{
+		fclose(handle);
+		return false;
+	}
+	size_t size = (size_t)fileSize;
+
+	size_t headerSize = ndtf_header_storedSize(probed);
+	size_t dataSize;
+	ndtf_header_getDataSize(probed, &dataSize);
+
+	NDTF_TexelFormat texelFormat = (NDTF_TexelFormat)probed->texelFormat;
+	bool convert = texelFormat != stack->texelFormat;
+	bool raw = !probed->flags.segmented && probed->flags.codec == NDTF_CODEC_NONE && !ndtf_lossy_enabled(probed) && !ndtf_planar_enabled(probed);
+
+	// uncompressed texels are read into their place
+	if (raw && !convert)
+	{
+		bool result = size == headerSize + dataSize && ndtf_fseek64(handle, (int64_t)headerSize, SEEK_SET) == 0;
+		if (result)
+		{
+			NDTF_SCOPE_BEGIN(ioScope, ctx, NDTF_PHASE_IO, "fread");
+			size_t bytesRead = fread(dst, 1, dataSize, handle);
+			NDTF_SCOPE_END(ioScope, ctx, bytesRead);
+			result = bytesRead == dataSize;
+		}
+		fclose(handle);
+		if (result && stack->transform)
+			ndtf_transform_runParallel(stack->transform, dst, dst, dataSize / ndtf_getTexelSize(texelFormat), ctx);
+		return result;
+	}
+
+	uint8_t* data;
+	bool result = ndtf_stack_readAll(handle, size, &data, ctx);
+	fclose(handle);
+
+	// the file must still be the one probed
+	NDTF_Header header;
+	result = result && ndtf_header_decode(data, size, &header) == headerSize && header.texelFormat == probed->texelFormat &&
+		header.dimensions == probed->dimensions && memcmp(header.size, probed->size, sizeof(header.size)) == 0;
+
+	NDTF_Segment* segments = NULL;
+	size_t count = 0;
+	if (result && header.flags.segmented)
+		result = ndtf_segments_parse(&header, data, size, &segments, &count, ctx);
+
+	uint8_t* volume = NULL;
+	const NDTF_Transform* transform = stack->transform;
+	if (result && !convert)
+	{
+		if (header.flags.segmented)
+		{
+			result = ndtf_segments_decode(&header, segments, count, data, dst, NULL, transform, ctx);
+			transform = NULL;
+		}
+		else
+			result = ndtf_payload_decode(&header, data + headerSize, size - headerSize, dst, NULL, ctx);
+	}
+	else if (result && header.flags.segmented && ndtf_delta_axis(&header) < 0)
+	{
+		// bricks are converted and transformed into place while they are still in cache
+		ndtf_StackBricks target;
+		ndtf_Bricks bricks;
+		ndtf_bricks_init(&bricks, &header);
+		target.volume = dst;
+		memcpy(target.size, bricks.size, sizeof(target.size));
+		target.srcFormat = texelFormat;
+		target.dstFormat = stack->texelFormat;
+		target.texelSize = ndtf_getTexelSize(stack->texelFormat);
+		target.transform = transform;
+		target.ctx = ctx;
+		result = ndtf_segments_decodeBricks(&header, segments, count, data, NULL, ndtf_stack_brick, &target, ctx);
+		transform = NULL;
+	}
+	else if (result)
+	{
+		const uint8_t* texels = data + headerSize;
+		if (!raw)
+		{
+			volume = (uint8_t*)ndtf_mem_alloc(ctx, dataSize);
+			result = volume && (header.flags.segmented ? ndtf_segments_decode(&header, segments, count, data, volume, NULL, NULL, ctx) :
+				ndtf_payload_decode(&header, data + headerSize, size - headerSize, volume, NULL, ctx));
+			texels = volume;
+		}
+		else
+			result = size - headerSize == dataSize;
+
+		if (result)
+		{
+			NDTF_SCOPE_BEGIN(convertScope, ctx, NDTF_PHASE_CONVERT, "reformat");
+			ndtf_reformat_convert(texelFormat, texels, stack->texelFormat, dst, dataSize / ndtf_getTexelSize(texelFormat), ctx);
+			NDTF_SCOPE_END(convertScope, ctx, dataSize);
+		}
+	}
+
+	// in the texel format of the stack
+	if (result && transform)
+		ndtf_transform_runParallel(transform, dst, dst, dataSize / ndtf_getTexelSize(texelFormat), ctx);
+
+	ndtf_mem_free(ctx, volume);
+	ndtf_mem_free(ctx, segments);
+	ndtf_mem_free(ctx, data);
+	return result;
+}
+
+static void ndtf_stack_loadTask(void* taskData, size_t index)
+{
+	ndtf_Stack* stack = (ndtf_Stack*)taskData;
+	if (ndtf_atomic_load_u64(&stack->failed))
+		return;
+
+	if (!ndtf_stack_loadFile(stack, index))
+		ndtf_atomic_store_u64(&stack->failed, 1);
+}
+
+NDTF_File ndtf_file_loadStack(const char* const* filenames, size_t count, int axis, NDTF_TexelFormat texelFormat, const NDTF_Context* ctx)
+{
+	NDTF_File result;
+	memset(&result, 0, sizeof(NDTF_File));
+
+	if (!filenames || !count || axis < NDTF_DIMENSIONS_MIN - 1 || axis >= NDTF_DIMENSIONS_MAX)
+		return result;
+
+	// texel statistics are collected over the whole stack once it is assembled, the transform is applied per file
+	NDTF_Context loadCtx;
+	memset(&loadCtx, 0, sizeof(NDTF_Context));
+	if (ctx)
+		loadCtx = *ctx;
+	loadCtx.texelStats = NULL;
+	loadCtx.transform = NULL;
+
+	ndtf_Stack stack;
+	memset(&stack, 0, sizeof(ndtf_Stack));
+	stack.filenames = filenames;
+	stack.ctx = &loadCtx;
+	stack.transform = ctx ? ctx->transform : NULL;
+	stack.headers = (NDTF_Header*)ndtf_mem_alloc(ctx, count * sizeof(NDTF_Header));
+	stack.offsets = (size_t*)ndtf_mem_alloc(ctx, count * sizeof(size_t));
+	if (!stack.headers || !stack.offsets)
+	{
+		ndtf_mem_free(ctx, stack.headers);
+		ndtf_mem_free(ctx, stack.offsets);
+		return result;
+	}
+
+	NDTF_SCOPE_BEGIN(headerScope, ctx, NDTF_PHASE_HEADER, "probe");
+	ndtf_parallelFor(ctx, ndtf_stack_probeTask, &stack, count);
+	NDTF_SCOPE_END(headerScope, ctx, count * sizeof(NDTF_Header));
+
+	// all files have the extents of the first, except along axis when it is their outermost one
+	const NDTF_Header* first = &stack.headers[0];
+	bool valid = !stack.failed && axis >= first->dimensions - 1;
+
+	// blocks are stacked as they are and only along slices
+	bool blocks = valid && (ndtf_getIsBlockCompressed(texelFormat) || ndtf_getIsBlockCompressed((NDTF_TexelFormat)first->texelFormat));
+	valid = valid && (!blocks || (axis >= 2 && (texelFormat == NDTF_TEXELFORMAT_NONE || texelFormat == first->texelFormat)));
+	ndtf_Bricks bricks;
+	if (valid)
+		ndtf_bricks_init(&bricks, first);
+
+	uint32_t size[NDTF_DIMENSIONS_MAX];
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX && valid; i++)
+		size[i] = (uint32_t)bricks.size[i];
+	uint64_t planes = 0;
+	for (size_t f = 0; f < count && valid; f++)
+	{
+		const NDTF_Header* header = &stack.headers[f];
+		valid = header->dimensions == first->dimensions && (!blocks || header->texelFormat == first->texelFormat);
+		for (int i = 0; i < first->dimensions && valid; i++)
+			valid = header->size[i] == first->size[i] || i == axis;
+		planes += axis < first->dimensions ? header->size[axis] : 1;
+	}
+	valid = valid && planes <= UINT32_MAX;
+
+	if (valid)
+	{
+		size[axis] = (uint32_t)planes;
+		if (texelFormat == NDTF_TEXELFORMAT_NONE)
+			texelFormat = (NDTF_TexelFormat)first->texelFormat;
+
+		// the transform is made for the texels of the stack
+		valid = ndtf_transform_fits(ctx, texelFormat);
+	}
+
+	if (valid)
+	{
+		int dimensions = max(first->dimensions, axis + 1);
+		result = ndtf_file_create_ND_ex((NDTF_Dimensions)dimensions, texelFormat, size, ctx);
+		valid = ndtf_file_isValid(&result);
+	}
+
+	if (valid)
+	{
+		size_t texelSize = ndtf_getTexelSize(texelFormat);
+		size_t offset = 0;
+		for (size_t f = 0; f < count; f++)
+		{
+			size_t texels, bytes;
+			ndtf_header_getTexelCount(&stack.headers[f], &texels);
+			bytes = texels * texelSize;
+			if (blocks)
+				ndtf_header_getDataSize(&stack.headers[f], &bytes);
+			stack.offsets[f] = offset;
+			offset += bytes;
+		}
+
+		stack.volume = result.data;
+		stack.texelFormat = texelFormat;
+		ndtf_parallelFor(ctx, ndtf_stack_loadTask, &stack, count);
+		valid = !stack.failed;
+	}
+
+	if (valid && ctx && ctx->texelStats)
+		ndtf_file_computeTexelStats(&result, ctx->texelStats, ctx);
+
+	if (!valid)
+		ndtf_file_free_ex(&result, ctx);
+	ndtf_mem_free(ctx, stack.headers);
+	ndtf_mem_free(ctx, stack.offsets);
+	return result;
+}
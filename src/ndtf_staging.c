@@ -0,0 +1,361 @@
+#include "ndtf_internal.h"
+#include <string.h>
+#include <math.h>
+
+#define NDTF_STAGING_CHUNK ((size_t)1 << 16) // source bytes per copy task
+
+static NDTF_TexelFormat ndtf_staging_expandedFormat(NDTF_TexelFormat texelFormat)
+{
+	switch (texelFormat)
+	{
+	case NDTF_TEXELFORMAT_RGB888: return NDTF_TEXELFORMAT_RGBA8888;
+	case NDTF_TEXELFORMAT_RGB161616: return NDTF_TEXELFORMAT_RGBA16161616;
+	case NDTF_TEXELFORMAT_RGB323232F: return NDTF_TEXELFORMAT_RGBA32323232F;
+	case NDTF_TEXELFORMAT_RGB323232: return NDTF_TEXELFORMAT_RGBA32323232;
+	default: return texelFormat;
+	}
+}
+
+static bool ndtf_staging_align(size_t value, size_t alignment, size_t* result)
+{
+	size_t rest = alignment > 1 ? value % alignment : 0;
+	return ndtf_size_add(value, rest ? alignment - rest : 0, result);
+}
+
+bool ndtf_staging_getLayout(const NDTF_Header* header, const NDTF_StagingOptions* options, NDTF_StagingLayout* layout)
+{
+	memset(layout, 0, sizeof(NDTF_StagingLayout));
+
+	size_t dataSize;
+	if (!ndtf_header_isValid(header) || !ndtf_header_getDataSize(header, &dataSize) || ndtf_getIsBlockCompressed((NDTF_TexelFormat)header->texelFormat))
+		return false;
+
+	NDTF_StagingOptions defaults;
+	memset(&defaults, 0, sizeof(NDTF_StagingOptions));
+	if (!options)
+		options = &defaults;
+
+	ndtf_Bricks bricks;
+	ndtf_bricks_init(&bricks, header);
+
+	NDTF_TexelFormat texelFormat = (NDTF_TexelFormat)header->texelFormat;
+	layout->header = *header;
+	layout->texelFormat = options->expandRGB ? ndtf_staging_expandedFormat(texelFormat) : texelFormat;
+	layout->texelSize = ndtf_getTexelSize(layout->texelFormat);
+	for (int i = 0; i < 3; i++)
+		layout->extent[i] = bricks.size[i];
+	layout->layers = bricks.size[3] * bricks.size[4];
+	layout->fill = options->fill;
+
+	size_t rowBytes, sliceBytes;
+	bool valid = ndtf_size_mul(layout->extent[0], layout->texelSize, &rowBytes) &&
+		ndtf_staging_align(rowBytes, options->rowAlignment, &layout->rowPitch) &&
+		ndtf_size_mul(layout->rowPitch, layout->extent[1], &sliceBytes) &&
+		ndtf_staging_align(sliceBytes, options->sliceAlignment, &layout->slicePitch) &&
+		ndtf_size_mul(layout->slicePitch, layout->extent[2], &layout->layerPitch) &&
+		ndtf_size_mul(layout->layerPitch, layout->layers, &layout->size);
+
+	if (!valid)
+		memset(layout, 0, sizeof(NDTF_StagingLayout));
+	return valid;
+}
+
+size_t ndtf_staging_getRegions(const NDTF_StagingLayout* layout, NDTF_StagingRegion* regions, size_t capacity)
+{
+	size_t ind = layout->header.dimensions > 3 ? max(layout->header.size[3], 1) : 1;
+
+	for (size_t i = 0; regions && i < layout->layers && i < capacity; i++)
+	{
+		NDTF_StagingRegion* region = &regions[i];
+		memset(region, 0, sizeof(NDTF_StagingRegion));
+
+		region->offset = (uint64_t)(i * layout->layerPitch);
+		region->rowPitch = (uint64_t)layout->rowPitch;
+		region->slicePitch = (uint64_t)layout->slicePitch;
+		if (layout->rowPitch % layout->texelSize == 0)
+			region->rowLength = (uint32_t)(layout->rowPitch / layout->texelSize);
+		if (layout->rowPitch && layout->slicePitch % layout->rowPitch == 0)
+			region->imageHeight = (uint32_t)(layout->slicePitch / layout->rowPitch);
+		for (int a = 0; a < 3; a++)
+			region->extent[a] = (uint32_t)layout->extent[a];
+		region->layer = (uint32_t)i;
+		region->coord[0] = (uint32_t)(i % ind);
+		region->coord[1] = (uint32_t)(i / ind);
+	}
+	return layout->layers;
+}
+
+typedef struct ndtf_Staging
+{
+	const NDTF_StagingLayout* layout;
+	uint8_t* buffer;
+	size_t ind;				// size of axis 3, layers are ordered ind-fastest
+	size_t texelSize;		// of the decoded texels
+	size_t channelSize;
+	bool expand;
+	uint8_t fill[sizeof(uint32_t)];
+	ndtf_TexelStatsSink* texelStats;	// bricks passed to ndtf_staging_brick
+	const NDTF_Context* ctx;
+} ndtf_Staging;
+
+static void ndtf_staging_fillValue(const NDTF_StagingLayout* layout, uint8_t fill[sizeof(uint32_t)])
+{
+	NDTF_TexelFormat texelFormat = (NDTF_TexelFormat)layout->header.texelFormat;
+	double value = isnan(layout->fill) ? 0.0 : layout->fill;
+
+	if (ndtf_getChannelIsFloat(texelFormat))
+	{
+		float f = (float)layout->fill;
+		memcpy(fill, &f, sizeof(float));
+		return;
+	}
+
+	size_t channelSize = ndtf_getChannelSize(texelFormat);
+	double top = (double)(channelSize == 4 ? UINT32_MAX : (1u << (channelSize * 8)) - 1);
+	uint32_t stored = (uint32_t)(min(max(value, 0.0), top) + 0.5);
+
+	uint8_t u8 = (uint8_t)stored;
+	uint16_t u16 = (uint16_t)stored;
+	switch (channelSize)
+	{
+	case 1: memcpy(fill, &u8, 1); break;
+	case 2: memcpy(fill, &u16, 2); break;
+	case 4: memcpy(fill, &stored, 4); break;
+	}
+}
+
+#define NDTF_STAGING_EXPAND(type)																	\
+static void ndtf_staging_expand_##type(type* dst, const type* src, size_t texels, const uint8_t* fill)	\
+{																									\
+	type alpha;																						\
+	memcpy(&alpha, fill, sizeof(type));																\
+	for (size_t i = 0; i < texels; i++, dst += 4, src += 3)											\
+	{																								\
+		dst[0] = src[0];																			\
+		dst[1] = src[1];																			\
+		dst[2] = src[2];																			\
+		dst[3] = alpha;																				\
+	}																								\
+}
+
+NDTF_STAGING_EXPAND(uint8_t)
+NDTF_STAGING_EXPAND(uint16_t)
+NDTF_STAGING_EXPAND(uint32_t)
+
+static void ndtf_staging_copyRow(const ndtf_Staging* staging, uint8_t* dst, const uint8_t* src, size_t texels)
+{
+	if (!staging->expand)
+	{
+		memcpy(dst, src, texels * staging->texelSize);
+		return;
+	}
+
+	switch (staging->channelSize)
+	{
+	case 1: ndtf_staging_expand_uint8_t(dst, src, texels, staging->fill); break;
+	case 2: ndtf_staging_expand_uint16_t((uint16_t*)dst, (const uint16_t*)src, texels, staging->fill); break;
+	case 4: ndtf_staging_expand_uint32_t((uint32_t*)dst, (const uint32_t*)src, texels, staging->fill); break;
+	}
+}
+
+// places rows [first, first + count) of a block packed x-fastest at origin
+static void ndtf_staging_copyRows(const ndtf_Staging* staging, const size_t origin[NDTF_DIMENSIONS_MAX], const size_t extent[NDTF_DIMENSIONS_MAX], const uint8_t* block, size_t first, size_t count)
+{
+	const NDTF_StagingLayout* layout = staging->layout;
+	size_t rowBytes = extent[0] * staging->texelSize;
+
+	for (size_t r = first; r < first + count; r++)
+	{
+		size_t rest = r;
+		size_t y = origin[1] + rest % extent[1];
+		rest /= extent[1];
+		size_t z = origin[2] + rest % extent[2];
+		rest /= extent[2];
+		size_t w = origin[3] + rest % extent[3];
+		size_t v = origin[4] + rest / extent[3];
+
+		uint8_t* dst = staging->buffer + (w + v * staging->ind) * layout->layerPitch + z * layout->slicePitch + y * layout->rowPitch + origin[0] * layout->texelSize;
+		ndtf_staging_copyRow(staging, dst, block + r * rowBytes, extent[0]);
+	}
+}
+
+static bool ndtf_staging_brick(void* user, const size_t origin[NDTF_DIMENSIONS_MAX], const size_t extent[NDTF_DIMENSIONS_MAX], const uint8_t* brick)
+{
+	const ndtf_Staging* staging = (const ndtf_Staging*)user;
+	size_t rows = extent[1] * extent[2] * extent[3] * extent[4];
+
+	if (staging->texelStats)
+		ndtf_texelStats_add(staging->texelStats, brick, rows * extent[0], staging->ctx);
+	ndtf_staging_copyRows(staging, origin, extent, brick, 0, rows);
+	return true;
+}
+
+typedef struct ndtf_StagingVolume
+{
+	const ndtf_Staging* staging;
+	const uint8_t* volume;
+	size_t extent[NDTF_DIMENSIONS_MAX];
+	size_t rows;
+	size_t rowsPerTask;
+} ndtf_StagingVolume;
+
+static void ndtf_staging_volumeTask(void* taskData, size_t index)
+{
+	const ndtf_StagingVolume* copy = (const ndtf_StagingVolume*)taskData;
+	size_t origin[NDTF_DIMENSIONS_MAX] = { 0 };
+	size_t first = index * copy->rowsPerTask;
+	ndtf_staging_copyRows(copy->staging, origin, copy->extent, copy->volume, first, min(copy->rowsPerTask, copy->rows - first));
+}
+
+static void ndtf_staging_copyVolume(const ndtf_Staging* staging, const ndtf_Bricks* bricks, const uint8_t* volume)
+{
+	ndtf_StagingVolume copy;
+	copy.staging = staging;
+	copy.volume = volume;
+	memcpy(copy.extent, bricks->size, sizeof(copy.extent));
+	copy.rows = bricks->size[1] * bricks->size[2] * bricks->size[3] * bricks->size[4];
+	copy.rowsPerTask = max(NDTF_STAGING_CHUNK / (bricks->size[0] * bricks->texelSize), 1);
+
+	NDTF_SCOPE_BEGIN(copyScope, staging->ctx, NDTF_PHASE_CONVERT, "staging");
+	ndtf_parallelFor(staging->ctx, ndtf_staging_volumeTask, &copy, (copy.rows + copy.rowsPerTask - 1) / copy.rowsPerTask);
+	NDTF_SCOPE_END(copyScope, staging->ctx, copy.rows * bricks->size[0] * bricks->texelSize);
+}
+
+// decodes a payload into a packed volume, transformed when the context has a transform
+static bool ndtf_staging_decodeVolume(const NDTF_Header* header, const ndtf_Bricks* bricks, const uint8_t* data, size_t size, size_t headerSize, uint8_t* volume, size_t dataSize, ndtf_TexelStatsSink* texelStats, const NDTF_Context* ctx)
+{
+	const NDTF_Transform* transform = ctx ? ctx->transform : NULL;
+
+	if (header->flags.segmented)
+	{
+		NDTF_Segment* segments;
+		size_t count;
+		if (!ndtf_segments_parse(header, data, size, &segments, &count, ctx))
+			return false;
+
+		bool result = ndtf_segments_decode(header, segments, count, data, volume, texelStats, transform, ctx);
+		ndtf_mem_free(ctx, segments);
+		return result;
+	}
+
+	bool result = ndtf_payload_decode(header, data + headerSize, size - headerSize, volume, NULL, ctx);
+	if (result && transform)
+		ndtf_transform_runParallel(transform, volume, volume, dataSize / bricks->texelSize, ctx);
+	if (result && texelStats)
+		ndtf_texelStats_addParallel(texelStats, volume, dataSize / bricks->texelSize, ctx);
+	return result;
+}
+
+bool ndtf_staging_loadFromData(const uint8_t* data, size_t size, const NDTF_StagingLayout* layout, void* staging, const NDTF_Context* ctx)
+{
+	if (!data || !layout || !staging || !layout->size)
+		return false;
+
+	NDTF_Header header;
+
+	NDTF_SCOPE_BEGIN(headerScope, ctx, NDTF_PHASE_HEADER, "header");
+	size_t headerSize = ndtf_header_decode(data, size, &header);
+	NDTF_SCOPE_END(headerScope, ctx, headerSize);
+
+	ndtf_Bricks bricks, expected;
+	size_t dataSize;
+	if (!headerSize || !ndtf_header_getDataSize(&header, &dataSize))
+		return false;
+	ndtf_bricks_init(&bricks, &header);
+	ndtf_bricks_init(&expected, &layout->header);
+	if (header.texelFormat != layout->header.texelFormat || memcmp(bricks.size, expected.size, sizeof(bricks.size)) != 0 ||
+		!ndtf_transform_fits(ctx, (NDTF_TexelFormat)header.texelFormat))
+		return false;
+	const NDTF_Transform* transform = ctx ? ctx->transform : NULL;
+
+	ndtf_Staging target;
+	memset(&target, 0, sizeof(ndtf_Staging));
+	target.layout = layout;
+	target.buffer = (uint8_t*)staging;
+	target.ind = bricks.size[3];
+	target.texelSize = bricks.texelSize;
+	target.channelSize = ndtf_getChannelSize((NDTF_TexelFormat)header.texelFormat);
+	target.expand = layout->texelSize != bricks.texelSize;
+	target.ctx = ctx;
+	ndtf_staging_fillValue(layout, target.fill);
+
+	ndtf_TexelStatsSink texelStats;
+	bool stats = ctx && ctx->texelStats && ndtf_texelStats_begin(&texelStats, ctx->texelStats, (NDTF_TexelFormat)header.texelFormat);
+
+	// without padding and expansion the staging buffer is laid out like the volume itself
+	bool packed = !target.expand && layout->rowPitch == bricks.size[0] * bricks.texelSize &&
+		layout->slicePitch == layout->rowPitch * bricks.size[1];
+
+	bool result;
+	if (header.flags.segmented && !packed && ndtf_delta_axis(&header) < 0)
+	{
+		// every brick is placed while it is still in cache
+		target.texelStats = stats ? &texelStats : NULL;
+
+		NDTF_Segment* segments;
+		size_t count;
+		result = ndtf_segments_parse(&header, data, size, &segments, &count, ctx);
+		if (result)
+		{
+			result = ndtf_segments_decodeBricks(&header, segments, count, data, transform, ndtf_staging_brick, &target, ctx);
+			ndtf_mem_free(ctx, segments);
+		}
+	}
+	else if (!header.flags.segmented && header.flags.codec == NDTF_CODEC_NONE && !ndtf_lossy_enabled(&header) && !ndtf_planar_enabled(&header) && !transform)
+	{
+		result = size - headerSize == dataSize;
+		if (result && stats)
+			ndtf_texelStats_addParallel(&texelStats, data + headerSize, dataSize / bricks.texelSize, ctx);
+		if (result)
+			ndtf_staging_copyVolume(&target, &bricks, data + headerSize);
+	}
+	else if (packed)
+		result = ndtf_staging_decodeVolume(&header, &bricks, data, size, headerSize, target.buffer, dataSize, stats ? &texelStats : NULL, ctx);
+	else
+	{
+		uint8_t* volume = (uint8_t*)ndtf_mem_alloc(ctx, dataSize);
+		result = volume && ndtf_staging_decodeVolume(&header, &bricks, data, size, headerSize, volume, dataSize, stats ? &texelStats : NULL, ctx);
+		if (result)
+			ndtf_staging_copyVolume(&target, &bricks, volume);
+		ndtf_mem_free(ctx, volume);
+	}
+
+	if (stats)
+		ndtf_texelStats_end(&texelStats);
+	return result;
+}
+
+bool ndtf_staging_loadFromFile(FILE* file, const NDTF_StagingLayout* layout, void* staging, const NDTF_Context* ctx)
+{
+	if (!file || ndtf_fseek64(file, 0, SEEK_END) != 0)
+		return false;
+
+	int64_t size = ndtf_ftell64(file);
+	if (size < 0 || (uint64_t)size > SIZE_MAX || ndtf_fseek64(file, 0, SEEK_SET) != 0)
+		return false;
+
+	uint8_t* data = (uint8_t*)ndtf_mem_alloc(ctx, max((size_t)size, 1));
+	if (!data)
+		return false;
+
+	NDTF_SCOPE_BEGIN(ioScope, ctx, NDTF_PHASE_IO, "fread");
+	size_t bytesRead = fread(data, 1, (size_t)size, file);
+	NDTF_SCOPE_END(ioScope, ctx, bytesRead);
+
+	bool result = bytesRead == (size_t)size && ndtf_staging_loadFromData(data, (size_t)size, layout, staging, ctx);
+	ndtf_mem_free(ctx, data);
+
+	return result;
+}
+
+bool ndtf_staging_load(const char* filename, const NDTF_StagingLayout* layout, void* staging, const NDTF_Context* ctx)
+{
+	FILE* file = fopen(filename, "rb");
+	if (!file)
+		return false;
+
+	bool result = ndtf_staging_loadFromFile(file, layout, staging, ctx);
+	fclose(file);
+
+	return result;
+}
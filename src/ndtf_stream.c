@@ -0,0 +1,961 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+	#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "ndtf_internal.h"
+#include <string.h>
+
+// out-of-core processing: the volume is cut into slabs of whole planes along its outermost axis,
+// each slab is read, processed and written before the next one is touched. the transform of the context is applied
+// once, to the texels that are written
+
+#define NDTF_STREAM_COMPARE_SIZE ((size_t)64 << 10) // chunk in which written segments are read back for deduplication
+#define NDTF_STREAM_PLANAR_SIZE ((size_t)64 << 10) // chunk in which the channels of planar sources are read
+
+// outermost axis that is not a single plane
+static int ndtf_stream_axis(const NDTF_Header* header)
+{
+	for (int i = header->dimensions - 1; i > 0; i--)
+	{
+		if (header->size[i] > 1)
+			return i;
+	}
+	return 0;
+}
+
+static uint64_t ndtf_stream_planeBytes(const NDTF_Header* header, int axis)
+{
+	uint64_t bytes = ndtf_getTexelSize((NDTF_TexelFormat)header->texelFormat);
+	for (int i = 0; i < axis; i++)
+		bytes *= header->size[i];
+	return bytes;
+}
+
+static size_t ndtf_stream_planes(const NDTF_Header* header, int axis)
+{
+	return max((size_t)header->size[axis], 1);
+}
+
+typedef struct ndtf_StreamReader
+{
+	FILE* file;
+	NDTF_Header header;
+	int axis;
+	size_t planeBytes;
+	size_t planes;
+
+	// segmented sources are decoded one row of bricks along the axis at a time
+	NDTF_Segment* segments;
+	size_t rowBricks;
+	size_t rowPlanes;
+	size_t rowIndex;
+	uint64_t rowStoredMax;
+	uint8_t* row;
+	uint8_t* stored;
+	size_t storedCapacity;
+	NDTF_Segment* rowSegments;
+
+	// delta encoding along the axis: rows are single slices that are added up from the last keyframe
+	bool delta;
+	uint8_t* deltaRow;
+
+	const NDTF_Context* ctx;
+} ndtf_StreamReader;
+
+static void ndtf_streamReader_close(ndtf_StreamReader* reader)
+{
+	ndtf_mem_free(reader->ctx, reader->segments);
+	ndtf_mem_free(reader->ctx, reader->rowSegments);
+	ndtf_mem_free(reader->ctx, reader->row);
+	ndtf_mem_free(reader->ctx, reader->deltaRow);
+	ndtf_mem_free(reader->ctx, reader->stored);
+	if (reader->file)
+		fclose(reader->file);
+	memset(reader, 0, sizeof(ndtf_StreamReader));
+}
+
+static bool ndtf_streamReader_open(ndtf_StreamReader* reader, const char* filename, const NDTF_Context* ctx)
+{
+	memset(reader, 0, sizeof(ndtf_StreamReader));
+	reader->ctx = ctx;
+	reader->rowIndex = SIZE_MAX;
+
+	reader->file = fopen(filename, "rb");
+	if (!reader->file)
+		return false;
+
+	if (ndtf_fseek64(reader->file, 0, SEEK_END) != 0)
+		return false;
+	int64_t fileSize = ndtf_ftell64(reader->file);
+	if (fileSize < 0 || ndtf_fseek64(reader->file, 0, SEEK_SET) != 0)
+		return false;
+
+	// planes of blocks would split them
+	if (!ndtf_header_read(reader->file, &reader->header) || ndtf_getIsBlockCompressed((NDTF_TexelFormat)reader->header.texelFormat))
+		return false;
+
+	reader->axis = ndtf_stream_axis(&reader->header);
+	reader->planes = ndtf_stream_planes(&reader->header, reader->axis);
+	uint64_t planeBytes = ndtf_stream_planeBytes(&reader->header, reader->axis);
+	if (planeBytes > SIZE_MAX)
+		return false;
+	reader->planeBytes = (size_t)planeBytes;
+
+	if (!reader->header.flags.segmented)
+	{
+		// a single compressed stream can only be decoded as a whole
+		if (reader->header.flags.codec != NDTF_CODEC_NONE || ndtf_lossy_enabled(&reader->header))
+			return false;
+		return (uint64_t)fileSize == ndtf_header_storedSize(&reader->header) + planeBytes * reader->planes;
+	}
+
+	NDTF_SegmentTable table;
+	if (fread(&table, 1, sizeof(NDTF_SegmentTable), reader->file) != sizeof(NDTF_SegmentTable) ||
+		table.count > (uint64_t)fileSize / sizeof(NDTF_Segment))
+		return false;
+
+	size_t entriesSize = ndtf_segments_tableSize(&reader->header, (size_t)table.count);
+	uint8_t* entries = (uint8_t*)ndtf_mem_alloc(ctx, max(entriesSize, 1));
+	if (!entries)
+		return false;
+
+	bool valid = fread(entries, 1, entriesSize, reader->file) == entriesSize &&
+		ndtf_segments_validate(&reader->header, &table, entries, (uint64_t)fileSize, &reader->segments, ctx);
+	ndtf_mem_free(ctx, entries);
+	if (!valid)
+		return false;
+
+	ndtf_Bricks bricks;
+	ndtf_bricks_init(&bricks, &reader->header);
+	reader->rowPlanes = bricks.extent[reader->axis];
+	reader->rowBricks = bricks.count / bricks.grid[reader->axis];
+
+	for (size_t i = 0; i < bricks.grid[reader->axis]; i++)
+	{
+		uint64_t stored = 0;
+		for (size_t j = 0; j < reader->rowBricks; j++)
+			stored += reader->segments[i * reader->rowBricks + j].size;
+		reader->rowStoredMax = max(reader->rowStoredMax, stored);
+	}
+
+	reader->rowSegments = (NDTF_Segment*)ndtf_mem_alloc(ctx, reader->rowBricks * sizeof(NDTF_Segment));
+	reader->row = (uint8_t*)ndtf_mem_alloc(ctx, reader->planeBytes * reader->rowPlanes);
+
+	reader->delta = ndtf_delta_axis(&reader->header) == reader->axis;
+	if (reader->delta)
+	{
+		reader->deltaRow = (uint8_t*)ndtf_mem_alloc(ctx, reader->planeBytes);
+		if (!reader->deltaRow)
+			return false;
+	}
+	return reader->rowSegments && reader->row;
+}
+
+// bytes the reader holds on top of the requested planes
+static uint64_t ndtf_streamReader_memory(const ndtf_StreamReader* reader)
+{
+	if (!reader->header.flags.segmented)
+		return 0;
+	// decoded row plus the stored bytes of the largest row
+	return (uint64_t)reader->planeBytes * (reader->rowPlanes + (reader->delta ? 1 : 0)) + reader->rowStoredMax;
+}
+
+static bool ndtf_streamReader_decodeRow(ndtf_StreamReader* reader, size_t rowIndex, uint8_t* out)
+{
+	const NDTF_Segment* segments = reader->segments + rowIndex * reader->rowBricks;
+
+	uint64_t storedSize = 0;
+	for (size_t i = 0; i < reader->rowBricks; i++)
+		storedSize += segments[i].size;
+	if (storedSize > SIZE_MAX)
+		return false;
+
+	if (storedSize > reader->storedCapacity)
+	{
+		ndtf_mem_free(reader->ctx, reader->stored);
+		reader->storedCapacity = 0;
+		reader->stored = (uint8_t*)ndtf_mem_alloc(reader->ctx, (size_t)storedSize);
+		if (!reader->stored)
+			return false;
+		reader->storedCapacity = (size_t)storedSize;
+	}
+
+	// segments are read into one packed buffer, their offsets are rebased onto it
+	size_t offset = 0;
+	for (size_t i = 0; i < reader->rowBricks; i++)
+	{
+		reader->rowSegments[i] = segments[i];
+		reader->rowSegments[i].offset = offset;
+
+		if (ndtf_fseek64(reader->file, (int64_t)segments[i].offset, SEEK_SET) != 0)
+			return false;
+
+		NDTF_SCOPE_BEGIN(ioScope, reader->ctx, NDTF_PHASE_IO, "fread");
+		size_t bytesRead = fread(reader->stored + offset, 1, (size_t)segments[i].size, reader->file);
+		NDTF_SCOPE_END(ioScope, reader->ctx, bytesRead);
+
+		if (bytesRead != segments[i].size)
+			return false;
+		offset += (size_t)segments[i].size;
+	}
+
+	NDTF_Header rowHeader = reader->header;
+	size_t first = rowIndex * reader->rowPlanes;
+	rowHeader.size[reader->axis] = (uint32_t)min(reader->rowPlanes, reader->planes - first);
+	if (reader->delta)
+		rowHeader.flags.deltaAxis = 0;
+
+	return ndtf_segments_decode(&rowHeader, reader->rowSegments, reader->rowBricks, reader->stored, out, NULL, NULL, reader->ctx);
+}
+
+static bool ndtf_streamReader_loadRow(ndtf_StreamReader* reader, size_t rowIndex)
+{
+	size_t current = reader->rowIndex;
+	if (current == rowIndex)
+		return true;
+	reader->rowIndex = SIZE_MAX;
+
+	if (!reader->delta)
+	{
+		if (!ndtf_streamReader_decodeRow(reader, rowIndex, reader->row))
+			return false;
+		reader->rowIndex = rowIndex;
+		return true;
+	}
+
+	// continues from the loaded slice when it lies between the keyframe and the requested one
+	size_t keyframe = rowIndex;
+	while (!ndtf_delta_isKeyframe(&reader->header, keyframe))
+		keyframe--;
+
+	size_t next = keyframe;
+	if (current != SIZE_MAX && current >= keyframe && current < rowIndex)
+		next = current + 1;
+	else if (!ndtf_streamReader_decodeRow(reader, next++, reader->row))
+		return false;
+
+	NDTF_TexelFormat format = (NDTF_TexelFormat)reader->header.texelFormat;
+	size_t texels = reader->planeBytes / ndtf_getTexelSize(format);
+	for (; next <= rowIndex; next++)
+	{
+		if (!ndtf_streamReader_decodeRow(reader, next, reader->deltaRow))
+			return false;
+		ndtf_delta_decode(format, reader->deltaRow, reader->row, texels);
+
+		uint8_t* swap = reader->row;
+		reader->row = reader->deltaRow;
+		reader->deltaRow = swap;
+	}
+
+	reader->rowIndex = rowIndex;
+	return true;
+}
+
+// planes of planar sources are read channel by channel in chunks of values
+static bool ndtf_streamReader_readPlanar(ndtf_StreamReader* reader, size_t first, size_t count, uint8_t* out)
+{
+	NDTF_TexelFormat format = (NDTF_TexelFormat)reader->header.texelFormat;
+	size_t channels = ndtf_getChannelCount(format);
+	size_t channelSize = ndtf_getChannelSize(format);
+	size_t texelSize = channels * channelSize;
+	size_t planeTexels = reader->planeBytes / texelSize;
+	uint64_t channelBytes = (uint64_t)planeTexels * reader->planes * channelSize;
+
+	uint8_t* values = (uint8_t*)ndtf_mem_alloc(reader->ctx, NDTF_STREAM_PLANAR_SIZE);
+	if (!values)
+		return false;
+
+	bool result = true;
+	size_t total = count * planeTexels;
+	size_t chunk = NDTF_STREAM_PLANAR_SIZE / channelSize;
+	for (size_t c = 0; c < channels && result; c++)
+	{
+		uint64_t offset = ndtf_header_storedSize(&reader->header) + c * channelBytes + (uint64_t)first * planeTexels * channelSize;
+		result = ndtf_fseek64(reader->file, (int64_t)offset, SEEK_SET) == 0;
+
+		for (size_t done = 0; done < total && result; done += chunk)
+		{
+			size_t n = min(chunk, total - done);
+
+			NDTF_SCOPE_BEGIN(ioScope, reader->ctx, NDTF_PHASE_IO, "fread");
+			size_t bytesRead = fread(values, 1, n * channelSize, reader->file);
+			NDTF_SCOPE_END(ioScope, reader->ctx, bytesRead);
+
+			result = bytesRead == n * channelSize;
+			uint8_t* texel = out + done * texelSize + c * channelSize;
+			for (size_t i = 0; i < n && result; i++)
+				memcpy(texel + i * texelSize, values + i * channelSize, channelSize);
+		}
+	}
+
+	ndtf_mem_free(reader->ctx, values);
+	return result;
+}
+
+static bool ndtf_streamReader_read(ndtf_StreamReader* reader, size_t first, size_t count, uint8_t* out)
+{
+	if (!reader->header.flags.segmented && ndtf_planar_enabled(&reader->header))
+		return ndtf_streamReader_readPlanar(reader, first, count, out);
+
+	if (!reader->header.flags.segmented)
+	{
+		if (ndtf_fseek64(reader->file, (int64_t)(ndtf_header_storedSize(&reader->header) + (uint64_t)first * reader->planeBytes), SEEK_SET) != 0)
+			return false;
+
+		NDTF_SCOPE_BEGIN(ioScope, reader->ctx, NDTF_PHASE_IO, "fread");
+		size_t bytesRead = fread(out, 1, count * reader->planeBytes, reader->file);
+		NDTF_SCOPE_END(ioScope, reader->ctx, bytesRead);
+
+		return bytesRead == count * reader->planeBytes;
+	}
+
+	size_t end = first + count;
+	for (size_t plane = first; plane < end; )
+	{
+		size_t rowIndex = plane / reader->rowPlanes;
+		if (!ndtf_streamReader_loadRow(reader, rowIndex))
+			return false;
+
+		size_t rowFirst = rowIndex * reader->rowPlanes;
+		size_t n = min(end, rowFirst + reader->rowPlanes) - plane;
+		memcpy(out + (plane - first) * reader->planeBytes, reader->row + (plane - rowFirst) * reader->planeBytes, n * reader->planeBytes);
+		plane += n;
+	}
+	return true;
+}
+
+typedef struct ndtf_StreamWriter
+{
+	FILE* file;
+	NDTF_Header header;
+	NDTF_Segment* segments;
+	NDTF_ValueRange* zoneMaps;
+	ndtf_Hash128* hashes;	// flags.deduplicated: hash of the stored bytes of every written segment
+	size_t* slots;
+	size_t slotCount;
+	uint8_t* compare;
+	size_t channels;
+	size_t count;
+	size_t next;
+	uint64_t offset;
+	const NDTF_Transform* transform;
+	const ndtf_LossyBound* errorBound;	// resolved against the whole output, NULL when it is not lossy
+	const NDTF_Context* ctx;
+} ndtf_StreamWriter;
+
+static bool ndtf_streamWriter_open(ndtf_StreamWriter* writer, const char* filename, const NDTF_Header* header, const NDTF_Context* ctx)
+{
+	memset(writer, 0, sizeof(ndtf_StreamWriter));
+	writer->transform = ctx ? ctx->transform : NULL;
+	writer->ctx = ctx;
+	ndtf_header_prepare(header, &writer->header);
+
+	// deduplication reads earlier segments back
+	writer->file = fopen(filename, header->flags.deduplicated ? "w+b" : "wb");
+	if (!writer->file)
+		return false;
+
+	if (!ndtf_header_write(writer->file, &writer->header))
+		return false;
+	writer->offset = ndtf_header_storedSize(&writer->header);
+
+	if (!writer->header.flags.segmented)
+		return true;
+
+	ndtf_Bricks bricks;
+	ndtf_bricks_init(&bricks, &writer->header);
+	writer->count = bricks.count;
+	writer->segments = (NDTF_Segment*)ndtf_mem_alloc(ctx, writer->count * sizeof(NDTF_Segment));
+	if (!writer->segments)
+		return false;
+	memset(writer->segments, 0, writer->count * sizeof(NDTF_Segment));
+
+	if (writer->header.flags.zoneMaps)
+	{
+		writer->channels = ndtf_getChannelCount((NDTF_TexelFormat)writer->header.texelFormat);
+		writer->zoneMaps = (NDTF_ValueRange*)ndtf_mem_alloc(ctx, max(writer->count * writer->channels * sizeof(NDTF_ValueRange), 1));
+		if (!writer->zoneMaps)
+			return false;
+	}
+
+	if (writer->header.flags.deduplicated)
+	{
+		writer->slotCount = 16;
+		while (writer->slotCount < writer->count * 2)
+			writer->slotCount *= 2;
+
+		writer->hashes = (ndtf_Hash128*)ndtf_mem_alloc(ctx, max(writer->count * sizeof(ndtf_Hash128), 1));
+		writer->slots = (size_t*)ndtf_mem_alloc(ctx, writer->slotCount * sizeof(size_t));
+		writer->compare = (uint8_t*)ndtf_mem_alloc(ctx, NDTF_STREAM_COMPARE_SIZE);
+		if (!writer->hashes || !writer->slots || !writer->compare)
+			return false;
+		for (size_t i = 0; i < writer->slotCount; i++)
+			writer->slots[i] = SIZE_MAX;
+	}
+
+	// the tables are written last, once the segment sizes are known
+	writer->offset += sizeof(NDTF_SegmentTable) + ndtf_segments_tableSize(&writer->header, writer->count);
+	return ndtf_fseek64(writer->file, (int64_t)writer->offset, SEEK_SET) == 0;
+}
+
+static bool ndtf_streamWriter_sameStored(ndtf_StreamWriter* writer, const NDTF_Segment* written, const uint8_t* data)
+{
+	if (ndtf_fseek64(writer->file, (int64_t)written->offset, SEEK_SET) != 0)
+		return false;
+
+	bool same = true;
+	for (uint64_t done = 0; done < written->size && same; )
+	{
+		size_t chunk = (size_t)min(written->size - done, (uint64_t)NDTF_STREAM_COMPARE_SIZE);
+		same = fread(writer->compare, 1, chunk, writer->file) == chunk && memcmp(writer->compare, data + done, chunk) == 0;
+		done += chunk;
+	}
+	return same;
+}
+
+// a segment that was already written with the same bytes and brick extent, SIZE_MAX if there is none
+static size_t ndtf_streamWriter_findStored(ndtf_StreamWriter* writer, size_t index, const uint8_t* data, const NDTF_Segment* segment)
+{
+	ndtf_Bricks bricks;
+	ndtf_bricks_init(&bricks, &writer->header);
+
+	size_t origin[NDTF_DIMENSIONS_MAX];
+	size_t extent[NDTF_DIMENSIONS_MAX];
+	size_t otherExtent[NDTF_DIMENSIONS_MAX];
+	ndtf_bricks_get(&bricks, index, origin, extent);
+
+	ndtf_Hash128 hash = ndtf_hash128(data, (size_t)segment->size, 0);
+	writer->hashes[index] = hash;
+
+	size_t mask = writer->slotCount - 1;
+	size_t slot = (size_t)hash.low & mask;
+	for (; writer->slots[slot] != SIZE_MAX; slot = (slot + 1) & mask)
+	{
+		size_t other = writer->slots[slot];
+		const NDTF_Segment* written = &writer->segments[other];
+		if (writer->hashes[other].low != hash.low || writer->hashes[other].high != hash.high || written->size != segment->size)
+			continue;
+
+		ndtf_bricks_get(&bricks, other, origin, otherExtent);
+		if (memcmp(extent, otherExtent, sizeof(extent)) == 0 && ndtf_streamWriter_sameStored(writer, written, data))
+			return other;
+	}
+
+	writer->slots[slot] = index;
+	return SIZE_MAX;
+}
+
+// the slab is transformed in place when it is written as it is
+static bool ndtf_streamWriter_write(ndtf_StreamWriter* writer, NDTF_File* slab)
+{
+	if (!writer->header.flags.segmented)
+	{
+		size_t size = ndtf_file_getDataSize(slab);
+		if (writer->transform)
+			ndtf_transform_runParallel(writer->transform, slab->data, slab->data, size / ndtf_getTexelSize((NDTF_TexelFormat)slab->header.texelFormat), writer->ctx);
+
+		NDTF_SCOPE_BEGIN(ioScope, writer->ctx, NDTF_PHASE_IO, "fwrite");
+		size_t bytesWritten = fwrite(slab->data, 1, size, writer->file);
+		NDTF_SCOPE_END(ioScope, writer->ctx, bytesWritten);
+
+		writer->offset += bytesWritten;
+		return bytesWritten == size;
+	}
+
+	ndtf_EncodedSegments encoded;
+	if (!ndtf_segments_encode(slab, &encoded, NULL, writer->transform, writer->errorBound, writer->ctx))
+		return false;
+
+	size_t count = (size_t)encoded.table.count;
+	bool written = writer->next + count <= writer->count;
+
+	NDTF_SCOPE_BEGIN(ioScope, writer->ctx, NDTF_PHASE_IO, "fwrite");
+	for (size_t i = 0; i < count && written; i++)
+	{
+		NDTF_Segment* segment = &writer->segments[writer->next + i];
+		*segment = encoded.segments[i];
+
+		// bricks are deduplicated within the slab when encoding, and against earlier slabs by their stored bytes
+		if (encoded.original && encoded.original[i] != i)
+		{
+			segment->offset = writer->segments[writer->next + encoded.original[i]].offset;
+			continue;
+		}
+		if (writer->hashes)
+		{
+			size_t stored = ndtf_streamWriter_findStored(writer, writer->next + i, encoded.data[i], segment);
+			written = ndtf_fseek64(writer->file, (int64_t)writer->offset, SEEK_SET) == 0;
+			if (stored != SIZE_MAX)
+			{
+				segment->offset = writer->segments[stored].offset;
+				continue;
+			}
+		}
+		segment->offset = writer->offset;
+
+		written = fwrite(encoded.data[i], 1, (size_t)segment->size, writer->file) == segment->size;
+		writer->offset += segment->size;
+	}
+	NDTF_SCOPE_END(ioScope, writer->ctx, written ? encoded.totalSize : 0);
+
+	// slabs hold consecutive bricks
+	if (written && encoded.zoneMaps)
+		memcpy(writer->zoneMaps + writer->next * writer->channels, encoded.zoneMaps, count * writer->channels * sizeof(NDTF_ValueRange));
+
+	writer->next += count;
+	ndtf_segments_freeEncoded(&encoded, writer->ctx);
+	return written;
+}
+
+static bool ndtf_streamWriter_finish(ndtf_StreamWriter* writer)
+{
+	if (!writer->header.flags.segmented)
+		return true;
+
+	if (writer->next != writer->count)
+		return false;
+
+	NDTF_SegmentTable table;
+	memset(&table, 0, sizeof(NDTF_SegmentTable));
+	table.count = writer->count;
+	if (writer->header.flags.checksums)
+		table.checksum = ndtf_crc32c(0, writer->segments, writer->count * sizeof(NDTF_Segment));
+
+	bool written = ndtf_fseek64(writer->file, (int64_t)ndtf_header_storedSize(&writer->header), SEEK_SET) == 0 &&
+		fwrite(&table, 1, sizeof(NDTF_SegmentTable), writer->file) == sizeof(NDTF_SegmentTable) &&
+		fwrite(writer->segments, sizeof(NDTF_Segment), writer->count, writer->file) == writer->count;
+
+	if (written && writer->zoneMaps)
+	{
+		NDTF_ZoneMapTable zoneTable;
+		memset(&zoneTable, 0, sizeof(NDTF_ZoneMapTable));
+		zoneTable.count = writer->count * writer->channels;
+		if (writer->header.flags.checksums)
+			zoneTable.checksum = ndtf_crc32c(0, writer->zoneMaps, (size_t)zoneTable.count * sizeof(NDTF_ValueRange));
+
+		written = fwrite(&zoneTable, 1, sizeof(NDTF_ZoneMapTable), writer->file) == sizeof(NDTF_ZoneMapTable) &&
+			fwrite(writer->zoneMaps, sizeof(NDTF_ValueRange), (size_t)zoneTable.count, writer->file) == zoneTable.count;
+	}
+	return written;
+}
+
+static bool ndtf_streamWriter_close(ndtf_StreamWriter* writer)
+{
+	ndtf_mem_free(writer->ctx, writer->segments);
+	ndtf_mem_free(writer->ctx, writer->zoneMaps);
+	ndtf_mem_free(writer->ctx, writer->hashes);
+	ndtf_mem_free(writer->ctx, writer->slots);
+	ndtf_mem_free(writer->ctx, writer->compare);
+	bool result = writer->file && fclose(writer->file) == 0;
+	memset(writer, 0, sizeof(ndtf_StreamWriter));
+	return result;
+}
+
+// box filter reduction
+
+typedef struct ndtf_Downsample
+{
+	const uint8_t* in;
+	uint8_t* out;
+	size_t inSize[NDTF_DIMENSIONS_MAX];
+	size_t outSize[NDTF_DIMENSIONS_MAX];
+	size_t factor[NDTF_DIMENSIONS_MAX];
+	size_t channels;
+	size_t channelSize;
+	bool isFloat;
+} ndtf_Downsample;
+
+static double ndtf_stream_readChannel(const uint8_t* p, size_t channelSize, bool isFloat)
+{
+	switch (channelSize)
+	{
+	case 1: return *p;
+	case 2: { uint16_t v; memcpy(&v, p, sizeof(v)); return v; }
+	default:
+	{
+		if (isFloat) { float v; memcpy(&v, p, sizeof(v)); return v; }
+		uint32_t v; memcpy(&v, p, sizeof(v)); return v;
+	}
+	}
+}
+
+static void ndtf_stream_writeChannel(uint8_t* p, size_t channelSize, bool isFloat, double value)
+{
+	switch (channelSize)
+	{
+	case 1: *p = (uint8_t)(value + 0.5); break;
+	case 2: { uint16_t v = (uint16_t)(value + 0.5); memcpy(p, &v, sizeof(v)); } break;
+	default:
+	{
+		if (isFloat) { float v = (float)value; memcpy(p, &v, sizeof(v)); }
+		else { uint32_t v = (uint32_t)(value + 0.5); memcpy(p, &v, sizeof(v)); }
+	} break;
+	}
+}
+
+// reduces one row of output texels along x
+static void ndtf_downsampleTask(void* taskData, size_t index)
+{
+	const ndtf_Downsample* ds = (const ndtf_Downsample*)taskData;
+	size_t texelSize = ds->channels * ds->channelSize;
+
+	size_t coord[NDTF_DIMENSIONS_MAX];
+	coord[0] = 0;
+	for (int i = 1; i < NDTF_DIMENSIONS_MAX; i++)
+	{
+		coord[i] = index % ds->outSize[i];
+		index /= ds->outSize[i];
+	}
+
+	size_t boxBegin[NDTF_DIMENSIONS_MAX];
+	size_t boxEnd[NDTF_DIMENSIONS_MAX];
+	for (int i = 1; i < NDTF_DIMENSIONS_MAX; i++)
+	{
+		boxBegin[i] = coord[i] * ds->factor[i];
+		boxEnd[i] = min(boxBegin[i] + ds->factor[i], ds->inSize[i]);
+	}
+
+	uint8_t* out = ds->out;
+	size_t outOffset = 0;
+	for (int i = NDTF_DIMENSIONS_MAX - 1; i >= 0; i--)
+		outOffset = outOffset * ds->outSize[i] + coord[i];
+	out += outOffset * texelSize;
+
+	for (size_t x = 0; x < ds->outSize[0]; x++, out += texelSize)
+	{
+		boxBegin[0] = x * ds->factor[0];
+		boxEnd[0] = min(boxBegin[0] + ds->factor[0], ds->inSize[0]);
+
+		double sum[4] = { 0.0, 0.0, 0.0, 0.0 };
+		size_t samples = 0;
+
+		size_t pos[NDTF_DIMENSIONS_MAX];
+		memcpy(pos, boxBegin, sizeof(pos));
+		for (;;)
+		{
+			size_t offset = 0;
+			for (int i = NDTF_DIMENSIONS_MAX - 1; i >= 0; i--)
+				offset = offset * ds->inSize[i] + pos[i];
+
+			const uint8_t* texel = ds->in + offset * texelSize;
+			for (size_t c = 0; c < ds->channels; c++)
+				sum[c] += ndtf_stream_readChannel(texel + c * ds->channelSize, ds->channelSize, ds->isFloat);
+			samples++;
+
+			int i = 0;
+			for (; i < NDTF_DIMENSIONS_MAX; i++)
+			{
+				if (++pos[i] < boxEnd[i])
+					break;
+				pos[i] = boxBegin[i];
+			}
+			if (i == NDTF_DIMENSIONS_MAX)
+				break;
+		}
+
+		for (size_t c = 0; c < ds->channels; c++)
+			ndtf_stream_writeChannel(out + c * ds->channelSize, ds->channelSize, ds->isFloat, sum[c] / (double)samples);
+	}
+}
+
+static bool ndtf_stream_reduce(NDTF_File* slab, const size_t factor[NDTF_DIMENSIONS_MAX], const NDTF_Context* ctx)
+{
+	NDTF_File result;
+	memset(&result, 0, sizeof(NDTF_File));
+	result.header = slab->header;
+	result.allocator = slab->allocator;
+
+	ndtf_Downsample ds;
+	memset(&ds, 0, sizeof(ndtf_Downsample));
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+	{
+		ds.inSize[i] = i < slab->header.dimensions ? max((size_t)slab->header.size[i], 1) : 1;
+		ds.outSize[i] = (ds.inSize[i] + factor[i] - 1) / factor[i];
+		ds.factor[i] = factor[i];
+		if (i < slab->header.dimensions)
+			result.header.size[i] = (uint32_t)ds.outSize[i];
+	}
+
+	NDTF_TexelFormat format = (NDTF_TexelFormat)slab->header.texelFormat;
+	ds.channels = ndtf_getChannelCount(format);
+	ds.channelSize = ndtf_getChannelSize(format);
+	ds.isFloat = ndtf_getChannelIsFloat(format);
+	ds.in = slab->data;
+
+	result.data = (uint8_t*)ndtf_mem_allocWith(ndtf_file_allocator(&result), ctx, ndtf_file_getDataSize(&result));
+	if (!result.data)
+		return false;
+	ds.out = result.data;
+
+	size_t rows = 1;
+	for (int i = 1; i < NDTF_DIMENSIONS_MAX; i++)
+		rows *= ds.outSize[i];
+
+	NDTF_SCOPE_BEGIN(convertScope, ctx, NDTF_PHASE_CONVERT, "downsample");
+	ndtf_parallelFor(ctx, ndtf_downsampleTask, &ds, rows);
+	NDTF_SCOPE_END(convertScope, ctx, ndtf_file_getDataSize(&result));
+
+	ndtf_file_free_ex(slab, ctx);
+	*slab = result;
+	return true;
+}
+
+// count output planes from plane first on, downsampled and reformatted. the caller frees slab->data, also on failure
+static bool ndtf_stream_readSlab(ndtf_StreamReader* reader, const NDTF_Header* outHeader, const NDTF_StreamOptions* options, const size_t factor[NDTF_DIMENSIONS_MAX], size_t first, size_t count, NDTF_File* slab, const NDTF_Context* ctx)
+{
+	int axis = reader->axis;
+	size_t inFirst = first * factor[axis];
+	size_t inCount = min(count * factor[axis], reader->planes - inFirst);
+
+	memset(slab, 0, sizeof(NDTF_File));
+	slab->header = reader->header;
+	slab->header.flags = outHeader->flags;
+	memcpy(slab->header.brickSize, outHeader->brickSize, sizeof(slab->header.brickSize));
+	slab->header.size[axis] = (uint32_t)inCount;
+	slab->allocator = ndtf_mem_allocator(ctx);
+	slab->errorBound = options->errorBound;
+
+	slab->data = (uint8_t*)ndtf_mem_alloc(ctx, inCount * reader->planeBytes);
+	bool result = slab->data && ndtf_streamReader_read(reader, inFirst, inCount, slab->data);
+
+	bool downsample = false;
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+		downsample |= factor[i] > 1;
+	if (result && downsample)
+		result = ndtf_stream_reduce(slab, factor, ctx);
+
+	if (result && outHeader->texelFormat != reader->header.texelFormat)
+	{
+		ndtf_file_reformat_ex(slab, (NDTF_TexelFormat)outHeader->texelFormat, ctx);
+		result = slab->header.texelFormat == outHeader->texelFormat;
+	}
+	return result;
+}
+
+bool ndtf_stream_process(const char* srcFilename, const char* dstFilename, const NDTF_StreamOptions* options, const NDTF_Context* ctx)
+{
+	ndtf_StreamReader reader;
+	if (!ndtf_streamReader_open(&reader, srcFilename, ctx))
+	{
+		ndtf_streamReader_close(&reader);
+		return false;
+	}
+
+	const NDTF_Header* inHeader = &reader.header;
+	int axis = reader.axis;
+
+	NDTF_Header outHeader;
+	memset(&outHeader, 0, sizeof(NDTF_Header));
+	memcpy(outHeader.signature, NDTF_SIGNATURE, 4);
+	outHeader.dimensions = inHeader->dimensions;
+	outHeader.texelFormat = options->texelFormat != NDTF_TEXELFORMAT_NONE ? options->texelFormat : inHeader->texelFormat;
+	if (ndtf_getIsBlockCompressed((NDTF_TexelFormat)outHeader.texelFormat) || !ndtf_transform_fits(ctx, (NDTF_TexelFormat)outHeader.texelFormat))
+	{
+		ndtf_streamReader_close(&reader);
+		return false;
+	}
+	outHeader.flags.codec = options->codec;
+	outHeader.flags.lossy = options->errorBound.mode != NDTF_ERRORBOUND_NONE;
+	outHeader.flags.segmented = options->segmented || options->checksums || options->zoneMaps || options->deduplicated || options->codec != NDTF_CODEC_NONE || outHeader.flags.lossy || options->planar;
+	outHeader.flags.planar = options->planar;
+	outHeader.flags.checksums = options->checksums;
+	outHeader.flags.zoneMaps = options->zoneMaps;
+	outHeader.flags.deduplicated = options->deduplicated;
+
+	size_t factor[NDTF_DIMENSIONS_MAX];
+	bool downsample = false;
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+	{
+		factor[i] = i < inHeader->dimensions && options->downsample[i] > 1 ? options->downsample[i] : 1;
+		downsample |= factor[i] > 1;
+		size_t size = (max((size_t)inHeader->size[i], 1) + factor[i] - 1) / factor[i];
+		outHeader.size[i] = (uint32_t)size;
+	}
+
+	bool reformat = outHeader.texelFormat != inHeader->texelFormat;
+	size_t outPlanes = ndtf_stream_planes(&outHeader, axis);
+
+	// peak memory per output plane: source planes and the buffers of the step that is running
+	NDTF_Header downHeader = outHeader;
+	downHeader.texelFormat = inHeader->texelFormat;
+	uint64_t inPerPlane = (uint64_t)reader.planeBytes * factor[axis];
+	uint64_t downPerPlane = downsample ? ndtf_stream_planeBytes(&downHeader, axis) : 0;
+	uint64_t current = downsample ? downPerPlane : inPerPlane;
+	uint64_t outPerPlane = ndtf_stream_planeBytes(&outHeader, axis);
+	uint64_t perPlane = inPerPlane + downPerPlane;
+	perPlane = max(perPlane, current + (reformat ? outPerPlane : 0));
+	if (outHeader.flags.segmented)
+		perPlane = max(perPlane, outPerPlane + outPerPlane + outPerPlane / 64); // encoded output, about the compress bound
+	if (outHeader.flags.lossy)
+		perPlane = max(perPlane, outPerPlane * 4 + outPerPlane / 2); // reconstruction, worst case symbols and their compress bound
+
+	uint64_t limit = options->memoryLimit ? options->memoryLimit : NDTF_STREAM_DEFAULT_MEMORY;
+	uint64_t fixed = ndtf_streamReader_memory(&reader);
+	size_t maxPlanes = limit > fixed && perPlane ? (size_t)min((limit - fixed) / perPlane, (uint64_t)outPlanes) : 0;
+	if (maxPlanes == 0)
+	{
+		ndtf_streamReader_close(&reader);
+		return false;
+	}
+
+	size_t slabPlanes = maxPlanes;
+	if (outHeader.flags.segmented)
+	{
+		// a slab holds whole bricks along the axis, an unset brick size picks the largest one that fits
+		uint32_t brickSize[NDTF_DIMENSIONS_MAX];
+		memcpy(brickSize, options->brickSize, sizeof(brickSize));
+		if (!brickSize[axis])
+		{
+			brickSize[axis] = 1;
+			while (brickSize[axis] * 2 <= maxPlanes && brickSize[axis] < outPlanes)
+				brickSize[axis] *= 2;
+		}
+
+		NDTF_File out;
+		memset(&out, 0, sizeof(NDTF_File));
+		out.header = outHeader;
+		ndtf_file_setBrickSize(&out, brickSize);
+		outHeader = out.header;
+
+		slabPlanes = ndtf_file_getBrickExtent(&out, axis);
+		if (slabPlanes > maxPlanes)
+		{
+			ndtf_streamReader_close(&reader);
+			return false;
+		}
+	}
+
+	// a relative bound is taken against the range of the whole output, gathered in a first pass over the slabs
+	bool result = true;
+	ndtf_LossyBound errorBound;
+	if (ndtf_lossy_enabled(&outHeader))
+	{
+		ndtf_LossyRange range;
+		ndtf_lossyRange_init(&range);
+		for (size_t first = 0; first < outPlanes && result && options->errorBound.mode == NDTF_ERRORBOUND_RELATIVE; first += slabPlanes)
+		{
+			NDTF_File slab;
+			result = ndtf_stream_readSlab(&reader, &outHeader, options, factor, first, min(slabPlanes, outPlanes - first), &slab, ctx);
+			if (result)
+				ndtf_lossyRange_add(&range, &slab.header, slab.data, ndtf_file_getDataSize(&slab) / ndtf_getTexelSize((NDTF_TexelFormat)slab.header.texelFormat), ctx ? ctx->transform : NULL, ctx);
+
+			if (slab.data)
+				ndtf_mem_freeWith(ndtf_file_allocator(&slab), ctx, slab.data);
+		}
+		ndtf_lossy_resolve(&errorBound, &outHeader, &options->errorBound, &range);
+	}
+
+	ndtf_StreamWriter writer;
+	result = ndtf_streamWriter_open(&writer, dstFilename, &outHeader, ctx) && result;
+	writer.errorBound = ndtf_lossy_enabled(&outHeader) ? &errorBound : NULL;
+
+	for (size_t first = 0; first < outPlanes && result; first += slabPlanes)
+	{
+		NDTF_File slab;
+		result = ndtf_stream_readSlab(&reader, &outHeader, options, factor, first, min(slabPlanes, outPlanes - first), &slab, ctx);
+		if (result)
+			result = ndtf_streamWriter_write(&writer, &slab);
+
+		if (slab.data)
+			ndtf_mem_freeWith(ndtf_file_allocator(&slab), ctx, slab.data);
+	}
+
+	result = result && ndtf_streamWriter_finish(&writer);
+	result = ndtf_streamWriter_close(&writer) && result;
+	ndtf_streamReader_close(&reader);
+
+	if (!result)
+		remove(dstFilename);
+
+	return result;
+}
+
+NDTF_File ndtf_stream_loadPlanes(const char* filename, size_t first, size_t count, const NDTF_Context* ctx)
+{
+	NDTF_File result;
+	memset(&result, 0, sizeof(NDTF_File));
+
+	ndtf_StreamReader reader;
+	if (!ndtf_streamReader_open(&reader, filename, ctx) || count == 0 || first >= reader.planes || count > reader.planes - first ||
+		!ndtf_transform_fits(ctx, (NDTF_TexelFormat)reader.header.texelFormat))
+	{
+		ndtf_streamReader_close(&reader);
+		return result;
+	}
+
+	// the planes come back as a plain uncompressed file
+	result.header = reader.header;
+	result.header.version = NDTF_VERSION;
+	memset(&result.header.flags, 0, sizeof(NDTF_Flags));
+	memset(result.header.brickSize, 0, sizeof(result.header.brickSize));
+	result.header.keyframeInterval = 0;
+	result.header.checksum = 0;
+	result.header.size[reader.axis] = (uint32_t)count;
+	result.allocator = ndtf_mem_allocator(ctx);
+
+	result.data = (uint8_t*)ndtf_mem_alloc(ctx, count * reader.planeBytes);
+	if (!result.data || !ndtf_streamReader_read(&reader, first, count, result.data))
+	{
+		ndtf_mem_free(ctx, result.data);
+		memset(&result, 0, sizeof(NDTF_File));
+	}
+	else if (ctx && ctx->transform)
+		ndtf_transform_runParallel(ctx->transform, result.data, result.data, count * reader.planeBytes / ndtf_getTexelSize((NDTF_TexelFormat)result.header.texelFormat), ctx);
+
+	ndtf_streamReader_close(&reader);
+	return result;
+}
+
+// keeps the codec, checksums, zone maps, deduplication, planar layout and bricks of the source unless changed
+static bool ndtf_stream_defaultOptions(const char* srcFilename, NDTF_StreamOptions* options, size_t memoryLimit)
+{
+	memset(options, 0, sizeof(NDTF_StreamOptions));
+	options->memoryLimit = memoryLimit;
+
+	NDTF_Header header;
+	if (!ndtf_probe(srcFilename, &header))
+		return false;
+
+	options->codec = (NDTF_Codec)header.flags.codec;
+	options->segmented = header.flags.segmented;
+	options->checksums = header.flags.checksums;
+	options->zoneMaps = header.flags.zoneMaps;
+	options->deduplicated = header.flags.deduplicated;
+	options->planar = ndtf_planar_enabled(&header);
+	if (header.flags.segmented)
+	{
+		for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+			options->brickSize[i] = header.brickSize[i] ? (uint32_t)1 << (header.brickSize[i] - 1) : 0;
+	}
+	return true;
+}
+
+bool ndtf_stream_reformat(const char* srcFilename, const char* dstFilename, NDTF_TexelFormat desiredFormat, size_t memoryLimit, const NDTF_Context* ctx)
+{
+	NDTF_StreamOptions options;
+	if (!ndtf_stream_defaultOptions(srcFilename, &options, memoryLimit))
+		return false;
+
+	options.texelFormat = desiredFormat;
+	return ndtf_stream_process(srcFilename, dstFilename, &options, ctx);
+}
+
+bool ndtf_stream_recompress(const char* srcFilename, const char* dstFilename, NDTF_Codec codec, size_t memoryLimit, const NDTF_Context* ctx)
+{
+	NDTF_StreamOptions options;
+	if (!ndtf_stream_defaultOptions(srcFilename, &options, memoryLimit))
+		return false;
+
+	options.codec = codec;
+	return ndtf_stream_process(srcFilename, dstFilename, &options, ctx);
+}
+
+bool ndtf_stream_downsample(const char* srcFilename, const char* dstFilename, const uint8_t factor[NDTF_DIMENSIONS_MAX], size_t memoryLimit, const NDTF_Context* ctx)
+{
+	NDTF_StreamOptions options;
+	if (!ndtf_stream_defaultOptions(srcFilename, &options, memoryLimit))
+		return false;
+
+	memcpy(options.downsample, factor, sizeof(options.downsample));
+	return ndtf_stream_process(srcFilename, dstFilename, &options, ctx);
+}
@@ -0,0 +1,477 @@
+#include "ndtf_internal.h"
+#include <string.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+	#define NDTF_TEXELSTATS_SSE2
+	#include <emmintrin.h>
+#endif
+
+// the kernels accumulate into a fixed number of lanes that is a multiple of every channel count, lane l
+// always sees channel l % channels. the lane loops have no dependencies between lanes and vectorize
+
+#define NDTF_TEXELSTATS_LANES 48
+#define NDTF_TEXELSTATS_CHUNK_MIN ((size_t)1 << 20) // bytes below which a chunk is not worth a task
+#define NDTF_TEXELSTATS_PIECE ((size_t)1 << 24) // texels per kernel call, keeps the 32 bit lane counters exact
+
+static void ndtf_texelStats_reset(ndtf_TexelStatsPartial* partial)
+{
+	memset(partial, 0, sizeof(ndtf_TexelStatsPartial));
+	for (int c = 0; c < NDTF_CHANNELS_RGBA; c++)
+	{
+		partial->min[c] = INFINITY;
+		partial->max[c] = -INFINITY;
+	}
+}
+
+#define NDTF_TEXELSTATS_INTEGER_KERNEL(name, type, squareType)																		\
+static void name(const type* src, size_t elements, size_t channels, ndtf_TexelStatsPartial* partial)								\
+{																																	\
+	type lo[NDTF_TEXELSTATS_LANES], hi[NDTF_TEXELSTATS_LANES];																		\
+	uint64_t sum[NDTF_TEXELSTATS_LANES];																							\
+	squareType squares[NDTF_TEXELSTATS_LANES];																						\
+	for (size_t l = 0; l < NDTF_TEXELSTATS_LANES; l++)																				\
+	{																																\
+		lo[l] = (type)~(type)0;																										\
+		hi[l] = 0;																													\
+		sum[l] = 0;																													\
+		squares[l] = 0;																												\
+	}																																\
+																																	\
+	size_t i = 0;																													\
+	for (; i + NDTF_TEXELSTATS_LANES <= elements; i += NDTF_TEXELSTATS_LANES)														\
+	{																																\
+		for (size_t l = 0; l < NDTF_TEXELSTATS_LANES; l++)																			\
+		{																															\
+			type v = src[i + l];																									\
+			lo[l] = v < lo[l] ? v : lo[l];																							\
+			hi[l] = v > hi[l] ? v : hi[l];																							\
+			sum[l] += v;																											\
+			squares[l] += (squareType)v * v;																						\
+		}																															\
+	}																																\
+	for (size_t l = 0; i < elements; i++, l++)																						\
+	{																																\
+		type v = src[i];																											\
+		lo[l] = v < lo[l] ? v : lo[l];																								\
+		hi[l] = v > hi[l] ? v : hi[l];																								\
+		sum[l] += v;																												\
+		squares[l] += (squareType)v * v;																							\
+	}																																\
+																																	\
+	for (size_t l = 0; l < NDTF_TEXELSTATS_LANES && l < elements; l++)																\
+	{																																\
+		size_t c = l % channels;																									\
+		partial->min[c] = lo[l] < partial->min[c] ? lo[l] : partial->min[c];														\
+		partial->max[c] = hi[l] > partial->max[c] ? hi[l] : partial->max[c];														\
+		partial->sum[c] += (double)sum[l];																							\
+		partial->sumSquares[c] += (double)squares[l];																				\
+		partial->count[c] += (elements - l + NDTF_TEXELSTATS_LANES - 1) / NDTF_TEXELSTATS_LANES;									\
+	}																																\
+}
+
+NDTF_TEXELSTATS_INTEGER_KERNEL(ndtf_texelStats_u8, uint8_t, uint64_t)
+NDTF_TEXELSTATS_INTEGER_KERNEL(ndtf_texelStats_u16, uint16_t, uint64_t)
+NDTF_TEXELSTATS_INTEGER_KERNEL(ndtf_texelStats_u32, uint32_t, double)
+
+static void ndtf_texelStats_f32Lanes(const float* src, size_t elements, size_t channels, ndtf_TexelStatsPartial* partial)
+{
+	float lo[NDTF_TEXELSTATS_LANES], hi[NDTF_TEXELSTATS_LANES];
+	double sum[NDTF_TEXELSTATS_LANES], squares[NDTF_TEXELSTATS_LANES];
+	uint32_t nan[NDTF_TEXELSTATS_LANES], inf[NDTF_TEXELSTATS_LANES];
+	for (size_t l = 0; l < NDTF_TEXELSTATS_LANES; l++)
+	{
+		lo[l] = INFINITY;
+		hi[l] = -INFINITY;
+		sum[l] = 0.0;
+		squares[l] = 0.0;
+		nan[l] = 0;
+		inf[l] = 0;
+	}
+
+	// classified on the bits, so the lane loop stays free of branches
+	size_t i = 0;
+	for (; i + NDTF_TEXELSTATS_LANES <= elements; i += NDTF_TEXELSTATS_LANES)
+	{
+		for (size_t l = 0; l < NDTF_TEXELSTATS_LANES; l++)
+		{
+			float v = src[i + l];
+			uint32_t bits;
+			memcpy(&bits, &v, sizeof(uint32_t));
+			uint32_t magnitude = bits & 0x7FFFFFFFu;
+			uint32_t finite = magnitude < 0x7F800000u;
+			nan[l] += magnitude > 0x7F800000u;
+			inf[l] += magnitude == 0x7F800000u;
+
+			float low = finite ? v : INFINITY;
+			float high = finite ? v : -INFINITY;
+			float value = finite ? v : 0.0f;
+			lo[l] = low < lo[l] ? low : lo[l];
+			hi[l] = high > hi[l] ? high : hi[l];
+			sum[l] += value;
+			squares[l] += (double)value * value;
+		}
+	}
+	for (size_t l = 0; i < elements; i++, l++)
+	{
+		float v = src[i];
+		if (isnan(v))
+			nan[l]++;
+		else if (isinf(v))
+			inf[l]++;
+		else
+		{
+			lo[l] = v < lo[l] ? v : lo[l];
+			hi[l] = v > hi[l] ? v : hi[l];
+			sum[l] += v;
+			squares[l] += (double)v * v;
+		}
+	}
+
+	for (size_t l = 0; l < NDTF_TEXELSTATS_LANES && l < elements; l++)
+	{
+		size_t c = l % channels;
+		partial->min[c] = lo[l] < partial->min[c] ? lo[l] : partial->min[c];
+		partial->max[c] = hi[l] > partial->max[c] ? hi[l] : partial->max[c];
+		partial->sum[c] += sum[l];
+		partial->sumSquares[c] += squares[l];
+		partial->count[c] += (elements - l + NDTF_TEXELSTATS_LANES - 1) / NDTF_TEXELSTATS_LANES - nan[l] - inf[l];
+		partial->nanCount[c] += nan[l];
+		partial->infCount[c] += inf[l];
+	}
+}
+
+static void ndtf_texelStats_f32(const float* src, size_t elements, size_t channels, ndtf_TexelStatsPartial* partial)
+{
+	size_t i = 0;
+
+#ifdef NDTF_TEXELSTATS_SSE2
+	// 4 floats per vector, the channels of the lanes repeat every period vectors
+	size_t period = channels == 3 ? 3 : 1;
+
+	__m128 lo[3], hi[3];
+	__m128d sum[6], squares[6];
+	__m128i nan[3], inf[3];
+	for (size_t k = 0; k < period; k++)
+	{
+		lo[k] = _mm_set1_ps(INFINITY);
+		hi[k] = _mm_set1_ps(-INFINITY);
+		sum[2 * k] = sum[2 * k + 1] = _mm_setzero_pd();
+		squares[2 * k] = squares[2 * k + 1] = _mm_setzero_pd();
+		nan[k] = inf[k] = _mm_setzero_si128();
+	}
+
+	const __m128i magnitudeMask = _mm_set1_epi32(0x7FFFFFFF);
+	const __m128i infinityBits = _mm_set1_epi32(0x7F800000);
+	const __m128 positiveInfinity = _mm_set1_ps(INFINITY);
+	const __m128 negativeInfinity = _mm_set1_ps(-INFINITY);
+
+	for (; i + 4 * period <= elements; i += 4 * period)
+	{
+		for (size_t k = 0; k < period; k++)
+		{
+			__m128 v = _mm_loadu_ps(src + i + 4 * k);
+
+			// magnitudes are below the sign bit, so the signed compares classify them
+			__m128i magnitude = _mm_and_si128(_mm_castps_si128(v), magnitudeMask);
+			__m128 finite = _mm_castsi128_ps(_mm_cmplt_epi32(magnitude, infinityBits));
+			nan[k] = _mm_sub_epi32(nan[k], _mm_cmpgt_epi32(magnitude, infinityBits));
+			inf[k] = _mm_sub_epi32(inf[k], _mm_cmpeq_epi32(magnitude, infinityBits));
+
+			__m128 value = _mm_and_ps(v, finite);
+			lo[k] = _mm_min_ps(lo[k], _mm_or_ps(value, _mm_andnot_ps(finite, positiveInfinity)));
+			hi[k] = _mm_max_ps(hi[k], _mm_or_ps(value, _mm_andnot_ps(finite, negativeInfinity)));
+
+			__m128d low = _mm_cvtps_pd(value);
+			__m128d high = _mm_cvtps_pd(_mm_movehl_ps(value, value));
+			sum[2 * k] = _mm_add_pd(sum[2 * k], low);
+			sum[2 * k + 1] = _mm_add_pd(sum[2 * k + 1], high);
+			squares[2 * k] = _mm_add_pd(squares[2 * k], _mm_mul_pd(low, low));
+			squares[2 * k + 1] = _mm_add_pd(squares[2 * k + 1], _mm_mul_pd(high, high));
+		}
+	}
+
+	size_t perLane = i / (4 * period);
+	for (size_t k = 0; k < period && perLane; k++)
+	{
+		float laneLo[4], laneHi[4];
+		double laneSum[4], laneSquares[4];
+		uint32_t laneNan[4], laneInf[4];
+		_mm_storeu_ps(laneLo, lo[k]);
+		_mm_storeu_ps(laneHi, hi[k]);
+		_mm_storeu_pd(laneSum, sum[2 * k]);
+		_mm_storeu_pd(laneSum + 2, sum[2 * k + 1]);
+		_mm_storeu_pd(laneSquares, squares[2 * k]);
+		_mm_storeu_pd(laneSquares + 2, squares[2 * k + 1]);
+		_mm_storeu_si128((__m128i*)laneNan, nan[k]);
+		_mm_storeu_si128((__m128i*)laneInf, inf[k]);
+
+		for (size_t l = 0; l < 4; l++)
+		{
+			size_t c = (4 * k + l) % channels;
+			partial->min[c] = laneLo[l] < partial->min[c] ? laneLo[l] : partial->min[c];
+			partial->max[c] = laneHi[l] > partial->max[c] ? laneHi[l] : partial->max[c];
+			partial->sum[c] += laneSum[l];
+			partial->sumSquares[c] += laneSquares[l];
+			partial->count[c] += perLane - laneNan[l] - laneInf[l];
+			partial->nanCount[c] += laneNan[l];
+			partial->infCount[c] += laneInf[l];
+		}
+	}
+#endif
+
+	// the rest starts on a texel boundary
+	if (i < elements)
+		ndtf_texelStats_f32Lanes(src + i, elements - i, channels, partial);
+}
+
+// NaN and infinity are left out of the histogram
+static void ndtf_texelStats_histogram(const ndtf_TexelStatsSink* sink, const uint8_t* data, size_t elements, uint64_t* histogram)
+{
+	size_t channels = sink->stats->channelCount;
+	size_t bins = sink->stats->bins;
+	size_t last = bins - 1;
+	double low = sink->low;
+	double scale = sink->high > low ? bins / (sink->high - low) : 0.0;
+
+	switch (ndtf_getChannelSize(sink->format))
+	{
+	case 1:
+	{
+		// a bin lookup per byte value
+		uint32_t lookup[256];
+		for (size_t v = 0; v < 256; v++)
+		{
+			double position = ((double)v - low) * scale;
+			lookup[v] = position <= 0.0 ? 0 : (position >= (double)last ? (uint32_t)last : (uint32_t)position);
+		}
+		for (size_t i = 0; i < elements; i++)
+			histogram[(i % channels) * bins + lookup[data[i]]]++;
+	} break;
+	case 2:
+	{
+		const uint16_t* src = (const uint16_t*)data;
+		for (size_t i = 0; i < elements; i++)
+		{
+			double position = ((double)src[i] - low) * scale;
+			size_t bin = position <= 0.0 ? 0 : (position >= (double)last ? last : (size_t)position);
+			histogram[(i % channels) * bins + bin]++;
+		}
+	} break;
+	case 4:
+	{
+		bool isFloat = ndtf_getChannelIsFloat(sink->format);
+		const uint32_t* src32 = (const uint32_t*)data;
+		const float* srcf = (const float*)data;
+		for (size_t i = 0; i < elements; i++)
+		{
+			double v = isFloat ? (double)srcf[i] : (double)src32[i];
+			if (!isfinite(v))
+				continue;
+			double position = (v - low) * scale;
+			size_t bin = position <= 0.0 ? 0 : (position >= (double)last ? last : (size_t)position);
+			histogram[(i % channels) * bins + bin]++;
+		}
+	} break;
+	}
+}
+
+bool ndtf_texelStats_begin(ndtf_TexelStatsSink* sink, NDTF_TexelStats* stats, NDTF_TexelFormat texelFormat)
+{
+	memset(sink, 0, sizeof(ndtf_TexelStatsSink));
+
+	size_t channelSize = ndtf_getChannelSize(texelFormat);
+	size_t channels = ndtf_getChannelCount(texelFormat);
+	if (!stats || !channels || !channelSize || (stats->bins && !stats->histogram))
+		return false;
+
+	memset(stats->channels, 0, sizeof(stats->channels));
+	stats->channelCount = (uint32_t)channels;
+	if (stats->bins)
+		memset(stats->histogram, 0, (size_t)stats->bins * channels * sizeof(uint64_t));
+
+	sink->stats = stats;
+	sink->format = texelFormat;
+	sink->low = stats->low;
+	sink->high = stats->high;
+	if (!(sink->high > sink->low))
+	{
+		sink->low = 0.0;
+		sink->high = ndtf_getChannelIsFloat(texelFormat) ? 1.0 : (double)(((uint64_t)1 << (channelSize * 8)) - 1);
+		// integer values sit in the middle of their bins when every value has its own
+		if (!ndtf_getChannelIsFloat(texelFormat))
+			sink->high += 1.0;
+	}
+
+	ndtf_texelStats_reset(&sink->partial);
+	ndtf_mutex_init(&sink->mutex);
+	return true;
+}
+
+void ndtf_texelStats_compute(const uint8_t* data, size_t texels, NDTF_TexelFormat texelFormat, ndtf_TexelStatsPartial* partial)
+{
+	size_t channels = ndtf_getChannelCount(texelFormat);
+	size_t channelSize = ndtf_getChannelSize(texelFormat);
+
+	ndtf_texelStats_reset(partial);
+
+	for (size_t first = 0; first < texels; first += NDTF_TEXELSTATS_PIECE)
+	{
+		const uint8_t* piece = data + first * channels * channelSize;
+		size_t pieceElements = min(texels - first, NDTF_TEXELSTATS_PIECE) * channels;
+
+		switch (channelSize)
+		{
+		case 1: ndtf_texelStats_u8(piece, pieceElements, channels, partial); break;
+		case 2: ndtf_texelStats_u16((const uint16_t*)piece, pieceElements, channels, partial); break;
+		case 4:
+			if (ndtf_getChannelIsFloat(texelFormat))
+				ndtf_texelStats_f32((const float*)piece, pieceElements, channels, partial);
+			else
+				ndtf_texelStats_u32((const uint32_t*)piece, pieceElements, channels, partial);
+			break;
+		}
+	}
+}
+
+void ndtf_texelStats_add(ndtf_TexelStatsSink* sink, const uint8_t* data, size_t texels, const NDTF_Context* ctx)
+{
+	ndtf_TexelStatsPartial partial;
+	ndtf_texelStats_compute(data, texels, sink->format, &partial);
+	ndtf_texelStats_addComputed(sink, &partial, data, texels, ctx);
+}
+
+void ndtf_texelStats_addComputed(ndtf_TexelStatsSink* sink, const ndtf_TexelStatsPartial* partial, const uint8_t* data, size_t texels, const NDTF_Context* ctx)
+{
+	size_t channels = sink->stats->channelCount;
+	size_t elements = texels * channels;
+
+	uint64_t* histogram = NULL;
+	size_t histogramSize = (size_t)sink->stats->bins * channels;
+	if (histogramSize)
+	{
+		histogram = (uint64_t*)ndtf_mem_alloc(ctx, histogramSize * sizeof(uint64_t));
+		if (histogram)
+		{
+			memset(histogram, 0, histogramSize * sizeof(uint64_t));
+			ndtf_texelStats_histogram(sink, data, elements, histogram);
+		}
+		else
+			ndtf_atomic_store_u64(&sink->failed, 1);
+	}
+
+	ndtf_mutex_lock(&sink->mutex);
+	for (size_t c = 0; c < channels; c++)
+	{
+		sink->partial.min[c] = partial->min[c] < sink->partial.min[c] ? partial->min[c] : sink->partial.min[c];
+		sink->partial.max[c] = partial->max[c] > sink->partial.max[c] ? partial->max[c] : sink->partial.max[c];
+		sink->partial.sum[c] += partial->sum[c];
+		sink->partial.sumSquares[c] += partial->sumSquares[c];
+		sink->partial.count[c] += partial->count[c];
+		sink->partial.nanCount[c] += partial->nanCount[c];
+		sink->partial.infCount[c] += partial->infCount[c];
+	}
+	if (histogram)
+	{
+		for (size_t i = 0; i < histogramSize; i++)
+			sink->stats->histogram[i] += histogram[i];
+	}
+	ndtf_mutex_unlock(&sink->mutex);
+
+	ndtf_mem_free(ctx, histogram);
+}
+
+bool ndtf_texelStats_end(ndtf_TexelStatsSink* sink)
+{
+	NDTF_TexelStats* stats = sink->stats;
+	for (size_t c = 0; c < stats->channelCount; c++)
+	{
+		NDTF_ChannelStats* channel = &stats->channels[c];
+		channel->count = sink->partial.count[c];
+		channel->min = channel->count ? sink->partial.min[c] : 0.0;
+		channel->max = channel->count ? sink->partial.max[c] : 0.0;
+		channel->sum = sink->partial.sum[c];
+		channel->sumSquares = sink->partial.sumSquares[c];
+		channel->nanCount = sink->partial.nanCount[c];
+		channel->infCount = sink->partial.infCount[c];
+	}
+
+	ndtf_mutex_destroy(&sink->mutex);
+	return !sink->failed;
+}
+
+typedef struct ndtf_TexelStatsTask
+{
+	ndtf_TexelStatsSink* sink;
+	const uint8_t* data;
+	size_t texels;
+	size_t texelSize;
+	size_t chunkTexels;
+	const NDTF_Context* ctx;
+} ndtf_TexelStatsTask;
+
+static void ndtf_texelStats_task(void* taskData, size_t index)
+{
+	const ndtf_TexelStatsTask* task = (const ndtf_TexelStatsTask*)taskData;
+	size_t begin = index * task->chunkTexels;
+	size_t count = min(task->chunkTexels, task->texels - begin);
+	ndtf_texelStats_add(task->sink, task->data + begin * task->texelSize, count, task->ctx);
+}
+
+void ndtf_texelStats_addParallel(ndtf_TexelStatsSink* sink, const uint8_t* data, size_t texels, const NDTF_Context* ctx)
+{
+	ndtf_TexelStatsTask task;
+	task.sink = sink;
+	task.data = data;
+	task.texels = texels;
+	task.texelSize = ndtf_getTexelSize(sink->format);
+	task.ctx = ctx;
+
+	size_t chunks = min(ndtf_concurrency(ctx) * 4, max(texels * task.texelSize / NDTF_TEXELSTATS_CHUNK_MIN, 1));
+	task.chunkTexels = max((texels + chunks - 1) / chunks, 1);
+
+	NDTF_SCOPE_BEGIN(statsScope, ctx, NDTF_PHASE_CONVERT, "texelStats");
+
+	if (texels)
+		ndtf_parallelFor(ctx, ndtf_texelStats_task, &task, (texels + task.chunkTexels - 1) / task.chunkTexels);
+
+	NDTF_SCOPE_END(statsScope, ctx, texels * task.texelSize);
+}
+
+bool ndtf_computeTexelStats(const void* data, size_t texels, NDTF_TexelFormat texelFormat, NDTF_TexelStats* stats, const NDTF_Context* ctx)
+{
+	if (!data && texels)
+		return false;
+
+	ndtf_TexelStatsSink sink;
+	if (!ndtf_texelStats_begin(&sink, stats, texelFormat))
+		return false;
+
+	ndtf_texelStats_addParallel(&sink, (const uint8_t*)data, texels, ctx);
+
+	return ndtf_texelStats_end(&sink);
+}
+
+bool ndtf_file_computeTexelStats(NDTF_File* file, NDTF_TexelStats* stats, const NDTF_Context* ctx)
+{
+	NDTF_TexelFormat format = (NDTF_TexelFormat)file->header.texelFormat;
+	return ndtf_computeTexelStats(file->data, ndtf_file_getDataSize(file) / max(ndtf_getTexelSize(format), 1), format, stats, ctx);
+}
+
+double ndtf_texelStats_mean(const NDTF_TexelStats* stats, int channel)
+{
+	if (channel < 0 || (uint32_t)channel >= stats->channelCount || !stats->channels[channel].count)
+		return 0.0;
+	return stats->channels[channel].sum / (double)stats->channels[channel].count;
+}
+
+double ndtf_texelStats_stddev(const NDTF_TexelStats* stats, int channel)
+{
+	if (channel < 0 || (uint32_t)channel >= stats->channelCount || !stats->channels[channel].count)
+		return 0.0;
+
+	const NDTF_ChannelStats* c = &stats->channels[channel];
+	double mean = c->sum / (double)c->count;
+	double variance = c->sumSquares / (double)c->count - mean * mean;
+	return variance > 0.0 ? sqrt(variance) : 0.0;
+}
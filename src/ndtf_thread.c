@@ -0,0 +1,344 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+	#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "ndtf_internal.h"
+#include <string.h>
+
+#ifndef _WIN32
+	#include <unistd.h>
+#endif
+
+void ndtf_mutex_init(ndtf_Mutex* mutex)
+{
+#ifdef _WIN32
+	InitializeSRWLock(mutex);
+#else
+	pthread_mutex_init(mutex, NULL);
+#endif
+}
+void ndtf_mutex_destroy(ndtf_Mutex* mutex)
+{
+#ifndef _WIN32
+	pthread_mutex_destroy(mutex);
+#endif
+}
+void ndtf_mutex_lock(ndtf_Mutex* mutex)
+{
+#ifdef _WIN32
+	AcquireSRWLockExclusive(mutex);
+#else
+	pthread_mutex_lock(mutex);
+#endif
+}
+void ndtf_mutex_unlock(ndtf_Mutex* mutex)
+{
+#ifdef _WIN32
+	ReleaseSRWLockExclusive(mutex);
+#else
+	pthread_mutex_unlock(mutex);
+#endif
+}
+void ndtf_cond_init(ndtf_Cond* cond)
+{
+#ifdef _WIN32
+	InitializeConditionVariable(cond);
+#else
+	pthread_cond_init(cond, NULL);
+#endif
+}
+void ndtf_cond_destroy(ndtf_Cond* cond)
+{
+#ifndef _WIN32
+	pthread_cond_destroy(cond);
+#endif
+}
+void ndtf_cond_wait(ndtf_Cond* cond, ndtf_Mutex* mutex)
+{
+#ifdef _WIN32
+	SleepConditionVariableSRW(cond, mutex, INFINITE, 0);
+#else
+	pthread_cond_wait(cond, mutex);
+#endif
+}
+void ndtf_cond_signal(ndtf_Cond* cond)
+{
+#ifdef _WIN32
+	WakeConditionVariable(cond);
+#else
+	pthread_cond_signal(cond);
+#endif
+}
+void ndtf_cond_broadcast(ndtf_Cond* cond)
+{
+#ifdef _WIN32
+	WakeAllConditionVariable(cond);
+#else
+	pthread_cond_broadcast(cond);
+#endif
+}
+
+typedef struct ndtf_ThreadStart
+{
+	ndtf_ThreadFunc func;
+	void* arg;
+} ndtf_ThreadStart;
+
+#ifdef _WIN32
+static DWORD WINAPI ndtf_threadEntry(LPVOID param)
+#else
+static void* ndtf_threadEntry(void* param)
+#endif
+{
+	ndtf_ThreadStart start = *(ndtf_ThreadStart*)param;
+	ndtf_mem_free(NULL, param);
+
+	start.func(start.arg);
+
+	return 0;
+}
+
+bool ndtf_thread_create(ndtf_Thread* thread, ndtf_ThreadFunc func, void* arg)
+{
+	ndtf_ThreadStart* start = (ndtf_ThreadStart*)ndtf_mem_alloc(NULL, sizeof(ndtf_ThreadStart));
+	if (!start) return false;
+
+	start->func = func;
+	start->arg = arg;
+
+#ifdef _WIN32
+	*thread = CreateThread(NULL, 0, ndtf_threadEntry, start, 0, NULL);
+	if (*thread == NULL)
+#else
+	if (pthread_create(thread, NULL, ndtf_threadEntry, start) != 0)
+#endif
+	{
+		ndtf_mem_free(NULL, start);
+		return false;
+	}
+
+	return true;
+}
+void ndtf_thread_join(ndtf_Thread* thread)
+{
+#ifdef _WIN32
+	WaitForSingleObject(*thread, INFINITE);
+	CloseHandle(*thread);
+#else
+	pthread_join(*thread, NULL);
+#endif
+}
+
+size_t ndtf_getHardwareConcurrency(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return max((size_t)info.dwNumberOfProcessors, 1);
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (size_t)count : 1;
+#endif
+}
+
+// built-in executor: a lazily started pool of worker threads. the calling thread works on its own
+// run as well, so nested runs from inside tasks always make progress
+
+typedef struct ndtf_PoolJob
+{
+	NDTF_TaskFunc task;
+	void* taskData;
+	size_t count;
+	size_t next;
+	size_t done;
+	struct ndtf_PoolJob* nextJob;
+} ndtf_PoolJob;
+
+static struct
+{
+	ndtf_Mutex mutex;
+	ndtf_Cond workAvailable;
+	ndtf_Cond jobFinished;
+	ndtf_PoolJob* jobs;
+	size_t workerCount;
+} pool;
+
+#ifdef _WIN32
+static INIT_ONCE poolOnce = INIT_ONCE_STATIC_INIT;
+#else
+static pthread_once_t poolOnce = PTHREAD_ONCE_INIT;
+#endif
+
+// claims the next index of the first job that still has unclaimed work. pool.mutex must be held
+static ndtf_PoolJob* ndtf_pool_claim(ndtf_PoolJob* job, size_t* index)
+{
+	if (!job)
+		job = pool.jobs;
+	else if (job->next >= job->count)
+		return NULL;
+
+	if (!job)
+		return NULL;
+
+	*index = job->next++;
+
+	if (job->next >= job->count)
+	{
+		// fully claimed, unlink it so workers move on to other jobs
+		ndtf_PoolJob** link = &pool.jobs;
+		while (*link && *link != job)
+			link = &(*link)->nextJob;
+		if (*link)
+			*link = job->nextJob;
+	}
+
+	return job;
+}
+
+static void ndtf_pool_complete(ndtf_PoolJob* job)
+{
+	if (++job->done == job->count)
+		ndtf_cond_broadcast(&pool.jobFinished);
+}
+
+static void ndtf_pool_worker(void* arg)
+{
+	ndtf_mutex_lock(&pool.mutex);
+	for (;;)
+	{
+		size_t index;
+		ndtf_PoolJob* job = ndtf_pool_claim(NULL, &index);
+		if (!job)
+		{
+			ndtf_cond_wait(&pool.workAvailable, &pool.mutex);
+			continue;
+		}
+
+		ndtf_mutex_unlock(&pool.mutex);
+		job->task(job->taskData, index);
+		ndtf_mutex_lock(&pool.mutex);
+
+		ndtf_pool_complete(job);
+	}
+}
+
+#ifdef _WIN32
+static BOOL CALLBACK ndtf_pool_init(PINIT_ONCE once, PVOID param, PVOID* context)
+#else
+static void ndtf_pool_init(void)
+#endif
+{
+	ndtf_mutex_init(&pool.mutex);
+	ndtf_cond_init(&pool.workAvailable);
+	ndtf_cond_init(&pool.jobFinished);
+
+	size_t threads = ndtf_getHardwareConcurrency() - 1;
+	for (size_t i = 0; i < threads; i++)
+	{
+		ndtf_Thread thread;
+		if (!ndtf_thread_create(&thread, ndtf_pool_worker, NULL))
+			break;
+#ifdef _WIN32
+		CloseHandle(thread);
+#else
+		pthread_detach(thread);
+#endif
+		pool.workerCount++;
+	}
+
+#ifdef _WIN32
+	return TRUE;
+#endif
+}
+
+static void ndtf_defaultRun(NDTF_TaskFunc task, void* taskData, size_t count, void* user)
+{
+#ifdef _WIN32
+	InitOnceExecuteOnce(&poolOnce, ndtf_pool_init, NULL, NULL);
+#else
+	pthread_once(&poolOnce, ndtf_pool_init);
+#endif
+
+	if (pool.workerCount == 0)
+	{
+		for (size_t i = 0; i < count; i++)
+			task(taskData, i);
+		return;
+	}
+
+	ndtf_PoolJob job;
+	memset(&job, 0, sizeof(ndtf_PoolJob));
+	job.task = task;
+	job.taskData = taskData;
+	job.count = count;
+
+	ndtf_mutex_lock(&pool.mutex);
+
+	// append, so older runs get their workers first
+	ndtf_PoolJob** link = &pool.jobs;
+	while (*link)
+		link = &(*link)->nextJob;
+	*link = &job;
+
+	if (count > 1)
+		ndtf_cond_broadcast(&pool.workAvailable);
+
+	size_t index;
+	while (ndtf_pool_claim(&job, &index))
+	{
+		ndtf_mutex_unlock(&pool.mutex);
+		task(taskData, index);
+		ndtf_mutex_lock(&pool.mutex);
+
+		ndtf_pool_complete(&job);
+	}
+
+	while (job.done < job.count)
+		ndtf_cond_wait(&pool.jobFinished, &pool.mutex);
+
+	ndtf_mutex_unlock(&pool.mutex);
+}
+
+static const NDTF_Executor defaultExecutor = { ndtf_defaultRun, 0, NULL };
+static NDTF_Executor globalExecutor = { ndtf_defaultRun, 0, NULL };
+
+void ndtf_setExecutor(const NDTF_Executor* executor)
+{
+	if (executor && executor->run)
+		globalExecutor = *executor;
+	else
+		globalExecutor = defaultExecutor;
+}
+
+const NDTF_Executor* ndtf_getExecutor(void)
+{
+	return &globalExecutor;
+}
+
+static const NDTF_Executor* ndtf_executor(const NDTF_Context* ctx)
+{
+	if (ctx && ctx->executor && ctx->executor->run)
+		return ctx->executor;
+	return &globalExecutor;
+}
+
+void ndtf_parallelFor(const NDTF_Context* ctx, NDTF_TaskFunc task, void* taskData, size_t count)
+{
+	if (count == 0)
+		return;
+
+	if (count == 1)
+	{
+		task(taskData, 0);
+		return;
+	}
+
+	const NDTF_Executor* executor = ndtf_executor(ctx);
+	executor->run(task, taskData, count, executor->user);
+}
+
+size_t ndtf_concurrency(const NDTF_Context* ctx)
+{
+	const NDTF_Executor* executor = ndtf_executor(ctx);
+	return executor->concurrency ? executor->concurrency : ndtf_getHardwareConcurrency();
+}
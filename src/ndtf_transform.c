@@ -0,0 +1,746 @@
+#include "ndtf_internal.h"
+#include <string.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+	#define NDTF_TRANSFORM_SSE2
+	#include <emmintrin.h>
+#endif
+
+// the steps are folded into one chain of instructions with parameters for every channel and a source channel per
+// output channel: swizzles only move the sources and the parameters of the instructions before them. 8 and 16 bit
+// formats run the chain once over every stored value into lookup tables, 32 bit formats run it over chunks of
+// texels that stay in cache. the chain works on interleaved channels, its parameters repeat every
+// NDTF_TRANSFORM_LANES values, a multiple of every channel count
+
+#define NDTF_TRANSFORM_LANES 12
+#define NDTF_TRANSFORM_CHUNK 256 // texels of a chunk
+#define NDTF_TRANSFORM_TASK_MIN ((size_t)1 << 20) // bytes below which a task is not worth it
+#define NDTF_TRANSFORM_CONSTANT (-1) // source of channels set to a constant
+
+typedef struct ndtf_TransformInstr
+{
+	NDTF_TransformOp op;
+	uint32_t mask;			// channels that are not passed through
+	float a[NDTF_CHANNELS_RGBA];
+	float b[NDTF_CHANNELS_RGBA];
+	float laneA[NDTF_TRANSFORM_LANES];	// a and b of the channel of every lane
+	float laneB[NDTF_TRANSFORM_LANES];
+	const float* lut;
+	uint32_t lutSize;
+} ndtf_TransformInstr;
+
+struct NDTF_Transform
+{
+	NDTF_TexelFormat texelFormat;
+	size_t channels;
+	size_t channelSize;
+	bool isFloat;
+	int source[NDTF_CHANNELS_RGBA];
+	float constant[NDTF_CHANNELS_RGBA];		// of NDTF_TRANSFORM_CONSTANT channels, chain applied
+	bool copied[NDTF_CHANNELS_RGBA];		// channels without instructions, copied as they are from their source
+	bool identity;
+	bool swizzled;
+	ndtf_TransformInstr* instrs;
+	size_t instrCount;
+	float* luts;
+	void* tables;		// channels tables of 256 or 65536 stored values for 8 and 16 bit formats
+	const NDTF_Allocator* allocator;
+};
+
+static float ndtf_transform_srgbToLinear(float v)
+{
+	float x = fabsf(v);
+	float r = x <= 0.04045f ? x / 12.92f : powf((x + 0.055f) / 1.055f, 2.4f);
+	return copysignf(r, v);
+}
+
+static float ndtf_transform_linearToSrgb(float v)
+{
+	float x = fabsf(v);
+	float r = x <= 0.0031308f ? x * 12.92f : 1.055f * powf(x, 1.0f / 2.4f) - 0.055f;
+	return copysignf(r, v);
+}
+
+static float ndtf_transform_lut(const float* lut, uint32_t size, float low, float high, float v)
+{
+	float last = (float)(size - 1);
+	float position = (v - low) / (high - low) * last;
+	position = position > 0.0f ? position : 0.0f;
+	position = position < last ? position : last;
+
+	uint32_t i = (uint32_t)position;
+	if (i >= size - 1)
+		return lut[size - 1];
+	float t = position - (float)i;
+	return lut[i] + (lut[i + 1] - lut[i]) * t;
+}
+
+// one instruction on count interleaved values, the first of them is channel 0
+static void ndtf_transform_instr(const ndtf_TransformInstr* instr, size_t channels, float* values, size_t count)
+{
+	const float* laneA = instr->laneA;
+	const float* laneB = instr->laneB;
+	size_t i = 0;
+
+	switch (instr->op)
+	{
+	case NDTF_TRANSFORM_SCALEBIAS:
+#ifdef NDTF_TRANSFORM_SSE2
+	{
+		__m128 scale0 = _mm_loadu_ps(laneA), scale1 = _mm_loadu_ps(laneA + 4), scale2 = _mm_loadu_ps(laneA + 8);
+		__m128 bias0 = _mm_loadu_ps(laneB), bias1 = _mm_loadu_ps(laneB + 4), bias2 = _mm_loadu_ps(laneB + 8);
+		for (; i + NDTF_TRANSFORM_LANES <= count; i += NDTF_TRANSFORM_LANES)
+		{
+			_mm_storeu_ps(values + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(values + i), scale0), bias0));
+			_mm_storeu_ps(values + i + 4, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(values + i + 4), scale1), bias1));
+			_mm_storeu_ps(values + i + 8, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(values + i + 8), scale2), bias2));
+		}
+	}
+#endif
+		for (; i < count; i++)
+			values[i] = values[i] * laneA[i % NDTF_TRANSFORM_LANES] + laneB[i % NDTF_TRANSFORM_LANES];
+		break;
+	case NDTF_TRANSFORM_CLAMP:
+		// NaN passes through on both paths
+#ifdef NDTF_TRANSFORM_SSE2
+	{
+		__m128 low0 = _mm_loadu_ps(laneA), low1 = _mm_loadu_ps(laneA + 4), low2 = _mm_loadu_ps(laneA + 8);
+		__m128 high0 = _mm_loadu_ps(laneB), high1 = _mm_loadu_ps(laneB + 4), high2 = _mm_loadu_ps(laneB + 8);
+		for (; i + NDTF_TRANSFORM_LANES <= count; i += NDTF_TRANSFORM_LANES)
+		{
+			_mm_storeu_ps(values + i, _mm_max_ps(low0, _mm_min_ps(high0, _mm_loadu_ps(values + i))));
+			_mm_storeu_ps(values + i + 4, _mm_max_ps(low1, _mm_min_ps(high1, _mm_loadu_ps(values + i + 4))));
+			_mm_storeu_ps(values + i + 8, _mm_max_ps(low2, _mm_min_ps(high2, _mm_loadu_ps(values + i + 8))));
+		}
+	}
+#endif
+		for (; i < count; i++)
+		{
+			float low = laneA[i % NDTF_TRANSFORM_LANES];
+			float high = laneB[i % NDTF_TRANSFORM_LANES];
+			float v = high < values[i] ? high : values[i];
+			values[i] = low > v ? low : v;
+		}
+		break;
+	default:
+		for (size_t c = 0; c < channels; c++)
+		{
+			if (!(instr->mask & (1u << c)))
+				continue;
+
+			float a = instr->a[c];
+			float b = instr->b[c];
+			switch (instr->op)
+			{
+			case NDTF_TRANSFORM_POW:
+				for (i = c; i < count; i += channels)
+					values[i] = copysignf(powf(fabsf(values[i]), a), values[i]);
+				break;
+			case NDTF_TRANSFORM_SRGB_TO_LINEAR:
+				for (i = c; i < count; i += channels)
+					values[i] = ndtf_transform_srgbToLinear(values[i]);
+				break;
+			case NDTF_TRANSFORM_LINEAR_TO_SRGB:
+				for (i = c; i < count; i += channels)
+					values[i] = ndtf_transform_linearToSrgb(values[i]);
+				break;
+			case NDTF_TRANSFORM_LUT:
+				for (i = c; i < count; i += channels)
+					values[i] = ndtf_transform_lut(instr->lut, instr->lutSize, a, b, values[i]);
+				break;
+			default:
+				break;
+			}
+		}
+		break;
+	}
+}
+
+static void ndtf_transform_chain(const NDTF_Transform* transform, float* values, size_t count)
+{
+	for (size_t k = 0; k < transform->instrCount; k++)
+		ndtf_transform_instr(&transform->instrs[k], transform->channels, values, count);
+}
+
+static void ndtf_transform_setIdentity(ndtf_TransformInstr* instr, size_t c)
+{
+	instr->mask &= ~(1u << c);
+	instr->a[c] = instr->op == NDTF_TRANSFORM_CLAMP ? -INFINITY : instr->op == NDTF_TRANSFORM_SCALEBIAS ? 1.0f : 0.0f;
+	// -0 keeps the sign of zeros
+	instr->b[c] = instr->op == NDTF_TRANSFORM_CLAMP ? INFINITY : instr->op == NDTF_TRANSFORM_SCALEBIAS ? -0.0f : 0.0f;
+}
+
+static void ndtf_transform_setLanes(NDTF_Transform* transform)
+{
+	for (size_t k = 0; k < transform->instrCount; k++)
+	{
+		ndtf_TransformInstr* instr = &transform->instrs[k];
+		for (size_t l = 0; l < NDTF_TRANSFORM_LANES; l++)
+		{
+			instr->laneA[l] = instr->a[l % transform->channels];
+			instr->laneB[l] = instr->b[l % transform->channels];
+		}
+	}
+}
+
+static bool ndtf_transform_isIdentity(const ndtf_TransformInstr* instr, size_t c)
+{
+	switch (instr->op)
+	{
+	case NDTF_TRANSFORM_SCALEBIAS:
+		return instr->a[c] == 1.0f && instr->b[c] == 0.0f;
+	case NDTF_TRANSFORM_CLAMP:
+		return instr->a[c] == -INFINITY && instr->b[c] == INFINITY;
+	case NDTF_TRANSFORM_POW:
+		return instr->a[c] == 1.0f;
+	default:
+		return false;
+	}
+}
+
+static bool ndtf_transform_swizzle(NDTF_Transform* transform, const uint8_t swizzle[NDTF_CHANNELS_RGBA])
+{
+	size_t channels = transform->channels;
+	for (size_t c = 0; c < channels; c++)
+	{
+		if (swizzle[c] >= channels && swizzle[c] != NDTF_SWIZZLE_ZERO && swizzle[c] != NDTF_SWIZZLE_ONE)
+			return false;
+	}
+
+	// channel c continues the chain of its source channel
+	for (size_t k = 0; k < transform->instrCount; k++)
+	{
+		ndtf_TransformInstr* instr = &transform->instrs[k];
+		ndtf_TransformInstr old = *instr;
+		for (size_t c = 0; c < channels; c++)
+		{
+			if (swizzle[c] < channels)
+			{
+				instr->a[c] = old.a[swizzle[c]];
+				instr->b[c] = old.b[swizzle[c]];
+				instr->mask = (instr->mask & ~(1u << c)) | (((old.mask >> swizzle[c]) & 1u) << c);
+			}
+			else
+				ndtf_transform_setIdentity(instr, c);
+		}
+	}
+
+	int source[NDTF_CHANNELS_RGBA];
+	float constant[NDTF_CHANNELS_RGBA];
+	for (size_t c = 0; c < channels; c++)
+	{
+		source[c] = swizzle[c] < channels ? transform->source[swizzle[c]] : NDTF_TRANSFORM_CONSTANT;
+		constant[c] = swizzle[c] < channels ? transform->constant[swizzle[c]] : swizzle[c] == NDTF_SWIZZLE_ONE ? 1.0f : 0.0f;
+	}
+	memcpy(transform->source, source, sizeof(source));
+	memcpy(transform->constant, constant, sizeof(constant));
+	return true;
+}
+
+static float ndtf_transform_clampf(float v, float low, float high)
+{
+	return v < low ? low : v > high ? high : v;
+}
+
+static bool ndtf_transform_add(NDTF_Transform* transform, const NDTF_TransformStep* step, float** luts)
+{
+	if (step->op == NDTF_TRANSFORM_SWIZZLE)
+		return ndtf_transform_swizzle(transform, step->swizzle);
+	if ((int)step->op < NDTF_TRANSFORM_SCALEBIAS || (int)step->op > NDTF_TRANSFORM_LUT)
+		return false;
+
+	size_t channels = transform->channels;
+	uint32_t all = (1u << channels) - 1;
+	uint32_t mask = step->channelMask ? step->channelMask & all : all;
+
+	ndtf_TransformInstr instr;
+	memset(&instr, 0, sizeof(ndtf_TransformInstr));
+	instr.op = step->op;
+	instr.mask = mask;
+	for (size_t c = 0; c < channels; c++)
+	{
+		if (!(mask & (1u << c)))
+		{
+			ndtf_transform_setIdentity(&instr, c);
+			continue;
+		}
+
+		instr.a[c] = step->a[c];
+		instr.b[c] = step->b[c];
+		if (step->op == NDTF_TRANSFORM_CLAMP && !(step->a[c] <= step->b[c]))
+			return false;
+		if (step->op == NDTF_TRANSFORM_LUT && (!isfinite(step->a[c]) || !isfinite(step->b[c]) || step->a[c] == step->b[c]))
+			return false;
+	}
+
+	if (step->op == NDTF_TRANSFORM_LUT)
+	{
+		if (!step->lut || step->lutSize < 2)
+			return false;
+		memcpy(*luts, step->lut, step->lutSize * sizeof(float));
+		instr.lut = *luts;
+		instr.lutSize = step->lutSize;
+		*luts += step->lutSize;
+	}
+
+	// neighbouring affine maps and clamps merge into one
+	ndtf_TransformInstr* previous = transform->instrCount ? &transform->instrs[transform->instrCount - 1] : NULL;
+	if (previous && previous->op == instr.op && instr.op == NDTF_TRANSFORM_SCALEBIAS)
+	{
+		for (size_t c = 0; c < channels; c++)
+		{
+			previous->a[c] *= instr.a[c];
+			previous->b[c] = previous->b[c] * instr.a[c] + instr.b[c];
+		}
+		previous->mask |= instr.mask;
+		return true;
+	}
+	if (previous && previous->op == instr.op && instr.op == NDTF_TRANSFORM_CLAMP)
+	{
+		for (size_t c = 0; c < channels; c++)
+		{
+			previous->a[c] = ndtf_transform_clampf(previous->a[c], instr.a[c], instr.b[c]);
+			previous->b[c] = ndtf_transform_clampf(previous->b[c], instr.a[c], instr.b[c]);
+		}
+		previous->mask |= instr.mask;
+		return true;
+	}
+
+	transform->instrs[transform->instrCount++] = instr;
+	return true;
+}
+
+// constants take their whole chain, instructions that change no channel are dropped
+static void ndtf_transform_finish(NDTF_Transform* transform)
+{
+	size_t channels = transform->channels;
+	float texel[NDTF_CHANNELS_RGBA];
+	memcpy(texel, transform->constant, sizeof(texel));
+	ndtf_transform_setLanes(transform);
+	ndtf_transform_chain(transform, texel, channels);
+	for (size_t c = 0; c < channels; c++)
+	{
+		if (transform->source[c] != NDTF_TRANSFORM_CONSTANT)
+			continue;
+		transform->constant[c] = texel[c];
+		for (size_t k = 0; k < transform->instrCount; k++)
+			ndtf_transform_setIdentity(&transform->instrs[k], c);
+	}
+
+	size_t count = 0;
+	for (size_t k = 0; k < transform->instrCount; k++)
+	{
+		ndtf_TransformInstr* instr = &transform->instrs[k];
+		for (size_t c = 0; c < channels; c++)
+		{
+			if ((instr->mask & (1u << c)) && ndtf_transform_isIdentity(instr, c))
+				instr->mask &= ~(1u << c);
+		}
+		if (instr->mask)
+			transform->instrs[count++] = *instr;
+	}
+	transform->instrCount = count;
+	ndtf_transform_setLanes(transform);
+
+	transform->identity = true;
+	for (size_t c = 0; c < channels; c++)
+	{
+		bool chained = false;
+		for (size_t k = 0; k < count; k++)
+			chained = chained || (transform->instrs[k].mask & (1u << c));
+		transform->copied[c] = !chained && transform->source[c] != NDTF_TRANSFORM_CONSTANT;
+		transform->swizzled = transform->swizzled || transform->source[c] != (int)c;
+		transform->identity = transform->identity && !chained && transform->source[c] == (int)c;
+	}
+}
+
+// float values of [0, 1] for integer channels
+static float ndtf_transform_normalize(uint32_t v, size_t channelSize)
+{
+	switch (channelSize)
+	{
+	case 1:
+		return (float)v * (1.0f / 255.0f);
+	case 2:
+		return (float)v * (1.0f / 65535.0f);
+	default:
+		return (float)((double)v * (1.0 / 4294967295.0));
+	}
+}
+
+static uint32_t ndtf_transform_quantize(float v, size_t channelSize)
+{
+	v = v > 0.0f ? v : 0.0f;
+	v = v < 1.0f ? v : 1.0f;
+	switch (channelSize)
+	{
+	case 1:
+		return (uint32_t)(v * 255.0f + 0.5f);
+	case 2:
+		return (uint32_t)(v * 65535.0f + 0.5f);
+	default:
+		return (uint32_t)((double)v * 4294967295.0 + 0.5);
+	}
+}
+
+typedef struct ndtf_TransformTables
+{
+	const NDTF_Transform* transform;
+	size_t size;		// entries per channel
+} ndtf_TransformTables;
+
+static void ndtf_transform_tableTask(void* taskData, size_t index)
+{
+	const ndtf_TransformTables* tables = (const ndtf_TransformTables*)taskData;
+	const NDTF_Transform* transform = tables->transform;
+	size_t channels = transform->channels;
+	size_t begin = index * NDTF_TRANSFORM_CHUNK;
+
+	float values[NDTF_TRANSFORM_CHUNK * NDTF_CHANNELS_RGBA];
+	for (size_t i = 0; i < NDTF_TRANSFORM_CHUNK; i++)
+	{
+		float v = ndtf_transform_normalize((uint32_t)(begin + i), transform->channelSize);
+		for (size_t c = 0; c < channels; c++)
+			values[i * channels + c] = transform->source[c] == NDTF_TRANSFORM_CONSTANT ? transform->constant[c] : v;
+	}
+	ndtf_transform_chain(transform, values, NDTF_TRANSFORM_CHUNK * channels);
+
+	for (size_t c = 0; c < channels; c++)
+	{
+		size_t entry = c * tables->size + begin;
+		for (size_t i = 0; i < NDTF_TRANSFORM_CHUNK; i++)
+		{
+			uint32_t stored = ndtf_transform_quantize(values[i * channels + c], transform->channelSize);
+			if (transform->channelSize == 1)
+				((uint8_t*)transform->tables)[entry + i] = (uint8_t)stored;
+			else
+				((uint16_t*)transform->tables)[entry + i] = (uint16_t)stored;
+		}
+	}
+}
+
+NDTF_Transform* ndtf_transform_create(const NDTF_TransformStep* steps, size_t count, NDTF_TexelFormat texelFormat, const NDTF_Context* ctx)
+{
+	size_t channels = ndtf_getChannelCount(texelFormat);
+	if ((!steps && count) || !channels || ndtf_getIsBlockCompressed(texelFormat))
+		return NULL;
+
+	size_t lutValues = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (steps[i].op == NDTF_TRANSFORM_LUT && !ndtf_size_add(lutValues, steps[i].lutSize, &lutValues))
+			return NULL;
+	}
+
+	NDTF_Transform* transform = (NDTF_Transform*)ndtf_mem_alloc(ctx, sizeof(NDTF_Transform));
+	if (!transform)
+		return NULL;
+	memset(transform, 0, sizeof(NDTF_Transform));
+	transform->texelFormat = texelFormat;
+	transform->channels = channels;
+	transform->channelSize = ndtf_getChannelSize(texelFormat);
+	transform->isFloat = ndtf_getChannelIsFloat(texelFormat);
+	transform->allocator = ndtf_mem_allocator(ctx);
+	for (size_t c = 0; c < NDTF_CHANNELS_RGBA; c++)
+		transform->source[c] = (int)c;
+
+	transform->instrs = (ndtf_TransformInstr*)ndtf_mem_alloc(ctx, max(count * sizeof(ndtf_TransformInstr), 1));
+	transform->luts = lutValues ? (float*)ndtf_mem_alloc(ctx, lutValues * sizeof(float)) : NULL;
+	bool valid = transform->instrs && (!lutValues || transform->luts);
+
+	float* luts = transform->luts;
+	for (size_t i = 0; i < count && valid; i++)
+		valid = ndtf_transform_add(transform, &steps[i], &luts);
+
+	if (valid)
+		ndtf_transform_finish(transform);
+
+	// 8 and 16 bit formats look their whole chain up
+	if (valid && !transform->identity && transform->channelSize <= 2)
+	{
+		ndtf_TransformTables tables;
+		tables.transform = transform;
+		tables.size = (size_t)1 << (8 * transform->channelSize);
+		transform->tables = ndtf_mem_alloc(ctx, channels * tables.size * transform->channelSize);
+		valid = transform->tables != NULL;
+		if (valid)
+			ndtf_parallelFor(ctx, ndtf_transform_tableTask, &tables, tables.size / NDTF_TRANSFORM_CHUNK);
+
+		for (size_t c = 0; c < channels; c++)
+		{
+			if (transform->source[c] == NDTF_TRANSFORM_CONSTANT)
+				transform->source[c] = 0;
+		}
+	}
+
+	if (!valid)
+	{
+		ndtf_transform_free(transform);
+		return NULL;
+	}
+	return transform;
+}
+
+void ndtf_transform_free(NDTF_Transform* transform)
+{
+	if (!transform)
+		return;
+
+	const NDTF_Allocator* allocator = transform->allocator;
+	ndtf_mem_freeWith(allocator, NULL, transform->instrs);
+	ndtf_mem_freeWith(allocator, NULL, transform->luts);
+	ndtf_mem_freeWith(allocator, NULL, transform->tables);
+	ndtf_mem_freeWith(allocator, NULL, transform);
+}
+
+NDTF_TexelFormat ndtf_transform_getTexelFormat(const NDTF_Transform* transform)
+{
+	return transform ? transform->texelFormat : NDTF_TEXELFORMAT_NONE;
+}
+
+bool ndtf_transform_fits(const NDTF_Context* ctx, NDTF_TexelFormat texelFormat)
+{
+	return !ctx || !ctx->transform || ctx->transform->texelFormat == texelFormat;
+}
+
+#define NDTF_TRANSFORM_TABLE_KERNEL(name, type, channels)																		\
+static void name(const NDTF_Transform* transform, const type* src, type* dst, size_t count)										\
+{																																\
+	const type* tables = (const type*)transform->tables;																		\
+	size_t size = (size_t)1 << (8 * sizeof(type));																				\
+	int source[NDTF_CHANNELS_RGBA];																								\
+	memcpy(source, transform->source, sizeof(source));																			\
+																																\
+	for (size_t i = 0; i < count * channels; i += channels)																		\
+	{																															\
+		type texel[channels];																									\
+		for (size_t c = 0; c < channels; c++)																					\
+			texel[c] = src[i + c];																								\
+		for (size_t c = 0; c < channels; c++)																					\
+			dst[i + c] = tables[c * size + texel[source[c]]];																	\
+	}																															\
+}
+
+NDTF_TRANSFORM_TABLE_KERNEL(ndtf_transform_u8x1, uint8_t, 1)
+NDTF_TRANSFORM_TABLE_KERNEL(ndtf_transform_u8x3, uint8_t, 3)
+NDTF_TRANSFORM_TABLE_KERNEL(ndtf_transform_u8x4, uint8_t, 4)
+NDTF_TRANSFORM_TABLE_KERNEL(ndtf_transform_u16x1, uint16_t, 1)
+NDTF_TRANSFORM_TABLE_KERNEL(ndtf_transform_u16x3, uint16_t, 3)
+NDTF_TRANSFORM_TABLE_KERNEL(ndtf_transform_u16x4, uint16_t, 4)
+
+// 32 bit channels. float texels without a swizzle are transformed where they are, the others are gathered into
+// values first. channels without instructions keep their bits
+static void ndtf_transform_wide(const NDTF_Transform* transform, const uint32_t* src, uint32_t* dst, size_t count)
+{
+	size_t channels = transform->channels;
+	bool direct = transform->isFloat && !transform->swizzled;
+	float gathered[NDTF_TRANSFORM_CHUNK * NDTF_CHANNELS_RGBA];
+	uint32_t bits[NDTF_TRANSFORM_CHUNK * NDTF_CHANNELS_RGBA];
+
+	for (size_t begin = 0; begin < count; begin += NDTF_TRANSFORM_CHUNK)
+	{
+		size_t n = min(count - begin, (size_t)NDTF_TRANSFORM_CHUNK) * channels;
+		const uint32_t* in = src + begin * channels;
+		uint32_t* out = dst + begin * channels;
+
+		if (direct)
+		{
+			if (in != out)
+				memcpy(out, in, n * sizeof(uint32_t));
+			ndtf_transform_chain(transform, (float*)out, n);
+			continue;
+		}
+
+		for (size_t i = 0; i < n; i += channels)
+		{
+			for (size_t c = 0; c < channels; c++)
+			{
+				int source = transform->source[c];
+				uint32_t v = source == NDTF_TRANSFORM_CONSTANT ? 0 : in[i + source];
+				bits[i + c] = v;
+				if (source == NDTF_TRANSFORM_CONSTANT)
+					gathered[i + c] = transform->constant[c];
+				else if (transform->isFloat)
+					memcpy(&gathered[i + c], &v, sizeof(float));
+				else
+					gathered[i + c] = ndtf_transform_normalize(v, 4);
+			}
+		}
+
+		ndtf_transform_chain(transform, gathered, n);
+
+		if (transform->isFloat)
+		{
+			memcpy(out, gathered, n * sizeof(float));
+			continue;
+		}
+		for (size_t i = 0; i < n; i += channels)
+		{
+			for (size_t c = 0; c < channels; c++)
+				out[i + c] = transform->copied[c] ? bits[i + c] : ndtf_transform_quantize(gathered[i + c], 4);
+		}
+	}
+}
+
+void ndtf_transform_run(const NDTF_Transform* transform, const uint8_t* src, uint8_t* dst, size_t count)
+{
+	if (transform->identity)
+	{
+		if (src != dst)
+			memcpy(dst, src, count * transform->channels * transform->channelSize);
+		return;
+	}
+
+	size_t kernel = transform->channelSize * 8 + transform->channels;
+	switch (kernel)
+	{
+	case 9:
+		ndtf_transform_u8x1(transform, src, dst, count);
+		break;
+	case 11:
+		ndtf_transform_u8x3(transform, src, dst, count);
+		break;
+	case 12:
+		ndtf_transform_u8x4(transform, src, dst, count);
+		break;
+	case 17:
+		ndtf_transform_u16x1(transform, (const uint16_t*)src, (uint16_t*)dst, count);
+		break;
+	case 19:
+		ndtf_transform_u16x3(transform, (const uint16_t*)src, (uint16_t*)dst, count);
+		break;
+	case 20:
+		ndtf_transform_u16x4(transform, (const uint16_t*)src, (uint16_t*)dst, count);
+		break;
+	default:
+		ndtf_transform_wide(transform, (const uint32_t*)src, (uint32_t*)dst, count);
+		break;
+	}
+}
+
+typedef struct ndtf_TransformTask
+{
+	const NDTF_Transform* transform;
+	const uint8_t* src;
+	uint8_t* dst;
+	size_t texels;
+	size_t texelSize;
+	size_t chunkTexels;
+} ndtf_TransformTask;
+
+static void ndtf_transform_task(void* taskData, size_t index)
+{
+	const ndtf_TransformTask* task = (const ndtf_TransformTask*)taskData;
+	size_t begin = index * task->chunkTexels;
+	size_t count = min(task->chunkTexels, task->texels - begin);
+	ndtf_transform_run(task->transform, task->src + begin * task->texelSize, task->dst + begin * task->texelSize, count);
+}
+
+void ndtf_transform_runParallel(const NDTF_Transform* transform, const uint8_t* src, uint8_t* dst, size_t count, const NDTF_Context* ctx)
+{
+	ndtf_TransformTask task;
+	task.transform = transform;
+	task.src = src;
+	task.dst = dst;
+	task.texels = count;
+	task.texelSize = transform->channels * transform->channelSize;
+
+	size_t chunks = min(ndtf_concurrency(ctx) * 4, max(count * task.texelSize / NDTF_TRANSFORM_TASK_MIN, 1));
+	task.chunkTexels = max((count + chunks - 1) / chunks, 1);
+
+	NDTF_SCOPE_BEGIN(transformScope, ctx, NDTF_PHASE_CONVERT, "transform");
+
+	if (count)
+		ndtf_parallelFor(ctx, ndtf_transform_task, &task, (count + task.chunkTexels - 1) / task.chunkTexels);
+
+	NDTF_SCOPE_END(transformScope, ctx, count * task.texelSize);
+}
+
+bool ndtf_transform_apply(const NDTF_Transform* transform, void* texels, size_t count, const NDTF_Context* ctx)
+{
+	if (!transform || (!texels && count))
+		return false;
+
+	if (!transform->identity)
+		ndtf_transform_runParallel(transform, (const uint8_t*)texels, (uint8_t*)texels, count, ctx);
+	return true;
+}
+
+typedef struct ndtf_TransformRegion
+{
+	const NDTF_Transform* transform;
+	uint8_t* data;
+	size_t size[NDTF_DIMENSIONS_MAX];
+	size_t origin[NDTF_DIMENSIONS_MAX];
+	size_t extent[NDTF_DIMENSIONS_MAX];
+	size_t texelSize;
+	size_t rows;
+	size_t rowsPerTask;
+} ndtf_TransformRegion;
+
+static void ndtf_transform_regionTask(void* taskData, size_t index)
+{
+	const ndtf_TransformRegion* region = (const ndtf_TransformRegion*)taskData;
+	const size_t* size = region->size;
+	const size_t* origin = region->origin;
+	const size_t* extent = region->extent;
+
+	size_t end = min(region->rows, (index + 1) * region->rowsPerTask);
+	for (size_t r = index * region->rowsPerTask; r < end; r++)
+	{
+		size_t rest = r;
+		size_t y = origin[1] + rest % extent[1];
+		rest /= extent[1];
+		size_t z = origin[2] + rest % extent[2];
+		rest /= extent[2];
+		size_t w = origin[3] + rest % extent[3];
+		size_t v = origin[4] + rest / extent[3];
+
+		size_t texel = origin[0] + size[0] * (y + size[1] * (z + size[2] * (w + size[3] * v)));
+		uint8_t* row = region->data + texel * region->texelSize;
+		ndtf_transform_run(region->transform, row, row, extent[0]);
+	}
+}
+
+bool ndtf_file_transform(NDTF_File* file, const NDTF_Transform* transform, const uint32_t origin[NDTF_DIMENSIONS_MAX], const uint32_t extent[NDTF_DIMENSIONS_MAX], const NDTF_Context* ctx)
+{
+	if (!transform || !ndtf_file_isValid(file) || file->header.texelFormat != transform->texelFormat || (!origin) != (!extent))
+		return false;
+
+	size_t texelSize = ndtf_getTexelSize(transform->texelFormat);
+	if (!origin)
+		return ndtf_transform_apply(transform, file->data, ndtf_file_getDataSize(file) / texelSize, ctx);
+
+	ndtf_TransformRegion region;
+	region.transform = transform;
+	region.data = file->data;
+	region.texelSize = texelSize;
+	region.rows = 1;
+
+	ndtf_Bricks bricks;
+	ndtf_bricks_init(&bricks, &file->header);
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+	{
+		bool used = i < file->header.dimensions;
+		region.size[i] = bricks.size[i];
+		region.origin[i] = used ? origin[i] : 0;
+		region.extent[i] = used ? extent[i] : 1;
+		if (!region.extent[i] || region.origin[i] >= region.size[i] || region.extent[i] > region.size[i] - region.origin[i])
+			return false;
+		if (i > 0)
+			region.rows *= region.extent[i];
+	}
+
+	if (transform->identity)
+		return true;
+
+	size_t rowBytes = region.extent[0] * texelSize;
+	size_t tasks = min(ndtf_concurrency(ctx) * 4, max(region.rows * rowBytes / NDTF_TRANSFORM_TASK_MIN, 1));
+	region.rowsPerTask = max((region.rows + tasks - 1) / tasks, 1);
+
+	NDTF_SCOPE_BEGIN(transformScope, ctx, NDTF_PHASE_CONVERT, "transform");
+	ndtf_parallelFor(ctx, ndtf_transform_regionTask, &region, (region.rows + region.rowsPerTask - 1) / region.rowsPerTask);
+	NDTF_SCOPE_END(transformScope, ctx, region.rows * rowBytes);
+	return true;
+}
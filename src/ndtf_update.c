@@ -0,0 +1,442 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+	#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "ndtf_internal.h"
+#include <string.h>
+#include <stdlib.h>
+
+// incremental updates of segmented files: rewritten bricks get new segments in the space no segment uses or at
+// the end of the file, the old ones become dead space until the file is compacted
+
+#define NDTF_COMPACT_COPY_SIZE ((size_t)1 << 20) // chunk in which segments are copied when compacting
+
+typedef struct ndtf_SegmentFile
+{
+	FILE* file;
+	NDTF_Header header;
+	uint64_t fileSize;
+	uint64_t tableOffset;	// of the segment table, right after the header
+	uint64_t dataOffset;	// first byte after the tables
+	NDTF_SegmentTable table;
+	NDTF_Segment* segments;
+	size_t count;
+	uint8_t* entries;		// segment entries, zone map table and ranges as stored
+	size_t entriesSize;
+	const NDTF_Context* ctx;
+} ndtf_SegmentFile;
+
+typedef struct ndtf_FileRange
+{
+	uint64_t offset;
+	uint64_t size;
+	size_t segment;
+} ndtf_FileRange;
+
+static void ndtf_segmentFile_close(ndtf_SegmentFile* segmentFile)
+{
+	if (segmentFile->file)
+		fclose(segmentFile->file);
+	ndtf_mem_free(segmentFile->ctx, segmentFile->segments);
+	ndtf_mem_free(segmentFile->ctx, segmentFile->entries);
+	memset(segmentFile, 0, sizeof(ndtf_SegmentFile));
+}
+
+static bool ndtf_segmentFile_open(ndtf_SegmentFile* segmentFile, const char* filename, const char* mode, const NDTF_Context* ctx)
+{
+	memset(segmentFile, 0, sizeof(ndtf_SegmentFile));
+	segmentFile->ctx = ctx;
+
+	segmentFile->file = fopen(filename, mode);
+	if (!segmentFile->file)
+		return false;
+
+	if (ndtf_fseek64(segmentFile->file, 0, SEEK_END) != 0)
+		return false;
+	int64_t fileSize = ndtf_ftell64(segmentFile->file);
+	if (fileSize < 0 || ndtf_fseek64(segmentFile->file, 0, SEEK_SET) != 0)
+		return false;
+	segmentFile->fileSize = (uint64_t)fileSize;
+
+	NDTF_SCOPE_BEGIN(headerScope, ctx, NDTF_PHASE_HEADER, "header");
+	bool valid = ndtf_header_read(segmentFile->file, &segmentFile->header) && segmentFile->header.flags.segmented;
+	NDTF_SCOPE_END(headerScope, ctx, valid ? sizeof(NDTF_Header) : 0);
+	if (!valid)
+		return false;
+
+	segmentFile->tableOffset = ndtf_header_storedSize(&segmentFile->header);
+	if (fread(&segmentFile->table, 1, sizeof(NDTF_SegmentTable), segmentFile->file) != sizeof(NDTF_SegmentTable) ||
+		segmentFile->table.count > segmentFile->fileSize / sizeof(NDTF_Segment))
+		return false;
+
+	segmentFile->count = (size_t)segmentFile->table.count;
+	segmentFile->entriesSize = ndtf_segments_tableSize(&segmentFile->header, segmentFile->count);
+	segmentFile->dataOffset = segmentFile->tableOffset + sizeof(NDTF_SegmentTable) + segmentFile->entriesSize;
+	segmentFile->entries = (uint8_t*)ndtf_mem_alloc(ctx, max(segmentFile->entriesSize, 1));
+	if (!segmentFile->entries)
+		return false;
+
+	NDTF_SCOPE_BEGIN(ioScope, ctx, NDTF_PHASE_IO, "fread");
+	size_t bytesRead = fread(segmentFile->entries, 1, segmentFile->entriesSize, segmentFile->file);
+	NDTF_SCOPE_END(ioScope, ctx, bytesRead);
+
+	return bytesRead == segmentFile->entriesSize &&
+		ndtf_segments_validate(&segmentFile->header, &segmentFile->table, segmentFile->entries, segmentFile->fileSize, &segmentFile->segments, ctx);
+}
+
+static int ndtf_fileRange_compare(const void* a, const void* b)
+{
+	const ndtf_FileRange* rangeA = (const ndtf_FileRange*)a;
+	const ndtf_FileRange* rangeB = (const ndtf_FileRange*)b;
+	if (rangeA->offset != rangeB->offset)
+		return rangeA->offset < rangeB->offset ? -1 : 1;
+	return rangeA->size < rangeB->size ? -1 : rangeA->size > rangeB->size ? 1 : 0;
+}
+
+// unused ranges between the tables and the end of the file, in file order
+static ndtf_FileRange* ndtf_segmentFile_findGaps(const ndtf_SegmentFile* segmentFile, size_t* gapCount)
+{
+	size_t count = segmentFile->count;
+	ndtf_FileRange* ranges = (ndtf_FileRange*)ndtf_mem_alloc(segmentFile->ctx, (count + 1) * sizeof(ndtf_FileRange));
+	if (!ranges)
+		return NULL;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		ranges[i].offset = segmentFile->segments[i].offset;
+		ranges[i].size = segmentFile->segments[i].size;
+		ranges[i].segment = i;
+	}
+	qsort(ranges, count, sizeof(ndtf_FileRange), ndtf_fileRange_compare);
+
+	// gaps are written over the sorted ranges, there is never more of them than ranges read so far plus one
+	size_t gaps = 0;
+	uint64_t cursor = segmentFile->dataOffset;
+	for (size_t i = 0; i < count; i++)
+	{
+		ndtf_FileRange range = ranges[i];
+		if (range.offset > cursor)
+		{
+			ranges[gaps].offset = cursor;
+			ranges[gaps].size = range.offset - cursor;
+			ranges[gaps].segment = SIZE_MAX;
+			gaps++;
+		}
+		cursor = max(cursor, range.offset + range.size);
+	}
+	if (segmentFile->fileSize > cursor)
+	{
+		ranges[gaps].offset = cursor;
+		ranges[gaps].size = segmentFile->fileSize - cursor;
+		ranges[gaps].segment = SIZE_MAX;
+		gaps++;
+	}
+
+	*gapCount = gaps;
+	return ranges;
+}
+
+// first gap the segment fits, the end of the file otherwise
+static uint64_t ndtf_segmentFile_place(ndtf_FileRange* gaps, size_t gapCount, uint64_t* end, uint64_t size)
+{
+	for (size_t i = 0; i < gapCount; i++)
+	{
+		if (gaps[i].size >= size)
+		{
+			uint64_t offset = gaps[i].offset;
+			gaps[i].offset += size;
+			gaps[i].size -= size;
+			return offset;
+		}
+	}
+
+	uint64_t offset = *end;
+	*end += size;
+	return offset;
+}
+
+static bool ndtf_segmentFile_write(ndtf_SegmentFile* segmentFile, uint64_t offset, const void* data, size_t size)
+{
+	if (ndtf_fseek64(segmentFile->file, (int64_t)offset, SEEK_SET) != 0)
+		return false;
+
+	NDTF_SCOPE_BEGIN(ioScope, segmentFile->ctx, NDTF_PHASE_IO, "fwrite");
+	size_t bytesWritten = fwrite(data, 1, size, segmentFile->file);
+	NDTF_SCOPE_END(ioScope, segmentFile->ctx, bytesWritten);
+
+	return bytesWritten == size;
+}
+
+// bricks overlapping the region. a changed slice of a delta encoded file also changes the difference stored
+// in the slice after it
+static size_t* ndtf_update_dirtyBricks(const NDTF_Header* header, const size_t origin[NDTF_DIMENSIONS_MAX], const size_t extent[NDTF_DIMENSIONS_MAX], size_t* dirtyCount, const NDTF_Context* ctx)
+{
+	ndtf_Bricks bricks;
+	ndtf_bricks_init(&bricks, header);
+	int axis = ndtf_delta_axis(header);
+
+	size_t first[NDTF_DIMENSIONS_MAX], last[NDTF_DIMENSIONS_MAX];
+	size_t count = 1;
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+	{
+		first[i] = origin[i] / bricks.extent[i];
+		last[i] = (origin[i] + extent[i] - 1) / bricks.extent[i];
+		if (i == axis && last[i] + 1 < bricks.grid[i] && !ndtf_delta_isKeyframe(header, last[i] + 1))
+			last[i]++;
+		count *= last[i] - first[i] + 1;
+	}
+
+	size_t* dirty = (size_t*)ndtf_mem_alloc(ctx, count * sizeof(size_t));
+	if (!dirty)
+		return NULL;
+
+	for (size_t n = 0; n < count; n++)
+	{
+		size_t rest = n;
+		size_t index = 0, stride = 1;
+		for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+		{
+			size_t span = last[i] - first[i] + 1;
+			index += (first[i] + rest % span) * stride;
+			rest /= span;
+			stride *= bricks.grid[i];
+		}
+		dirty[n] = index;
+	}
+
+	*dirtyCount = count;
+	return dirty;
+}
+
+bool ndtf_file_update(NDTF_File* file, const char* filename, const uint32_t origin[NDTF_DIMENSIONS_MAX], const uint32_t extent[NDTF_DIMENSIONS_MAX], const NDTF_Context* ctx)
+{
+	if (!ndtf_file_isValid(file) || !filename || !origin || !extent)
+		return false;
+
+	ndtf_SegmentFile segmentFile;
+	if (!ndtf_segmentFile_open(&segmentFile, filename, "r+b", ctx))
+	{
+		ndtf_segmentFile_close(&segmentFile);
+		return false;
+	}
+
+	// the stored layout decides the bricks, the texels have to describe the same volume
+	const NDTF_Header* header = &segmentFile.header;
+	bool matches = header->dimensions == file->header.dimensions && header->texelFormat == file->header.texelFormat &&
+		memcmp(header->size, file->header.size, sizeof(header->size)) == 0 && ndtf_transform_fits(ctx, (NDTF_TexelFormat)header->texelFormat);
+
+	ndtf_Bricks bricks;
+	ndtf_bricks_init(&bricks, header);
+
+	size_t regionOrigin[NDTF_DIMENSIONS_MAX];
+	size_t regionExtent[NDTF_DIMENSIONS_MAX];
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX && matches; i++)
+	{
+		bool used = i < header->dimensions;
+		regionOrigin[i] = used ? origin[i] : 0;
+		regionExtent[i] = used ? extent[i] : 1;
+		matches = regionExtent[i] && regionOrigin[i] < bricks.size[i] && regionExtent[i] <= bricks.size[i] - regionOrigin[i];
+	}
+
+	size_t dirtyCount = 0;
+	size_t* dirty = matches ? ndtf_update_dirtyBricks(header, regionOrigin, regionExtent, &dirtyCount, ctx) : NULL;
+	if (!dirty)
+	{
+		ndtf_segmentFile_close(&segmentFile);
+		return false;
+	}
+
+	NDTF_File target;
+	memset(&target, 0, sizeof(NDTF_File));
+	target.header = *header;
+	target.data = file->data;
+	target.errorBound = file->errorBound;
+
+	ndtf_EncodedSegments encoded;
+	size_t gapCount = 0;
+	ndtf_FileRange* gaps = NULL;
+	bool result = ndtf_segments_encodeBricks(&target, dirty, dirtyCount, &encoded, ctx ? ctx->transform : NULL, ctx);
+	if (result)
+	{
+		gaps = ndtf_segmentFile_findGaps(&segmentFile, &gapCount);
+		result = gaps != NULL;
+	}
+
+	// new segments first, the old ones stay valid until the entries point away from them
+	uint64_t end = segmentFile.fileSize;
+	size_t lowest = SIZE_MAX, highest = 0;
+	for (size_t n = 0; n < dirtyCount && result; n++)
+	{
+		size_t index = dirty[n];
+		NDTF_Segment* segment = &encoded.segments[index];
+		segment->offset = ndtf_segmentFile_place(gaps, gapCount, &end, segment->size);
+		result = ndtf_segmentFile_write(&segmentFile, segment->offset, encoded.data[index], (size_t)segment->size);
+		lowest = min(lowest, index);
+		highest = max(highest, index);
+	}
+	result = result && fflush(segmentFile.file) == 0;
+
+	if (result)
+	{
+		size_t channels = ndtf_getChannelCount((NDTF_TexelFormat)header->texelFormat);
+		size_t entriesSize = segmentFile.count * sizeof(NDTF_Segment);
+		uint8_t* ranges = header->flags.zoneMaps ? segmentFile.entries + entriesSize + sizeof(NDTF_ZoneMapTable) : NULL;
+		for (size_t n = 0; n < dirtyCount; n++)
+		{
+			size_t index = dirty[n];
+			memcpy(segmentFile.entries + index * sizeof(NDTF_Segment), &encoded.segments[index], sizeof(NDTF_Segment));
+			if (header->flags.zoneMaps)
+				memcpy(ranges + index * channels * sizeof(NDTF_ValueRange), encoded.zoneMaps + index * channels, channels * sizeof(NDTF_ValueRange));
+		}
+
+		NDTF_ZoneMapTable zoneTable;
+		if (header->flags.zoneMaps)
+			memcpy(&zoneTable, segmentFile.entries + entriesSize, sizeof(NDTF_ZoneMapTable));
+		if (header->flags.checksums)
+		{
+			segmentFile.table.checksum = ndtf_crc32c(0, segmentFile.entries, entriesSize);
+			if (header->flags.zoneMaps)
+				zoneTable.checksum = ndtf_crc32c(0, ranges, (size_t)zoneTable.count * sizeof(NDTF_ValueRange));
+		}
+
+		// the span of changed entries and ranges, then the checksums that cover them
+		uint64_t entriesOffset = segmentFile.tableOffset + sizeof(NDTF_SegmentTable);
+		result = ndtf_segmentFile_write(&segmentFile, entriesOffset + lowest * sizeof(NDTF_Segment),
+			segmentFile.entries + lowest * sizeof(NDTF_Segment), (highest - lowest + 1) * sizeof(NDTF_Segment));
+		if (result && header->flags.zoneMaps)
+		{
+			size_t rangeSize = channels * sizeof(NDTF_ValueRange);
+			result = ndtf_segmentFile_write(&segmentFile, entriesOffset + entriesSize + sizeof(NDTF_ZoneMapTable) + lowest * rangeSize,
+				ranges + lowest * rangeSize, (highest - lowest + 1) * rangeSize) &&
+				ndtf_segmentFile_write(&segmentFile, entriesOffset + entriesSize, &zoneTable, sizeof(NDTF_ZoneMapTable));
+		}
+		result = result && ndtf_segmentFile_write(&segmentFile, segmentFile.tableOffset, &segmentFile.table, sizeof(NDTF_SegmentTable)) &&
+			fflush(segmentFile.file) == 0;
+	}
+
+	if (encoded.segments)
+		ndtf_segments_freeEncoded(&encoded, ctx);
+	ndtf_mem_free(ctx, gaps);
+	ndtf_mem_free(ctx, dirty);
+	ndtf_segmentFile_close(&segmentFile);
+	return result;
+}
+
+static bool ndtf_compact_replace(const char* from, const char* to)
+{
+#ifdef _WIN32
+	return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return rename(from, to) == 0;
+#endif
+}
+
+// segments copied in file order into a new file next to the old one, which then replaces it. deduplicated
+// bricks keep sharing their segment
+bool ndtf_compact(const char* filename, uint64_t* reclaimed, const NDTF_Context* ctx)
+{
+	if (reclaimed)
+		*reclaimed = 0;
+	if (!filename)
+		return false;
+
+	ndtf_SegmentFile segmentFile;
+	if (!ndtf_segmentFile_open(&segmentFile, filename, "rb", ctx))
+	{
+		ndtf_segmentFile_close(&segmentFile);
+		return false;
+	}
+
+	size_t count = segmentFile.count;
+	ndtf_FileRange* ranges = (ndtf_FileRange*)ndtf_mem_alloc(ctx, max(count * sizeof(ndtf_FileRange), 1));
+	NDTF_Segment* segments = (NDTF_Segment*)ndtf_mem_alloc(ctx, max(count * sizeof(NDTF_Segment), 1));
+	uint8_t* buffer = (uint8_t*)ndtf_mem_alloc(ctx, NDTF_COMPACT_COPY_SIZE);
+	size_t nameLength = strlen(filename);
+	char* compactName = (char*)ndtf_mem_alloc(ctx, nameLength + sizeof(".compact"));
+	if (!ranges || !segments || !buffer || !compactName)
+	{
+		ndtf_mem_free(ctx, ranges);
+		ndtf_mem_free(ctx, segments);
+		ndtf_mem_free(ctx, buffer);
+		ndtf_mem_free(ctx, compactName);
+		ndtf_segmentFile_close(&segmentFile);
+		return false;
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		ranges[i].offset = segmentFile.segments[i].offset;
+		ranges[i].size = segmentFile.segments[i].size;
+		ranges[i].segment = i;
+	}
+	qsort(ranges, count, sizeof(ndtf_FileRange), ndtf_fileRange_compare);
+
+	// new offsets in file order, equal ranges share
+	memcpy(segments, segmentFile.segments, count * sizeof(NDTF_Segment));
+	uint64_t cursor = segmentFile.dataOffset;
+	bool moved = false;
+	for (size_t i = 0; i < count; i++)
+	{
+		NDTF_Segment* segment = &segments[ranges[i].segment];
+		if (i > 0 && ranges[i].offset == ranges[i - 1].offset && ranges[i].size == ranges[i - 1].size)
+		{
+			segment->offset = segments[ranges[i - 1].segment].offset;
+			continue;
+		}
+		segment->offset = cursor;
+		cursor += ranges[i].size;
+		moved |= segment->offset != ranges[i].offset;
+	}
+
+	bool result = true;
+	if (moved || cursor < segmentFile.fileSize)
+	{
+		memcpy(compactName, filename, nameLength);
+		memcpy(compactName + nameLength, ".compact", sizeof(".compact"));
+
+		NDTF_SegmentTable table = segmentFile.table;
+		if (segmentFile.header.flags.checksums)
+			table.checksum = ndtf_crc32c(0, segments, count * sizeof(NDTF_Segment));
+		size_t entriesSize = count * sizeof(NDTF_Segment);
+
+		FILE* out = fopen(compactName, "wb");
+		result = out && ndtf_header_write(out, &segmentFile.header) &&
+			fwrite(&table, 1, sizeof(NDTF_SegmentTable), out) == sizeof(NDTF_SegmentTable) &&
+			fwrite(segments, sizeof(NDTF_Segment), count, out) == count &&
+			fwrite(segmentFile.entries + entriesSize, 1, segmentFile.entriesSize - entriesSize, out) == segmentFile.entriesSize - entriesSize;
+
+		NDTF_SCOPE_BEGIN(ioScope, ctx, NDTF_PHASE_IO, "compact");
+		for (size_t i = 0; i < count && result; i++)
+		{
+			if (i > 0 && ranges[i].offset == ranges[i - 1].offset && ranges[i].size == ranges[i - 1].size)
+				continue;
+
+			result = ndtf_fseek64(segmentFile.file, (int64_t)ranges[i].offset, SEEK_SET) == 0;
+			for (uint64_t done = 0; done < ranges[i].size && result; done += NDTF_COMPACT_COPY_SIZE)
+			{
+				size_t chunk = (size_t)min(ranges[i].size - done, (uint64_t)NDTF_COMPACT_COPY_SIZE);
+				result = fread(buffer, 1, chunk, segmentFile.file) == chunk && fwrite(buffer, 1, chunk, out) == chunk;
+			}
+		}
+		NDTF_SCOPE_END(ioScope, ctx, result ? cursor : 0);
+
+		if (out && fclose(out) != 0)
+			result = false;
+
+		fclose(segmentFile.file);
+		segmentFile.file = NULL;
+
+		result = result && ndtf_compact_replace(compactName, filename);
+		if (!result)
+			remove(compactName);
+		else if (reclaimed)
+			*reclaimed = segmentFile.fileSize - cursor;
+	}
+
+	ndtf_mem_free(ctx, ranges);
+	ndtf_mem_free(ctx, segments);
+	ndtf_mem_free(ctx, buffer);
+	ndtf_mem_free(ctx, compactName);
+	ndtf_segmentFile_close(&segmentFile);
+	return result;
+}
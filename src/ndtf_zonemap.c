@@ -0,0 +1,188 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+	#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "ndtf_internal.h"
+#include <string.h>
+#include <math.h>
+
+void ndtf_zoneMaps_fromStats(const NDTF_Header* header, const ndtf_LossyBound* errorBound, const ndtf_TexelStatsPartial* partial, NDTF_ValueRange* ranges)
+{
+	size_t channels = ndtf_getChannelCount((NDTF_TexelFormat)header->texelFormat);
+	for (size_t c = 0; c < channels; c++)
+	{
+		double low = partial->min[c];
+		double high = partial->max[c];
+
+		if (partial->infCount[c])
+		{
+			// the statistics do not keep the sign of infinities
+			low = -INFINITY;
+			high = INFINITY;
+		}
+		else if (errorBound && low <= high)
+		{
+			// the decoded values may move by the bound
+			low -= errorBound->absolute[c];
+			high += errorBound->absolute[c];
+		}
+
+		ranges[c].min = low;
+		ranges[c].max = high;
+	}
+}
+
+// copies the ranges out of a validated table
+static bool ndtf_zoneMaps_init(NDTF_ZoneMaps* maps, const NDTF_Header* header, const NDTF_SegmentTable* table, const uint8_t* entries, uint64_t fileSize, const NDTF_Context* ctx)
+{
+	if (!header->flags.zoneMaps)
+		return false;
+
+	NDTF_Segment* segments;
+	if (!ndtf_segments_validate(header, table, entries, fileSize, &segments, ctx))
+		return false;
+	ndtf_mem_free(ctx, segments);
+
+	size_t channels = ndtf_getChannelCount((NDTF_TexelFormat)header->texelFormat);
+	size_t rangesSize = (size_t)table->count * channels * sizeof(NDTF_ValueRange);
+
+	maps->ranges = (NDTF_ValueRange*)ndtf_mem_alloc(ctx, max(rangesSize, 1));
+	if (!maps->ranges)
+		return false;
+	memcpy(maps->ranges, entries + (size_t)table->count * sizeof(NDTF_Segment) + sizeof(NDTF_ZoneMapTable), rangesSize);
+
+	maps->header = *header;
+	maps->brickCount = (size_t)table->count;
+	maps->channelCount = channels;
+	return true;
+}
+
+bool ndtf_zoneMaps_loadFromData(NDTF_ZoneMaps* maps, const uint8_t* data, size_t size, const NDTF_Context* ctx)
+{
+	if (!maps)
+		return false;
+
+	memset(maps, 0, sizeof(NDTF_ZoneMaps));
+	maps->allocator = ndtf_mem_allocator(ctx);
+
+	NDTF_Header header;
+	size_t headerSize = ndtf_header_decode(data, size, &header);
+	if (!headerSize || !header.flags.segmented || size < headerSize + sizeof(NDTF_SegmentTable))
+		return false;
+
+	NDTF_SegmentTable table;
+	memcpy(&table, data + headerSize, sizeof(NDTF_SegmentTable));
+
+	return ndtf_zoneMaps_init(maps, &header, &table, data + headerSize + sizeof(NDTF_SegmentTable), size, ctx);
+}
+
+bool ndtf_zoneMaps_loadFromFile(NDTF_ZoneMaps* maps, FILE* file, const NDTF_Context* ctx)
+{
+	if (!maps)
+		return false;
+
+	memset(maps, 0, sizeof(NDTF_ZoneMaps));
+	maps->allocator = ndtf_mem_allocator(ctx);
+
+	if (!file || ndtf_fseek64(file, 0, SEEK_END) != 0)
+		return false;
+	int64_t fileSize = ndtf_ftell64(file);
+	if (fileSize < 0 || ndtf_fseek64(file, 0, SEEK_SET) != 0)
+		return false;
+
+	// only the tables in front of the segments are read
+	NDTF_Header header;
+	NDTF_SegmentTable table;
+	if (!ndtf_header_read(file, &header) || !header.flags.zoneMaps ||
+		fread(&table, 1, sizeof(NDTF_SegmentTable), file) != sizeof(NDTF_SegmentTable) ||
+		table.count > (uint64_t)fileSize / sizeof(NDTF_Segment))
+		return false;
+
+	size_t entriesSize = ndtf_segments_tableSize(&header, (size_t)table.count);
+	uint8_t* entries = (uint8_t*)ndtf_mem_alloc(ctx, max(entriesSize, 1));
+	if (!entries)
+		return false;
+
+	NDTF_SCOPE_BEGIN(ioScope, ctx, NDTF_PHASE_IO, "fread");
+	size_t bytesRead = fread(entries, 1, entriesSize, file);
+	NDTF_SCOPE_END(ioScope, ctx, bytesRead);
+
+	bool result = bytesRead == entriesSize && ndtf_zoneMaps_init(maps, &header, &table, entries, (uint64_t)fileSize, ctx);
+	ndtf_mem_free(ctx, entries);
+
+	return result;
+}
+
+bool ndtf_zoneMaps_load(NDTF_ZoneMaps* maps, const char* filename, const NDTF_Context* ctx)
+{
+	FILE* file = fopen(filename, "rb");
+	if (!file)
+	{
+		if (maps)
+			memset(maps, 0, sizeof(NDTF_ZoneMaps));
+		return false;
+	}
+
+	bool result = ndtf_zoneMaps_loadFromFile(maps, file, ctx);
+	fclose(file);
+
+	return result;
+}
+
+size_t ndtf_zoneMaps_query(const NDTF_ZoneMaps* maps, int channel, double low, double high, uint64_t* bricks, size_t capacity)
+{
+	if (!maps || !maps->ranges || channel >= (int)maps->channelCount)
+		return 0;
+
+	size_t first = channel < 0 ? 0 : (size_t)channel;
+	size_t last = channel < 0 ? maps->channelCount : (size_t)channel + 1;
+
+	size_t matches = 0;
+	for (size_t b = 0; b < maps->brickCount; b++)
+	{
+		const NDTF_ValueRange* ranges = maps->ranges + b * maps->channelCount;
+
+		bool overlaps = false;
+		for (size_t c = first; c < last && !overlaps; c++)
+			overlaps = ranges[c].min <= high && ranges[c].max >= low;
+
+		if (overlaps)
+		{
+			if (bricks && matches < capacity)
+				bricks[matches] = b;
+			matches++;
+		}
+	}
+	return matches;
+}
+
+bool ndtf_zoneMaps_getBrick(const NDTF_ZoneMaps* maps, uint64_t brick, uint32_t origin[NDTF_DIMENSIONS_MAX], uint32_t extent[NDTF_DIMENSIONS_MAX])
+{
+	if (!maps || brick >= maps->brickCount)
+		return false;
+
+	ndtf_Bricks bricks;
+	ndtf_bricks_init(&bricks, &maps->header);
+
+	size_t brickOrigin[NDTF_DIMENSIONS_MAX];
+	size_t brickExtent[NDTF_DIMENSIONS_MAX];
+	ndtf_bricks_get(&bricks, (size_t)brick, brickOrigin, brickExtent);
+
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+	{
+		if (origin)
+			origin[i] = (uint32_t)brickOrigin[i];
+		if (extent)
+			extent[i] = (uint32_t)brickExtent[i];
+	}
+	return true;
+}
+
+void ndtf_zoneMaps_free(NDTF_ZoneMaps* maps)
+{
+	const NDTF_Allocator* allocator = maps->allocator ? maps->allocator : ndtf_mem_allocator(NULL);
+
+	ndtf_mem_freeWith(allocator, NULL, maps->ranges);
+
+	memset(maps, 0, sizeof(NDTF_ZoneMaps));
+}
@@ -0,0 +1,1115 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+	#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "ndtf_internal.h"
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+	#include <direct.h>
+#endif
+
+// ndtf command-line tool. batch commands run a pool of file workers, more of them than cores so reads and
+// writes of some files overlap the encoding of others. big files are still split by the library itself
+
+#define NDTF_TOOL_REPORT_INTERVAL 500000000ull // nanoseconds between progress lines
+
+typedef enum ndtf_ToolCommand
+{
+	NDTF_TOOL_INFO,
+	NDTF_TOOL_CONVERT,
+	NDTF_TOOL_RECOMPRESS,
+	NDTF_TOOL_VERIFY,
+	NDTF_TOOL_EXTRACT_SLICE,
+	NDTF_TOOL_BENCH,
+	NDTF_TOOL_COMPACT,
+} ndtf_ToolCommand;
+
+typedef struct ndtf_Tool
+{
+	ndtf_ToolCommand command;
+	const char* output;
+	const char* journal;
+	bool inPlace;
+	bool quiet;
+	size_t jobs;
+	NDTF_TexelFormat format;
+	int codec;			// -1 = keep
+	int level;
+	float minGain;		// 0 = library default
+	NDTF_BlockQuality blockQuality;
+	bool plain;
+	bool bricks;
+	uint32_t brickSize[NDTF_DIMENSIONS_MAX];
+	bool checksums;
+	bool zoneMaps;
+	bool deduplicated;
+	bool planar;
+	bool resize;
+	uint32_t resizeSize[NDTF_DIMENSIONS_MAX];
+	NDTF_ResizeOptions resizeOptions;
+	size_t first, count;
+	size_t iterations;
+} ndtf_Tool;
+
+typedef struct ndtf_ToolInputs
+{
+	char** paths;
+	char** relative;	// output path below the output directory
+	size_t count;
+	size_t capacity;
+	bool fromDirectory;
+} ndtf_ToolInputs;
+
+static const struct
+{
+	const char* name;
+	NDTF_TexelFormat format;
+} ndtf_tool_formats[] =
+{
+	{ "rgba8", NDTF_TEXELFORMAT_RGBA8888 },
+	{ "rgb8", NDTF_TEXELFORMAT_RGB888 },
+	{ "r8", NDTF_TEXELFORMAT_R8 },
+	{ "rgba16", NDTF_TEXELFORMAT_RGBA16161616 },
+	{ "rgb16", NDTF_TEXELFORMAT_RGB161616 },
+	{ "r16", NDTF_TEXELFORMAT_R16 },
+	{ "rgba32f", NDTF_TEXELFORMAT_RGBA32323232F },
+	{ "rgb32f", NDTF_TEXELFORMAT_RGB323232F },
+	{ "r32f", NDTF_TEXELFORMAT_R32F },
+	{ "rgba32", NDTF_TEXELFORMAT_RGBA32323232 },
+	{ "rgb32", NDTF_TEXELFORMAT_RGB323232 },
+	{ "r32", NDTF_TEXELFORMAT_R32 },
+	{ "bc4", NDTF_TEXELFORMAT_BC4 },
+	{ "bc5", NDTF_TEXELFORMAT_BC5 },
+	{ "bc6h", NDTF_TEXELFORMAT_BC6H },
+	{ "bc7", NDTF_TEXELFORMAT_BC7 },
+};
+
+static const char* ndtf_tool_formatName(NDTF_TexelFormat format)
+{
+	for (size_t i = 0; i < sizeof(ndtf_tool_formats) / sizeof(ndtf_tool_formats[0]); i++)
+	{
+		if (ndtf_tool_formats[i].format == format)
+			return ndtf_tool_formats[i].name;
+	}
+	return "none";
+}
+
+static const char* ndtf_tool_codecName(NDTF_Codec codec)
+{
+	const NDTF_CodecInfo* info = ndtf_getCodec(codec);
+	return codec == NDTF_CODEC_NONE ? "none" : info && info->name ? info->name : "unknown";
+}
+
+static int ndtf_tool_parseCodec(const char* name)
+{
+	if (strcmp(name, "none") == 0)
+		return NDTF_CODEC_NONE;
+	for (int codec = NDTF_CODEC_NONE + 1; codec <= NDTF_CODEC_MAX; codec++)
+	{
+		const NDTF_CodecInfo* info = ndtf_getCodec((NDTF_Codec)codec);
+		if (info && info->name && strcmp(info->name, name) == 0)
+			return codec;
+	}
+	return -1;
+}
+
+static void ndtf_tool_usage(void)
+{
+	fprintf(stderr,
+		"usage: ndtf <command> [options] <inputs>\n"
+		"\n"
+		"commands:\n"
+		"  info            print the header of every input\n"
+		"  convert         convert inputs to another texel format and layout\n"
+		"  recompress      re-encode inputs with another codec or level\n"
+		"  verify          check the checksums of every input\n"
+		"  extract-slice   write planes along the outermost axis of one input to a new file\n"
+		"  bench           measure decode and encode throughput of every input\n"
+		"  compact         drop the space of replaced segments from segmented inputs\n"
+		"\n"
+		"inputs are files, directories (scanned for .ndtf files) or @list files with one path per line\n"
+		"\n"
+		"options:\n"
+		"  -o <path>           output file or directory, the directory layout of the inputs is kept\n"
+		"  -i, --in-place      replace the inputs\n"
+		"  -j, --jobs <n>      file workers (default twice the hardware concurrency)\n"
+		"  --journal <file>    record finished inputs, inputs already recorded are skipped on the next run\n"
+		"  -q, --quiet         no progress output\n"
+		"  --format <name>     rgba8 rgb8 r8 rgba16 rgb16 r16 rgba32f rgb32f r32f rgba32 rgb32 r32 bc4 bc5 bc6h bc7\n"
+		"  --quality <name>    block encoder effort: fast normal high (default normal)\n"
+		"  --codec <name>      none zlib deflate lz\n"
+		"  --level <n>         compression level (0 = codec default)\n"
+		"  --min-gain <n>      store bricks raw that shrink by less than n percent (default 5, 0 = always compress)\n"
+		"  --bricks <WxHx..>   segment into bricks of this extent (0 = whole axis)\n"
+		"  --plain             store a single payload instead of segments\n"
+		"  --checksums         add CRC32C checksums\n"
+		"  --zone-maps         add per brick value ranges\n"
+		"  --dedup             share the stored bytes of identical bricks\n"
+		"  --planar            store every channel as its own plane\n"
+		"  --resize <WxHx..>   convert: resample to this extent (0 = keep the axis)\n"
+		"  --filter <name>     nearest linear cubic lanczos (default linear)\n"
+		"  --align-corners     resample grid points onto each other (lookup tables)\n"
+		"  --first <n>         extract-slice: first plane\n"
+		"  --count <n>         extract-slice: number of planes (default 1)\n"
+		"  --iterations <n>    bench: runs per file (default 5)\n");
+}
+
+// inputs
+
+static bool ndtf_tool_isDirectory(const char* path)
+{
+#ifdef _WIN32
+	struct _stat64 st;
+	return _stat64(path, &st) == 0 && (st.st_mode & _S_IFDIR);
+#else
+	struct stat st;
+	return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+}
+
+static char* ndtf_tool_strdup(const char* string, size_t length)
+{
+	char* result = (char*)malloc(length + 1);
+	if (result)
+	{
+		memcpy(result, string, length);
+		result[length] = '\0';
+	}
+	return result;
+}
+
+static char* ndtf_tool_join(const char* directory, const char* path)
+{
+	size_t length = strlen(directory);
+	while (length > 1 && (directory[length - 1] == '/' || directory[length - 1] == '\\'))
+		length--;
+
+	size_t pathLength = strlen(path);
+	char* result = (char*)malloc(length + 1 + pathLength + 1);
+	if (result)
+	{
+		memcpy(result, directory, length);
+		result[length] = '/';
+		memcpy(result + length + 1, path, pathLength + 1);
+	}
+	return result;
+}
+
+// relative paths without parent references keep their place below the output directory, others keep their name
+static const char* ndtf_tool_relative(const char* path)
+{
+	bool rooted = path[0] == '/' || path[0] == '\\' || (path[0] && path[1] == ':');
+	if (!rooted && !strstr(path, ".."))
+	{
+		while (path[0] == '.' && (path[1] == '/' || path[1] == '\\'))
+			path += 2;
+		return path;
+	}
+
+	const char* name = path;
+	for (const char* p = path; *p; p++)
+	{
+		if (*p == '/' || *p == '\\')
+			name = p + 1;
+	}
+	return name;
+}
+
+static bool ndtf_tool_addInput(ndtf_ToolInputs* inputs, char* path, const char* relative)
+{
+	if (!path)
+		return false;
+
+	if (inputs->count == inputs->capacity)
+	{
+		size_t capacity = max(inputs->capacity * 2, 64);
+		char** paths = (char**)realloc(inputs->paths, capacity * sizeof(char*));
+		if (paths)
+			inputs->paths = paths;
+		char** relatives = (char**)realloc(inputs->relative, capacity * sizeof(char*));
+		if (relatives)
+			inputs->relative = relatives;
+		if (!paths || !relatives)
+		{
+			free(path);
+			return false;
+		}
+		inputs->capacity = capacity;
+	}
+
+	char* copy = ndtf_tool_strdup(relative, strlen(relative));
+	if (!copy)
+	{
+		free(path);
+		return false;
+	}
+
+	inputs->paths[inputs->count] = path;
+	inputs->relative[inputs->count] = copy;
+	inputs->count++;
+	return true;
+}
+
+static bool ndtf_tool_addPath(ndtf_ToolInputs* inputs, const char* path)
+{
+	if (!ndtf_tool_isDirectory(path))
+		return ndtf_tool_addInput(inputs, ndtf_tool_strdup(path, strlen(path)), ndtf_tool_relative(path));
+
+	NDTF_Catalog catalog;
+	if (!ndtf_catalog_build(&catalog, path, NULL, NULL))
+	{
+		fprintf(stderr, "ndtf: cannot scan %s\n", path);
+		return false;
+	}
+
+	bool result = true;
+	for (size_t i = 0; i < catalog.count && result; i++)
+		result = ndtf_tool_addInput(inputs, ndtf_tool_join(path, catalog.entries[i].path), catalog.entries[i].path);
+
+	inputs->fromDirectory = true;
+	ndtf_catalog_free(&catalog);
+	return result;
+}
+
+static bool ndtf_tool_addList(ndtf_ToolInputs* inputs, const char* listFilename)
+{
+	FILE* list = fopen(listFilename, "r");
+	if (!list)
+	{
+		fprintf(stderr, "ndtf: cannot open %s\n", listFilename);
+		return false;
+	}
+
+	bool result = true;
+	char line[4096];
+	while (result && fgets(line, sizeof(line), list))
+	{
+		size_t length = strlen(line);
+		while (length && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+			line[--length] = '\0';
+		if (length)
+			result = ndtf_tool_addPath(inputs, line);
+	}
+
+	fclose(list);
+	return result;
+}
+
+static void ndtf_tool_freeInputs(ndtf_ToolInputs* inputs)
+{
+	for (size_t i = 0; i < inputs->count; i++)
+	{
+		free(inputs->paths[i]);
+		free(inputs->relative[i]);
+	}
+	free(inputs->paths);
+	free(inputs->relative);
+	memset(inputs, 0, sizeof(ndtf_ToolInputs));
+}
+
+// outputs
+
+static bool ndtf_tool_makeDirectory(const char* path)
+{
+#ifdef _WIN32
+	return _mkdir(path) == 0 || errno == EEXIST;
+#else
+	return mkdir(path, 0777) == 0 || errno == EEXIST;
+#endif
+}
+
+static bool ndtf_tool_makeParents(const char* path)
+{
+	char* copy = ndtf_tool_strdup(path, strlen(path));
+	if (!copy)
+		return false;
+
+	bool result = true;
+	for (char* p = copy + 1; *p && result; p++)
+	{
+		if (*p != '/' && *p != '\\')
+			continue;
+		char separator = *p;
+		*p = '\0';
+		if (p[-1] != ':')
+			result = ndtf_tool_makeDirectory(copy);
+		*p = separator;
+	}
+
+	free(copy);
+	return result;
+}
+
+static char* ndtf_tool_outputPath(const ndtf_Tool* tool, const ndtf_ToolInputs* inputs, size_t index)
+{
+	if (tool->inPlace)
+		return ndtf_tool_strdup(inputs->paths[index], strlen(inputs->paths[index]));
+
+	// a single input file goes to the output itself unless that is a directory
+	if (inputs->count == 1 && !inputs->fromDirectory && !ndtf_tool_isDirectory(tool->output))
+		return ndtf_tool_strdup(tool->output, strlen(tool->output));
+
+	return ndtf_tool_join(tool->output, inputs->relative[index]);
+}
+
+// writes into a temporary file next to the output and moves it in place once complete, so an interrupted
+// run never leaves a truncated output behind
+static bool ndtf_tool_save(NDTF_File* file, const char* output, const NDTF_Context* ctx, uint64_t* bytesWritten)
+{
+	size_t length = strlen(output);
+	char* temporary = (char*)malloc(length + 5);
+	if (!temporary)
+		return false;
+	memcpy(temporary, output, length);
+	memcpy(temporary + length, ".tmp", 5);
+
+	bool result = ndtf_tool_makeParents(output);
+	FILE* handle = result ? fopen(temporary, "wb") : NULL;
+	if (handle)
+	{
+		result = ndtf_file_saveToFile_ex(file, handle, ctx);
+		int64_t size = ndtf_ftell64(handle);
+		result = fclose(handle) == 0 && result && size >= 0;
+		if (result)
+			*bytesWritten = (uint64_t)size;
+
+#ifdef _WIN32
+		if (result)
+			remove(output);
+#endif
+		result = result && rename(temporary, output) == 0;
+		if (!result)
+			remove(temporary);
+	}
+	else
+		result = false;
+
+	free(temporary);
+	return result;
+}
+
+static void ndtf_tool_apply(const ndtf_Tool* tool, NDTF_File* file)
+{
+	if (tool->codec >= 0)
+		ndtf_file_setCodec(file, (NDTF_Codec)tool->codec);
+	if (tool->plain)
+		ndtf_file_setSegmented(file, false);
+	if (tool->bricks)
+		ndtf_file_setBrickSize(file, tool->brickSize);
+	if (tool->checksums)
+		ndtf_file_setChecksums(file, true);
+	if (tool->zoneMaps)
+		ndtf_file_setZoneMaps(file, true);
+	if (tool->deduplicated)
+		ndtf_file_setDeduplicated(file, true);
+	if (tool->planar)
+		ndtf_file_setPlanar(file, true);
+}
+
+static NDTF_File ndtf_tool_load(const char* path, NDTF_TexelFormat format, const NDTF_Context* ctx, uint64_t* bytesRead)
+{
+	NDTF_File result;
+	memset(&result, 0, sizeof(NDTF_File));
+
+	FILE* handle = fopen(path, "rb");
+	if (!handle)
+		return result;
+
+	if (ndtf_fseek64(handle, 0, SEEK_END) == 0)
+	{
+		int64_t size = ndtf_ftell64(handle);
+		*bytesRead = size > 0 ? (uint64_t)size : 0;
+	}
+
+	result = ndtf_file_loadFromFile_ex(handle, NULL, format, ctx);
+	fclose(handle);
+
+	// a failed conversion leaves the texels in the stored format
+	if (ndtf_file_isValid(&result) && format != NDTF_TEXELFORMAT_NONE && result.header.texelFormat != format)
+		ndtf_file_free_ex(&result, ctx);
+
+	return result;
+}
+
+// batches
+
+typedef struct ndtf_ToolBatch ndtf_ToolBatch;
+typedef bool (*ndtf_ToolProcessFunc)(ndtf_ToolBatch* batch, size_t index, uint64_t* bytesIn, uint64_t* bytesOut);
+
+struct ndtf_ToolBatch
+{
+	const ndtf_Tool* tool;
+	const ndtf_ToolInputs* inputs;
+	ndtf_ToolProcessFunc process;
+	const bool* skip;
+	volatile uint64_t next;
+	volatile uint64_t done;
+	volatile uint64_t failed;
+	volatile uint64_t bytesIn;
+	volatile uint64_t bytesOut;
+	uint64_t start;
+	uint64_t lastReport;
+	size_t skipped;
+	FILE* journal;
+	ndtf_Mutex mutex;	// output, journal and report time
+};
+
+static void ndtf_tool_report(ndtf_ToolBatch* batch, bool final)
+{
+	uint64_t now = ndtf_timeNanoseconds();
+	if (batch->tool->quiet || (!final && now - batch->lastReport < NDTF_TOOL_REPORT_INTERVAL))
+		return;
+	batch->lastReport = now;
+
+	double seconds = (double)(now - batch->start) * 1e-9;
+	double mbIn = (double)ndtf_atomic_load_u64(&batch->bytesIn) / (1 << 20);
+	double mbOut = (double)ndtf_atomic_load_u64(&batch->bytesOut) / (1 << 20);
+	uint64_t done = ndtf_atomic_load_u64(&batch->done);
+	uint64_t failed = ndtf_atomic_load_u64(&batch->failed);
+
+	fprintf(stderr, "\r%llu/%llu files, %.1f files/s, in %.1f MB/s, out %.1f MB/s, %llu failed%s",
+		(unsigned long long)done, (unsigned long long)(batch->inputs->count - batch->skipped),
+		seconds > 0.0 ? (double)done / seconds : 0.0, seconds > 0.0 ? mbIn / seconds : 0.0, seconds > 0.0 ? mbOut / seconds : 0.0,
+		(unsigned long long)failed, final ? "\n" : "");
+	fflush(stderr);
+}
+
+static void ndtf_tool_worker(void* arg)
+{
+	ndtf_ToolBatch* batch = (ndtf_ToolBatch*)arg;
+	for (;;)
+	{
+		size_t index = (size_t)ndtf_atomic_add_u64(&batch->next, 1);
+		if (index >= batch->inputs->count)
+			break;
+		if (batch->skip && batch->skip[index])
+			continue;
+
+		uint64_t bytesIn = 0;
+		uint64_t bytesOut = 0;
+		bool processed = batch->process(batch, index, &bytesIn, &bytesOut);
+
+		ndtf_atomic_add_u64(&batch->bytesIn, bytesIn);
+		ndtf_atomic_add_u64(&batch->bytesOut, bytesOut);
+		ndtf_atomic_add_u64(&batch->done, 1);
+		if (!processed)
+			ndtf_atomic_add_u64(&batch->failed, 1);
+
+		ndtf_mutex_lock(&batch->mutex);
+		if (processed && batch->journal)
+		{
+			fprintf(batch->journal, "%s\n", batch->inputs->paths[index]);
+			fflush(batch->journal);
+		}
+		ndtf_tool_report(batch, false);
+		ndtf_mutex_unlock(&batch->mutex);
+	}
+}
+
+static int ndtf_tool_compareStrings(const void* a, const void* b)
+{
+	return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+// inputs recorded in the journal of an earlier run
+static bool* ndtf_tool_readJournal(const char* filename, const ndtf_ToolInputs* inputs, size_t* skipped)
+{
+	*skipped = 0;
+	bool* skip = (bool*)calloc(max(inputs->count, 1), sizeof(bool));
+	FILE* journal = skip ? fopen(filename, "r") : NULL;
+	if (!journal)
+		return skip;
+
+	ndtf_ToolInputs finished;
+	memset(&finished, 0, sizeof(ndtf_ToolInputs));
+
+	char line[4096];
+	while (fgets(line, sizeof(line), journal))
+	{
+		size_t length = strlen(line);
+		// a line cut short by an interruption is not a finished input
+		if (!length || line[length - 1] != '\n')
+			continue;
+		line[--length] = '\0';
+		if (!ndtf_tool_addInput(&finished, ndtf_tool_strdup(line, length), ""))
+			break;
+	}
+	fclose(journal);
+
+	qsort(finished.paths, finished.count, sizeof(char*), ndtf_tool_compareStrings);
+	for (size_t i = 0; i < inputs->count && finished.count; i++)
+	{
+		skip[i] = bsearch(&inputs->paths[i], finished.paths, finished.count, sizeof(char*), ndtf_tool_compareStrings) != NULL;
+		*skipped += skip[i];
+	}
+
+	ndtf_tool_freeInputs(&finished);
+	return skip;
+}
+
+static int ndtf_tool_runBatch(const ndtf_Tool* tool, const ndtf_ToolInputs* inputs, ndtf_ToolProcessFunc process)
+{
+	ndtf_ToolBatch batch;
+	memset(&batch, 0, sizeof(ndtf_ToolBatch));
+	batch.tool = tool;
+	batch.inputs = inputs;
+	batch.process = process;
+
+	bool* skip = NULL;
+	if (tool->journal)
+	{
+		skip = ndtf_tool_readJournal(tool->journal, inputs, &batch.skipped);
+		batch.journal = skip ? fopen(tool->journal, "a") : NULL;
+		if (!batch.journal)
+		{
+			fprintf(stderr, "ndtf: cannot open journal %s\n", tool->journal);
+			free(skip);
+			return 1;
+		}
+		if (batch.skipped && !tool->quiet)
+			fprintf(stderr, "skipping %llu inputs finished earlier\n", (unsigned long long)batch.skipped);
+	}
+	batch.skip = skip;
+
+	ndtf_mutex_init(&batch.mutex);
+	batch.start = ndtf_timeNanoseconds();
+	batch.lastReport = batch.start;
+
+	// the calling thread is one of the workers
+	size_t jobs = min(tool->jobs ? tool->jobs : ndtf_getHardwareConcurrency() * 2, max(inputs->count, 1));
+	ndtf_Thread* threads = (ndtf_Thread*)malloc(jobs * sizeof(ndtf_Thread));
+	size_t started = 0;
+	for (size_t i = 1; threads && i < jobs; i++)
+	{
+		if (!ndtf_thread_create(&threads[started], ndtf_tool_worker, &batch))
+			break;
+		started++;
+	}
+	ndtf_tool_worker(&batch);
+	for (size_t i = 0; i < started; i++)
+		ndtf_thread_join(&threads[i]);
+	free(threads);
+
+	ndtf_tool_report(&batch, true);
+
+	ndtf_mutex_destroy(&batch.mutex);
+	if (batch.journal)
+		fclose(batch.journal);
+	free(skip);
+
+	return batch.failed ? 1 : 0;
+}
+
+static bool ndtf_tool_convertTask(ndtf_ToolBatch* batch, size_t index, uint64_t* bytesIn, uint64_t* bytesOut)
+{
+	const ndtf_Tool* tool = batch->tool;
+	const char* input = batch->inputs->paths[index];
+
+	NDTF_Context ctx;
+	memset(&ctx, 0, sizeof(NDTF_Context));
+	ctx.compressionLevel = tool->level;
+	ctx.minCompressionGain = tool->minGain;
+	ctx.blockQuality = tool->blockQuality;
+
+	// blocks are resampled as their decoded texels and encoded again
+	NDTF_File file = ndtf_tool_load(input, tool->resize ? ndtf_getDecodedTexelFormat(tool->format) : tool->format, &ctx, bytesIn);
+	if (tool->resize && ndtf_file_isValid(&file))
+	{
+		NDTF_TexelFormat format = tool->format != NDTF_TEXELFORMAT_NONE ? tool->format : (NDTF_TexelFormat)file.header.texelFormat;
+		ndtf_file_reformat_ex(&file, ndtf_getDecodedTexelFormat(format), &ctx);
+		NDTF_File resized = ndtf_file_resize(&file, tool->resizeSize, &tool->resizeOptions, &ctx);
+		ndtf_file_free_ex(&file, &ctx);
+		file = resized;
+
+		ndtf_file_reformat_ex(&file, format, &ctx);
+		if (ndtf_file_isValid(&file) && file.header.texelFormat != format)
+			ndtf_file_free_ex(&file, &ctx);
+	}
+
+	bool result = ndtf_file_isValid(&file);
+	if (result)
+	{
+		ndtf_tool_apply(tool, &file);
+
+		char* output = ndtf_tool_outputPath(tool, batch->inputs, index);
+		result = output && ndtf_tool_save(&file, output, &ctx, bytesOut);
+		free(output);
+	}
+	ndtf_file_free_ex(&file, &ctx);
+
+	if (!result)
+	{
+		ndtf_mutex_lock(&batch->mutex);
+		fprintf(stderr, "%sndtf: failed to convert %s\n", tool->quiet ? "" : "\r", input);
+		ndtf_mutex_unlock(&batch->mutex);
+	}
+	return result;
+}
+
+static const char* ndtf_tool_verifyResultName(NDTF_VerifyResult result)
+{
+	switch (result)
+	{
+	case NDTF_VERIFY_OK: return "ok";
+	case NDTF_VERIFY_NO_CHECKSUMS: return "no checksums";
+	case NDTF_VERIFY_IO_ERROR: return "io error";
+	case NDTF_VERIFY_BAD_HEADER: return "bad header";
+	case NDTF_VERIFY_BAD_SEGMENT_TABLE: return "bad segment table";
+	case NDTF_VERIFY_BAD_SEGMENT: return "bad segment";
+	default: return "unknown";
+	}
+}
+
+static bool ndtf_tool_verifyTask(ndtf_ToolBatch* batch, size_t index, uint64_t* bytesIn, uint64_t* bytesOut)
+{
+	const char* input = batch->inputs->paths[index];
+	(void)bytesOut;
+
+	NDTF_VerifyResult result = NDTF_VERIFY_IO_ERROR;
+	FILE* handle = fopen(input, "rb");
+	if (handle)
+	{
+		if (ndtf_fseek64(handle, 0, SEEK_END) == 0)
+		{
+			int64_t size = ndtf_ftell64(handle);
+			*bytesIn = size > 0 ? (uint64_t)size : 0;
+		}
+		result = ndtf_verifyFile(handle, NULL);
+		fclose(handle);
+	}
+
+	if (result != NDTF_VERIFY_OK && result != NDTF_VERIFY_NO_CHECKSUMS)
+	{
+		ndtf_mutex_lock(&batch->mutex);
+		printf("%s: %s\n", input, ndtf_tool_verifyResultName(result));
+		fflush(stdout);
+		ndtf_mutex_unlock(&batch->mutex);
+		return false;
+	}
+	return true;
+}
+
+static bool ndtf_tool_compactTask(ndtf_ToolBatch* batch, size_t index, uint64_t* bytesIn, uint64_t* bytesOut)
+{
+	const char* input = batch->inputs->paths[index];
+	(void)bytesIn;
+	(void)bytesOut;
+
+	if (!ndtf_compact(input, NULL, NULL))
+	{
+		ndtf_mutex_lock(&batch->mutex);
+		printf("%s: cannot compact\n", input);
+		fflush(stdout);
+		ndtf_mutex_unlock(&batch->mutex);
+		return false;
+	}
+	return true;
+}
+
+// single file commands
+
+static void ndtf_tool_printSize(const char* label, uint64_t bytes)
+{
+	if (bytes >= ((uint64_t)1 << 30))
+		printf("%s%.2f GiB", label, (double)bytes / (1 << 30));
+	else if (bytes >= ((uint64_t)1 << 20))
+		printf("%s%.2f MiB", label, (double)bytes / (1 << 20));
+	else
+		printf("%s%llu bytes", label, (unsigned long long)bytes);
+}
+
+static bool ndtf_tool_info(const char* path)
+{
+	FILE* handle = fopen(path, "rb");
+	NDTF_File file;
+	memset(&file, 0, sizeof(NDTF_File));
+	bool valid = handle && ndtf_probeFile(handle, &file.header);
+
+	uint64_t fileSize = 0;
+	if (handle && ndtf_fseek64(handle, 0, SEEK_END) == 0)
+	{
+		int64_t size = ndtf_ftell64(handle);
+		fileSize = size > 0 ? (uint64_t)size : 0;
+	}
+	if (handle)
+		fclose(handle);
+
+	if (!valid)
+	{
+		printf("%s: not a valid ndtf file\n", path);
+		return false;
+	}
+
+	const NDTF_Header* header = &file.header;
+	printf("%s: v%d.%d, %dD ", path, NDTF_EXTRACT_VERSION_MAJOR(header->version), NDTF_EXTRACT_VERSION_MINOR(header->version), header->dimensions);
+	for (int i = 0; i < header->dimensions; i++)
+		printf(i ? "x%u" : "%u", (unsigned)header->size[i]);
+	printf(" %s", ndtf_tool_formatName((NDTF_TexelFormat)header->texelFormat));
+	ndtf_tool_printSize(", ", fileSize);
+	ndtf_tool_printSize(" stored, ", ndtf_file_getDataSize(&file));
+	printf(" texels\n");
+
+	printf("  codec %s", ndtf_tool_codecName(ndtf_file_getCodec(&file)));
+	if (header->flags.lossy)
+		printf(", lossy");
+	if (ndtf_file_getSegmented(&file))
+	{
+		printf(", %llu bricks of ", (unsigned long long)ndtf_file_getSegmentCount(&file));
+		for (int i = 0; i < header->dimensions; i++)
+			printf(i ? "x%llu" : "%llu", (unsigned long long)ndtf_file_getBrickExtent(&file, i));
+	}
+	if (header->flags.checksums)
+		printf(", checksums");
+	if (header->flags.zoneMaps)
+		printf(", zone maps");
+	if (header->flags.deduplicated)
+		printf(", deduplicated");
+	if (ndtf_file_getPlanar(&file))
+		printf(", planar");
+	if (ndtf_file_getDeltaAxis(&file) >= 0)
+		printf(", delta along axis %d (keyframes every %u)", ndtf_file_getDeltaAxis(&file), (unsigned)header->keyframeInterval);
+	printf("\n");
+	return true;
+}
+
+// planes along the outermost axis. a single compressed payload cannot be streamed, it is loaded whole
+static NDTF_File ndtf_tool_loadPlanes(const char* path, size_t first, size_t count, const NDTF_Context* ctx)
+{
+	NDTF_File result = ndtf_stream_loadPlanes(path, first, count, ctx);
+	if (ndtf_file_isValid(&result))
+		return result;
+
+	NDTF_File file = ndtf_file_load_ex(path, NULL, NDTF_TEXELFORMAT_NONE, ctx);
+	if (!ndtf_file_isValid(&file))
+		return result;
+
+	int axis = file.header.dimensions - 1;
+	while (axis > 0 && file.header.size[axis] <= 1)
+		axis--;
+
+	// rows of blocks cannot be split
+	bool blocks = ndtf_getIsBlockCompressed((NDTF_TexelFormat)file.header.texelFormat);
+	if (count && first < file.header.size[axis] && count <= file.header.size[axis] - first && (!blocks || axis >= 2))
+	{
+		uint32_t size[NDTF_DIMENSIONS_MAX];
+		memcpy(size, file.header.size, sizeof(size));
+		size[axis] = (uint32_t)count;
+
+		size_t planeBytes = ndtf_file_getDataSize(&file) / file.header.size[axis];
+		result = ndtf_file_create_ND_ex((NDTF_Dimensions)file.header.dimensions, (NDTF_TexelFormat)file.header.texelFormat, size, ctx);
+		if (ndtf_file_isValid(&result))
+			memcpy(result.data, file.data + first * planeBytes, count * planeBytes);
+	}
+
+	ndtf_file_free_ex(&file, ctx);
+	return result;
+}
+
+static int ndtf_tool_extractSlice(const ndtf_Tool* tool, const ndtf_ToolInputs* inputs)
+{
+	if (inputs->count != 1 || !tool->output)
+	{
+		fprintf(stderr, "ndtf: extract-slice takes one input and -o\n");
+		return 2;
+	}
+
+	NDTF_Context ctx;
+	memset(&ctx, 0, sizeof(NDTF_Context));
+	ctx.compressionLevel = tool->level;
+	ctx.minCompressionGain = tool->minGain;
+	ctx.blockQuality = tool->blockQuality;
+
+	NDTF_File file = ndtf_tool_loadPlanes(inputs->paths[0], tool->first, tool->count, &ctx);
+	if (!ndtf_file_isValid(&file))
+	{
+		fprintf(stderr, "ndtf: cannot read planes %llu to %llu of %s\n", (unsigned long long)tool->first,
+			(unsigned long long)(tool->first + tool->count), inputs->paths[0]);
+		return 1;
+	}
+
+	if (tool->format != NDTF_TEXELFORMAT_NONE)
+		ndtf_file_reformat_ex(&file, tool->format, &ctx);
+	ndtf_tool_apply(tool, &file);
+
+	uint64_t bytesWritten = 0;
+	bool result = (tool->format == NDTF_TEXELFORMAT_NONE || file.header.texelFormat == tool->format) &&
+		ndtf_tool_save(&file, tool->output, &ctx, &bytesWritten);
+	ndtf_file_free_ex(&file, &ctx);
+
+	if (!result)
+		fprintf(stderr, "ndtf: cannot write %s\n", tool->output);
+	return result ? 0 : 1;
+}
+
+static bool ndtf_tool_bench(const ndtf_Tool* tool, const char* path)
+{
+	FILE* handle = fopen(path, "rb");
+	if (!handle)
+		return false;
+
+	uint8_t* data = NULL;
+	int64_t size = -1;
+	if (ndtf_fseek64(handle, 0, SEEK_END) == 0 && (size = ndtf_ftell64(handle)) > 0 && ndtf_fseek64(handle, 0, SEEK_SET) == 0)
+		data = (uint8_t*)malloc((size_t)size);
+	bool result = data && fread(data, 1, (size_t)size, handle) == (size_t)size;
+	fclose(handle);
+
+	// decode and encode from memory, the file is read once up front
+	uint64_t decodeBest = UINT64_MAX, encodeBest = UINT64_MAX;
+	size_t texelBytes = 0, encodedSize = 0;
+	NDTF_Context ctx;
+	memset(&ctx, 0, sizeof(NDTF_Context));
+	ctx.compressionLevel = tool->level;
+	ctx.minCompressionGain = tool->minGain;
+
+	for (size_t i = 0; i < tool->iterations && result; i++)
+	{
+		uint64_t start = ndtf_timeNanoseconds();
+		NDTF_File file = ndtf_file_loadFromData_ex(data, (size_t)size, NULL, NDTF_TEXELFORMAT_NONE, &ctx);
+		decodeBest = min(decodeBest, ndtf_timeNanoseconds() - start);
+
+		result = ndtf_file_isValid(&file);
+		if (result)
+		{
+			ndtf_tool_apply(tool, &file);
+			texelBytes = ndtf_file_getDataSize(&file);
+
+			start = ndtf_timeNanoseconds();
+			void* encoded = ndtf_file_saveToData_ex(&file, &encodedSize, &ctx);
+			encodeBest = min(encodeBest, ndtf_timeNanoseconds() - start);
+
+			result = encoded != NULL;
+			ndtf_free(encoded);
+		}
+		ndtf_file_free_ex(&file, &ctx);
+	}
+	free(data);
+
+	if (!result)
+	{
+		printf("%s: failed\n", path);
+		return false;
+	}
+
+	double megabytes = (double)texelBytes / (1 << 20);
+	printf("%s: %.2f MiB texels, decode %.1f MB/s, encode %.1f MB/s, ratio %.3f\n", path, megabytes,
+		megabytes / max((double)decodeBest * 1e-9, 1e-9), megabytes / max((double)encodeBest * 1e-9, 1e-9),
+		encodedSize ? (double)texelBytes / (double)encodedSize : 0.0);
+	return true;
+}
+
+// arguments
+
+static bool ndtf_tool_parseSize(const char* text, size_t* value)
+{
+	char* end;
+	unsigned long long parsed = strtoull(text, &end, 10);
+	if (end == text || *end != '\0')
+		return false;
+	*value = (size_t)parsed;
+	return true;
+}
+
+static bool ndtf_tool_parseBricks(const char* text, uint32_t brickSize[NDTF_DIMENSIONS_MAX])
+{
+	memset(brickSize, 0, NDTF_DIMENSIONS_MAX * sizeof(uint32_t));
+	for (int i = 0; i < NDTF_DIMENSIONS_MAX; i++)
+	{
+		char* end;
+		unsigned long value = strtoul(text, &end, 10);
+		if (end == text || value > UINT32_MAX)
+			return false;
+		brickSize[i] = (uint32_t)value;
+		if (*end == '\0')
+			return true;
+		if (*end != 'x')
+			return false;
+		text = end + 1;
+	}
+	return false;
+}
+
+static const char* const ndtf_tool_filters[] = { "nearest", "linear", "cubic", "lanczos" };
+
+static const char* const ndtf_tool_qualities[] = { "default", "fast", "normal", "high" };
+
+static const char* const ndtf_tool_commands[] = { "info", "convert", "recompress", "verify", "extract-slice", "bench", "compact" };
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		ndtf_tool_usage();
+		return 2;
+	}
+
+	ndtf_Tool tool;
+	memset(&tool, 0, sizeof(ndtf_Tool));
+	tool.codec = -1;
+	tool.count = 1;
+	tool.iterations = 5;
+	tool.resizeOptions.filter = NDTF_FILTER_LINEAR;
+
+	size_t commandCount = sizeof(ndtf_tool_commands) / sizeof(ndtf_tool_commands[0]);
+	size_t command = 0;
+	while (command < commandCount && strcmp(argv[1], ndtf_tool_commands[command]) != 0)
+		command++;
+	if (command == commandCount)
+	{
+		ndtf_tool_usage();
+		return 2;
+	}
+	tool.command = (ndtf_ToolCommand)command;
+
+	ndtf_ToolInputs inputs;
+	memset(&inputs, 0, sizeof(ndtf_ToolInputs));
+
+	bool valid = true;
+	for (int i = 2; i < argc && valid; i++)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+		bool takesValue = true;
+
+		if (arg[0] != '-' || arg[1] == '\0')
+		{
+			valid = arg[0] == '@' ? ndtf_tool_addList(&inputs, arg + 1) : ndtf_tool_addPath(&inputs, arg);
+			takesValue = false;
+		}
+		else if (strcmp(arg, "-o") == 0 || strcmp(arg, "--output") == 0)
+			tool.output = value;
+		else if (strcmp(arg, "--journal") == 0)
+			tool.journal = value;
+		else if (strcmp(arg, "-j") == 0 || strcmp(arg, "--jobs") == 0)
+			valid = value && ndtf_tool_parseSize(value, &tool.jobs);
+		else if (strcmp(arg, "--format") == 0)
+		{
+			size_t f = 0;
+			size_t formatCount = sizeof(ndtf_tool_formats) / sizeof(ndtf_tool_formats[0]);
+			while (value && f < formatCount && strcmp(value, ndtf_tool_formats[f].name) != 0)
+				f++;
+			valid = value && f < formatCount;
+			if (valid)
+				tool.format = ndtf_tool_formats[f].format;
+		}
+		else if (strcmp(arg, "--codec") == 0)
+			valid = value && (tool.codec = ndtf_tool_parseCodec(value)) >= 0;
+		else if (strcmp(arg, "--level") == 0)
+		{
+			size_t level = 0;
+			valid = value && ndtf_tool_parseSize(value, &level) && level <= 12;
+			tool.level = (int)level;
+		}
+		else if (strcmp(arg, "--min-gain") == 0)
+		{
+			size_t percent = 0;
+			valid = value && ndtf_tool_parseSize(value, &percent) && percent <= 100;
+			tool.minGain = percent ? (float)percent / 100.0f : -1.0f;
+		}
+		else if (strcmp(arg, "--bricks") == 0)
+			valid = tool.bricks = value && ndtf_tool_parseBricks(value, tool.brickSize);
+		else if (strcmp(arg, "--resize") == 0)
+			valid = tool.resize = value && ndtf_tool_parseBricks(value, tool.resizeSize);
+		else if (strcmp(arg, "--filter") == 0)
+		{
+			size_t f = 0;
+			size_t filterCount = sizeof(ndtf_tool_filters) / sizeof(ndtf_tool_filters[0]);
+			while (value && f < filterCount && strcmp(value, ndtf_tool_filters[f]) != 0)
+				f++;
+			valid = value && f < filterCount;
+			tool.resizeOptions.filter = (NDTF_Filter)f;
+		}
+		else if (strcmp(arg, "--quality") == 0)
+		{
+			size_t q = 0;
+			size_t qualityCount = sizeof(ndtf_tool_qualities) / sizeof(ndtf_tool_qualities[0]);
+			while (value && q < qualityCount && strcmp(value, ndtf_tool_qualities[q]) != 0)
+				q++;
+			valid = value && q < qualityCount;
+			tool.blockQuality = (NDTF_BlockQuality)q;
+		}
+		else if (strcmp(arg, "--first") == 0)
+			valid = value && ndtf_tool_parseSize(value, &tool.first);
+		else if (strcmp(arg, "--count") == 0)
+			valid = value && ndtf_tool_parseSize(value, &tool.count);
+		else if (strcmp(arg, "--iterations") == 0)
+			valid = value && ndtf_tool_parseSize(value, &tool.iterations) && tool.iterations > 0;
+		else
+		{
+			takesValue = false;
+			if (strcmp(arg, "-i") == 0 || strcmp(arg, "--in-place") == 0)
+				tool.inPlace = true;
+			else if (strcmp(arg, "-q") == 0 || strcmp(arg, "--quiet") == 0)
+				tool.quiet = true;
+			else if (strcmp(arg, "--plain") == 0)
+				tool.plain = true;
+			else if (strcmp(arg, "--checksums") == 0)
+				tool.checksums = true;
+			else if (strcmp(arg, "--zone-maps") == 0)
+				tool.zoneMaps = true;
+			else if (strcmp(arg, "--dedup") == 0)
+				tool.deduplicated = true;
+			else if (strcmp(arg, "--planar") == 0)
+				tool.planar = true;
+			else if (strcmp(arg, "--align-corners") == 0)
+				tool.resizeOptions.alignCorners = true;
+			else
+				valid = false;
+		}
+
+		if (!valid)
+			fprintf(stderr, "ndtf: invalid argument %s%s%s\n", arg, takesValue && value ? " " : "", takesValue && value ? value : "");
+		if (takesValue)
+			i++;
+	}
+
+	if (valid && !inputs.count)
+	{
+		fprintf(stderr, "ndtf: no inputs\n");
+		valid = false;
+	}
+	if (valid && (tool.command == NDTF_TOOL_CONVERT || tool.command == NDTF_TOOL_RECOMPRESS) && !tool.inPlace && !tool.output)
+	{
+		fprintf(stderr, "ndtf: %s needs -o or --in-place\n", argv[1]);
+		valid = false;
+	}
+	if (valid && tool.command == NDTF_TOOL_RECOMPRESS && tool.format != NDTF_TEXELFORMAT_NONE)
+	{
+		fprintf(stderr, "ndtf: recompress keeps the texel format, use convert\n");
+		valid = false;
+	}
+
+	int result = valid ? 0 : 2;
+	if (valid)
+	{
+		switch (tool.command)
+		{
+		case NDTF_TOOL_INFO:
+			for (size_t i = 0; i < inputs.count; i++)
+				result |= ndtf_tool_info(inputs.paths[i]) ? 0 : 1;
+			break;
+		case NDTF_TOOL_CONVERT:
+		case NDTF_TOOL_RECOMPRESS:
+			result = ndtf_tool_runBatch(&tool, &inputs, ndtf_tool_convertTask);
+			break;
+		case NDTF_TOOL_VERIFY:
+			result = ndtf_tool_runBatch(&tool, &inputs, ndtf_tool_verifyTask);
+			break;
+		case NDTF_TOOL_COMPACT:
+			result = ndtf_tool_runBatch(&tool, &inputs, ndtf_tool_compactTask);
+			break;
+		case NDTF_TOOL_EXTRACT_SLICE:
+			result = ndtf_tool_extractSlice(&tool, &inputs);
+			break;
+		case NDTF_TOOL_BENCH:
+			for (size_t i = 0; i < inputs.count; i++)
+				result |= ndtf_tool_bench(&tool, inputs.paths[i]) ? 0 : 1;
+			break;
+		}
+	}
+
+	ndtf_tool_freeInputs(&inputs);
+	return result;
+}